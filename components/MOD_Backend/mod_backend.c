@@ -46,6 +46,13 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "mod_backend.h"
+#include "esp_timer.h"
+#ifdef CONFIG_APP_FLIGHT_REC
+#include "mod_flight_rec.h"
+#endif
+#ifdef CONFIG_APP_MQTT_TLS
+#include "mod_backend_tls.h"
+#endif
 
 
 
@@ -62,7 +69,11 @@ typedef struct MOD_BACKEND_HDL_t
 /* Private define ------------------------------------------------------------*/
 #define STR_HELPER(x) #x
 #define STR(x) STR_HELPER(x)
+#ifdef CONFIG_APP_MQTT_TLS
+#define CONFIG_BROKER_URL "mqtts://" CONFIG_APP_MQTT_BROKER_IP_ADR ":" STR(CONFIG_APP_MQTT_BROKER_IP_PORT)
+#else
 #define CONFIG_BROKER_URL "mqtt://" CONFIG_APP_MQTT_BROKER_IP_ADR ":" STR(CONFIG_APP_MQTT_BROKER_IP_PORT)
+#endif
 
 //MQTT topic defines.
 #define MQTT_TOPIC_DEVICE_ID        CONFIG_APP_MQTT_DEVICE_LOCATION "/DeviceID" 
@@ -70,6 +81,29 @@ typedef struct MOD_BACKEND_HDL_t
 #define MQTT_TOPIC_AMBIENT_TEMP_C   CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/AmbientTempCel" 
 #define MQTT_TOPIC_HUMIDITY         CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/Humidity" 
 #define MQTT_TOPIC_LIGHT            CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/Light" 
+#define MQTT_TOPIC_ENERGY           CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/Energy" 
+#define MQTT_TOPIC_DIAGNOSTICS      CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/Diagnostics" 
+#define MQTT_TOPIC_SAMPLES          CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/Samples" 
+#define MQTT_TOPIC_FLIGHT_REC       CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/FlightRec" 
+#define MQTT_TOPIC_REPORT           CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/Report" 
+#define MQTT_TOPIC_STORED           CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/Stored" 
+
+#ifdef CONFIG_APP_MQTT_PERSISTENT_SESSION
+//esp-mqtt sends a PINGREQ after half the keepalive. 2 * n iTWT wake intervals keep them in line with the service periods.
+#define BACKEND_TWT_WAKE_INVL_US    (CONFIG_APP_ITWT_WAKE_INVL_MS * 1000ULL)
+#define BACKEND_KEEPALIVE_S         ((2 * CONFIG_APP_MQTT_KEEPALIVE_TWT_INVL * BACKEND_TWT_WAKE_INVL_US + 500000) / 1000000)
+#if (BACKEND_KEEPALIVE_S < 1) || (BACKEND_KEEPALIVE_S > 65535)
+#error "MQTT keepalive derived from the iTWT wake interval is out of range 1..65535 sec"
+#endif
+#endif
+
+#if defined(CONFIG_APP_MQTT_REPORT_CBOR)
+#define BACKEND_REPORT_ENCODING     BACKEND_REPORT_ENC_CBOR
+#elif defined(CONFIG_APP_MQTT_REPORT_JSON)
+#define BACKEND_REPORT_ENCODING     BACKEND_REPORT_ENC_JSON
+#else
+#define BACKEND_REPORT_ENCODING     BACKEND_REPORT_ENC_CSV
+#endif
 
 
 /* Private macro -------------------------------------------------------------*/
@@ -82,17 +116,26 @@ static const char *TAG_BAC = "mod_backend";
 /* Private variables ---------------------------------------------------------*/
 MOD_BACKEND_HDL_t mod_backend;
 
+static BACKEND_TRACKER_t Tracker;                                   //!< Messages in flight. Written by the main and the MQTT task
+static portMUX_TYPE TrackerLock = portMUX_INITIALIZER_UNLOCKED;
+
 esp_mqtt_client_config_t mqtt_cfg =
 {
     .broker.address.uri                  = CONFIG_BROKER_URL,
     .credentials.username                = CONFIG_APP_MQTT_BROKER_USER_NAME,
     .credentials.client_id               = CONFIG_APP_MQTT_DEVICE_ID,        
     .credentials.authentication.password = CONFIG_APP_MQTT_BROKER_USER_PW,
+#ifdef CONFIG_APP_MQTT_PERSISTENT_SESSION
+    .session.disable_clean_session       = true,
+    .session.keepalive                   = BACKEND_KEEPALIVE_S,
+#endif
 };
 
 /* Private function prototypes -----------------------------------------------*/
 static void log_error_if_nonzero(const char *message, int error_code);
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static int Backend_Publish(const char *pTopic, const char *pData, int s32_Len, int s32_QoS);
+static void Backend_AllMsgsAcked(void);
 
 
 /* Exported functions --------------------------------------------------------*/
@@ -101,10 +144,16 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 /// @param  void
 /// @return ESP_OK on success
 /// @note   Call this function before calling any other function from this module
+/// @note   nvs_flash_init(..) must have been called before
 esp_err_t Backend_Init(void)
 {
-    //Ensure flash is initialized prior to starting the mqtt client.
-    ESP_ERROR_CHECK(nvs_flash_init());    
+#ifdef CONFIG_APP_MQTT_TLS
+    //Own transport instead of the esp-mqtt SSL transport. Keeps the TLS session for a resumed handshake after deep sleep.
+    mqtt_cfg.network.transport = backend_tls_Init( );
+
+    if( mqtt_cfg.network.transport == NULL )
+        return ESP_FAIL;
+#endif
 
     mod_backend.MQTT_client_hdl = esp_mqtt_client_init(&mqtt_cfg);
 
@@ -117,6 +166,10 @@ esp_err_t Backend_Init(void)
 
     if( mod_backend.MQTT_client_hdl == NULL )      
         return ESP_FAIL;
+
+#ifdef CONFIG_APP_MQTT_PERSISTENT_SESSION
+    ESP_LOGI(TAG_BAC, "Persistent session, keepalive %d sec", (int)(BACKEND_KEEPALIVE_S));
+#endif
     
     return ESP_OK;
 }
@@ -140,11 +193,28 @@ esp_err_t Backend_DeInit(void)
 /// @param  void
 /// @return ESP_OK on success
 /// @note   Ensure to call Backend_Init(..) before calling this function
+/// @note   If the client kept running over sleep (CONFIG_APP_MQTT_PERSISTENT_SESSION) BACKEND_CONNECTED_EVENT
+///         is posted right away. While esp-mqtt waits for the next reconnect the reconnect is started now.
 /// @todo:  If this function is called multiple times we get a -1 (FAIL) back. We need to be able to handle mutliple calls without returning an error
 esp_err_t Backend_Connect(void)
 {
     esp_err_t ret = ESP_OK;
 
+#ifdef CONFIG_APP_MQTT_PERSISTENT_SESSION
+    if( mod_backend.b_MQTT_ClientRunning == true )
+    {
+        if( mod_backend.b_MQTT_Connected == true )
+        {
+            ESP_LOGI(TAG_BAC, "Backend_Connect: session still open");
+            EventDispatcher_TryPostEvent(MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST);
+        }
+        else
+            esp_mqtt_client_reconnect(mod_backend.MQTT_client_hdl);     /*Fails if a connect is in progress already*/
+
+        return ESP_OK;
+    }
+#endif
+
     ESP_LOGI(TAG_BAC, "Backend_Connect to Broker URL:%s", CONFIG_BROKER_URL);    
 
     if( mod_backend.b_MQTT_ClientRunning == false)
@@ -192,6 +262,42 @@ void Backend_Disconnect(void)
 }
 
 
+/// @brief Start a publish round. Messages still in flight from a previous round are not waited for anymore.
+/// @note  Call before the first message of a wake cycle is published
+void Backend_PublishBegin(void)
+{
+    portENTER_CRITICAL(&TrackerLock);
+    backend_tracker_Begin(&Tracker);
+    portEXIT_CRITICAL(&TrackerLock);
+}
+
+
+/// @brief End of the publish round. BACKEND_ALL_MSGS_ACKED is posted once all messages published since
+///        Backend_PublishBegin(..) are acked. Right away if none is in flight (e.g. QoS0).
+/// @note  Messages which could not be published are not waited for. See BACKEND_TRACKER_STATS_t::u32_Failed
+void Backend_PublishEnd(void)
+{
+    bool b_Done;
+
+    portENTER_CRITICAL(&TrackerLock);
+    b_Done = backend_tracker_Arm(&Tracker);
+    portEXIT_CRITICAL(&TrackerLock);
+
+    if(b_Done == true)
+        Backend_AllMsgsAcked( );
+}
+
+
+/// @brief            Statistics of the current publish round incl. the ack latencies
+/// @param[out] pStats Copy of the statistics
+void Backend_GetPublishStats(BACKEND_TRACKER_STATS_t *pStats)
+{
+    portENTER_CRITICAL(&TrackerLock);
+    *pStats = Tracker.Stats;
+    portEXIT_CRITICAL(&TrackerLock);
+}
+
+
 /// @brief Send a message to the backend
 /// @param Message See BACKEND_MESSAGE_t for details.
 void Backend_SendMessage(BACKEND_MESSAGE_t* Message)
@@ -201,15 +307,19 @@ void Backend_SendMessage(BACKEND_MESSAGE_t* Message)
     switch(Message->topic)
     {
         case AmbientTempC:                         
-            s32_msg_id = esp_mqtt_client_publish(mod_backend.MQTT_client_hdl, MQTT_TOPIC_AMBIENT_TEMP_C, Message->str_Data, 0, CONFIG_APP_MQTT_QoS, 0);        
+            s32_msg_id = Backend_Publish(MQTT_TOPIC_AMBIENT_TEMP_C, Message->str_Data, 0, CONFIG_APP_MQTT_QoS);        
         break;
 
         case Humidity:
-            s32_msg_id = esp_mqtt_client_publish(mod_backend.MQTT_client_hdl, MQTT_TOPIC_HUMIDITY, Message->str_Data , 0, CONFIG_APP_MQTT_QoS, 0);        
+            s32_msg_id = Backend_Publish(MQTT_TOPIC_HUMIDITY, Message->str_Data , 0, CONFIG_APP_MQTT_QoS);        
         break;
 
         case Light:
-            s32_msg_id = esp_mqtt_client_publish(mod_backend.MQTT_client_hdl, MQTT_TOPIC_LIGHT, Message->str_Data , 0, CONFIG_APP_MQTT_QoS, 0);                                
+            s32_msg_id = Backend_Publish(MQTT_TOPIC_LIGHT, Message->str_Data , 0, CONFIG_APP_MQTT_QoS);                                
+        break;
+
+        case Energy:
+            s32_msg_id = Backend_Publish(MQTT_TOPIC_ENERGY, Message->str_Data , 0, CONFIG_APP_MQTT_QoS);                                
         break;
 
         default:
@@ -225,11 +335,141 @@ void Backend_SendMessage(BACKEND_MESSAGE_t* Message)
         ESP_LOGE(TAG_BAC, "Backend_SendMessage error. Failure"); 
     else
         Message->s32_Msg_ID = s32_msg_id;    
+
+#ifdef CONFIG_APP_FLIGHT_REC
+    if(s32_msg_id < 0)
+        FREC_ERROR(FREC_SRC_BACKEND, s32_msg_id);
+#endif
+}
+
+
+/// @brief          Publish diagnostic data (e.g. profiling records) to the diagnostics topic
+/// @param pData    Data to publish
+/// @param s32_Len  Length of pData. If 0 the length is calculated from the zero terminated string
+/// @return         Msg ID. -1 on failure, -2 if the outbox is full
+/// @note           Diagnostics are sent with QoS 0. Never waited for.
+int Backend_PublishDiagnostics(const char *pData, int s32_Len)
+{
+    int s32_msg_id = Backend_Publish(MQTT_TOPIC_DIAGNOSTICS, pData, s32_Len, 0);
+
+    if(s32_msg_id < 0)
+        ESP_LOGE(TAG_BAC, "Backend_PublishDiagnostics error: %d", s32_msg_id); 
+
+    return s32_msg_id;
+}
+
+
+/// @brief          Publish a batch of stored samples to the samples topic
+/// @param pData    Samples, e.g. formatted by mod_samples_FormatCSV(..)
+/// @param s32_Len  Length of pData. If 0 the length is calculated from the zero terminated string
+/// @return         Msg ID. -1 on failure, -2 if the outbox is full
+/// @note           Sent with CONFIG_APP_MQTT_QoS and tracked like all other messages
+int Backend_PublishSamples(const char *pData, int s32_Len)
+{
+    int s32_msg_id = Backend_Publish(MQTT_TOPIC_SAMPLES, pData, s32_Len, CONFIG_APP_MQTT_QoS);
+
+    if(s32_msg_id < 0)
+        ESP_LOGE(TAG_BAC, "Backend_PublishSamples error: %d", s32_msg_id); 
+
+    return s32_msg_id;
+}
+
+
+/// @brief          Publish reports of the flash queue (binary) to the stored topic
+/// @param pData    CBOR array of the stored reports, decode with tools/codec/codec_decode.py
+/// @param s32_Len  Length of pData
+/// @return         Msg ID. -1 on failure, -2 if the outbox is full
+/// @note           Sent with CONFIG_APP_MQTT_QoS and tracked like all other messages
+int Backend_PublishStored(const uint8_t *pData, int s32_Len)
+{
+    int s32_msg_id = Backend_Publish(MQTT_TOPIC_STORED, (const char*)pData, s32_Len, CONFIG_APP_MQTT_QoS);
+
+    if(s32_msg_id < 0)
+        ESP_LOGE(TAG_BAC, "Backend_PublishStored error: %d", s32_msg_id); 
+
+    return s32_msg_id;
+}
+
+
+/// @brief         Publish all values of a report as one message to the report topic
+/// @param pReport Values of the report. Encoded according to CONFIG_APP_MQTT_REPORT_ENCODING
+/// @return        Msg ID. -1 on failure, -2 if the outbox is full
+/// @note          Sent with CONFIG_APP_MQTT_QoS and tracked like the messages of Backend_SendMessage(..)
+int Backend_PublishReport(const BACKEND_REPORT_t *pReport)
+{
+    char str_Report[BACKEND_REPORT_STR_MAX_LEN];
+    int  s32_Len    = backend_report_Encode(pReport, BACKEND_REPORT_ENCODING, str_Report, sizeof(str_Report));
+    int  s32_msg_id = -1;
+
+    if(s32_Len > 0)
+        s32_msg_id = Backend_Publish(MQTT_TOPIC_REPORT, str_Report, s32_Len, CONFIG_APP_MQTT_QoS);
+
+    if(s32_msg_id < 0)
+    {
+        ESP_LOGE(TAG_BAC, "Backend_PublishReport error: %d", s32_msg_id); 
+#ifdef CONFIG_APP_FLIGHT_REC
+        FREC_ERROR(FREC_SRC_BACKEND, s32_msg_id);
+#endif
+    }
+
+    return s32_msg_id;
+}
+
+
+/// @brief          Publish a flight recorder export (binary) to the flight recorder topic
+/// @param pData    Export of mod_frec_Export(..)
+/// @param s32_Len  Length of pData
+/// @return         Msg ID. -1 on failure, -2 if the outbox is full
+/// @note           Sent with QoS 0 like the diagnostics
+int Backend_PublishFlightRec(const uint8_t *pData, int s32_Len)
+{
+    int s32_msg_id = Backend_Publish(MQTT_TOPIC_FLIGHT_REC, (const char*)pData, s32_Len, 0);
+
+    if(s32_msg_id < 0)
+        ESP_LOGE(TAG_BAC, "Backend_PublishFlightRec error: %d", s32_msg_id); 
+
+    return s32_msg_id;
 }
 
 
 /* Private functions ---------------------------------------------------------*/
 
+/// @brief          Publish a message and add it to the publish tracker
+/// @param pTopic   MQTT topic
+/// @param pData    Data to publish
+/// @param s32_Len  Length of pData. If 0 the length is calculated from the zero terminated string
+/// @param s32_QoS  MQTT QoS
+/// @return         Msg ID. -1 on failure, -2 if the outbox is full
+static int Backend_Publish(const char *pTopic, const char *pData, int s32_Len, int s32_QoS)
+{
+    int64_t s64_Publish_us = esp_timer_get_time( );
+    int s32_msg_id = esp_mqtt_client_publish(mod_backend.MQTT_client_hdl, pTopic, pData, s32_Len, s32_QoS, 0);
+    bool b_Done;
+
+    /*Not locked during the publish call. The MQTT task holds the client lock while calling mqtt_event_handler(..)*/
+    portENTER_CRITICAL(&TrackerLock);
+    b_Done = backend_tracker_Published(&Tracker, s32_msg_id, s32_QoS, s64_Publish_us);
+    portEXIT_CRITICAL(&TrackerLock);
+
+    if(b_Done == true)
+        Backend_AllMsgsAcked( );
+
+    return s32_msg_id;
+}
+
+
+/// @brief Logs the publish statistics and posts BACKEND_ALL_MSGS_ACKED
+static void Backend_AllMsgsAcked(void)
+{
+    BACKEND_TRACKER_STATS_t Stats;
+
+    Backend_GetPublishStats(&Stats);
+    ESP_LOGI(TAG_BAC, "%lu of %lu msgs acked. Ack max: %lums, avg: %lums", Stats.u32_Completed, Stats.u32_Published, Stats.u32_MaxAck_ms, Stats.u32_Acks ? Stats.u32_SumAck_ms / Stats.u32_Acks : 0);
+
+    EventDispatcher_TryPostEvent(MOD_BACKEND_EVENTS, BACKEND_ALL_MSGS_ACKED, NULL, 0, EVENT_DISP_DROP_OLDEST);
+}
+
+
 /// @brief            If the error is not ESP_OK the message will be logged
 /// @param message    message to write in output log
 /// @param error_code Errro code
@@ -262,14 +502,14 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         case MQTT_EVENT_CONNECTED:
             mod_backend.b_MQTT_Connected = true;
             ESP_LOGI(TAG_BAC, "MQTT_EVENT_CONNECTED");
-            EventDispatcher_PostEvent(MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT, NULL, 0, portMAX_DELAY);            
+            EventDispatcher_TryPostEvent(MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST);            
             break;
 
         case MQTT_EVENT_DISCONNECTED:
             mod_backend.b_MQTT_Connected = false;
             ESP_LOGI(TAG_BAC, "MQTT_EVENT_DISCONNECTED");
 
-            EventDispatcher_PostEvent(MOD_BACKEND_EVENTS, BACKEND_DISCONNECTED_EVENT, NULL, 0, portMAX_DELAY);              
+            EventDispatcher_TryPostEvent(MOD_BACKEND_EVENTS, BACKEND_DISCONNECTED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST);              
 
             /*If we lost the connection(not on purpose) try to reconnect*/
             if(mod_backend.b_MQTT_Reconnect == true)
@@ -280,7 +520,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
                 /* Note: esp_mqtt_client_stop(client)) will not work here because the mqtt client cannot be stopped from the the MQTT task itself!
                          Call Backend_Stop() to stop the client connection. */
                 if( ESP_err != ESP_OK )
-                    EventDispatcher_PostEvent(MOD_BACKEND_EVENTS, BACKEND_CONNECT_FAILED_EVENT, NULL, 0, portMAX_DELAY);              
+                    EventDispatcher_TryPostEvent(MOD_BACKEND_EVENTS, BACKEND_CONNECT_FAILED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST);              
             }   
             break;
     
@@ -293,8 +533,19 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
             break;
 
         case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(TAG_BAC, "MQTT_EVENT_PUBLISHED, msg_id=%d, size:%u", event->msg_id, sizeof(event->msg_id));
-            EventDispatcher_PostEvent(MOD_BACKEND_EVENTS, BACKEND_SEND_MESSAGE_DONE, (const void*)(&event->msg_id), sizeof(event->msg_id), portMAX_DELAY);  
+        {
+            int64_t s64_Now_us = esp_timer_get_time( );
+            bool b_Done;
+
+            portENTER_CRITICAL(&TrackerLock);
+            b_Done = backend_tracker_Acked(&Tracker, event->msg_id, s64_Now_us);
+            portEXIT_CRITICAL(&TrackerLock);
+
+            ESP_LOGD(TAG_BAC, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+
+            if(b_Done == true)
+                Backend_AllMsgsAcked( );
+        }
             break;
 
         case MQTT_EVENT_DATA:
@@ -305,6 +556,9 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 
         case MQTT_EVENT_ERROR:
             ESP_LOGI(TAG_BAC, "MQTT_EVENT_ERROR");
+#ifdef CONFIG_APP_FLIGHT_REC
+            FREC_ERROR(FREC_SRC_BACKEND, event->error_handle->error_type);
+#endif
             if (event->error_handle->error_type == MQTT_ERROR_TYPE_TCP_TRANSPORT) {
                 log_error_if_nonzero("reported from esp-tls", event->error_handle->esp_tls_last_esp_err);
                 log_error_if_nonzero("reported from tls stack", event->error_handle->esp_tls_stack_err);
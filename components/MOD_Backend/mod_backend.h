@@ -58,6 +58,8 @@
 #include "esp_event.h"
 #include "mod_eventDispatcher.h"
 #include "app_events.h"
+#include "mod_backend_tracker.h"
+#include "mod_backend_report.h"
 
 
 /* Exported types ------------------------------------------------------------*/
@@ -66,13 +68,14 @@ typedef enum
     AmbientTempC,                /* Ambient temperature in Celsius */
     Humidity,                    /* Humidity in ???                */
     Light,                       /* Ambient Light value in ??      */   
+    Energy,                      /* Estimated charge "<since last report uAh>,<total uAh>" */
 
 }BACKEND_TOPICS_ENUM_t;
 
 typedef struct BACKEND_MESSAGE_t
 {
     BACKEND_TOPICS_ENUM_t topic;
-    char str_Data[10];  	         /*The maximum size depends on the max data length across all topics.*/  
+    char str_Data[24];  	         /*The maximum size depends on the max data length across all topics.*/  
     int s32_Msg_ID;
 
 }BACKEND_MESSAGE_t;
@@ -89,7 +92,15 @@ esp_err_t Backend_Init(void);
 esp_err_t Backend_DeInit(void);
 esp_err_t Backend_Connect(void);
 void Backend_Disconnect(void);
+void Backend_PublishBegin(void);
+void Backend_PublishEnd(void);
+void Backend_GetPublishStats(BACKEND_TRACKER_STATS_t *pStats);
 void Backend_SendMessage(BACKEND_MESSAGE_t* Message);
+int Backend_PublishDiagnostics(const char *pData, int s32_Len);
+int Backend_PublishFlightRec(const uint8_t *pData, int s32_Len);
+int Backend_PublishSamples(const char *pData, int s32_Len);
+int Backend_PublishStored(const uint8_t *pData, int s32_Len);
+int Backend_PublishReport(const BACKEND_REPORT_t *pReport);
 
 
 /* Initialization and de-initialization functions *****************************/
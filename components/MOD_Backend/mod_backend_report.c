@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    mod_backend_report.c
+  * @author  The Embedded Dude
+  * @brief   Report encoder.
+  *          Encodes all values of one report into a single MQTT payload
+  *          instead of one message per value. Text or binary (MOD_Codec).
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    See mod_backend_report.h
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT) 
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  * 
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  * 
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "mod_backend_report.h"
+#include "mod_codec.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+
+
+/* Private macro -------------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private function prototypes -----------------------------------------------*/
+static int backend_report_Append(char *pBuffer, size_t BufferSize, int s32_Len, int s32_Ret);
+static int backend_report_EncodeCBOR(const BACKEND_REPORT_t *pReport, char *pBuffer, size_t BufferSize);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief            Encodes the values of a report into one payload
+/// @param pReport    Values of the report
+/// @param Encoding   See BACKEND_REPORT_ENC_t
+/// @param pBuffer    Destination. Should hold BACKEND_REPORT_STR_MAX_LEN chars
+/// @param BufferSize Size of pBuffer
+/// @return           Length of the payload without the terminating 0 of the text encodings. -1 if it does not fit or on invalid arguments
+int backend_report_Encode(const BACKEND_REPORT_t *pReport, BACKEND_REPORT_ENC_t Encoding, char *pBuffer, size_t BufferSize)
+{
+    int s32_Len = 0;
+
+    if(pReport == NULL || pBuffer == NULL || BufferSize == 0)
+        return -1;
+
+    switch(Encoding)
+    {
+        case BACKEND_REPORT_ENC_CSV:
+            s32_Len = backend_report_Append(pBuffer, BufferSize, s32_Len, snprintf(pBuffer, BufferSize, "%.2f,%.2f,%.2f,%.1f,%.0f", 
+                                            pReport->f_Temp_C, pReport->f_Humi_PCT, pReport->f_Light_Lux, pReport->f_Report_uAh, pReport->f_Total_uAh));
+
+            if((s32_Len >= 0) && (pReport->u8_Fields & BACKEND_REPORT_HAS_RSSI))
+                s32_Len = backend_report_Append(pBuffer, BufferSize, s32_Len, snprintf(&pBuffer[s32_Len], BufferSize - s32_Len, ",%d", pReport->s8_RSSI_dBm));
+        break;
+
+        case BACKEND_REPORT_ENC_JSON:
+            s32_Len = backend_report_Append(pBuffer, BufferSize, s32_Len, snprintf(pBuffer, BufferSize, "{\"t\":%.2f,\"h\":%.2f,\"lux\":%.2f,\"uAh\":%.1f,\"uAh_total\":%.0f", 
+                                            pReport->f_Temp_C, pReport->f_Humi_PCT, pReport->f_Light_Lux, pReport->f_Report_uAh, pReport->f_Total_uAh));
+
+            if((s32_Len >= 0) && (pReport->u8_Fields & BACKEND_REPORT_HAS_RSSI))
+                s32_Len = backend_report_Append(pBuffer, BufferSize, s32_Len, snprintf(&pBuffer[s32_Len], BufferSize - s32_Len, ",\"rssi\":%d", pReport->s8_RSSI_dBm));
+
+            if(s32_Len >= 0)
+                s32_Len = backend_report_Append(pBuffer, BufferSize, s32_Len, snprintf(&pBuffer[s32_Len], BufferSize - s32_Len, "}"));
+        break;
+
+        case BACKEND_REPORT_ENC_CBOR:
+            s32_Len = backend_report_EncodeCBOR(pReport, pBuffer, BufferSize);
+        break;
+
+        default:
+            return -1;
+    }
+
+    return s32_Len;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief            Adds the return value of snprintf(..) to the payload length
+/// @param pBuffer    Destination of snprintf(..)
+/// @param BufferSize Size of pBuffer
+/// @param s32_Len    Payload length before the snprintf(..) call
+/// @param s32_Ret    Return value of the snprintf(..) call
+/// @return           New payload length. -1 if the output was truncated
+static int backend_report_Append(char *pBuffer, size_t BufferSize, int s32_Len, int s32_Ret)
+{
+    if((s32_Ret < 0) || ((size_t)(s32_Len + s32_Ret) >= BufferSize))
+    {
+        pBuffer[0] = '\0';
+        return -1;
+    }
+
+    return s32_Len + s32_Ret;
+}
+
+
+/// @brief            Encodes the report as CBOR map, see CODEC_SCHEMA
+/// @param pReport    Values of the report
+/// @param pBuffer    Destination
+/// @param BufferSize Size of pBuffer
+/// @return           Length of the payload. -1 if it does not fit
+static int backend_report_EncodeCBOR(const BACKEND_REPORT_t *pReport, char *pBuffer, size_t BufferSize)
+{
+    CODEC_WRITER_t Writer;
+    bool b_RSSI = (pReport->u8_Fields & BACKEND_REPORT_HAS_RSSI) != 0;
+
+    codec_Init(&Writer, (uint8_t*)(pBuffer), BufferSize);
+    codec_MapBegin(&Writer, b_RSSI ? 6 : 5);
+    codec_PutValue(&Writer, CODEC_KEY_TEMP_C,     pReport->f_Temp_C);
+    codec_PutValue(&Writer, CODEC_KEY_HUMI_PCT,   pReport->f_Humi_PCT);
+    codec_PutValue(&Writer, CODEC_KEY_LIGHT_LUX,  pReport->f_Light_Lux);
+    codec_PutValue(&Writer, CODEC_KEY_REPORT_UAH, pReport->f_Report_uAh);
+    codec_PutValue(&Writer, CODEC_KEY_TOTAL_UAH,  pReport->f_Total_uAh);
+
+    if(b_RSSI)
+        codec_PutValue(&Writer, CODEC_KEY_RSSI_DBM, (float)(pReport->s8_RSSI_dBm));
+
+    return codec_Len(&Writer);
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file    mod_backend_report.h
+  * @author  The Embedded Dude
+  * @brief   Report encoder.
+  *          Encodes all values of one report into a single MQTT payload
+  *          instead of one message per value. Text or binary (MOD_Codec).
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The encoder has no dependencies to ESP-IDF or FreeRTOS.
+    2. Fill a BACKEND_REPORT_t. Optional values are only encoded if their
+       BACKEND_REPORT_HAS_* flag is set in u8_Fields.
+    3. backend_report_Encode(..) writes the payload in the requested encoding:
+       BACKEND_REPORT_ENC_CSV:  "21.50,45.20,123.40,12.3,456,-58"
+                                temp_C,humi_pct,lux,report_uAh,total_uAh[,rssi_dBm]
+       BACKEND_REPORT_ENC_JSON: {"t":21.50,"h":45.20,"lux":123.40,"uAh":12.3,"uAh_total":456,"rssi":-58}
+       BACKEND_REPORT_ENC_CBOR: CBOR map of mod_codec.h, 23 bytes for the values above.
+                                Not 0 terminated. Decode with tools/codec/codec_decode.py
+    4. The buffer should hold BACKEND_REPORT_STR_MAX_LEN chars.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT) 
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  * 
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  * 
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_BACKEND_REPORT_H_
+#define COMPONENTS_MODULE_BACKEND_REPORT_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Exported constants --------------------------------------------------------*/
+#define BACKEND_REPORT_STR_MAX_LEN  112         //!< Longest payload incl. the terminating 0
+
+#define BACKEND_REPORT_HAS_RSSI     0x01        //!< s8_RSSI_dBm is valid
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Payload encodings
+typedef enum
+{
+    BACKEND_REPORT_ENC_CSV = 0,                 //!< Values only, fixed order. Smallest text payload
+    BACKEND_REPORT_ENC_JSON,                    //!< Self-describing
+    BACKEND_REPORT_ENC_CBOR                     //!< Binary, keys and scale factors of CODEC_SCHEMA. Smallest payload, no float formatting
+
+}BACKEND_REPORT_ENC_t;
+
+/// @brief Values of one report
+typedef struct BACKEND_REPORT_t
+{
+    float    f_Temp_C;
+    float    f_Humi_PCT;
+    float    f_Light_Lux;
+    float    f_Report_uAh;                      //!< Estimated charge since the last report
+    float    f_Total_uAh;                       //!< Estimated charge in total
+    int8_t   s8_RSSI_dBm;                       //!< RSSI of the AP. Optional
+    uint8_t  u8_Fields;                         //!< BACKEND_REPORT_HAS_* of the optional values
+
+}BACKEND_REPORT_t;
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+int backend_report_Encode(const BACKEND_REPORT_t *pReport, BACKEND_REPORT_ENC_t Encoding, char *pBuffer, size_t BufferSize);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_MODULE_BACKEND_REPORT_H_ */
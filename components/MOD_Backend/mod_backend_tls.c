@@ -0,0 +1,535 @@
+/**
+  ******************************************************************************
+  * @file    mod_backend_tls.c
+  * @author  The Embedded Dude
+  * @brief   TLS transport for the MQTT client (mqtts).
+  *          esp-tls with the TLS session cached in RTC memory. After a deep
+  *          sleep the session is resumed with an abbreviated handshake instead
+  *          of the certificate verification and ECDHE of a full handshake.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    See mod_backend_tls.h
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/select.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "esp_tls.h"
+#include "esp_idf_version.h"
+#include "mbedtls/ssl.h"
+#include "mod_backend_tls.h"
+
+#ifdef CONFIG_APP_MQTT_TLS
+
+/* Private define ------------------------------------------------------------*/
+#define BACKEND_TLS_RTC_MAGIC       0x534C5442      //!< "BTLS"
+#define BACKEND_TLS_DEFAULT_PORT    8883
+#define BACKEND_TLS_MASTER_LEN      48              //!< TLS 1.2 master secret
+
+//Empty Kconfig string: the common name must match the broker address
+#define BACKEND_TLS_COMMON_NAME     ((sizeof(CONFIG_APP_MQTT_TLS_COMMON_NAME) > 1) ? CONFIG_APP_MQTT_TLS_COMMON_NAME : NULL)
+
+
+/* Private typedef -----------------------------------------------------------*/
+/// @brief Transport context
+typedef struct BACKEND_TLS_t
+{
+    esp_tls_t *pTls;                            //!< Connection. NULL if closed
+    int        s32_Sockfd;                      //!< Socket of pTls. -1 if closed
+
+}BACKEND_TLS_t;
+
+/// @brief Cached session and statistics. Survive deep sleep.
+typedef struct BACKEND_TLS_RTC_t
+{
+    uint32_t u32_Magic;
+    BACKEND_TLS_STATS_t Stats;
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+    uint32_t u32_Len;                           //!< Length of the serialized session. 0 = none
+    uint8_t  au8_Session[CONFIG_APP_MQTT_TLS_SESSION_CACHE_SIZE];
+#endif
+    uint32_t u32_Crc;                           //!< Over all fields above
+
+}BACKEND_TLS_RTC_t;
+
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+//Layout of esp_tls_client_session_t (esp-tls private_include/esp_tls_private.h, IDF v5.2). esp-tls only exports the type.
+//The cached session is loaded into saved_session and handed over with esp_tls_cfg_t::client_session.
+//esp_tls_get_client_session(..) returns a heap copy which does not survive deep sleep, and esp-tls has no API
+//to create a client session from a serialized one. Check the layout before extending the version range.
+#if (ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 2, 0)) || (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0))
+#error "Layout of struct esp_tls_client_session only checked for ESP-IDF v5.2. Check esp_tls_private.h"
+#endif
+#if !defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS) || !defined(CONFIG_ESP_TLS_USING_MBEDTLS)
+#error "CONFIG_APP_MQTT_TLS_SESSION_CACHE needs esp-tls with mbedTLS and CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS"
+#endif
+
+struct esp_tls_client_session
+{
+    mbedtls_ssl_session saved_session;
+};
+#endif
+
+
+/* Private macro -------------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+static const char *TAG_TLS = "mod_backend_tls";
+
+//CA of the broker. Embedded from CONFIG_APP_MQTT_TLS_CA_CERT_PATH by CMakeLists.txt, incl. the terminating 0.
+extern const char ca_pem_start[] asm("_binary_mqtt_broker_ca_pem_start");
+extern const char ca_pem_end[]   asm("_binary_mqtt_broker_ca_pem_end");
+
+
+/* Private variables ---------------------------------------------------------*/
+RTC_DATA_ATTR static BACKEND_TLS_RTC_t TlsRtc;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static int backend_tls_Connect(esp_transport_handle_t t, const char *pHost, int s32_Port, int s32_Timeout_ms);
+static int backend_tls_Read(esp_transport_handle_t t, char *pBuffer, int s32_Len, int s32_Timeout_ms);
+static int backend_tls_Write(esp_transport_handle_t t, const char *pBuffer, int s32_Len, int s32_Timeout_ms);
+static int backend_tls_PollRead(esp_transport_handle_t t, int s32_Timeout_ms);
+static int backend_tls_PollWrite(esp_transport_handle_t t, int s32_Timeout_ms);
+static int backend_tls_Close(esp_transport_handle_t t);
+static int backend_tls_Destroy(esp_transport_handle_t t);
+static int backend_tls_Poll(BACKEND_TLS_t *pCtx, int s32_Timeout_ms, bool b_Write);
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+static bool backend_tls_SaveSession(BACKEND_TLS_t *pCtx, const uint8_t *pu8_OfferedMaster);
+#endif
+static bool backend_tls_HandshakeRejected(esp_tls_t *pTls);
+static void backend_tls_Account(bool b_Offered, bool b_Resumed, uint32_t u32_Time_ms);
+static bool backend_tls_RtcValid(void);
+static void backend_tls_RtcSave(void);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief  Creates the TLS transport
+/// @return Transport for esp_mqtt_client_config_t::network.transport. NULL if out of memory.
+/// @note   The cached session and the statistics are kept after a deep sleep wake up
+esp_transport_handle_t backend_tls_Init(void)
+{
+    esp_transport_handle_t t = esp_transport_init( );
+    BACKEND_TLS_t *pCtx = calloc(1, sizeof(BACKEND_TLS_t));
+
+    if((t == NULL) || (pCtx == NULL))
+    {
+        free(pCtx);
+        if(t != NULL)
+            esp_transport_destroy(t);
+        return NULL;
+    }
+
+    pCtx->s32_Sockfd = -1;
+    esp_transport_set_context_data(t, pCtx);
+    esp_transport_set_func(t, backend_tls_Connect, backend_tls_Read, backend_tls_Write, backend_tls_Close,
+                              backend_tls_PollRead, backend_tls_PollWrite, backend_tls_Destroy);
+    esp_transport_set_default_port(t, BACKEND_TLS_DEFAULT_PORT);
+
+    if(backend_tls_RtcValid( ) == false)
+    {
+        memset(&TlsRtc, 0, sizeof(TlsRtc));
+        TlsRtc.u32_Magic = BACKEND_TLS_RTC_MAGIC;
+        backend_tls_RtcSave( );
+    }
+
+    return t;
+}
+
+
+/// @brief            Copies the handshake statistics
+/// @param[out] pStats Statistics since the last cold boot
+void backend_tls_GetStats(BACKEND_TLS_STATS_t *pStats)
+{
+    *pStats = TlsRtc.Stats;
+}
+
+
+/// @brief Drops the cached session. The next connect does a full handshake.
+void backend_tls_ForgetSession(void)
+{
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+    TlsRtc.u32_Len = 0;
+    backend_tls_RtcSave( );
+#endif
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief                TCP connect and TLS handshake. Offers the cached session.
+/// @param t              Transport
+/// @param pHost          Broker host name or address
+/// @param s32_Port       Broker port
+/// @param s32_Timeout_ms Connect timeout
+/// @return               0 on success, -1 on failure
+/// @note                 Called by the MQTT task
+static int backend_tls_Connect(esp_transport_handle_t t, const char *pHost, int s32_Port, int s32_Timeout_ms)
+{
+    BACKEND_TLS_t *pCtx = esp_transport_get_context_data(t);
+    esp_tls_cfg_t Cfg =
+    {
+        .cacert_buf   = (const unsigned char *)(ca_pem_start),
+        .cacert_bytes = (unsigned int)(ca_pem_end - ca_pem_start),
+        .common_name  = BACKEND_TLS_COMMON_NAME,
+        .timeout_ms   = s32_Timeout_ms,
+    };
+    const uint8_t *pu8_OfferedMaster = NULL;
+    bool b_Resumed = false;
+    int64_t s64_Start_us;
+    uint32_t u32_Time_ms;
+    int ret;
+
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+    struct esp_tls_client_session Session;
+    uint8_t au8_Master[BACKEND_TLS_MASTER_LEN];
+
+    mbedtls_ssl_session_init(&Session.saved_session);
+
+    if((TlsRtc.u32_Len > 0) && (mbedtls_ssl_session_load(&Session.saved_session, TlsRtc.au8_Session, TlsRtc.u32_Len) == 0))
+    {
+        memcpy(au8_Master, Session.saved_session.MBEDTLS_PRIVATE(master), sizeof(au8_Master));
+        pu8_OfferedMaster  = au8_Master;
+        Cfg.client_session = &Session;
+    }
+#endif
+
+    backend_tls_Close(t);
+    pCtx->pTls = esp_tls_init( );
+
+    if(pCtx->pTls == NULL)
+        ret = -1;
+    else
+    {
+        s64_Start_us = esp_timer_get_time( );
+        ret = esp_tls_conn_new_sync(pHost, strlen(pHost), s32_Port, &Cfg, pCtx->pTls);
+        u32_Time_ms = (uint32_t)((esp_timer_get_time( ) - s64_Start_us) / 1000);
+    }
+
+    if(ret == 1)
+    {
+        esp_tls_get_conn_sockfd(pCtx->pTls, &pCtx->s32_Sockfd);
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+        b_Resumed = backend_tls_SaveSession(pCtx, pu8_OfferedMaster);
+#endif
+        backend_tls_Account(pu8_OfferedMaster != NULL, b_Resumed, u32_Time_ms);
+    }
+    else
+    {
+        //A session the broker chokes on would block every connect. The next connect does a full handshake.
+        //DNS, TCP and I/O failures keep the session.
+        bool b_Forget = (pu8_OfferedMaster != NULL) && backend_tls_HandshakeRejected(pCtx->pTls);
+
+        ESP_LOGE(TAG_TLS, "Connect to %s:%d failed%s", pHost, s32_Port, b_Forget ? ". Cached session dropped" : "");
+        TlsRtc.Stats.u32_Failed++;
+        if(b_Forget == true)
+            backend_tls_ForgetSession( );
+        backend_tls_Close(t);
+    }
+
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+    mbedtls_ssl_session_free(&Session.saved_session);      /*Copied into the connection by esp-tls*/
+#endif
+    return (ret == 1) ? 0 : -1;
+}
+
+
+/// @brief                Reads from the TLS connection
+/// @param t              Transport
+/// @param pBuffer        Destination
+/// @param s32_Len        Size of pBuffer
+/// @param s32_Timeout_ms Max. time to wait for data
+/// @return               Bytes read, ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT without data, < 0 on errors
+static int backend_tls_Read(esp_transport_handle_t t, char *pBuffer, int s32_Len, int s32_Timeout_ms)
+{
+    BACKEND_TLS_t *pCtx = esp_transport_get_context_data(t);
+    int ret;
+
+    if(pCtx->pTls == NULL)
+        return -1;
+
+    ret = backend_tls_PollRead(t, s32_Timeout_ms);
+    if(ret <= 0)
+        return (ret == 0) ? ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT : ret;
+
+    ret = esp_tls_conn_read(pCtx->pTls, pBuffer, s32_Len);
+
+    if((ret == ESP_TLS_ERR_SSL_WANT_READ) || (ret == ESP_TLS_ERR_SSL_TIMEOUT))
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+
+    if(ret == 0)
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;     /*Readable but no data: closed by the broker*/
+
+    if(ret < 0)
+        ESP_LOGE(TAG_TLS, "Read failed: -0x%04x", -ret);
+
+    return ret;
+}
+
+
+/// @brief                Writes to the TLS connection
+/// @param t              Transport
+/// @param pBuffer        Data
+/// @param s32_Len        Length of pBuffer
+/// @param s32_Timeout_ms Max. time to wait until the socket is writable
+/// @return               Bytes written, 0 on timeout, < 0 on errors
+static int backend_tls_Write(esp_transport_handle_t t, const char *pBuffer, int s32_Len, int s32_Timeout_ms)
+{
+    BACKEND_TLS_t *pCtx = esp_transport_get_context_data(t);
+    int ret;
+
+    if(pCtx->pTls == NULL)
+        return -1;
+
+    ret = backend_tls_PollWrite(t, s32_Timeout_ms);
+    if(ret <= 0)
+        return ret;
+
+    ret = esp_tls_conn_write(pCtx->pTls, pBuffer, s32_Len);
+
+    if(ret < 0)
+        ESP_LOGE(TAG_TLS, "Write failed: -0x%04x", -ret);
+
+    return ret;
+}
+
+
+/// @brief                Waits until data can be read
+/// @param t              Transport
+/// @param s32_Timeout_ms Max. time to wait. -1 waits forever
+/// @return               > 0 readable, 0 on timeout, < 0 on errors
+static int backend_tls_PollRead(esp_transport_handle_t t, int s32_Timeout_ms)
+{
+    BACKEND_TLS_t *pCtx = esp_transport_get_context_data(t);
+
+    //Decrypted data buffered by mbedtls is not seen by select()
+    if((pCtx->pTls != NULL) && (esp_tls_get_bytes_avail(pCtx->pTls) > 0))
+        return 1;
+
+    return backend_tls_Poll(pCtx, s32_Timeout_ms, false);
+}
+
+
+/// @brief                Waits until data can be written
+/// @param t              Transport
+/// @param s32_Timeout_ms Max. time to wait. -1 waits forever
+/// @return               > 0 writable, 0 on timeout, < 0 on errors
+static int backend_tls_PollWrite(esp_transport_handle_t t, int s32_Timeout_ms)
+{
+    return backend_tls_Poll(esp_transport_get_context_data(t), s32_Timeout_ms, true);
+}
+
+
+/// @brief   Closes the connection. The cached session is kept.
+/// @param t Transport
+/// @return  0
+static int backend_tls_Close(esp_transport_handle_t t)
+{
+    BACKEND_TLS_t *pCtx = esp_transport_get_context_data(t);
+
+    if(pCtx->pTls != NULL)
+    {
+        esp_tls_conn_destroy(pCtx->pTls);
+        pCtx->pTls = NULL;
+    }
+
+    pCtx->s32_Sockfd = -1;
+    return 0;
+}
+
+
+/// @brief   Closes the connection and frees the context. Called by esp_transport_destroy(..)
+/// @param t Transport
+/// @return  0
+static int backend_tls_Destroy(esp_transport_handle_t t)
+{
+    backend_tls_Close(t);
+    free(esp_transport_get_context_data(t));
+    esp_transport_set_context_data(t, NULL);
+    return 0;
+}
+
+
+/// @brief                select() on the socket
+/// @param pCtx           Context
+/// @param s32_Timeout_ms Max. time to wait. -1 waits forever
+/// @param b_Write        true: wait until writable, false: until readable
+/// @return               > 0 ready, 0 on timeout, < 0 on errors
+static int backend_tls_Poll(BACKEND_TLS_t *pCtx, int s32_Timeout_ms, bool b_Write)
+{
+    struct timeval Timeout = { .tv_sec = s32_Timeout_ms / 1000, .tv_usec = (s32_Timeout_ms % 1000) * 1000 };
+    fd_set Fds;
+    fd_set ErrFds;
+    int ret;
+
+    if(pCtx->s32_Sockfd < 0)
+        return -1;
+
+    FD_ZERO(&Fds);
+    FD_ZERO(&ErrFds);
+    FD_SET(pCtx->s32_Sockfd, &Fds);
+    FD_SET(pCtx->s32_Sockfd, &ErrFds);
+
+    ret = select(pCtx->s32_Sockfd + 1, b_Write ? NULL : &Fds, b_Write ? &Fds : NULL, &ErrFds, (s32_Timeout_ms < 0) ? NULL : &Timeout);
+
+    if((ret > 0) && FD_ISSET(pCtx->s32_Sockfd, &ErrFds))
+        return -1;
+
+    return ret;
+}
+
+
+#ifdef CONFIG_APP_MQTT_TLS_SESSION_CACHE
+/// @brief                   Caches the session of the connection in RTC memory
+/// @param pCtx              Context after a successful handshake
+/// @param pu8_OfferedMaster Master secret of the offered session. NULL if none was offered
+/// @return                  true if the broker resumed the offered session
+static bool backend_tls_SaveSession(BACKEND_TLS_t *pCtx, const uint8_t *pu8_OfferedMaster)
+{
+    mbedtls_ssl_session Session;
+    size_t Len = 0;
+    bool b_Resumed = false;
+    int ret;
+
+    mbedtls_ssl_session_init(&Session);
+    ret = mbedtls_ssl_get_session((const mbedtls_ssl_context *)(esp_tls_get_ssl_context(pCtx->pTls)), &Session);
+
+    if(ret == 0)
+    {
+        //A resumed handshake keeps the master secret, a full handshake derives a new one
+        b_Resumed = (pu8_OfferedMaster != NULL) && (memcmp(pu8_OfferedMaster, Session.MBEDTLS_PRIVATE(master), BACKEND_TLS_MASTER_LEN) == 0);
+        ret = mbedtls_ssl_session_save(&Session, TlsRtc.au8_Session, sizeof(TlsRtc.au8_Session), &Len);
+    }
+
+    if(ret != 0)
+    {
+        ESP_LOGW(TAG_TLS, "Session not cached: -0x%04x, %u bytes needed", -ret, (unsigned)(Len));
+        Len = 0;
+    }
+
+    TlsRtc.u32_Len = (uint32_t)(Len);
+    mbedtls_ssl_session_free(&Session);
+    return b_Resumed;
+}
+#endif
+
+
+/// @brief      Checks if the TLS handshake itself failed, e.g. with an alert of the broker
+/// @param pTls esp-tls handle of the failed connect. Not yet destroyed.
+/// @return     true for TLS protocol errors. false for DNS, TCP, timeouts and lost connections.
+static bool backend_tls_HandshakeRejected(esp_tls_t *pTls)
+{
+    esp_tls_error_handle_t pError = NULL;
+    int s32_Code;
+
+    if((pTls == NULL) || (esp_tls_get_error_handle(pTls, &pError) != ESP_OK) || (pError == NULL))
+        return false;
+
+    if(pError->last_error != ESP_ERR_MBEDTLS_SSL_HANDSHAKE_FAILED)
+        return false;
+
+    //esp-tls keeps the mbedtls error negated. Only the SSL module range is a TLS protocol error.
+    s32_Code = -pError->esp_tls_error_code;
+    if((s32_Code > -0x6000) || (s32_Code <= -0x8000))
+        return false;
+
+    return (s32_Code != MBEDTLS_ERR_SSL_TIMEOUT) && (s32_Code != MBEDTLS_ERR_SSL_CONN_EOF) &&
+           (s32_Code != MBEDTLS_ERR_SSL_WANT_READ) && (s32_Code != MBEDTLS_ERR_SSL_WANT_WRITE);
+}
+
+
+/// @brief             Updates and logs the handshake statistics
+/// @param b_Offered   A cached session was offered
+/// @param b_Resumed   The broker resumed it
+/// @param u32_Time_ms TCP connect and handshake time
+static void backend_tls_Account(bool b_Offered, bool b_Resumed, uint32_t u32_Time_ms)
+{
+    BACKEND_TLS_STATS_t *pStats = &TlsRtc.Stats;
+
+    if(b_Resumed)
+    {
+        pStats->u32_Resumed++;
+        pStats->u32_SumResumed_ms += u32_Time_ms;
+    }
+    else
+    {
+        pStats->u32_Full++;
+        pStats->u32_SumFull_ms += u32_Time_ms;
+        if(b_Offered)
+            pStats->u32_Rejected++;
+    }
+
+    pStats->u32_Last_ms   = u32_Time_ms;
+    pStats->b_LastResumed = b_Resumed;
+    backend_tls_RtcSave( );
+
+    ESP_LOGI(TAG_TLS, "Handshake %lu ms, %s. Full: %lu x %lu ms avg, resumed: %lu x %lu ms avg", u32_Time_ms,
+             b_Resumed ? "resumed" : (b_Offered ? "full (session rejected)" : "full"),
+             pStats->u32_Full,    pStats->u32_Full    ? pStats->u32_SumFull_ms    / pStats->u32_Full    : 0,
+             pStats->u32_Resumed, pStats->u32_Resumed ? pStats->u32_SumResumed_ms / pStats->u32_Resumed : 0);
+}
+
+
+/// @brief  Checks the RTC memory copy
+/// @return true after a deep sleep wake up with a valid copy
+static bool backend_tls_RtcValid(void)
+{
+    if(TlsRtc.u32_Magic != BACKEND_TLS_RTC_MAGIC)
+        return false;
+
+    return TlsRtc.u32_Crc == esp_rom_crc32_le(0, (const uint8_t *)(&TlsRtc), offsetof(BACKEND_TLS_RTC_t, u32_Crc));
+}
+
+
+/// @brief Updates the CRC. Call after every change of TlsRtc.
+static void backend_tls_RtcSave(void)
+{
+    TlsRtc.u32_Crc = esp_rom_crc32_le(0, (const uint8_t *)(&TlsRtc), offsetof(BACKEND_TLS_RTC_t, u32_Crc));
+}
+
+#endif /* CONFIG_APP_MQTT_TLS */
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    mod_backend_tls.h
+  * @author  The Embedded Dude
+  * @brief   TLS transport for the MQTT client (mqtts).
+  *          esp-tls with the TLS session cached in RTC memory. After a deep
+  *          sleep the session is resumed with an abbreviated handshake instead
+  *          of the certificate verification and ECDHE of a full handshake.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. backend_tls_Init(..) creates the transport. Hand it over to esp-mqtt
+       with esp_mqtt_client_config_t::network.transport. esp-mqtt destroys it
+       together with the client.
+    2. The broker certificate is verified against the CA embedded from
+       CONFIG_APP_MQTT_TLS_CA_CERT_PATH, its common name must be
+       CONFIG_APP_MQTT_TLS_COMMON_NAME.
+    3. With CONFIG_APP_MQTT_TLS_SESSION_CACHE the session (ticket or session
+       ID) of the last handshake is kept in RTC memory and offered on the next
+       connect. A cold boot, a failed handshake or a session which does not
+       fit into CONFIG_APP_MQTT_TLS_SESSION_CACHE_SIZE starts with a full
+       handshake again.
+    4. Every handshake is timed (TCP connect plus TLS handshake) and logged.
+       backend_tls_GetStats(..) returns the count and the time of full and
+       resumed handshakes since the last cold boot.
+    5. tools/tls_broker/tls_broker.py is a local broker stand-in with session
+       tickets. It creates the test CA and shows per connect if the session
+       was resumed.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_BACKEND_TLS_H_
+#define COMPONENTS_MODULE_BACKEND_TLS_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_transport.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Exported constants --------------------------------------------------------*/
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Handshake statistics since the last cold boot
+typedef struct BACKEND_TLS_STATS_t
+{
+    uint32_t u32_Full;                          //!< Full handshakes. Certificate verification and key exchange
+    uint32_t u32_Resumed;                       //!< Abbreviated handshakes with the cached session
+    uint32_t u32_Rejected;                      //!< Cached session offered but the broker did a full handshake. Included in u32_Full
+    uint32_t u32_Failed;                        //!< Failed connects
+    uint32_t u32_SumFull_ms;                    //!< Sum of the full handshake times
+    uint32_t u32_SumResumed_ms;                 //!< Sum of the resumed handshake times
+    uint32_t u32_Last_ms;                       //!< Time of the last handshake
+    bool     b_LastResumed;                     //!< The last handshake was resumed
+
+}BACKEND_TLS_STATS_t;
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+esp_transport_handle_t backend_tls_Init(void);
+void backend_tls_GetStats(BACKEND_TLS_STATS_t *pStats);
+void backend_tls_ForgetSession(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_MODULE_BACKEND_TLS_H_ */
@@ -0,0 +1,219 @@
+/**
+  ******************************************************************************
+  * @file    mod_backend_tracker.c
+  * @author  The Embedded Dude
+  * @brief   Publish tracker.
+  *          Tracks the MQTT messages in flight, detects when all of them
+  *          are acked and records the ack latency per message.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The tracker has no dependencies to ESP-IDF or FreeRTOS. All functions
+       take the time in µs from the caller. mod_backend serializes the calls
+       from the main task (publish) and the MQTT task (acks).
+    2. Start a publish round with backend_tracker_Begin(..).
+    3. Add every message with backend_tracker_Published(..) after
+       esp_mqtt_client_publish(..) returned. QoS0 messages complete right away.
+    4. Pass the msg ID of every MQTT_EVENT_PUBLISHED to backend_tracker_Acked(..).
+       An ack can arrive before the publish call returned. It is remembered
+       and matched when the message is added.
+    5. Call backend_tracker_Arm(..) after the last message of the round.
+       Exactly one of the calls from then on returns true once no message is
+       in flight anymore.
+    6. The ack latency per message is kept in BACKEND_TRACKER_STATS_t.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT) 
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  * 
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  * 
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "mod_backend_tracker.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+
+
+/* Private macro -------------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void backend_tracker_Complete(BACKEND_TRACKER_t *obj, int64_t s64_Publish_us, int64_t s64_Ack_us);
+static bool backend_tracker_Done(BACKEND_TRACKER_t *obj);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief     Start a new publish round. Forgets all messages in flight and clears the statistics.
+/// @param obj Instance
+void backend_tracker_Begin(BACKEND_TRACKER_t *obj)
+{
+    memset(obj, 0, sizeof(BACKEND_TRACKER_t));
+}
+
+
+/// @brief                Adds a message handed over to the MQTT client
+/// @param obj            Instance
+/// @param s32_Msg_ID     Return value of esp_mqtt_client_publish(..). < 0 on failure
+/// @param s32_QoS        QoS of the message. QoS0 messages complete right away
+/// @param s64_Publish_us Time the publish was started
+/// @return               true if this completed the armed round. Returned once per round.
+bool backend_tracker_Published(BACKEND_TRACKER_t *obj, int s32_Msg_ID, int s32_QoS, int64_t s64_Publish_us)
+{
+    obj->Stats.u32_Published++;
+
+    if(s32_Msg_ID < 0)
+    {
+        obj->Stats.u32_Failed++;
+        return false;
+    }
+
+    if(s32_QoS == 0 || s32_Msg_ID == 0)
+    {
+        obj->Stats.u32_Completed++;
+        return backend_tracker_Done(obj);
+    }
+
+    /*The ack might have been faster than the return of the publish call*/
+    for(int i = 0; i < BACKEND_TRACKER_EARLY; i++)
+    {
+        if(obj->as32_Early_ID[i] == s32_Msg_ID)
+        {
+            obj->as32_Early_ID[i] = 0;
+            backend_tracker_Complete(obj, s64_Publish_us, obj->as64_Early_us[i]);
+            return backend_tracker_Done(obj);
+        }
+    }
+
+    for(int i = 0; i < BACKEND_TRACKER_SIZE; i++)
+    {
+        if(obj->aMsg[i].s32_Msg_ID == 0)
+        {
+            obj->aMsg[i].s32_Msg_ID     = s32_Msg_ID;
+            obj->aMsg[i].s64_Publish_us = s64_Publish_us;
+            obj->Stats.u32_InFlight++;
+            return false;
+        }
+    }
+
+    /*Tracker full. The message is sent anyway but not waited for*/
+    obj->Stats.u32_Failed++;
+    return false;
+}
+
+
+/// @brief            Marks a message as acked (PUBACK/PUBCOMP)
+/// @param obj        Instance
+/// @param s32_Msg_ID Msg ID of the MQTT_EVENT_PUBLISHED event
+/// @param s64_Now_us Current time in µs
+/// @return           true if this completed the armed round. Returned once per round.
+bool backend_tracker_Acked(BACKEND_TRACKER_t *obj, int s32_Msg_ID, int64_t s64_Now_us)
+{
+    if(s32_Msg_ID <= 0)
+        return false;
+
+    for(int i = 0; i < BACKEND_TRACKER_SIZE; i++)
+    {
+        if(obj->aMsg[i].s32_Msg_ID == s32_Msg_ID)
+        {
+            obj->aMsg[i].s32_Msg_ID = 0;
+            obj->Stats.u32_InFlight--;
+            backend_tracker_Complete(obj, obj->aMsg[i].s64_Publish_us, s64_Now_us);
+            return backend_tracker_Done(obj);
+        }
+    }
+
+    /*Unknown msg ID. Either the publish call did not return yet or the msg is from a previous round*/
+    obj->as32_Early_ID[obj->u32_EarlyIdx] = s32_Msg_ID;
+    obj->as64_Early_us[obj->u32_EarlyIdx] = s64_Now_us;
+    obj->u32_EarlyIdx = (obj->u32_EarlyIdx + 1) % BACKEND_TRACKER_EARLY;
+
+    return false;
+}
+
+
+/// @brief     Call once all messages of the round have been published
+/// @param obj Instance
+/// @return    true if all messages are acked already (e.g. QoS0). Otherwise backend_tracker_Acked(..) returns true with the last ack.
+bool backend_tracker_Arm(BACKEND_TRACKER_t *obj)
+{
+    obj->b_Armed = true;
+
+    return backend_tracker_Done(obj);
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief                Accounts an acked QoS > 0 message
+/// @param obj            Instance
+/// @param s64_Publish_us Time the publish was started
+/// @param s64_Ack_us     Time of the ack
+static void backend_tracker_Complete(BACKEND_TRACKER_t *obj, int64_t s64_Publish_us, int64_t s64_Ack_us)
+{
+    uint32_t u32_Ack_ms = (s64_Ack_us > s64_Publish_us) ? (uint32_t)((s64_Ack_us - s64_Publish_us) / 1000) : 0;
+
+    obj->Stats.u32_Completed++;
+    obj->Stats.u32_Acks++;
+    obj->Stats.u32_LastAck_ms  = u32_Ack_ms;
+    obj->Stats.u32_SumAck_ms  += u32_Ack_ms;
+
+    if(u32_Ack_ms > obj->Stats.u32_MaxAck_ms)
+        obj->Stats.u32_MaxAck_ms = u32_Ack_ms;
+}
+
+
+/// @brief     Checks if the armed round is complete. Disarms so the completion is only reported once.
+/// @param obj Instance
+/// @return    true if armed and no message is in flight
+static bool backend_tracker_Done(BACKEND_TRACKER_t *obj)
+{
+    if(obj->b_Armed == false || obj->Stats.u32_InFlight > 0)
+        return false;
+
+    obj->b_Armed = false;
+
+    return true;
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file    mod_backend_tracker.h
+  * @author  The Embedded Dude
+  * @brief   Publish tracker.
+  *          Tracks the MQTT messages in flight, detects when all of them
+  *          are acked and records the ack latency per message.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The tracker has no dependencies to ESP-IDF or FreeRTOS. All functions
+       take the time in µs from the caller. mod_backend serializes the calls
+       from the main task (publish) and the MQTT task (acks).
+    2. Start a publish round with backend_tracker_Begin(..).
+    3. Add every message with backend_tracker_Published(..) after
+       esp_mqtt_client_publish(..) returned. QoS0 messages complete right away.
+    4. Pass the msg ID of every MQTT_EVENT_PUBLISHED to backend_tracker_Acked(..).
+       An ack can arrive before the publish call returned. It is remembered
+       and matched when the message is added.
+    5. Call backend_tracker_Arm(..) after the last message of the round.
+       Exactly one of the calls from then on returns true once no message is
+       in flight anymore.
+    6. The ack latency per message is kept in BACKEND_TRACKER_STATS_t.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT) 
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  * 
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  * 
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_BACKEND_TRACKER_H_
+#define COMPONENTS_MODULE_BACKEND_TRACKER_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Exported constants --------------------------------------------------------*/
+#define BACKEND_TRACKER_SIZE    8               //!< Max. number of messages in flight
+#define BACKEND_TRACKER_EARLY   4               //!< Acks remembered which arrived before the msg was added
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Message in flight
+typedef struct BACKEND_TRACKER_MSG_t
+{
+    int      s32_Msg_ID;                        //!< MQTT msg ID. 0 if the slot is free
+    int64_t  s64_Publish_us;                    //!< Time the publish was started
+
+}BACKEND_TRACKER_MSG_t;
+
+/// @brief Statistics since the last backend_tracker_Begin(..)
+typedef struct BACKEND_TRACKER_STATS_t
+{
+    uint32_t u32_Published;                     //!< Messages handed over to the MQTT client
+    uint32_t u32_Completed;                     //!< Messages acked. QoS0 messages complete when they are enqueued
+    uint32_t u32_Failed;                        //!< Publish failed or the tracker was full. Not waited for
+    uint32_t u32_InFlight;                      //!< Messages waiting for an ack
+    uint32_t u32_Acks;                          //!< Acks of QoS > 0 messages. Base of the latencies below
+    uint32_t u32_LastAck_ms;                    //!< Publish to ack of the last acked message
+    uint32_t u32_MaxAck_ms;                     //!< Longest publish to ack time
+    uint32_t u32_SumAck_ms;                     //!< Sum of all publish to ack times
+
+}BACKEND_TRACKER_STATS_t;
+
+/// @brief Publish tracker instance
+typedef struct BACKEND_TRACKER_t
+{
+    BACKEND_TRACKER_MSG_t aMsg[BACKEND_TRACKER_SIZE];   //!< Messages in flight
+    int      as32_Early_ID[BACKEND_TRACKER_EARLY];      //!< Acks of unknown msg IDs. The ack can overtake the return of the publish call
+    int64_t  as64_Early_us[BACKEND_TRACKER_EARLY];      //!< Time of the early acks
+    uint32_t u32_EarlyIdx;                              //!< Next as32_Early_ID entry to overwrite
+    bool     b_Armed;                                   //!< All messages published. Completion is signalled once
+    BACKEND_TRACKER_STATS_t Stats;                      //!< Statistics
+
+}BACKEND_TRACKER_t;
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+void backend_tracker_Begin(BACKEND_TRACKER_t *obj);
+bool backend_tracker_Published(BACKEND_TRACKER_t *obj, int s32_Msg_ID, int s32_QoS, int64_t s64_Publish_us);
+bool backend_tracker_Acked(BACKEND_TRACKER_t *obj, int s32_Msg_ID, int64_t s64_Now_us);
+bool backend_tracker_Arm(BACKEND_TRACKER_t *obj);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_MODULE_BACKEND_TRACKER_H_ */
@@ -0,0 +1,289 @@
+/**
+  ******************************************************************************
+  * @file    mod_codec.c
+  * @author  The Embedded Dude
+  * @brief   Binary payload codec.
+  *          Encodes the sensor values as CBOR (RFC 8949) with small integer keys
+  *          and fixed-point integer values. Shared by the MQTT report and the
+  *          ESP-NOW frame.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    See mod_codec.h
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include "mod_codec.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+/*CBOR major types, already shifted*/
+#define CODEC_MT_UINT               0x00
+#define CODEC_MT_NINT               0x20
+#define CODEC_MT_ARRAY              0x80
+#define CODEC_MT_MAP                0xA0
+
+#define CODEC_ARRAY_INDEF           0x9F
+#define CODEC_NULL                  0xF6
+#define CODEC_BREAK                 0xFF
+
+
+/* Private macro -------------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+/// @brief Scale factor per key, see CODEC_SCHEMA
+static const uint16_t au16_CodecScale[] =
+{
+#define CODEC_KEY_SCALE(key, id, scale, name)   [id] = scale,
+    CODEC_SCHEMA(CODEC_KEY_SCALE)
+#undef CODEC_KEY_SCALE
+};
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void codec_PutByte(CODEC_WRITER_t *pWriter, uint8_t u8_Byte);
+static void codec_PutHead(CODEC_WRITER_t *pWriter, uint8_t u8_MajorType, uint32_t u32_Arg);
+static void codec_PutScaled(CODEC_WRITER_t *pWriter, float f_Value, uint16_t u16_Scale);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief            Sets up a writer
+/// @param pWriter    Writer
+/// @param pu8_Buffer Destination of the payload
+/// @param Size       Size of pu8_Buffer
+void codec_Init(CODEC_WRITER_t *pWriter, uint8_t *pu8_Buffer, size_t Size)
+{
+    pWriter->pu8_Buffer = pu8_Buffer;
+    pWriter->Size       = (pu8_Buffer != NULL) ? Size : 0;
+    pWriter->Len        = 0;
+    pWriter->b_Overflow = false;
+}
+
+
+/// @brief         Length of the payload
+/// @param pWriter Writer
+/// @return        Bytes written. -1 if a write did not fit
+int codec_Len(const CODEC_WRITER_t *pWriter)
+{
+    return pWriter->b_Overflow ? -1 : (int)(pWriter->Len);
+}
+
+
+/// @brief           Starts a map. Must be followed by u32_Pairs keys and values
+/// @param pWriter   Writer
+/// @param u32_Pairs Number of key/value pairs
+void codec_MapBegin(CODEC_WRITER_t *pWriter, uint32_t u32_Pairs)
+{
+    codec_PutHead(pWriter, CODEC_MT_MAP, u32_Pairs);
+}
+
+
+/// @brief           Starts an array. Must be followed by u32_Items items
+/// @param pWriter   Writer
+/// @param u32_Items Number of items
+void codec_ArrayBegin(CODEC_WRITER_t *pWriter, uint32_t u32_Items)
+{
+    codec_PutHead(pWriter, CODEC_MT_ARRAY, u32_Items);
+}
+
+
+/// @brief         Starts an array of unknown length. Must be closed by codec_Break(..)
+/// @param pWriter Writer
+void codec_ArrayBeginIndef(CODEC_WRITER_t *pWriter)
+{
+    codec_PutByte(pWriter, CODEC_ARRAY_INDEF);
+}
+
+
+/// @brief         Closes the array of codec_ArrayBeginIndef(..)
+/// @param pWriter Writer
+void codec_Break(CODEC_WRITER_t *pWriter)
+{
+    codec_PutByte(pWriter, CODEC_BREAK);
+}
+
+
+/// @brief           Writes an integer in the shortest form (1, 2, 3 or 5 bytes)
+/// @param pWriter   Writer
+/// @param s32_Value Value
+void codec_PutInt(CODEC_WRITER_t *pWriter, int32_t s32_Value)
+{
+    if(s32_Value >= 0)
+        codec_PutHead(pWriter, CODEC_MT_UINT, (uint32_t)(s32_Value));
+    else
+        codec_PutHead(pWriter, CODEC_MT_NINT, (uint32_t)(-(s32_Value + 1)));
+}
+
+
+/// @brief           Writes an unsigned integer in the shortest form, e.g. a timestamp
+/// @param pWriter   Writer
+/// @param u32_Value Value
+void codec_PutUint(CODEC_WRITER_t *pWriter, uint32_t u32_Value)
+{
+    codec_PutHead(pWriter, CODEC_MT_UINT, u32_Value);
+}
+
+
+/// @brief         Writes a map key
+/// @param pWriter Writer
+/// @param Key     See CODEC_SCHEMA
+void codec_PutKey(CODEC_WRITER_t *pWriter, CODEC_KEY_ENUM_t Key)
+{
+    codec_PutHead(pWriter, CODEC_MT_UINT, (uint32_t)(Key));
+}
+
+
+/// @brief         Writes a map key and the value scaled by the factor of the key
+/// @param pWriter Writer
+/// @param Key     See CODEC_SCHEMA
+/// @param f_Value Value in the unit of the key
+void codec_PutValue(CODEC_WRITER_t *pWriter, CODEC_KEY_ENUM_t Key, float f_Value)
+{
+    codec_PutKey(pWriter, Key);
+    codec_PutScaled(pWriter, f_Value, au16_CodecScale[Key]);
+}
+
+
+/// @brief             Writes one item [age_s, temp, humi, lux] of the samples array.
+///                    Only written if it fits and one byte is left for codec_Break(..).
+/// @param pWriter     Writer
+/// @param u32_Age_s   Age of the sample in seconds
+/// @param f_Temp_C    Temperature in °C
+/// @param f_Humi_PCT  Relative humidity in %
+/// @param f_Light_Lux Illuminance in lux
+/// @return            true if written. false if the buffer is full, the writer is unchanged then
+bool codec_PutSample(CODEC_WRITER_t *pWriter, uint32_t u32_Age_s, float f_Temp_C, float f_Humi_PCT, float f_Light_Lux)
+{
+    size_t Len = pWriter->Len;
+
+    if(pWriter->b_Overflow)
+        return false;
+
+    codec_ArrayBegin(pWriter, 4);
+    codec_PutHead(pWriter, CODEC_MT_UINT, u32_Age_s);
+    codec_PutScaled(pWriter, f_Temp_C,    au16_CodecScale[CODEC_KEY_TEMP_C]);
+    codec_PutScaled(pWriter, f_Humi_PCT,  au16_CodecScale[CODEC_KEY_HUMI_PCT]);
+    codec_PutScaled(pWriter, f_Light_Lux, au16_CodecScale[CODEC_KEY_LIGHT_LUX]);
+
+    if(pWriter->b_Overflow || pWriter->Len >= pWriter->Size)
+    {
+        pWriter->Len        = Len;
+        pWriter->b_Overflow = false;
+        return false;
+    }
+
+    return true;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief          Appends one byte
+/// @param pWriter  Writer
+/// @param u8_Byte  Byte
+static void codec_PutByte(CODEC_WRITER_t *pWriter, uint8_t u8_Byte)
+{
+    if(pWriter->Len >= pWriter->Size)
+    {
+        pWriter->b_Overflow = true;
+        return;
+    }
+
+    if(pWriter->b_Overflow == false)
+        pWriter->pu8_Buffer[pWriter->Len++] = u8_Byte;
+}
+
+
+/// @brief              Writes the initial byte of a data item and its argument in the shortest form
+/// @param pWriter      Writer
+/// @param u8_MajorType CODEC_MT_*
+/// @param u32_Arg      Value, length or number of items
+static void codec_PutHead(CODEC_WRITER_t *pWriter, uint8_t u8_MajorType, uint32_t u32_Arg)
+{
+    if(u32_Arg < 24)
+        codec_PutByte(pWriter, u8_MajorType | (uint8_t)(u32_Arg));
+    else if(u32_Arg <= 0xFF)
+    {
+        codec_PutByte(pWriter, u8_MajorType | 24);
+        codec_PutByte(pWriter, (uint8_t)(u32_Arg));
+    }
+    else if(u32_Arg <= 0xFFFF)
+    {
+        codec_PutByte(pWriter, u8_MajorType | 25);
+        codec_PutByte(pWriter, (uint8_t)(u32_Arg >> 8));
+        codec_PutByte(pWriter, (uint8_t)(u32_Arg));
+    }
+    else
+    {
+        codec_PutByte(pWriter, u8_MajorType | 26);
+        codec_PutByte(pWriter, (uint8_t)(u32_Arg >> 24));
+        codec_PutByte(pWriter, (uint8_t)(u32_Arg >> 16));
+        codec_PutByte(pWriter, (uint8_t)(u32_Arg >> 8));
+        codec_PutByte(pWriter, (uint8_t)(u32_Arg));
+    }
+}
+
+
+/// @brief           Writes round(f_Value * u16_Scale) as integer. Saturates at the int32 range, NaN is written as null.
+/// @param pWriter   Writer
+/// @param f_Value   Value
+/// @param u16_Scale Scale factor
+static void codec_PutScaled(CODEC_WRITER_t *pWriter, float f_Value, uint16_t u16_Scale)
+{
+    float f_Scaled = roundf(f_Value * (float)(u16_Scale));
+
+    if(isnan(f_Scaled))
+        codec_PutByte(pWriter, CODEC_NULL);
+    else if(f_Scaled >= 2147483520.0f)          /*Largest float < 2^31*/
+        codec_PutInt(pWriter, INT32_MAX);
+    else if(f_Scaled <= -2147483648.0f)
+        codec_PutInt(pWriter, INT32_MIN);
+    else
+        codec_PutInt(pWriter, (int32_t)(f_Scaled));
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file    mod_codec.h
+  * @author  The Embedded Dude
+  * @brief   Binary payload codec.
+  *          Encodes the sensor values as CBOR (RFC 8949) with small integer keys
+  *          and fixed-point integer values. Shared by the MQTT report and the
+  *          ESP-NOW frame.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The codec has no dependencies to ESP-IDF or FreeRTOS.
+    2. The keys and scale factors of all values are defined by CODEC_SCHEMA.
+       A value is sent as the integer round(value * scale), e.g. 21.53°C as 2153.
+       NaN is sent as CBOR null.
+    3. codec_Init(..) sets up a writer on a buffer. Then write a map:
+         codec_MapBegin(&Writer, 2);
+         codec_PutValue(&Writer, CODEC_KEY_TEMP_C, f_Temp_C);
+         codec_PutValue(&Writer, CODEC_KEY_HUMI_PCT, f_Humi_PCT);
+    4. Samples are an indefinite array of [age_s, temp, humi, lux] items:
+         codec_PutKey(&Writer, CODEC_KEY_SAMPLES);
+         codec_ArrayBeginIndef(&Writer);
+         while(codec_PutSample(&Writer, ..)) ..
+         codec_Break(&Writer);
+       codec_PutSample(..) only writes complete items and keeps room for the break.
+    5. Timestamps are written with codec_PutUint(..). A float cannot hold them.
+    6. codec_Len(..) returns the payload length or -1 if the buffer was too small.
+    7. Decode on the host with tools/codec/codec_decode.py. It reads the
+       schema from this file.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_CODEC_H_
+#define COMPONENTS_MODULE_CODEC_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Exported constants --------------------------------------------------------*/
+/* Schema: X(key, CBOR key, scale, name)
+ * Keys must stay < 24 (one byte). Only add keys, never change or reuse one. The
+ * decoder skips unknown keys. A scale of 0 marks a container.*/
+#define CODEC_SCHEMA(X)                                  \
+    X(CODEC_KEY_TEMP_C,      0, 100, "temp_C")           \
+    X(CODEC_KEY_HUMI_PCT,    1, 100, "humi_pct")         \
+    X(CODEC_KEY_LIGHT_LUX,   2, 100, "lux")              \
+    X(CODEC_KEY_REPORT_UAH,  3,  10, "report_uAh")       \
+    X(CODEC_KEY_TOTAL_UAH,   4,   1, "total_uAh")        \
+    X(CODEC_KEY_RSSI_DBM,    5,   1, "rssi_dBm")         \
+    X(CODEC_KEY_SAMPLES,     6,   0, "samples")          \
+    X(CODEC_KEY_TIME_S,      7,   1, "time_s")
+
+#define CODEC_SAMPLE_MAX_LEN        21          //!< Longest encoded sample: array header and 4 ints of 5 bytes
+#define CODEC_REPORT_MAX_LEN        40          //!< Longest report map without samples: header and 6 values of 6 bytes
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Keys of the schema
+typedef enum
+{
+#define CODEC_KEY_ENUM(key, id, scale, name)    key = id,
+    CODEC_SCHEMA(CODEC_KEY_ENUM)
+#undef CODEC_KEY_ENUM
+
+}CODEC_KEY_ENUM_t;
+
+/// @brief Writer on a caller provided buffer
+typedef struct CODEC_WRITER_t
+{
+    uint8_t *pu8_Buffer;
+    size_t   Size;
+    size_t   Len;                               //!< Bytes written
+    bool     b_Overflow;                        //!< Set if a write did not fit. All further writes are dropped
+
+}CODEC_WRITER_t;
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+void codec_Init(CODEC_WRITER_t *pWriter, uint8_t *pu8_Buffer, size_t Size);
+int codec_Len(const CODEC_WRITER_t *pWriter);
+
+void codec_MapBegin(CODEC_WRITER_t *pWriter, uint32_t u32_Pairs);
+void codec_ArrayBegin(CODEC_WRITER_t *pWriter, uint32_t u32_Items);
+void codec_ArrayBeginIndef(CODEC_WRITER_t *pWriter);
+void codec_Break(CODEC_WRITER_t *pWriter);
+
+void codec_PutInt(CODEC_WRITER_t *pWriter, int32_t s32_Value);
+void codec_PutUint(CODEC_WRITER_t *pWriter, uint32_t u32_Value);
+void codec_PutKey(CODEC_WRITER_t *pWriter, CODEC_KEY_ENUM_t Key);
+void codec_PutValue(CODEC_WRITER_t *pWriter, CODEC_KEY_ENUM_t Key, float f_Value);
+bool codec_PutSample(CODEC_WRITER_t *pWriter, uint32_t u32_Age_s, float f_Temp_C, float f_Humi_PCT, float f_Light_Lux);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_MODULE_CODEC_H_ */
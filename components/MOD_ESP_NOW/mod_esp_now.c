@@ -83,10 +83,9 @@ MOD_ESPNOW_DATA_t mod_espnow_obj;
 
 /* Private function prototypes -----------------------------------------------*/
 static esp_err_t mod_espnow_init_wifi(void);
-static esp_err_t mod_espnow_init_module(void);
+static esp_err_t mod_espnow_init_module(const uint8_t *pu8_PeerMac);
 
 static void mod_espnow_send_cb(const uint8_t *mac_addr, esp_now_send_status_t status);
-static esp_err_t Str2Mac(const char* str_mac, uint8_t* mac);
 
 
 
@@ -94,15 +93,19 @@ static esp_err_t Str2Mac(const char* str_mac, uint8_t* mac);
 
 /// @brief                    Init the ESP-NOW module
 /// @param u32_MaxBufferSize  Maximum buffer size for the ESP-NOW messages. Must be < than ESP_NOW_MAX_DATA_LEN
+/// @param pu8_PeerMac        MAC address of the peer (ESP_NOW_ETH_ALEN bytes). E.g. CONFIG_APP_ESPNOW_PEER_MAC parsed by the caller
 /// @return                   ESP_OK on success
 /// @note                     This module will also inti the WiFi and ESP-Now. IT would be more clean to have WiFi being initialized in WiFi Module.
 /// @note                     It does not makes sense to have more than one object due to the fact that the module also controls WiFi and ESP-NOW init and deinit. 
-esp_err_t mod_espnow_init( size_t u32_MaxBufferSize )
+esp_err_t mod_espnow_init( size_t u32_MaxBufferSize, const uint8_t *pu8_PeerMac )
 {
 #if CONFIG_APP_ESPNOW_ENABLE
     if( u32_MaxBufferSize > ESP_NOW_MAX_DATA_LEN )
         return ESP_ERR_INVALID_SIZE;
 
+    if( pu8_PeerMac == NULL )
+        return ESP_ERR_INVALID_ARG;
+
     mod_espnow_obj.u32_MaxBuffSize = u32_MaxBufferSize;
     mod_espnow_obj.pu8_Buffer      = malloc(mod_espnow_obj.u32_MaxBuffSize); 
     
@@ -115,7 +118,7 @@ esp_err_t mod_espnow_init( size_t u32_MaxBufferSize )
     memset(mod_espnow_obj.pu8_Buffer, 0, mod_espnow_obj.u32_MaxBuffSize);
 
     ESP_ERROR_CHECK(mod_espnow_init_wifi( ));
-    ESP_ERROR_CHECK(mod_espnow_init_module( ));
+    ESP_ERROR_CHECK(mod_espnow_init_module( pu8_PeerMac ));
         
 #else
     return ESP_ERR_INVALID_ARG;
@@ -202,10 +205,10 @@ static esp_err_t mod_espnow_init_wifi( void )
 }
 
 
-/// @brief  Init ESP-NOW and register the send callback function
-/// @param  void
-/// @return ESP_OK on success
-static esp_err_t mod_espnow_init_module(void)
+/// @brief             Init ESP-NOW and register the send callback function
+/// @param pu8_PeerMac MAC address of the peer
+/// @return            ESP_OK on success
+static esp_err_t mod_espnow_init_module(const uint8_t *pu8_PeerMac)
 { 
     ESP_ERROR_CHECK( esp_now_init() );
     ESP_ERROR_CHECK( esp_now_register_send_cb(mod_espnow_send_cb) ); 
@@ -217,8 +220,7 @@ static esp_err_t mod_espnow_init_module(void)
     
     ESP_ERROR_CHECK( esp_now_set_pmk((uint8_t *)CONFIG_APP_ESPNOW_PMK) );
 
-    /*Get peer mac address from sdkconfig*/
-    ESP_ERROR_CHECK( Str2Mac(CONFIG_APP_ESPNOW_PEER_MAC, mod_espnow_obj.u8_dest_mac ));
+    memcpy(mod_espnow_obj.u8_dest_mac, pu8_PeerMac, ESP_NOW_ETH_ALEN);
 
     /* Add broadcast peer information to peer list. */
     esp_now_peer_info_t *peer = malloc(sizeof(esp_now_peer_info_t));
@@ -256,23 +258,7 @@ static void mod_espnow_send_cb(const uint8_t *mac_addr, esp_now_send_status_t st
     else    
         espnow_event = ESPNOW_DATA_SENT;
         
-    EventDispatcher_PostEvent(MOD_ESPNOW_EVENTS, espnow_event, NULL, 0, portMAX_DELAY);        
-}
-
-
-/// @brief         Converts a string containing a mac address byte values
-/// @param str_mac String that contains the mac address in the format ff:ff:ff:ff:ff:ff
-/// @param mac     Destination array the converted bytes will be written to
-/// @return        ESP_OK if conversation was ok, otherwise ESP_FAIL
-/// @note          Ensure that mac is at least 6 bytes big
-static esp_err_t Str2Mac(const char* str_mac, uint8_t* mac)
-{
-    esp_err_t ret = ESP_OK;
-
-    if( ESP_NOW_ETH_ALEN != sscanf( str_mac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",&mac[0], &mac[1], &mac[2],&mac[3], &mac[4], &mac[5] ))
-        ret = ESP_FAIL;
-    
-    return ret;
+    EventDispatcher_TryPostEvent(MOD_ESPNOW_EVENTS, espnow_event, NULL, 0, EVENT_DISP_DROP_OLDEST);        
 }
 
 /*****************************END OF FILE**************************************/
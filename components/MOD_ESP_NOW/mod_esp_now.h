@@ -63,7 +63,7 @@
 
 /* Exported functions --------------------------------------------------------*/
 
-esp_err_t mod_espnow_init( size_t u32_MaxBufferSize);
+esp_err_t mod_espnow_init( size_t u32_MaxBufferSize, const uint8_t *pu8_PeerMac );
 void mod_espnow_deinit( void );
 esp_err_t mod_espnow_add_send_data( void *p_Data, size_t u32_Len );
 esp_err_t mod_espnow_send_data( void );
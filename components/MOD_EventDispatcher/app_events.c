@@ -56,9 +56,32 @@
 
 
 /* Private macro -------------------------------------------------------------*/
+#ifdef CONFIG_APP_EVENT_STATIC_ROUTING
+#define APP_ROUTE_PROTOTYPE(base, id, handler)  void handler(void* handler_args, esp_event_base_t event_base, int32_t s32_EventID, void* event_data);
+#define APP_ROUTE_ENTRY(base, id, handler)      [base##_IDX][id] = handler,
+#define APP_ROUTE_COUNT(base, id, handler)      + 1
+#define APP_ROUTE_BIT(base, id, handler)        | (1ULL << ((base##_IDX) * APP_EVENT_MAX_IDS + (id)))
+#define APP_ROUTE_ALL(base, num)                (((1ULL << (num)) - 1) << ((base##_IDX) * APP_EVENT_MAX_IDS))
+#define APP_ROUTE_BITS                          (0 APP_EVENT_ROUTES(APP_ROUTE_BIT))
+#endif
 
 
 /* Private constants ---------------------------------------------------------*/
+#ifdef CONFIG_APP_EVENT_STATIC_ROUTING
+_Static_assert(APP_EVENT_NUM_BASES * APP_EVENT_MAX_IDS <= 64, "Routing check needs one bit per event");
+_Static_assert((WIFI_NUM_EVENTS <= APP_EVENT_MAX_IDS) && (BACKEND_NUM_EVENTS <= APP_EVENT_MAX_IDS) &&
+               (PWR_NUM_EVENTS  <= APP_EVENT_MAX_IDS) && (ESPNOW_NUM_EVENTS  <= APP_EVENT_MAX_IDS), "Too many events per base");
+
+/*Each event needs a route...*/
+_Static_assert((APP_ROUTE_BITS & APP_ROUTE_ALL(MOD_WIFI_EVENTS,    WIFI_NUM_EVENTS))    == APP_ROUTE_ALL(MOD_WIFI_EVENTS,    WIFI_NUM_EVENTS),    "MOD_WIFI_EVENTS: event without route in APP_EVENT_ROUTES");
+_Static_assert((APP_ROUTE_BITS & APP_ROUTE_ALL(MOD_BACKEND_EVENTS, BACKEND_NUM_EVENTS)) == APP_ROUTE_ALL(MOD_BACKEND_EVENTS, BACKEND_NUM_EVENTS), "MOD_BACKEND_EVENTS: event without route in APP_EVENT_ROUTES");
+_Static_assert((APP_ROUTE_BITS & APP_ROUTE_ALL(MOD_POWER_EVENTS,   PWR_NUM_EVENTS))     == APP_ROUTE_ALL(MOD_POWER_EVENTS,   PWR_NUM_EVENTS),     "MOD_POWER_EVENTS: event without route in APP_EVENT_ROUTES");
+_Static_assert((APP_ROUTE_BITS & APP_ROUTE_ALL(MOD_ESPNOW_EVENTS,  ESPNOW_NUM_EVENTS))  == APP_ROUTE_ALL(MOD_ESPNOW_EVENTS,  ESPNOW_NUM_EVENTS),  "MOD_ESPNOW_EVENTS: event without route in APP_EVENT_ROUTES");
+
+/*...and only one*/
+_Static_assert((0 APP_EVENT_ROUTES(APP_ROUTE_COUNT)) == WIFI_NUM_EVENTS + BACKEND_NUM_EVENTS + PWR_NUM_EVENTS + ESPNOW_NUM_EVENTS,
+               "APP_EVENT_ROUTES: each event needs exactly one route");
+#endif
 
 
 /* Private variables ---------------------------------------------------------*/
@@ -67,6 +90,16 @@ ESP_EVENT_DEFINE_BASE(MOD_BACKEND_EVENTS);
 ESP_EVENT_DEFINE_BASE(MOD_POWER_EVENTS);
 ESP_EVENT_DEFINE_BASE(MOD_ESPNOW_EVENTS);
 
+#ifdef CONFIG_APP_EVENT_STATIC_ROUTING
+APP_EVENT_ROUTES(APP_ROUTE_PROTOTYPE)
+
+/*Indexed by base and event ID, see APP_EVENT_ROUTES in app_events.h*/
+static const esp_event_handler_t Routes[APP_EVENT_NUM_BASES][APP_EVENT_MAX_IDS] =
+{
+    APP_EVENT_ROUTES(APP_ROUTE_ENTRY)
+};
+#endif
+
 
 /* Private function prototypes -----------------------------------------------*/
 
@@ -84,6 +117,7 @@ const char *app_wifi_event_to_str(MOD_WIFI_EVENTS_ENUM_t WiFi_event)
         case WIFI_CONNECT_FAILED_EVENT:   return "WiFi Connection failed";
         case WIFI_ITWT_ESTABLISHED:       return "iTWT established";
         case WIFI_ITWT_CLOSED:            return "iTWT closed";
+        case WIFI_ITWT_FAILED:            return "iTWT setup failed";
         default:                          return "UNKNOWN MOD_WIFI_EVENT";
     }
 }
@@ -102,6 +136,7 @@ const char *app_backend_event_to_str(MOD_BACKEND_EVENTS_ENUM_t backend_event)
         case BACKEND_SEND_MESSAGE:         return "Sent Message to Backend";        
         case BACKEND_SEND_MESSAGE_DONE:    return "Ack that Message received by backend";         
         case BACKEND_MESSAGE_RECEIVED:     return "Message from Backend received";
+        case BACKEND_ALL_MSGS_ACKED:       return "All Messages acked by backend";
         default:                           return "UNKNOWN MOD_BACKEND_EVENT";
     }
 }
@@ -134,6 +169,103 @@ const char *app_espnow_event_to_str(MOD_ESPNOW_EVENTS_ENUM_t espnow_event)
 }
 
 
+/// @brief            Index of an app event base
+/// @param event_base Event base
+/// @return           MOD_*_EVENTS_IDX, -1 for an unknown base
+int32_t app_event_get_base_idx(esp_event_base_t event_base)
+{
+    if(event_base == MOD_WIFI_EVENTS)    return MOD_WIFI_EVENTS_IDX;
+    if(event_base == MOD_BACKEND_EVENTS) return MOD_BACKEND_EVENTS_IDX;
+    if(event_base == MOD_POWER_EVENTS)   return MOD_POWER_EVENTS_IDX;
+    if(event_base == MOD_ESPNOW_EVENTS)  return MOD_ESPNOW_EVENTS_IDX;
+
+    return -1;
+}
+
+
+/// @brief             "Translates" an event of any app event base into string
+/// @param event_base  Event base
+/// @param s32_EventID Event ID of the base
+/// @return            translated string
+const char *app_event_to_str(esp_event_base_t event_base, int32_t s32_EventID)
+{
+    if(event_base == MOD_WIFI_EVENTS)    return app_wifi_event_to_str((MOD_WIFI_EVENTS_ENUM_t)s32_EventID);
+    if(event_base == MOD_BACKEND_EVENTS) return app_backend_event_to_str((MOD_BACKEND_EVENTS_ENUM_t)s32_EventID);
+    if(event_base == MOD_POWER_EVENTS)   return app_power_event_to_str((MOD_POWER_EVENTS_ENUM_t)s32_EventID);
+    if(event_base == MOD_ESPNOW_EVENTS)  return app_espnow_event_to_str((MOD_ESPNOW_EVENTS_ENUM_t)s32_EventID);
+
+    return "UNKNOWN EVENT BASE";
+}
+
+
+/// @brief             Dispatch class of an event. Used by the EventDispatcher to order and merge posted events.
+/// @param event_base  Event base
+/// @param s32_EventID Event ID of the base
+/// @return            APP_EVENT_* flags, 0 for a routine event
+/// @note  Only flag an event APP_EVENT_DROPPABLE if no handler waits for it. Losing a connect, ack or sleep
+///        event leaves the state machines waiting.
+uint8_t app_event_get_flags(esp_event_base_t event_base, int32_t s32_EventID)
+{
+    if(event_base == MOD_POWER_EVENTS)
+    {
+        /*Only the latest sleep time counts*/
+        return (s32_EventID == PWR_GO_TO_SLEEP) ? (APP_EVENT_URGENT | APP_EVENT_COALESCE) : 0;
+    }
+
+    if(event_base == MOD_WIFI_EVENTS)
+    {
+        switch(s32_EventID)
+        {
+            /*All link states in one lane. Otherwise a DISCONNECTED overtakes a queued CONNECTED
+              and MainApp ends up connected while the link is down.*/
+            case WIFI_CONNECTED_EVENT:      return APP_EVENT_URGENT | APP_EVENT_LINK_STATE;
+            case WIFI_DISCONNECTED_EVENT:   return APP_EVENT_URGENT | APP_EVENT_LINK_STATE;  /*Retry storm while the link flaps*/
+            case WIFI_CONNECT_FAILED_EVENT: return APP_EVENT_URGENT | APP_EVENT_LINK_STATE;
+            case WIFI_ITWT_CLOSED:          return APP_EVENT_DROPPABLE;                     /*Information only*/
+            default:                        return 0;
+        }
+    }
+
+    if(event_base == MOD_BACKEND_EVENTS)
+    {
+        switch(s32_EventID)
+        {
+            case BACKEND_CONNECTED_EVENT:      return APP_EVENT_URGENT | APP_EVENT_LINK_STATE;
+            case BACKEND_DISCONNECTED_EVENT:   return APP_EVENT_URGENT | APP_EVENT_LINK_STATE;
+            case BACKEND_CONNECT_FAILED_EVENT: return APP_EVENT_URGENT | APP_EVENT_LINK_STATE;
+            case BACKEND_SEND_MESSAGE_DONE:    return APP_EVENT_DROPPABLE;
+            case BACKEND_MESSAGE_RECEIVED:     return APP_EVENT_DROPPABLE;
+            default:                           return 0;
+        }
+    }
+
+    return 0;
+}
+
+
+#ifdef CONFIG_APP_EVENT_STATIC_ROUTING
+/// @brief             Handler of an event in the static routing table
+/// @param event_base  Event base
+/// @param s32_EventID Event ID of the base
+/// @return            The handler, NULL for an unknown event
+esp_event_handler_t app_event_get_route(esp_event_base_t event_base, int32_t s32_EventID)
+{
+    int32_t s32_Base = app_event_get_base_idx(event_base);
+
+    if((s32_Base < 0) || (s32_EventID < 0) || (s32_EventID >= APP_EVENT_MAX_IDS))
+        return NULL;
+
+    return Routes[s32_Base][s32_EventID];
+}
+
+
+/// @brief Route target of events which are not used in a configuration
+void app_event_ignore(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+{
+}
+#endif
+
+
 
 
 
@@ -54,6 +54,7 @@
 
 
 /* Includes ------------------------------------------------------------------*/
+#include "sdkconfig.h"
 #include "esp_event.h"
 
 
@@ -71,7 +72,9 @@ typedef enum mod_wifi_events
     WIFI_DISCONNECTED_EVENT,             //!< Wi-Fi connection got lost or disconnected on purpose                   
     WIFI_CONNECT_FAILED_EVENT,           //!< Wi-Fi connection could not be established even after retries           
     WIFI_ITWT_ESTABLISHED,               //!< We got an iTWT agreement in place with AP                              
-    WIFI_ITWT_CLOSED                     //!< iTWT not active anymore. Will be raised if iTWT was established before.
+    WIFI_ITWT_CLOSED,                    //!< iTWT not active anymore. Will be raised if iTWT was established before.
+    WIFI_ITWT_FAILED,                    //!< No iTWT agreement: rejected after all tries, not HE20 or iTWT disabled
+    WIFI_NUM_EVENTS
 
 }MOD_WIFI_EVENTS_ENUM_t;
 
@@ -84,29 +87,88 @@ typedef enum mod_backend_events
     BACKEND_SEND_MESSAGE,                //!< Send message to backend                                                
     BACKEND_SEND_MESSAGE_DONE,           //!< Message delivered                                                      
     BACKEND_MESSAGE_RECEIVED,            //!< Message from backend received                                          
-    
+    BACKEND_ALL_MSGS_ACKED,              //!< All messages published since Backend_PublishBegin(..) are acked. Posted once per Backend_PublishEnd(..)
+    BACKEND_NUM_EVENTS
+
 }MOD_BACKEND_EVENTS_ENUM_t;
 
 
 typedef enum mod_power_events
 {    
-    PWR_GO_TO_SLEEP                      //!< Will be published to all modules to go to sleep                                
-    
+    PWR_GO_TO_SLEEP,                     //!< Will be published to all modules to go to sleep                                
+    PWR_NUM_EVENTS
+
 }MOD_POWER_EVENTS_ENUM_t;
 
 
 typedef enum mod_espnow_events
 {
     ESPNOW_DATA_SENT,                    //!< Will be published after ESP-Now message has been sent.   Note: Its not a confirmation that this message also got received.                          
-    ESPNOW_DATA_SENT_FAILED              //!< Will be published after ESP-Now message sent has failed. 
+    ESPNOW_DATA_SENT_FAILED,             //!< Will be published after ESP-Now message sent has failed. 
+    ESPNOW_NUM_EVENTS
 
 }MOD_ESPNOW_EVENTS_ENUM_t;
 
 
 /* Exported constants --------------------------------------------------------*/
+#define APP_EVENT_URGENT        0x01    //!< Dispatched before all routine events
+#define APP_EVENT_COALESCE      0x02    //!< A new event replaces a queued event with the same base and ID
+#define APP_EVENT_DROPPABLE     0x04    //!< May be discarded by EVENT_DISP_DROP_OLDEST. Only for events which carry no state.
+#define APP_EVENT_LINK_STATE    0x08    //!< Link state of the base. Replaces any queued link state event of the base.
+
+/*Index of each event base in the static routing table*/
+#define MOD_WIFI_EVENTS_IDX     0
+#define MOD_BACKEND_EVENTS_IDX  1
+#define MOD_POWER_EVENTS_IDX    2
+#define MOD_ESPNOW_EVENTS_IDX   3
+#define APP_EVENT_NUM_BASES     4
+#define APP_EVENT_MAX_IDS       16  //!< Max. number of events per base
 
 
 /* Exported macro ------------------------------------------------------------*/
+#ifdef CONFIG_APP_EVENT_STATIC_ROUTING
+/* Static routing table: X(base, event ID, handler)
+   Each event of the enums above needs exactly one row, otherwise the build fails (see app_events.c).
+   Events which are not used in a configuration are routed to app_event_ignore.
+   The handlers are called with handler_args = NULL. */
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+#define APP_EVENT_ROUTES(X)                                                         \
+    X(MOD_WIFI_EVENTS,    WIFI_CONNECTED_EVENT,         app_event_ignore)            \
+    X(MOD_WIFI_EVENTS,    WIFI_DISCONNECTED_EVENT,      app_event_ignore)            \
+    X(MOD_WIFI_EVENTS,    WIFI_CONNECT_FAILED_EVENT,    app_event_ignore)            \
+    X(MOD_WIFI_EVENTS,    WIFI_ITWT_ESTABLISHED,        mod_pwr_wifi_events_handler) \
+    X(MOD_WIFI_EVENTS,    WIFI_ITWT_CLOSED,             app_event_ignore)            \
+    X(MOD_WIFI_EVENTS,    WIFI_ITWT_FAILED,             mod_pwr_wifi_events_handler) \
+    X(MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT,      app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_DISCONNECTED_EVENT,   app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_CONNECT_FAILED_EVENT, app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_SEND_MESSAGE,         app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_SEND_MESSAGE_DONE,    app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_MESSAGE_RECEIVED,     app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_ALL_MSGS_ACKED,       app_event_ignore)            \
+    X(MOD_POWER_EVENTS,   PWR_GO_TO_SLEEP,              PWR_events_handler)          \
+    X(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT,             ESPNOW_events_handler)       \
+    X(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT_FAILED,      ESPNOW_events_handler)
+#else
+#define APP_EVENT_ROUTES(X)                                                         \
+    X(MOD_WIFI_EVENTS,    WIFI_CONNECTED_EVENT,         WiFi_events_handler)         \
+    X(MOD_WIFI_EVENTS,    WIFI_DISCONNECTED_EVENT,      WiFi_events_handler)         \
+    X(MOD_WIFI_EVENTS,    WIFI_CONNECT_FAILED_EVENT,    WiFi_events_handler)         \
+    X(MOD_WIFI_EVENTS,    WIFI_ITWT_ESTABLISHED,        mod_pwr_wifi_events_handler) \
+    X(MOD_WIFI_EVENTS,    WIFI_ITWT_CLOSED,             app_event_ignore)            \
+    X(MOD_WIFI_EVENTS,    WIFI_ITWT_FAILED,             mod_pwr_wifi_events_handler) \
+    X(MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT,      Backend_events_handler)      \
+    X(MOD_BACKEND_EVENTS, BACKEND_DISCONNECTED_EVENT,   Backend_events_handler)      \
+    X(MOD_BACKEND_EVENTS, BACKEND_CONNECT_FAILED_EVENT, Backend_events_handler)      \
+    X(MOD_BACKEND_EVENTS, BACKEND_SEND_MESSAGE,         app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_SEND_MESSAGE_DONE,    app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_MESSAGE_RECEIVED,     app_event_ignore)            \
+    X(MOD_BACKEND_EVENTS, BACKEND_ALL_MSGS_ACKED,       Backend_events_handler)      \
+    X(MOD_POWER_EVENTS,   PWR_GO_TO_SLEEP,              PWR_events_handler)          \
+    X(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT,             app_event_ignore)            \
+    X(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT_FAILED,      app_event_ignore)
+#endif
+#endif /* CONFIG_APP_EVENT_STATIC_ROUTING */
 
 
 /* Exported functions --------------------------------------------------------*/
@@ -114,6 +176,13 @@ const char *app_wifi_event_to_str(MOD_WIFI_EVENTS_ENUM_t wfif_event);
 const char *app_backend_event_to_str(MOD_BACKEND_EVENTS_ENUM_t backend_event);
 const char *app_power_event_to_str(MOD_POWER_EVENTS_ENUM_t power_event);
 const char *app_espnow_event_to_str(MOD_ESPNOW_EVENTS_ENUM_t espnow_event);
+const char *app_event_to_str(esp_event_base_t event_base, int32_t s32_EventID);
+int32_t app_event_get_base_idx(esp_event_base_t event_base);
+uint8_t app_event_get_flags(esp_event_base_t event_base, int32_t s32_EventID);
+#ifdef CONFIG_APP_EVENT_STATIC_ROUTING
+esp_event_handler_t app_event_get_route(esp_event_base_t event_base, int32_t s32_EventID);
+void app_event_ignore(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+#endif
 
 
 #endif /* COMPONENTS_APP_EVENTS_H_ */
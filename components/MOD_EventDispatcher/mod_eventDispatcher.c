@@ -3,7 +3,8 @@
   * @file    mod_eventDispatcher.h
   * @author  The Embedded Dude
   * @brief   Event dispatching module
-  *          Handles events in the system using the ESP event library (simple wrapper)
+  *          Handles events in the system. The event data is stored in a fixed
+  *          size pool, no heap is used on the event path.
   * @date    GIT controlled
   * @version GIT controlled
 
@@ -15,9 +16,38 @@
        EventDispatcher_Start(..)
     2. Once the module is running clients can register event handler and subscribe
        to events. Events are defined in app_events.h
-    3. Clients can post events using EventDispatcher_PostEvent(..)
-    4. Queue and stack sizes can be changed by modifying MOD_EVENT_DISP_QUEUE_SIZE 
-       and MOD_EVENT_DISP_STACK_SIZE in mod_eventDispatcher.h
+       The returned handle is owned by the client. A module which is started and
+       stopped more than once releases it with EventDispatcher_UnregisterEventHandler(..)
+       in its de-init function. EventDispatcher_AuditHandlers() logs the handlers
+       per event and warns about duplicates and a growing number of handlers.
+       With CONFIG_APP_EVENT_STATIC_ROUTING the handlers are not registered. Each event
+       is routed to one handler by APP_EVENT_ROUTES in app_events.h
+    3. Clients post events using EventDispatcher_TryPostEvent(..). It never blocks
+       and returns an error if the event has been dropped, so it can be used from
+       driver callbacks (Wi-Fi, MQTT, ESP-NOW) and event handlers.
+    4. Zero-copy: EventDispatcher_Borrow(..) returns a pool slot, the client fills
+       it in place and posts it with EventDispatcher_PostBorrowed(..). A slot which
+       shall not be posted anymore is given back with EventDispatcher_Return(..)
+    5. The slot is freed after the last handler has been called. The event data is
+       only valid during the handler call.
+    6. If the pool is empty the overflow policy decides: EVENT_DISP_DROP_NEWEST
+       discards the new event, EVENT_DISP_DROP_OLDEST discards the oldest event
+       flagged APP_EVENT_DROPPABLE which has not been dispatched yet (routine events
+       first). Events which carry a state are never discarded for a new one. If no
+       droppable event is queued the new event is discarded and logged as error.
+    7. Posted events wait in two lanes. Events flagged APP_EVENT_URGENT in
+       app_event_get_flags(..) overtake all routine events. An event flagged
+       APP_EVENT_COALESCE replaces a queued event with the same base and ID. It keeps
+       the queue position and the post time of the old one and carries the new data.
+       An event flagged APP_EVENT_LINK_STATE removes the queued link state event of
+       its base, whatever its ID, and is queued at the end. All link state events of
+       a base must be in the same lane, so the latest state is always dispatched last.
+    8. Pool, slot and stack sizes can be changed by modifying MOD_EVENT_DISP_POOL_SIZE,
+       MOD_EVENT_DISP_SLOT_SIZE, MOD_EVENT_DISP_MAX_HANDLERS and MOD_EVENT_DISP_STACK_SIZE
+       in mod_eventDispatcher.h
+    9. EventDispatcher_GetStats(..) and EventDispatcher_GetEventStats(..) return the
+       counters, the queue-wait and handler times and the high-water marks.
+       EventDispatcher_DumpStats() writes all of them to the log.
 
   @endverbatim
   ******************************************************************************
@@ -49,70 +79,835 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
 #include "mod_eventDispatcher.h"
+#include "app_events.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#ifdef CONFIG_APP_FLIGHT_REC
+#include "mod_flight_rec.h"
+#endif
 
 
 
 /* Private typedef -----------------------------------------------------------*/
+/// @brief Slot of the payload pool. Holds one posted event.
+typedef struct EVENT_DISP_SLOT_t
+{
+    esp_event_base_t Base;
+    int32_t          s32_EventID;
+    uint8_t          u8_Flags;                          //!< APP_EVENT_* of app_event_get_flags(..)
+    int64_t          s64_Post_us;
+    size_t           DataSize;                          //!< 0 if the event has no data
+    union
+    {
+        uint8_t      au8[MOD_EVENT_DISP_SLOT_SIZE];
+        uint64_t     u64_Align;                         //!< Any data type can be placed in the slot
+
+    }Data;
+
+}EVENT_DISP_SLOT_t;
+
+
+/// @brief Posted slots of one priority in post order
+typedef struct EVENT_DISP_LANE_t
+{
+    uint8_t au8_Idx[MOD_EVENT_DISP_POOL_SIZE];          //!< Ring of slot indices. Can hold the whole pool.
+    uint8_t u8_Head;                                    //!< Oldest entry
+    uint8_t u8_Cnt;
+
+}EVENT_DISP_LANE_t;
+
+
+typedef enum
+{
+    EVENT_DISP_LANE_URGENT = 0,
+    EVENT_DISP_LANE_ROUTINE,
+    EVENT_DISP_LANE_CNT
+
+}EVENT_DISP_LANE_ENUM_t;
+
+
+/// @brief Registered event handler
+typedef struct EVENT_DISP_HANDLER_t
+{
+    esp_event_base_t    Base;
+    int32_t             s32_EventID;                    //!< ESP_EVENT_ANY_ID for all events of the base
+    esp_event_handler_t Handler;
+    void*               pArg;
+
+}EVENT_DISP_HANDLER_t;
 
 
 /* Private define ------------------------------------------------------------*/
+#define EVENT_DISP_TAG  "EVENT_DISP"
 
 
 /* Private macro -------------------------------------------------------------*/
+#ifndef MAX
+#define MAX(a, b)       (((a) > (b)) ? (a) : (b))
+#endif
 
 
 /* Private constants ---------------------------------------------------------*/
 
 
 /* Private variables ---------------------------------------------------------*/
-esp_event_loop_handle_t general_app_event_loop; /*This loop is used for general communication for the components of the app*/
+static EVENT_DISP_SLOT_t    Pool[MOD_EVENT_DISP_POOL_SIZE];
+static QueueHandle_t        FreeSlots;      /*Indices of the free slots*/
+static EVENT_DISP_LANE_t    Lanes[EVENT_DISP_LANE_CNT];
+static TaskHandle_t         DispatcherTask;
+
+#ifndef CONFIG_APP_EVENT_STATIC_ROUTING
+static EVENT_DISP_HANDLER_t Handlers[MOD_EVENT_DISP_MAX_HANDLERS];
+static volatile uint32_t    u32_HandlerCnt;
+static volatile uint32_t    u32_DispatchSeq;    /*Incremented before and after the handlers of an event are called. Odd while dispatching.*/
+#endif
+static EVENT_DISP_STATS_t       Stats;
+static EVENT_DISP_EVENT_STATS_t EventStats[MOD_EVENT_DISP_MAX_EVENTS];
+static portMUX_TYPE         DispLock = portMUX_INITIALIZER_UNLOCKED;
 
 
 /* Private function prototypes -----------------------------------------------*/
+static void EventDispatcher_Task(void *pvParameters);
+static uint32_t EventDispatcher_Dispatch(const EVENT_DISP_SLOT_t *pSlot);
+static EVENT_DISP_EVENT_STATS_t *EventDispatcher_EventStats(esp_event_base_t event_base, int32_t s32_EventID);
+static uint8_t EventDispatcher_HistBin(uint32_t u32_Time_us);
+static void EventDispatcher_CountDropped(esp_event_base_t event_base, int32_t s32_EventID);
+static void EventDispatcher_LogHist(const char *pc_Name, const uint32_t *pu32_Bins, uint32_t u32_Max_us);
+static EVENT_DISP_SLOT_t *EventDispatcher_GetSlot(void *pData);
+static bool EventDispatcher_LanePop(EVENT_DISP_LANE_t *pLane, uint8_t *pu8_Idx);
+static bool EventDispatcher_LaneReplace(EVENT_DISP_LANE_t *pLane, uint8_t u8_NewIdx, uint8_t *pu8_OldIdx);
+static bool EventDispatcher_LaneSupersede(EVENT_DISP_LANE_t *pLane, esp_event_base_t event_base, uint8_t *pu8_OldIdx);
+static bool EventDispatcher_LaneEvict(EVENT_DISP_LANE_t *pLane, uint8_t *pu8_Idx);
+static void EventDispatcher_LaneRemove(EVENT_DISP_LANE_t *pLane, uint8_t u8_Pos);
 
 
 /* Exported functions --------------------------------------------------------*/
 
-/// @brief  Start the event dispatcher task with queue and stack size 
-///         according to MOD_EVENT_DISP_QUEUE_SIZE and MOD_EVENT_DISP_STACK_SIZE
+/// @brief  Start the event dispatcher task with the payload pool and stack size 
+///         according to MOD_EVENT_DISP_POOL_SIZE and MOD_EVENT_DISP_STACK_SIZE
 /// @param  void
 void EventDispatcher_Start( void )
 {
-    esp_event_loop_args_t loop_with_task_args = 
-    {    
-        .queue_size      = MOD_EVENT_DISP_QUEUE_SIZE,
-        .task_name       = "app_event_dispatcher",
-        .task_priority   = uxTaskPriorityGet(NULL),
-        .task_stack_size = MOD_EVENT_DISP_STACK_SIZE,
-        .task_core_id    = tskNO_AFFINITY
-    };
+    FreeSlots = xQueueCreate(MOD_EVENT_DISP_POOL_SIZE, sizeof(uint8_t));
+
+    if(FreeSlots == NULL)
+    {
+        ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
+    }
+
+    for(uint8_t u8_Idx = 0; u8_Idx < MOD_EVENT_DISP_POOL_SIZE; u8_Idx++)
+    {
+        xQueueSend(FreeSlots, &u8_Idx, 0);
+    }
 
-    ESP_ERROR_CHECK(esp_event_loop_create(&loop_with_task_args, &general_app_event_loop));
+    if(xTaskCreate(EventDispatcher_Task, "app_event_dispatcher", MOD_EVENT_DISP_STACK_SIZE, NULL, uxTaskPriorityGet(NULL), &DispatcherTask) != pdPASS)
+    {
+        ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
+    }
 }
 
 
+#ifndef CONFIG_APP_EVENT_STATIC_ROUTING
 /// @brief                   Register a new event handler and subscribe to an even base and event.
 /// @param event_base        Pre-defined bases are in app_events.h
-/// @param s32_EventID       Pre-defined event IDs are in app_events.h
+/// @param s32_EventID       Pre-defined event IDs are in app_events.h. ESP_EVENT_ANY_ID for all events of the base
 /// @param event_handler     Event handler that gets called once event has been published
 /// @param event_handler_arg Optional event arg/data. If not needed set to NULL
-void EventDispatcher_RegisterEventHandler(esp_event_base_t event_base, int32_t s32_EventID, esp_event_handler_t event_handler, void* event_handler_arg)
+/// @param[out] pHandle      Handle for EventDispatcher_UnregisterEventHandler(..). NULL if the handler is never unregistered.
+/// @note  The number of handlers is limited by MOD_EVENT_DISP_MAX_HANDLERS. Unregistered entries are reused.
+void EventDispatcher_RegisterEventHandler(esp_event_base_t event_base, int32_t s32_EventID, esp_event_handler_t event_handler, void* event_handler_arg, EVENT_DISP_HANDLE_t *pHandle)
 {    
-    ESP_ERROR_CHECK(esp_event_handler_instance_register_with(general_app_event_loop, event_base, s32_EventID, event_handler, event_handler_arg, NULL));
+    EVENT_DISP_HANDLER_t *pEntry = NULL;
+
+    portENTER_CRITICAL(&DispLock);
+    for(uint32_t u32_Idx = 0; u32_Idx < u32_HandlerCnt; u32_Idx++)
+    {
+        if(Handlers[u32_Idx].Handler == NULL)
+        {
+            pEntry = &Handlers[u32_Idx];
+            break;
+        }
+    }
+
+    if((pEntry == NULL) && (u32_HandlerCnt < MOD_EVENT_DISP_MAX_HANDLERS))
+    {
+        pEntry = &Handlers[u32_HandlerCnt];
+        pEntry->Handler = NULL;
+        u32_HandlerCnt++;  /*The dispatcher only reads entries below the count*/
+    }
+
+    if(pEntry != NULL)
+    {
+        pEntry->Base        = event_base;
+        pEntry->s32_EventID = s32_EventID;
+        pEntry->pArg        = event_handler_arg;
+        pEntry->Handler     = event_handler;    /*Last, a NULL handler marks a free entry*/
+    }
+    portEXIT_CRITICAL(&DispLock);
+
+    if(pHandle != NULL)
+    {
+        *pHandle = pEntry;
+    }
+
+    ESP_ERROR_CHECK((pEntry != NULL) ? ESP_OK : ESP_ERR_NO_MEM);
+}
+
+
+/// @brief         Unregister an event handler. The handler is not called for events dispatched afterwards.
+/// @param pHandle Handle of EventDispatcher_RegisterEventHandler(..). Set to NULL. Nothing happens if it is NULL already.
+/// @note          Waits until an event which is dispatched right now has been handled. Afterwards the handler
+///                is not running anymore and its argument can be freed. Called from a handler it returns at once,
+///                the handler is not called again.
+void EventDispatcher_UnregisterEventHandler(EVENT_DISP_HANDLE_t *pHandle)
+{
+    uint32_t u32_Seq;
+
+    if((pHandle == NULL) || (*pHandle == NULL))
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&DispLock);
+    (*pHandle)->Handler = NULL;
+
+    while((u32_HandlerCnt > 0) && (Handlers[u32_HandlerCnt - 1].Handler == NULL))
+    {
+        u32_HandlerCnt--;
+    }
+    u32_Seq = u32_DispatchSeq;
+    portEXIT_CRITICAL(&DispLock);
+
+    *pHandle = NULL;
+
+    /*The running dispatch may have copied the entry before it was cleared*/
+    if(xTaskGetCurrentTaskHandle() != DispatcherTask)
+    {
+        while((u32_Seq & 1) && (u32_DispatchSeq == u32_Seq))
+        {
+            vTaskDelay(1);
+        }
+    }
 }
 
 
-/// @brief                 Post an event for a specfic event base including data (optional)
+/// @brief Logs the number of handlers of each event. Warns if a handler is registered more than once
+///        for the same event and argument or if the number of handlers grew since the last call.
+/// @note  Call once per wake cycle (CONFIG_APP_EVENT_DISP_HANDLER_AUDIT). A leaking module shows up as growth.
+void EventDispatcher_AuditHandlers( void )
+{
+    static uint32_t u32_LastActive = 0;
+    EVENT_DISP_HANDLER_t Snapshot[MOD_EVENT_DISP_MAX_HANDLERS];
+    uint32_t u32_Cnt;
+    uint32_t u32_Active = 0;
+
+    portENTER_CRITICAL(&DispLock);
+    u32_Cnt = u32_HandlerCnt;
+    memcpy(Snapshot, Handlers, u32_Cnt * sizeof(EVENT_DISP_HANDLER_t));
+    portEXIT_CRITICAL(&DispLock);
+
+    for(uint32_t i = 0; i < u32_Cnt; i++)
+    {
+        uint32_t u32_PerEvent = 0;
+        bool     b_Counted    = false;
+
+        if(Snapshot[i].Handler == NULL)
+            continue;
+
+        u32_Active++;
+
+        for(uint32_t j = 0; j < u32_Cnt; j++)
+        {
+            if((Snapshot[j].Handler == NULL) || (Snapshot[j].Base != Snapshot[i].Base) || (Snapshot[j].s32_EventID != Snapshot[i].s32_EventID))
+                continue;
+
+            if(j < i)
+            {
+                b_Counted = true;   /*Event logged with its first handler*/
+
+                if((Snapshot[j].Handler == Snapshot[i].Handler) && (Snapshot[j].pArg == Snapshot[i].pArg))
+                    ESP_LOGW(EVENT_DISP_TAG, "Audit: handler %p registered more than once for %s", Snapshot[i].Handler, 
+                             (Snapshot[i].s32_EventID == ESP_EVENT_ANY_ID) ? Snapshot[i].Base : app_event_to_str(Snapshot[i].Base, Snapshot[i].s32_EventID));
+            }
+
+            u32_PerEvent++;
+        }
+
+        if(b_Counted == false)
+            ESP_LOGI(EVENT_DISP_TAG, "Audit: %-28s %lu handler(s)", 
+                     (Snapshot[i].s32_EventID == ESP_EVENT_ANY_ID) ? Snapshot[i].Base : app_event_to_str(Snapshot[i].Base, Snapshot[i].s32_EventID), u32_PerEvent);
+    }
+
+    ESP_LOGI(EVENT_DISP_TAG, "Audit: %lu handlers registered, %lu of %d entries used", u32_Active, u32_Cnt, MOD_EVENT_DISP_MAX_HANDLERS);
+
+    if((u32_LastActive != 0) && (u32_Active > u32_LastActive))
+        ESP_LOGW(EVENT_DISP_TAG, "Audit: number of handlers grew from %lu to %lu. Handler leak?", u32_LastActive, u32_Active);
+
+    u32_LastActive = u32_Active;
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    /*Handlers of the default event loop (Wi-Fi, IP, MQTT)*/
+    esp_event_dump(stdout);
+#endif
+}
+#endif
+
+
+/// @brief                 Borrow a slot of the payload pool. The event data is written directly into the slot.
+/// @param event_data_size Size of the event data, max. MOD_EVENT_DISP_SLOT_SIZE
+/// @param ticks_to_wait   Number of ticks to wait for a free slot
+/// @param Overflow        What to do if no slot is free after ticks_to_wait
+/// @return                Pointer to the data of the slot. NULL if the event has been dropped.
+/// @note  The slot must be posted with EventDispatcher_PostBorrowed(..) or given back with EventDispatcher_Return(..)
+void *EventDispatcher_Borrow(size_t event_data_size, TickType_t ticks_to_wait, EVENT_DISP_OVERFLOW_t Overflow)
+{
+    uint8_t u8_Idx;
+
+    if((event_data_size > MOD_EVENT_DISP_SLOT_SIZE) || (FreeSlots == NULL))
+    {
+        return NULL;
+    }
+
+    if(xQueueReceive(FreeSlots, &u8_Idx, ticks_to_wait) != pdTRUE)
+    {
+        bool b_Taken = false;
+
+        /*Pool is empty. Take over the oldest droppable event which has not been dispatched yet.
+          Events carrying a state are never taken over, a lost connect or ack leaves MainApp waiting.*/
+        portENTER_CRITICAL(&DispLock);
+        Stats.u32_Dropped++;
+        if(Overflow == EVENT_DISP_DROP_OLDEST)
+        {
+            b_Taken = EventDispatcher_LaneEvict(&Lanes[EVENT_DISP_LANE_ROUTINE], &u8_Idx) ||
+                      EventDispatcher_LaneEvict(&Lanes[EVENT_DISP_LANE_URGENT],  &u8_Idx);
+        }
+        if(b_Taken)
+        {
+            EVENT_DISP_EVENT_STATS_t *pEventStats = EventDispatcher_EventStats(Pool[u8_Idx].Base, Pool[u8_Idx].s32_EventID);
+            if(pEventStats != NULL)
+            {
+                pEventStats->u32_Dropped++;
+            }
+        }
+        portEXIT_CRITICAL(&DispLock);
+
+        if(b_Taken == false)
+        {
+            ESP_LOGE(EVENT_DISP_TAG, "Pool empty, new event dropped");
+            return NULL;
+        }
+
+        ESP_LOGW(EVENT_DISP_TAG, "Pool empty, event %s:%ld dropped", Pool[u8_Idx].Base, Pool[u8_Idx].s32_EventID);
+    }
+
+    Pool[u8_Idx].DataSize = event_data_size;
+
+    return (void*)Pool[u8_Idx].Data.au8;
+}
+
+
+/// @brief             Post an event whose data has been written into a borrowed slot
+/// @param pData       Pointer returned by EventDispatcher_Borrow(..)
+/// @param event_base  Pre-defined bases are in app_events.h
+/// @param s32_EventID Pre-defined event IDs are in app_events.h
+/// @note  Never blocks. A lane can hold all slots of the pool.
+void EventDispatcher_PostBorrowed(void *pData, esp_event_base_t event_base, int32_t s32_EventID)
+{
+    EVENT_DISP_SLOT_t *pSlot = EventDispatcher_GetSlot(pData);
+    EVENT_DISP_LANE_t *pLane;
+    EVENT_DISP_EVENT_STATS_t *pEventStats;
+    uint8_t u8_Idx;
+    uint8_t u8_OldIdx;
+    bool    b_Coalesced = false;    /*u8_OldIdx has been removed from the lane*/
+    bool    b_Replaced  = false;    /*The new slot took over the queue position of u8_OldIdx*/
+
+    if(pSlot == NULL)
+    {
+        return;
+    }
+
+    u8_Idx             = (uint8_t)(pSlot - Pool);
+    pSlot->Base        = event_base;
+    pSlot->s32_EventID = s32_EventID;
+    pSlot->u8_Flags    = app_event_get_flags(event_base, s32_EventID);
+    pSlot->s64_Post_us = esp_timer_get_time( );
+    pLane              = &Lanes[(pSlot->u8_Flags & APP_EVENT_URGENT) ? EVENT_DISP_LANE_URGENT : EVENT_DISP_LANE_ROUTINE];
+
+    portENTER_CRITICAL(&DispLock);
+    if(pSlot->u8_Flags & APP_EVENT_LINK_STATE)
+    {
+        /*Latest link state wins. It is queued behind everything posted before, never in place.*/
+        b_Coalesced = EventDispatcher_LaneSupersede(pLane, event_base, &u8_OldIdx);
+    }
+    else if(pSlot->u8_Flags & APP_EVENT_COALESCE)
+    {
+        b_Replaced  = EventDispatcher_LaneReplace(pLane, u8_Idx, &u8_OldIdx);
+        b_Coalesced = b_Replaced;
+    }
+
+    if(b_Replaced == false)
+    {
+        pLane->au8_Idx[(pLane->u8_Head + pLane->u8_Cnt) % MOD_EVENT_DISP_POOL_SIZE] = u8_Idx;
+        pLane->u8_Cnt++;
+    }
+
+    Stats.u32_Posted++;
+    Stats.u32_Coalesced     += b_Coalesced ? 1 : 0;
+    Stats.u32_QueueHighWater = MAX(Stats.u32_QueueHighWater, (uint32_t)(Lanes[EVENT_DISP_LANE_URGENT].u8_Cnt + Lanes[EVENT_DISP_LANE_ROUTINE].u8_Cnt));
+
+    pEventStats = EventDispatcher_EventStats(event_base, s32_EventID);
+    if(pEventStats != NULL)
+    {
+        pEventStats->u32_Posted++;
+        pEventStats->u32_Coalesced += b_Coalesced ? 1 : 0;
+    }
+    portEXIT_CRITICAL(&DispLock);
+
+    if(b_Coalesced)
+    {
+        ESP_LOGD(EVENT_DISP_TAG, "Event %s:%ld coalesced", event_base, s32_EventID);
+        xQueueSend(FreeSlots, &u8_OldIdx, 0);
+    }
+
+    if(b_Replaced == false)
+    {
+        xTaskNotifyGive(DispatcherTask);
+    }
+}
+
+
+/// @brief       Give a borrowed slot back without posting it
+/// @param pData Pointer returned by EventDispatcher_Borrow(..)
+void EventDispatcher_Return(void *pData)
+{
+    EVENT_DISP_SLOT_t *pSlot = EventDispatcher_GetSlot(pData);
+    uint8_t u8_Idx;
+
+    if(pSlot != NULL)
+    {
+        u8_Idx = (uint8_t)(pSlot - Pool);
+        xQueueSend(FreeSlots, &u8_Idx, 0);
+    }
+}
+
+
+/// @brief                 Post an event without blocking the calling task
 /// @param event_base      Pre-defined bases are in app_events.h
 /// @param s32_EventID     Pre-defined event IDs are in app_events.h
-/// @param event_data      A pointer to the event data. Example (const void*)(&MyIntVariable)
-/// @param event_data_size Size of the event data
-/// @param ticks_to_wait   Number of ticks to wait (blocking calling task) in case the event loop is already full
-/// @note A deep copy of the event data will be created on the heap. 
-void EventDispatcher_PostEvent(esp_event_base_t event_base, int32_t s32_EventID, const void* event_data, size_t event_data_size, TickType_t ticks_to_wait)
+/// @param event_data      A pointer to the event data. NULL if the event has no data
+/// @param event_data_size Size of the event data, max. MOD_EVENT_DISP_SLOT_SIZE
+/// @param Overflow        What to do if the pool is empty
+/// @return                ESP_OK, ESP_ERR_INVALID_SIZE if the data does not fit into a slot,
+///                        ESP_ERR_NO_MEM if the event has been dropped
+esp_err_t EventDispatcher_TryPostEvent(esp_event_base_t event_base, int32_t s32_EventID, const void* event_data, size_t event_data_size, EVENT_DISP_OVERFLOW_t Overflow)
 {
-    ESP_ERROR_CHECK(esp_event_post_to(general_app_event_loop, event_base, s32_EventID, event_data, event_data_size, ticks_to_wait));
+    void *pData;
+
+    if(event_data_size > MOD_EVENT_DISP_SLOT_SIZE)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    pData = EventDispatcher_Borrow(event_data_size, 0, Overflow);
+
+    if(pData == NULL)
+    {
+        EventDispatcher_CountDropped(event_base, s32_EventID);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if(event_data_size > 0)
+    {
+        memcpy(pData, event_data, event_data_size);
+    }
+
+    EventDispatcher_PostBorrowed(pData, event_base, s32_EventID);
+
+    return ESP_OK;
+}
+
+
+/// @brief        Get the statistics of the dispatcher since start
+/// @param pStats Statistics
+void EventDispatcher_GetStats(EVENT_DISP_STATS_t *pStats)
+{
+    portENTER_CRITICAL(&DispLock);
+    *pStats = Stats;
+    portEXIT_CRITICAL(&DispLock);
+
+    pStats->u32_StackHighWater = (DispatcherTask != NULL) ? uxTaskGetStackHighWaterMark(DispatcherTask) : 0;
+}
+
+
+/// @brief         Get the statistics of one event since start
+/// @param u32_Idx 0 .. EVENT_DISP_STATS_t.u32_EventCnt - 1, in order of the first post
+/// @param pStats  Statistics of the event
+/// @return        false if u32_Idx is out of range
+bool EventDispatcher_GetEventStats(uint32_t u32_Idx, EVENT_DISP_EVENT_STATS_t *pStats)
+{
+    bool b_Valid;
+
+    portENTER_CRITICAL(&DispLock);
+    b_Valid = (u32_Idx < Stats.u32_EventCnt);
+    if(b_Valid)
+    {
+        *pStats = EventStats[u32_Idx];
+    }
+    portEXIT_CRITICAL(&DispLock);
+
+    return b_Valid;
 }
-/*****************************END OF FILE**************************************/
 
+
+/// @brief Write all statistics to the log. Bins of the histograms: <16us <64us <256us <1ms <4ms <16ms <64ms >=64ms
+/// @param void
+void EventDispatcher_DumpStats( void )
+{
+    EVENT_DISP_STATS_t       Total;
+    EVENT_DISP_EVENT_STATS_t Event;
+
+    EventDispatcher_GetStats(&Total);
+
+    ESP_LOGI(EVENT_DISP_TAG, "Posted %lu, dropped %lu, coalesced %lu, handled %lu. Queue max %lu of %d, stack free min %lu bytes",
+             Total.u32_Posted, Total.u32_Dropped, Total.u32_Coalesced, Total.u32_Handled, 
+             Total.u32_QueueHighWater, MOD_EVENT_DISP_POOL_SIZE, Total.u32_StackHighWater);
+
+    for(uint32_t u32_Idx = 0; EventDispatcher_GetEventStats(u32_Idx, &Event); u32_Idx++)
+    {
+        ESP_LOGI(EVENT_DISP_TAG, "%s: posted %lu, dropped %lu, coalesced %lu, handled %lu, unhandled %lu",
+                 app_event_to_str(Event.Base, Event.s32_EventID),
+                 Event.u32_Posted, Event.u32_Dropped, Event.u32_Coalesced, Event.u32_Handled, Event.u32_Unhandled);
+        EventDispatcher_LogHist("wait", Event.au32_Wait, Event.u32_MaxWait_us);
+        EventDispatcher_LogHist("exec", Event.au32_Exec, Event.u32_MaxExec_us);
+    }
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief              Dispatcher task. Calls the handlers of each posted event and frees the slot afterwards.
+///                     The urgent lane is checked again before each event.
+/// @param pvParameters Not used
+static void EventDispatcher_Task(void *pvParameters)
+{
+    uint8_t u8_Idx;
+    bool    b_Posted;
+
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        do
+        {
+            portENTER_CRITICAL(&DispLock);
+            b_Posted = EventDispatcher_LanePop(&Lanes[EVENT_DISP_LANE_URGENT],  &u8_Idx) ||
+                       EventDispatcher_LanePop(&Lanes[EVENT_DISP_LANE_ROUTINE], &u8_Idx);
+            portEXIT_CRITICAL(&DispLock);
+
+            if(b_Posted)
+            {
+                const EVENT_DISP_SLOT_t *pSlot = &Pool[u8_Idx];
+                EVENT_DISP_EVENT_STATS_t *pEventStats;
+                int64_t  s64_Start_us = esp_timer_get_time( );
+                uint32_t u32_Handlers = EventDispatcher_Dispatch(pSlot);
+                uint32_t u32_Wait_us  = (uint32_t)(s64_Start_us - pSlot->s64_Post_us);
+                uint32_t u32_Exec_us  = (uint32_t)(esp_timer_get_time( ) - s64_Start_us);
+
+                portENTER_CRITICAL(&DispLock);
+                Stats.u32_Handled++;
+                pEventStats = EventDispatcher_EventStats(pSlot->Base, pSlot->s32_EventID);
+                if(pEventStats != NULL)
+                {
+                    pEventStats->u32_Handled++;
+                    pEventStats->u32_Unhandled += (u32_Handlers == 0) ? 1 : 0;
+                    pEventStats->au32_Wait[EventDispatcher_HistBin(u32_Wait_us)]++;
+                    pEventStats->au32_Exec[EventDispatcher_HistBin(u32_Exec_us)]++;
+                    pEventStats->u32_MaxWait_us = MAX(pEventStats->u32_MaxWait_us, u32_Wait_us);
+                    pEventStats->u32_MaxExec_us = MAX(pEventStats->u32_MaxExec_us, u32_Exec_us);
+                }
+                portEXIT_CRITICAL(&DispLock);
+
+                xQueueSend(FreeSlots, &u8_Idx, 0);
+            }
+
+        }while(b_Posted);
+    }
+}
+
+
+/// @brief       Call all handlers subscribed to the event of the slot
+/// @param pSlot Posted slot
+/// @return      Number of called handlers
+static uint32_t EventDispatcher_Dispatch(const EVENT_DISP_SLOT_t *pSlot)
+{
+    void    *pData   = (pSlot->DataSize > 0) ? (void*)pSlot->Data.au8 : NULL;
+
+#ifdef CONFIG_APP_FLIGHT_REC
+    mod_frec_Event((uint8_t)app_event_get_base_idx(pSlot->Base), pSlot->s32_EventID, pData, pSlot->DataSize);
+#endif
+
+#ifdef CONFIG_APP_EVENT_STATIC_ROUTING
+    esp_event_handler_t Handler = app_event_get_route(pSlot->Base, pSlot->s32_EventID);
+
+    if(Handler == NULL)
+    {
+        return 0;
+    }
+
+    Handler(NULL, pSlot->Base, pSlot->s32_EventID, pData);
+
+    return 1;
+#else
+    uint32_t u32_Handlers = 0;
+    bool     b_Valid      = true;
+
+    portENTER_CRITICAL(&DispLock);
+    u32_DispatchSeq++;
+    portEXIT_CRITICAL(&DispLock);
+
+    for(uint32_t u32_Idx = 0; b_Valid; u32_Idx++)
+    {
+        EVENT_DISP_HANDLER_t Entry;
+
+        /*Copy the entry, it can be changed by (un)register while the handler runs*/
+        portENTER_CRITICAL(&DispLock);
+        b_Valid = (u32_Idx < u32_HandlerCnt);
+        if(b_Valid)
+        {
+            Entry = Handlers[u32_Idx];
+        }
+        portEXIT_CRITICAL(&DispLock);
+
+        if(b_Valid && (Entry.Handler != NULL) && (Entry.Base == pSlot->Base) &&     /*NULL if unregistered*/
+           ((Entry.s32_EventID == pSlot->s32_EventID) || (Entry.s32_EventID == ESP_EVENT_ANY_ID)))
+        {
+            Entry.Handler(Entry.pArg, pSlot->Base, pSlot->s32_EventID, pData);
+            u32_Handlers++;
+        }
+    }
+
+    portENTER_CRITICAL(&DispLock);
+    u32_DispatchSeq++;
+    portEXIT_CRITICAL(&DispLock);
+
+    return u32_Handlers;
+#endif
+}
+
+
+/// @brief       Get the slot of a pointer returned by EventDispatcher_Borrow(..)
+/// @param pData Pointer to the data of the slot
+/// @return      The slot or NULL if pData is not part of the pool
+static EVENT_DISP_SLOT_t *EventDispatcher_GetSlot(void *pData)
+{
+    EVENT_DISP_SLOT_t *pSlot;
+
+    if(pData == NULL)
+    {
+        return NULL;
+    }
+
+    pSlot = (EVENT_DISP_SLOT_t*)((uint8_t*)pData - offsetof(EVENT_DISP_SLOT_t, Data));
+
+    if((pSlot < &Pool[0]) || (pSlot >= &Pool[MOD_EVENT_DISP_POOL_SIZE]))
+    {
+        return NULL;
+    }
+
+    return pSlot;
+}
+
+
+/// @brief         Remove the oldest slot of a lane. Must be called with DispLock taken.
+/// @param pLane   Lane
+/// @param pu8_Idx Index of the removed slot
+/// @return        false if the lane is empty
+static bool EventDispatcher_LanePop(EVENT_DISP_LANE_t *pLane, uint8_t *pu8_Idx)
+{
+    if(pLane->u8_Cnt == 0)
+    {
+        return false;
+    }
+
+    *pu8_Idx       = pLane->au8_Idx[pLane->u8_Head];
+    pLane->u8_Head = (pLane->u8_Head + 1) % MOD_EVENT_DISP_POOL_SIZE;
+    pLane->u8_Cnt--;
+
+    return true;
+}
+
+
+/// @brief            Replace a queued slot with the same base and ID by a new slot. The new slot takes over the
+///                   queue position and the post time. Must be called with DispLock taken.
+/// @param pLane      Lane
+/// @param u8_NewIdx  Index of the new slot
+/// @param pu8_OldIdx Index of the replaced slot. It has to be freed by the caller.
+/// @return           false if no event with the same base and ID is queued
+static bool EventDispatcher_LaneReplace(EVENT_DISP_LANE_t *pLane, uint8_t u8_NewIdx, uint8_t *pu8_OldIdx)
+{
+    const EVENT_DISP_SLOT_t *pNew = &Pool[u8_NewIdx];
+
+    for(uint8_t u8_Pos = 0; u8_Pos < pLane->u8_Cnt; u8_Pos++)
+    {
+        uint8_t *pu8_Entry = &pLane->au8_Idx[(pLane->u8_Head + u8_Pos) % MOD_EVENT_DISP_POOL_SIZE];
+
+        if((Pool[*pu8_Entry].Base == pNew->Base) && (Pool[*pu8_Entry].s32_EventID == pNew->s32_EventID))
+        {
+            /*The event waits since the first post. Otherwise the wait statistics hide a starved event.*/
+            Pool[u8_NewIdx].s64_Post_us = Pool[*pu8_Entry].s64_Post_us;
+            *pu8_OldIdx = *pu8_Entry;
+            *pu8_Entry  = u8_NewIdx;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/// @brief            Remove the queued link state event of a base. Must be called with DispLock taken.
+/// @param pLane      Lane
+/// @param event_base Event base
+/// @param pu8_OldIdx Index of the removed slot. It has to be freed by the caller.
+/// @return           false if no link state event of the base is queued
+/// @note  There is never more than one, each link state event removes the one before.
+static bool EventDispatcher_LaneSupersede(EVENT_DISP_LANE_t *pLane, esp_event_base_t event_base, uint8_t *pu8_OldIdx)
+{
+    for(uint8_t u8_Pos = 0; u8_Pos < pLane->u8_Cnt; u8_Pos++)
+    {
+        uint8_t u8_Idx = pLane->au8_Idx[(pLane->u8_Head + u8_Pos) % MOD_EVENT_DISP_POOL_SIZE];
+
+        if((Pool[u8_Idx].Base == event_base) && (Pool[u8_Idx].u8_Flags & APP_EVENT_LINK_STATE))
+        {
+            *pu8_OldIdx = u8_Idx;
+            EventDispatcher_LaneRemove(pLane, u8_Pos);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/// @brief         Remove the oldest slot of a lane which is flagged APP_EVENT_DROPPABLE. Must be called with DispLock taken.
+/// @param pLane   Lane
+/// @param pu8_Idx Index of the removed slot
+/// @return        false if the lane holds no droppable event
+static bool EventDispatcher_LaneEvict(EVENT_DISP_LANE_t *pLane, uint8_t *pu8_Idx)
+{
+    for(uint8_t u8_Pos = 0; u8_Pos < pLane->u8_Cnt; u8_Pos++)
+    {
+        uint8_t u8_Idx = pLane->au8_Idx[(pLane->u8_Head + u8_Pos) % MOD_EVENT_DISP_POOL_SIZE];
+
+        if(Pool[u8_Idx].u8_Flags & APP_EVENT_DROPPABLE)
+        {
+            *pu8_Idx = u8_Idx;
+            EventDispatcher_LaneRemove(pLane, u8_Pos);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/// @brief        Remove an entry of a lane. The younger entries move up. Must be called with DispLock taken.
+/// @param pLane  Lane
+/// @param u8_Pos Position of the entry, 0 is the oldest
+static void EventDispatcher_LaneRemove(EVENT_DISP_LANE_t *pLane, uint8_t u8_Pos)
+{
+    for(; u8_Pos < (pLane->u8_Cnt - 1); u8_Pos++)
+    {
+        pLane->au8_Idx[(pLane->u8_Head + u8_Pos) % MOD_EVENT_DISP_POOL_SIZE] = 
+            pLane->au8_Idx[(pLane->u8_Head + u8_Pos + 1) % MOD_EVENT_DISP_POOL_SIZE];
+    }
+
+    pLane->u8_Cnt--;
+}
+
+
+/// @brief             Statistics entry of an event. Must be called with DispLock taken.
+/// @param event_base  Event base
+/// @param s32_EventID Event ID
+/// @return            The entry, a new one on the first call. NULL if all MOD_EVENT_DISP_MAX_EVENTS entries are used.
+static EVENT_DISP_EVENT_STATS_t *EventDispatcher_EventStats(esp_event_base_t event_base, int32_t s32_EventID)
+{
+    for(uint32_t u32_Idx = 0; u32_Idx < Stats.u32_EventCnt; u32_Idx++)
+    {
+        if((EventStats[u32_Idx].Base == event_base) && (EventStats[u32_Idx].s32_EventID == s32_EventID))
+        {
+            return &EventStats[u32_Idx];
+        }
+    }
+
+    if(Stats.u32_EventCnt >= MOD_EVENT_DISP_MAX_EVENTS)
+    {
+        return NULL;
+    }
+
+    EventStats[Stats.u32_EventCnt].Base        = event_base;
+    EventStats[Stats.u32_EventCnt].s32_EventID = s32_EventID;
+
+    return &EventStats[Stats.u32_EventCnt++];
+}
+
+
+/// @brief             Histogram bin of a time
+/// @param u32_Time_us Time in us
+/// @return            0 for < 16us, each further bin is 4 times wider
+static uint8_t EventDispatcher_HistBin(uint32_t u32_Time_us)
+{
+    uint8_t u8_Bin = 0;
+
+    u32_Time_us >>= 4;
+    while((u32_Time_us > 0) && (u8_Bin < (MOD_EVENT_DISP_HIST_BINS - 1)))
+    {
+        u32_Time_us >>= 2;
+        u8_Bin++;
+    }
+
+    return u8_Bin;
+}
+
+
+/// @brief             Count a new event which has been dropped because the pool was empty
+/// @param event_base  Event base
+/// @param s32_EventID Event ID
+static void EventDispatcher_CountDropped(esp_event_base_t event_base, int32_t s32_EventID)
+{
+    EVENT_DISP_EVENT_STATS_t *pEventStats;
+
+    portENTER_CRITICAL(&DispLock);
+    pEventStats = EventDispatcher_EventStats(event_base, s32_EventID);
+    if(pEventStats != NULL)
+    {
+        pEventStats->u32_Dropped++;
+    }
+    portEXIT_CRITICAL(&DispLock);
+}
+
+
+/// @brief           Write one histogram as a log line
+/// @param pc_Name   Name of the histogram
+/// @param pu32_Bins MOD_EVENT_DISP_HIST_BINS bins
+/// @param u32_Max_us Max. time
+static void EventDispatcher_LogHist(const char *pc_Name, const uint32_t *pu32_Bins, uint32_t u32_Max_us)
+{
+    char ac_Line[MOD_EVENT_DISP_HIST_BINS * 11 + 1];
+    int  s32_Len = 0;
+
+    for(uint8_t u8_Bin = 0; u8_Bin < MOD_EVENT_DISP_HIST_BINS; u8_Bin++)
+    {
+        s32_Len += snprintf(&ac_Line[s32_Len], sizeof(ac_Line) - s32_Len, " %lu", pu32_Bins[u8_Bin]);
+    }
+
+    ESP_LOGI(EVENT_DISP_TAG, "  %s:%s, max %lu us", pc_Name, ac_Line, u32_Max_us);
+}
+/*****************************END OF FILE**************************************/
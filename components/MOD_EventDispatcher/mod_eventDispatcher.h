@@ -3,7 +3,8 @@
   * @file    mod_eventDispatcher.h
   * @author  The Embedded Dude
   * @brief   Event dispatching module
-  *          Handles events in the system using the ESP event library (simple wrapper)
+  *          Handles events in the system. The event data is stored in a fixed
+  *          size pool, no heap is used on the event path.
   * @date    Git controlled
   * @version Git controlled
 
@@ -15,9 +16,38 @@
        EventDispatcher_Start(..)
     2. Once the module is running clients can register event handler and subscribe
        to events. Events are defined in app_events.h
-    3. Clients can post events using EventDispatcher_PostEvent(..)
-    4. Queue and stack sizes can be changed by modifying MOD_EVENT_DISP_QUEUE_SIZE 
-       and MOD_EVENT_DISP_STACK_SIZE
+       The returned handle is owned by the client. A module which is started and
+       stopped more than once releases it with EventDispatcher_UnregisterEventHandler(..)
+       in its de-init function. EventDispatcher_AuditHandlers() logs the handlers
+       per event and warns about duplicates and a growing number of handlers.
+       With CONFIG_APP_EVENT_STATIC_ROUTING the handlers are not registered. Each event
+       is routed to one handler by APP_EVENT_ROUTES in app_events.h
+    3. Clients post events using EventDispatcher_TryPostEvent(..). It never blocks
+       and returns an error if the event has been dropped, so it can be used from
+       driver callbacks (Wi-Fi, MQTT, ESP-NOW) and event handlers.
+    4. Zero-copy: EventDispatcher_Borrow(..) returns a pool slot, the client fills
+       it in place and posts it with EventDispatcher_PostBorrowed(..). A slot which
+       shall not be posted anymore is given back with EventDispatcher_Return(..)
+    5. The slot is freed after the last handler has been called. The event data is
+       only valid during the handler call.
+    6. If the pool is empty the overflow policy decides: EVENT_DISP_DROP_NEWEST
+       discards the new event, EVENT_DISP_DROP_OLDEST discards the oldest event
+       flagged APP_EVENT_DROPPABLE which has not been dispatched yet (routine events
+       first). Events which carry a state are never discarded for a new one. If no
+       droppable event is queued the new event is discarded and logged as error.
+    7. Posted events wait in two lanes. Events flagged APP_EVENT_URGENT in
+       app_event_get_flags(..) overtake all routine events. An event flagged
+       APP_EVENT_COALESCE replaces a queued event with the same base and ID. It keeps
+       the queue position and the post time of the old one and carries the new data.
+       An event flagged APP_EVENT_LINK_STATE removes the queued link state event of
+       its base, whatever its ID, and is queued at the end. All link state events of
+       a base must be in the same lane, so the latest state is always dispatched last.
+    8. Pool, slot and stack sizes can be changed by modifying MOD_EVENT_DISP_POOL_SIZE,
+       MOD_EVENT_DISP_SLOT_SIZE, MOD_EVENT_DISP_MAX_HANDLERS and MOD_EVENT_DISP_STACK_SIZE
+       in mod_eventDispatcher.h
+    9. EventDispatcher_GetStats(..) and EventDispatcher_GetEventStats(..) return the
+       counters, the queue-wait and handler times and the high-water marks.
+       EventDispatcher_DumpStats() writes all of them to the log.
 
   @endverbatim
   ******************************************************************************
@@ -55,6 +85,8 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_event.h"
 #include "esp_event_base.h"
@@ -66,12 +98,60 @@ extern "C" {
 #endif
 
 
+/* Exported defines ----------------------------------------------------------*/
+#define MOD_EVENT_DISP_POOL_SIZE     8      /*Max. number of events waiting for dispatch*/
+#define MOD_EVENT_DISP_SLOT_SIZE     16     /*Max. size of the event data in bytes*/
+#define MOD_EVENT_DISP_MAX_HANDLERS  16
+#define MOD_EVENT_DISP_STACK_SIZE    3072
+#define MOD_EVENT_DISP_MAX_EVENTS    24     /*Max. number of events (base and ID) with own statistics*/
+#define MOD_EVENT_DISP_HIST_BINS     8      /*Bin n counts times below 16us * 4^n, the last bin all above*/
+
+
 /* Exported types ------------------------------------------------------------*/
+/// @brief What happens to an event if the payload pool is empty
+typedef enum
+{
+    EVENT_DISP_DROP_NEWEST = 0,     //!< The new event is discarded
+    EVENT_DISP_DROP_OLDEST,         //!< The oldest APP_EVENT_DROPPABLE event which has not been dispatched yet is discarded.
+                                    //!< The new event if none is queued.
 
+}EVENT_DISP_OVERFLOW_t;
+
+
+/// @brief Handle of a registered event handler. NULL if not registered.
+typedef struct EVENT_DISP_HANDLER_t *EVENT_DISP_HANDLE_t;
 
-/* Exported defines ----------------------------------------------------------*/
-#define MOD_EVENT_DISP_QUEUE_SIZE  5 
-#define MOD_EVENT_DISP_STACK_SIZE  3072
+
+/// @brief Statistics of one event (base and ID). Times are log bucketed, see MOD_EVENT_DISP_HIST_BINS.
+typedef struct EVENT_DISP_EVENT_STATS_t
+{
+    esp_event_base_t Base;
+    int32_t          s32_EventID;
+    uint32_t         u32_Posted;
+    uint32_t         u32_Dropped;                               //!< Discarded because the pool was empty
+    uint32_t         u32_Coalesced;                             //!< Merged into a queued event
+    uint32_t         u32_Handled;                               //!< Dispatched
+    uint32_t         u32_Unhandled;                             //!< Dispatched, but no handler registered
+    uint32_t         au32_Wait[MOD_EVENT_DISP_HIST_BINS];       //!< Time from post to dispatch
+    uint32_t         au32_Exec[MOD_EVENT_DISP_HIST_BINS];       //!< Time of all handler calls
+    uint32_t         u32_MaxWait_us;
+    uint32_t         u32_MaxExec_us;
+
+}EVENT_DISP_EVENT_STATS_t;
+
+
+/// @brief Statistics of the dispatcher
+typedef struct EVENT_DISP_STATS_t
+{
+    uint32_t u32_Posted;
+    uint32_t u32_Dropped;
+    uint32_t u32_Coalesced;
+    uint32_t u32_Handled;
+    uint32_t u32_QueueHighWater;                                //!< Max. number of events waiting for dispatch
+    uint32_t u32_StackHighWater;                                //!< Min. free stack of the dispatcher task in bytes
+    uint32_t u32_EventCnt;                                      //!< Number of events with own statistics
+
+}EVENT_DISP_STATS_t;
 
 
 /* Exported constants --------------------------------------------------------*/
@@ -82,8 +162,18 @@ extern "C" {
 
 /* Exported functions --------------------------------------------------------*/
 void EventDispatcher_Start( void );
-void EventDispatcher_RegisterEventHandler(esp_event_base_t event_base, int32_t s32_EventID, esp_event_handler_t event_handler, void* event_handler_arg);
-void EventDispatcher_PostEvent(esp_event_base_t event_base, int32_t s32_EventID, const void* event_data, size_t event_data_size, TickType_t ticks_to_wait);
+#ifndef CONFIG_APP_EVENT_STATIC_ROUTING
+void EventDispatcher_RegisterEventHandler(esp_event_base_t event_base, int32_t s32_EventID, esp_event_handler_t event_handler, void* event_handler_arg, EVENT_DISP_HANDLE_t *pHandle);
+void EventDispatcher_UnregisterEventHandler(EVENT_DISP_HANDLE_t *pHandle);
+void EventDispatcher_AuditHandlers( void );
+#endif
+esp_err_t EventDispatcher_TryPostEvent(esp_event_base_t event_base, int32_t s32_EventID, const void* event_data, size_t event_data_size, EVENT_DISP_OVERFLOW_t Overflow);
+void *EventDispatcher_Borrow(size_t event_data_size, TickType_t ticks_to_wait, EVENT_DISP_OVERFLOW_t Overflow);
+void EventDispatcher_PostBorrowed(void *pData, esp_event_base_t event_base, int32_t s32_EventID);
+void EventDispatcher_Return(void *pData);
+void EventDispatcher_GetStats(EVENT_DISP_STATS_t *pStats);
+bool EventDispatcher_GetEventStats(uint32_t u32_Idx, EVENT_DISP_EVENT_STATS_t *pStats);
+void EventDispatcher_DumpStats( void );
 
 
 /* Initialization and de-initialization functions *****************************/
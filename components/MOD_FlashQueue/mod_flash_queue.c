@@ -0,0 +1,554 @@
+/**
+  ******************************************************************************
+  * @file    mod_flash_queue.c
+  * @author  The Embedded Dude
+  * @brief   Flash queue for store-and-forward reporting.
+  *          Append-only log of small records with a CRC on a dedicated flash
+  *          partition. Keeps the reports which could not be sent over resets
+  *          and power loss until the backend is reachable again.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### Flash layout #####
+  ==============================================================================
+    The partition is a ring of 4 kB sectors. A sector in use starts with a
+    sector header {magic, sequence number}. The sector with the highest
+    sequence number is the head which is written to. Records follow back to
+    back, 4 byte aligned:
+
+      state (1) | len (1) | reserved (2) | CRC32 of len and payload (4) | payload
+
+    State 0xFF: free, 0xFE: valid, 0xFC: sent. A record is written in one go
+    and only marked as sent later by clearing bits. A torn write fails the CRC
+    and is skipped. A header which cannot be parsed closes the sector.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "mod_flash_queue.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+/// @brief Header at the start of a sector in use
+typedef struct FQ_SECTOR_HDR_t
+{
+    uint32_t u32_Magic;                 //!< FQ_SECTOR_MAGIC
+    uint32_t u32_Seq;                   //!< Incremented with every new head sector
+
+}FQ_SECTOR_HDR_t;
+
+/// @brief Header in front of each record
+typedef struct FQ_RECORD_HDR_t
+{
+    uint8_t  u8_State;                  //!< FQ_REC_*
+    uint8_t  u8_Len;                    //!< Payload length
+    uint16_t u16_Reserved;              //!< 0xFFFF
+    uint32_t u32_Crc;                   //!< CRC32 of u8_Len and the payload
+
+}FQ_RECORD_HDR_t;
+
+/// @brief Position in the partition
+typedef struct FQ_POS_t
+{
+    uint32_t u32_Sector;
+    uint32_t u32_Offset;                //!< Offset within the sector
+
+}FQ_POS_t;
+
+/// @brief Read and write positions. Kept in RTC memory, rebuilt from flash on a cold boot.
+typedef struct FQ_STATE_t
+{
+    uint32_t u32_Magic;                 //!< FQ_RTC_MAGIC
+    uint32_t u32_PartAddr;              //!< Partition the state belongs to
+    uint32_t u32_Sectors;
+    FQ_POS_t Head;                      //!< The next record is written here
+    uint32_t u32_HeadSeq;               //!< Sequence number of the head sector
+    FQ_POS_t Tail;                      //!< The oldest unsent record is here or after
+    uint32_t u32_Pending;
+    uint32_t u32_Dropped;
+    uint32_t u32_Erases;
+    uint32_t u32_Crc;                   //!< CRC32 of all members above
+
+}FQ_STATE_t;
+
+
+/* Private define ------------------------------------------------------------*/
+#define FQ_SECTOR_SIZE          4096
+#define FQ_SECTOR_MAGIC         0x31305146  //!< "FQ01". Change if the flash layout changes.
+#define FQ_RTC_MAGIC            0x46515354  //!< Change if FQ_STATE_t changes.
+
+#define FQ_SECTOR_HDR_SIZE      sizeof(FQ_SECTOR_HDR_t)
+#define FQ_REC_HDR_SIZE         sizeof(FQ_RECORD_HDR_t)
+
+#define FQ_REC_VALID            0xFE
+#define FQ_REC_SENT             0xFC
+
+#define TAG_FQ                  "FQ"
+
+
+/* Private macro -------------------------------------------------------------*/
+#define FQ_REC_SIZE(len)        (FQ_REC_HDR_SIZE + (((uint32_t)(len) + 3u) & ~3u))
+#define FQ_ADDR(pos)            ((pos).u32_Sector * FQ_SECTOR_SIZE + (pos).u32_Offset)
+
+
+/* Private constants ---------------------------------------------------------*/
+_Static_assert(FQ_REC_SIZE(FQ_RECORD_MAX_LEN) <= FQ_SECTOR_SIZE - FQ_SECTOR_HDR_SIZE, "FQ_RECORD_MAX_LEN does not fit into a sector");
+_Static_assert(FQ_RECORD_MAX_LEN < 0xFF, "0xFF marks an erased record length");
+
+
+/* Private variables ---------------------------------------------------------*/
+/*Survives deep sleep. Checked by mod_fq_Init(..)*/
+RTC_DATA_ATTR static FQ_STATE_t Fq;
+
+static const esp_partition_t *pFqPart;
+static bool b_FqInit;
+static esp_err_t FqStatus = ESP_ERR_INVALID_STATE;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static bool fq_StateValid(void);
+static void fq_Save(void);
+static void fq_Scan(void);
+static bool fq_Seek(FQ_POS_t *pPos, FQ_RECORD_HDR_t *pHdr, uint8_t *pu8_Payload);
+static esp_err_t fq_NextSector(void);
+static esp_err_t fq_ReadHdr(const FQ_POS_t *pPos, FQ_RECORD_HDR_t *pHdr);
+static bool fq_HdrErased(const FQ_RECORD_HDR_t *pHdr);
+static uint32_t fq_Crc(const uint8_t *pData, uint8_t u8_Len);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief  Looks up the partition and restores the positions from RTC memory. Scans the partition after a cold boot.
+/// @return ESP_OK, ESP_ERR_NOT_FOUND without FQ_PARTITION_LABEL partition, ESP_ERR_INVALID_SIZE if it is smaller than 2 sectors
+/// @note   Only runs once per boot. Later calls return the first result.
+esp_err_t mod_fq_Init(void)
+{
+    if(b_FqInit)
+        return FqStatus;
+
+    b_FqInit = true;
+    pFqPart  = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, FQ_PARTITION_LABEL);
+
+    if(pFqPart == NULL)
+    {
+        ESP_LOGW(TAG_FQ, "No '%s' partition. Unsent reports are not stored", FQ_PARTITION_LABEL);
+        FqStatus = ESP_ERR_NOT_FOUND;
+        return FqStatus;
+    }
+
+    if((pFqPart->size < 2 * FQ_SECTOR_SIZE) || (pFqPart->size % FQ_SECTOR_SIZE != 0))
+    {
+        ESP_LOGE(TAG_FQ, "Partition size %lu is not a multiple of 2 or more sectors", (uint32_t)(pFqPart->size));
+        FqStatus = ESP_ERR_INVALID_SIZE;
+        return FqStatus;
+    }
+
+    if(fq_StateValid( ) == false)
+    {
+        fq_Scan( );
+        fq_Save( );
+        ESP_LOGI(TAG_FQ, "Scanned %lu sectors: %lu records pending, head %lu/%lu", Fq.u32_Sectors, Fq.u32_Pending, Fq.Head.u32_Sector, Fq.Head.u32_Offset);
+    }
+
+    FqStatus = ESP_OK;
+    return FqStatus;
+}
+
+
+/// @brief       Appends a record
+/// @param pData Payload
+/// @param Len   Length of pData. 1..FQ_RECORD_MAX_LEN
+/// @return      ESP_OK or the error of mod_fq_Init(..) or the flash access
+/// @note        Erases the next sector if the head sector is full. If the ring is full the
+///              unsent records of the oldest sector are dropped.
+esp_err_t mod_fq_Append(const uint8_t *pData, size_t Len)
+{
+    uint8_t au8_Record[FQ_REC_SIZE(FQ_RECORD_MAX_LEN)];
+    FQ_RECORD_HDR_t Hdr;
+    uint32_t u32_Size = FQ_REC_SIZE(Len);
+    esp_err_t ret = mod_fq_Init( );
+
+    if(ret != ESP_OK)
+        return ret;
+
+    if((pData == NULL) || (Len == 0) || (Len > FQ_RECORD_MAX_LEN))
+        return ESP_ERR_INVALID_ARG;
+
+    if(Fq.Head.u32_Offset + u32_Size > FQ_SECTOR_SIZE)
+    {
+        ret = fq_NextSector( );
+        if(ret != ESP_OK)
+            return ret;
+    }
+
+    Hdr.u8_State     = FQ_REC_VALID;
+    Hdr.u8_Len       = (uint8_t)(Len);
+    Hdr.u16_Reserved = 0xFFFF;
+    Hdr.u32_Crc      = fq_Crc(pData, Hdr.u8_Len);
+
+    memset(au8_Record, 0xFF, u32_Size);
+    memcpy(au8_Record, &Hdr, FQ_REC_HDR_SIZE);
+    memcpy(&au8_Record[FQ_REC_HDR_SIZE], pData, Len);
+
+    //Header and payload in one write. A failed write leaves a record which fails the CRC and is skipped.
+    ret = esp_partition_write(pFqPart, FQ_ADDR(Fq.Head), au8_Record, u32_Size);
+    Fq.Head.u32_Offset += u32_Size;
+
+    if(ret == ESP_OK)
+        Fq.u32_Pending++;
+    else
+        ESP_LOGE(TAG_FQ, "Write failed: %d", ret);
+
+    fq_Save( );
+    return ret;
+}
+
+
+/// @brief  Number of records not marked as sent
+/// @return 0 if the queue is not available
+uint32_t mod_fq_GetCnt(void)
+{
+    if(mod_fq_Init( ) != ESP_OK)
+        return 0;
+
+    return Fq.u32_Pending;
+}
+
+
+/// @brief               Copies the payloads of the oldest unsent records back to back into pBuffer
+/// @param pBuffer       Destination
+/// @param BufferSize    Size of pBuffer
+/// @param u32_MaxCnt    Max. number of records to copy
+/// @param[out] pu32_Cnt Number of records copied. Records which do not fit are left for the next call.
+/// @param[out] pLen     Number of bytes copied
+/// @return              ESP_OK or the error of mod_fq_Init(..)
+/// @note                The records stay unsent until mod_fq_MarkSent(..) is called
+esp_err_t mod_fq_ReadOldest(uint8_t *pBuffer, size_t BufferSize, uint32_t u32_MaxCnt, uint32_t *pu32_Cnt, size_t *pLen)
+{
+    uint8_t au8_Payload[FQ_RECORD_MAX_LEN];
+    FQ_RECORD_HDR_t Hdr;
+    FQ_POS_t Pos;
+    esp_err_t ret = mod_fq_Init( );
+
+    *pu32_Cnt = 0;
+    *pLen     = 0;
+
+    if(ret != ESP_OK)
+        return ret;
+
+    Pos = Fq.Tail;
+
+    while((*pu32_Cnt < u32_MaxCnt) && fq_Seek(&Pos, &Hdr, au8_Payload))
+    {
+        if(*pLen + Hdr.u8_Len > BufferSize)
+            break;
+
+        memcpy(&pBuffer[*pLen], au8_Payload, Hdr.u8_Len);
+        *pLen += Hdr.u8_Len;
+        (*pu32_Cnt)++;
+
+        Pos.u32_Offset += FQ_REC_SIZE(Hdr.u8_Len);
+    }
+
+    return ESP_OK;
+}
+
+
+/// @brief         Marks the oldest unsent records as sent
+/// @param u32_Cnt Number of records, e.g. returned by mod_fq_ReadOldest(..)
+/// @return        ESP_OK or the error of mod_fq_Init(..) or the flash access
+esp_err_t mod_fq_MarkSent(uint32_t u32_Cnt)
+{
+    static const uint8_t u8_Sent = FQ_REC_SENT;
+    uint8_t au8_Payload[FQ_RECORD_MAX_LEN];
+    FQ_RECORD_HDR_t Hdr;
+    esp_err_t ret = mod_fq_Init( );
+
+    if(ret != ESP_OK)
+        return ret;
+
+    //Clears bits of the state byte only. No erase needed.
+    while((u32_Cnt > 0) && fq_Seek(&Fq.Tail, &Hdr, au8_Payload))
+    {
+        ret = esp_partition_write(pFqPart, FQ_ADDR(Fq.Tail), &u8_Sent, sizeof(u8_Sent));
+        if(ret != ESP_OK)
+            break;
+
+        Fq.Tail.u32_Offset += FQ_REC_SIZE(Hdr.u8_Len);
+        if(Fq.u32_Pending > 0)
+            Fq.u32_Pending--;
+        u32_Cnt--;
+    }
+
+    fq_Save( );
+    return ret;
+}
+
+
+/// @brief             Statistics of the flash queue
+/// @param[out] pStats Copy of the statistics. All 0 if the queue is not available
+void mod_fq_GetStats(FQ_STATS_t *pStats)
+{
+    memset(pStats, 0, sizeof(FQ_STATS_t));
+
+    if(mod_fq_Init( ) != ESP_OK)
+        return;
+
+    pStats->u32_Pending = Fq.u32_Pending;
+    pStats->u32_Dropped = Fq.u32_Dropped;
+    pStats->u32_Erases  = Fq.u32_Erases;
+    pStats->u32_Sectors = Fq.u32_Sectors;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief  Checks the state in RTC memory against the partition
+/// @return true after a deep sleep wake up with a valid state of this partition
+static bool fq_StateValid(void)
+{
+    if((Fq.u32_Magic != FQ_RTC_MAGIC) || (Fq.u32_Crc != esp_rom_crc32_le(0, (const uint8_t*)(&Fq), offsetof(FQ_STATE_t, u32_Crc))))
+        return false;
+
+    return (Fq.u32_PartAddr == pFqPart->address) && (Fq.u32_Sectors == pFqPart->size / FQ_SECTOR_SIZE) &&
+           (Fq.Head.u32_Sector < Fq.u32_Sectors) && (Fq.Tail.u32_Sector < Fq.u32_Sectors);
+}
+
+
+/// @brief Marks the state as valid and updates the CRC. Call after every change of Fq.
+static void fq_Save(void)
+{
+    Fq.u32_Magic = FQ_RTC_MAGIC;
+    Fq.u32_Crc   = esp_rom_crc32_le(0, (const uint8_t*)(&Fq), offsetof(FQ_STATE_t, u32_Crc));
+}
+
+
+/// @brief Rebuilds the state from flash. The newest sector is the head, the oldest one holds the tail.
+/// @note  Dropped records and erases are counted from 0 again
+static void fq_Scan(void)
+{
+    uint8_t au8_Payload[FQ_RECORD_MAX_LEN];
+    FQ_SECTOR_HDR_t SectorHdr;
+    FQ_RECORD_HDR_t Hdr;
+    FQ_POS_t Pos;
+    uint32_t u32_OldestSeq = 0;
+    bool b_Used = false;
+
+    memset(&Fq, 0, sizeof(Fq));
+    Fq.u32_PartAddr = pFqPart->address;
+    Fq.u32_Sectors  = pFqPart->size / FQ_SECTOR_SIZE;
+
+    for(uint32_t s = 0; s < Fq.u32_Sectors; s++)
+    {
+        if((esp_partition_read(pFqPart, s * FQ_SECTOR_SIZE, &SectorHdr, sizeof(SectorHdr)) != ESP_OK) || (SectorHdr.u32_Magic != FQ_SECTOR_MAGIC))
+            continue;
+
+        //Sequence numbers compared by their difference. Handles the overflow.
+        if((b_Used == false) || ((int32_t)(SectorHdr.u32_Seq - Fq.u32_HeadSeq) > 0))
+        {
+            Fq.u32_HeadSeq     = SectorHdr.u32_Seq;
+            Fq.Head.u32_Sector = s;
+        }
+
+        if((b_Used == false) || ((int32_t)(SectorHdr.u32_Seq - u32_OldestSeq) < 0))
+        {
+            u32_OldestSeq      = SectorHdr.u32_Seq;
+            Fq.Tail.u32_Sector = s;
+        }
+
+        b_Used = true;
+    }
+
+    if(b_Used == false)
+    {
+        //Empty. The first append starts with sector 0.
+        Fq.Head.u32_Sector = Fq.u32_Sectors - 1;
+        Fq.Head.u32_Offset = FQ_SECTOR_SIZE;
+        Fq.Tail            = Fq.Head;
+        return;
+    }
+
+    //End of the written area of the head sector
+    Fq.Head.u32_Offset = FQ_SECTOR_HDR_SIZE;
+
+    while(Fq.Head.u32_Offset + FQ_REC_HDR_SIZE <= FQ_SECTOR_SIZE)
+    {
+        if((fq_ReadHdr(&Fq.Head, &Hdr) != ESP_OK) || fq_HdrErased(&Hdr))
+            break;
+
+        if(Hdr.u8_Len > FQ_RECORD_MAX_LEN)
+        {
+            Fq.Head.u32_Offset = FQ_SECTOR_SIZE;    /*Corrupted. Close the sector*/
+            break;
+        }
+
+        Fq.Head.u32_Offset += FQ_REC_SIZE(Hdr.u8_Len);
+    }
+
+    if(Fq.Head.u32_Offset > FQ_SECTOR_SIZE)
+        Fq.Head.u32_Offset = FQ_SECTOR_SIZE;
+
+    //Count the unsent records from the oldest sector on
+    Fq.Tail.u32_Offset = FQ_SECTOR_HDR_SIZE;
+
+    if(fq_Seek(&Fq.Tail, &Hdr, au8_Payload) == false)
+        return;
+
+    Pos = Fq.Tail;
+
+    do
+    {
+        Fq.u32_Pending++;
+        Pos.u32_Offset += FQ_REC_SIZE(Hdr.u8_Len);
+    }
+    while(fq_Seek(&Pos, &Hdr, au8_Payload));
+}
+
+
+/// @brief                  Moves pPos to the next valid unsent record at or after pPos. Skips sent and corrupted records.
+/// @param pPos             Position to start from
+/// @param[out] pHdr        Header of the record found
+/// @param[out] pu8_Payload Payload of the record found. FQ_RECORD_MAX_LEN bytes
+/// @return                 true if found. false if the head has been reached, pPos is the head then.
+static bool fq_Seek(FQ_POS_t *pPos, FQ_RECORD_HDR_t *pHdr, uint8_t *pu8_Payload)
+{
+    uint32_t u32_Jumps = 0;
+
+    while((pPos->u32_Sector != Fq.Head.u32_Sector) || (pPos->u32_Offset < Fq.Head.u32_Offset))
+    {
+        if((pPos->u32_Offset + FQ_REC_HDR_SIZE > FQ_SECTOR_SIZE) || (fq_ReadHdr(pPos, pHdr) != ESP_OK) ||
+           fq_HdrErased(pHdr) || (pHdr->u8_Len > FQ_RECORD_MAX_LEN))
+        {
+            //End of the written area. Continue with the next sector of the ring.
+            if((pPos->u32_Sector == Fq.Head.u32_Sector) || (++u32_Jumps > Fq.u32_Sectors))
+                break;
+
+            pPos->u32_Sector = (pPos->u32_Sector + 1) % Fq.u32_Sectors;
+            pPos->u32_Offset = FQ_SECTOR_HDR_SIZE;
+            continue;
+        }
+
+        if((pHdr->u8_State == FQ_REC_VALID) &&
+           (esp_partition_read(pFqPart, FQ_ADDR(*pPos) + FQ_REC_HDR_SIZE, pu8_Payload, pHdr->u8_Len) == ESP_OK) &&
+           (pHdr->u32_Crc == fq_Crc(pu8_Payload, pHdr->u8_Len)))
+            return true;
+
+        pPos->u32_Offset += FQ_REC_SIZE(pHdr->u8_Len);
+    }
+
+    *pPos = Fq.Head;
+    return false;
+}
+
+
+/// @brief  Erases the next sector of the ring and makes it the head. Drops the unsent records in it.
+/// @return ESP_OK or the error of the flash access
+static esp_err_t fq_NextSector(void)
+{
+    uint8_t au8_Payload[FQ_RECORD_MAX_LEN];
+    FQ_RECORD_HDR_t Hdr;
+    FQ_SECTOR_HDR_t SectorHdr = { .u32_Magic = FQ_SECTOR_MAGIC, .u32_Seq = Fq.u32_HeadSeq + 1 };
+    uint32_t u32_Next = (Fq.Head.u32_Sector + 1) % Fq.u32_Sectors;
+    uint32_t u32_Dropped = 0;
+    esp_err_t ret;
+
+    //The ring is full if the tail is in the next sector
+    while(fq_Seek(&Fq.Tail, &Hdr, au8_Payload) && (Fq.Tail.u32_Sector == u32_Next))
+    {
+        Fq.Tail.u32_Offset += FQ_REC_SIZE(Hdr.u8_Len);
+        if(Fq.u32_Pending > 0)
+            Fq.u32_Pending--;
+        u32_Dropped++;
+    }
+
+    if(u32_Dropped > 0)
+    {
+        Fq.u32_Dropped += u32_Dropped;
+        ESP_LOGW(TAG_FQ, "Queue full. %lu records dropped", u32_Dropped);
+    }
+
+    ret = esp_partition_erase_range(pFqPart, u32_Next * FQ_SECTOR_SIZE, FQ_SECTOR_SIZE);
+    Fq.u32_Erases++;
+
+    if(ret == ESP_OK)
+        ret = esp_partition_write(pFqPart, u32_Next * FQ_SECTOR_SIZE, &SectorHdr, sizeof(SectorHdr));
+
+    if(ret != ESP_OK)
+    {
+        ESP_LOGE(TAG_FQ, "Sector %lu could not be prepared: %d", u32_Next, ret);
+        fq_Save( );
+        return ret;
+    }
+
+    Fq.Head.u32_Sector = u32_Next;
+    Fq.Head.u32_Offset = FQ_SECTOR_HDR_SIZE;
+    Fq.u32_HeadSeq     = SectorHdr.u32_Seq;
+
+    return ESP_OK;
+}
+
+
+/// @brief           Reads a record header
+/// @param pPos      Position of the record
+/// @param[out] pHdr Header
+/// @return          Result of esp_partition_read(..)
+static esp_err_t fq_ReadHdr(const FQ_POS_t *pPos, FQ_RECORD_HDR_t *pHdr)
+{
+    return esp_partition_read(pFqPart, FQ_ADDR(*pPos), pHdr, FQ_REC_HDR_SIZE);
+}
+
+
+/// @brief      Checks for an erased (never written) record header
+/// @param pHdr Header
+/// @return     true if all bytes are 0xFF
+static bool fq_HdrErased(const FQ_RECORD_HDR_t *pHdr)
+{
+    return (pHdr->u8_State == 0xFF) && (pHdr->u8_Len == 0xFF) && (pHdr->u16_Reserved == 0xFFFF) && (pHdr->u32_Crc == 0xFFFFFFFF);
+}
+
+
+/// @brief        CRC32 of the length and the payload of a record
+/// @param pData  Payload
+/// @param u8_Len Length of the payload
+/// @return       CRC32
+static uint32_t fq_Crc(const uint8_t *pData, uint8_t u8_Len)
+{
+    return esp_rom_crc32_le(esp_rom_crc32_le(0, &u8_Len, 1), pData, u8_Len);
+}
+
+
+/*****************************END OF FILE**************************************/
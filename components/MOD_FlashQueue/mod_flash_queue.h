@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file    mod_flash_queue.h
+  * @author  The Embedded Dude
+  * @brief   Flash queue for store-and-forward reporting.
+  *          Append-only log of small records with a CRC on a dedicated flash
+  *          partition. Keeps the reports which could not be sent over resets
+  *          and power loss until the backend is reachable again.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Add a data partition with the label FQ_PARTITION_LABEL to the partition
+       table, see partitions.csv. Without it all functions return
+       ESP_ERR_NOT_FOUND and nothing is stored.
+    2. mod_fq_Append(..) adds a record of up to FQ_RECORD_MAX_LEN bytes.
+    3. mod_fq_ReadOldest(..) copies the oldest unsent records back to back into
+       a buffer. Publish them and call mod_fq_MarkSent(..) with the number of
+       records once they have been acked. Until then they are read again.
+    4. The partition is used as a ring of sectors. Each sector is erased once
+       per lap (wear levelling). If the ring is full the unsent records of the
+       oldest sector are dropped, see FQ_STATS_t::u32_Dropped.
+    5. The read/write positions are kept in RTC memory. Only a cold boot scans
+       the partition. mod_fq_Init(..) is called by all functions on first use.
+    6. Not thread safe. Use from one task only.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_FLASH_QUEUE_H_
+#define COMPONENTS_MODULE_FLASH_QUEUE_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+
+/* Exported constants --------------------------------------------------------*/
+#define FQ_PARTITION_LABEL          "flashqueue"    //!< Label of the data partition, see partitions.csv
+#define FQ_RECORD_MAX_LEN           64              //!< Max. payload of one record
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Statistics of the flash queue
+typedef struct FQ_STATS_t
+{
+    uint32_t u32_Pending;               //!< Records not marked as sent
+    uint32_t u32_Dropped;               //!< Unsent records lost because the ring was full, since the last cold boot
+    uint32_t u32_Erases;                //!< Sector erases since the last cold boot
+    uint32_t u32_Sectors;               //!< Sectors of the partition
+
+}FQ_STATS_t;
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+esp_err_t mod_fq_Init(void);
+esp_err_t mod_fq_Append(const uint8_t *pData, size_t Len);
+uint32_t mod_fq_GetCnt(void);
+esp_err_t mod_fq_ReadOldest(uint8_t *pBuffer, size_t BufferSize, uint32_t u32_MaxCnt, uint32_t *pu32_Cnt, size_t *pLen);
+esp_err_t mod_fq_MarkSent(uint32_t u32_Cnt);
+void mod_fq_GetStats(FQ_STATS_t *pStats);
+
+
+#endif /* COMPONENTS_MODULE_FLASH_QUEUE_H_ */
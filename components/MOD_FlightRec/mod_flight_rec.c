@@ -0,0 +1,292 @@
+/**
+  ******************************************************************************
+  * @file    mod_flight_rec.c
+  * @author  The Embedded Dude
+  * @brief   Flight recorder. Binary trace of the dispatched app events, state
+  *          transitions and errors in RTC slow memory. Survives deep sleep,
+  *          panics and software resets.
+  * @date    Git controlled
+  * @version Git controlled
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <sys/time.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "mod_flight_rec.h"
+
+
+/* Private define ------------------------------------------------------------*/
+#ifdef CONFIG_APP_FLIGHT_REC_SIZE
+#define FREC_SIZE               CONFIG_APP_FLIGHT_REC_SIZE
+#else
+#define FREC_SIZE               64
+#endif
+
+#define FREC_FLUSH_LEVEL        ((FREC_SIZE * 3) / 4)   //!< Unsent records which trigger a flush without error
+
+#define FREC_MAGIC              0x46524543  //!< "FREC". Change if FREC_TRACE_t changes.
+#define FREC_LOG_RECORDS        4           //!< Records per log line of mod_frec_Log()
+#define TAG_FREC                "FREC"
+
+
+/* Private typedef -----------------------------------------------------------*/
+/// @brief Trace in RTC slow memory
+typedef struct FREC_TRACE_t
+{
+    uint32_t      u32_Magic;
+    uint32_t      u32_Head;                 //!< Index the next record is written to
+    uint32_t      u32_Cnt;                  //!< Number of valid records
+    uint32_t      u32_Unsent;               //!< Latest records which have not been exported and sent yet
+    uint32_t      u32_Lost;                 //!< Unsent records overwritten since the last export
+    uint32_t      u32_Trigger;              //!< != 0 if the unsent records contain an error or an abnormal reset
+    FREC_RECORD_t Records[FREC_SIZE];
+
+}FREC_TRACE_t;
+
+
+/* Private macro -------------------------------------------------------------*/
+#define FREC_IDX(i)             ((Trace.u32_Head + FREC_SIZE - Trace.u32_Unsent + (i)) % FREC_SIZE)
+
+
+/* Private constants ---------------------------------------------------------*/
+_Static_assert(sizeof(FREC_RECORD_t) == 12, "FREC_RECORD_t is exported as is. Keep it in sync with frec_decode.py");
+
+
+/* Private variables ---------------------------------------------------------*/
+/*Not initialized on any reset. mod_frec_Boot(..) checks the content.*/
+RTC_NOINIT_ATTR static FREC_TRACE_t Trace;
+static portMUX_TYPE FrecLock = portMUX_INITIALIZER_UNLOCKED;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void mod_frec_Add(uint8_t u8_Type, uint8_t u8_Src, uint16_t u16_ID, uint32_t u32_Data);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief                 Checks the trace in RTC memory and adds the boot record
+/// @param u32_ResetReason Reset reason (esp_reset_reason_t)
+/// @param b_Abnormal      true after a panic, watchdog or brownout reset. Triggers a flush.
+void mod_frec_Boot(uint32_t u32_ResetReason, bool b_Abnormal)
+{
+    struct timeval Now;
+
+    if((Trace.u32_Magic != FREC_MAGIC) || (Trace.u32_Head >= FREC_SIZE) || (Trace.u32_Cnt > FREC_SIZE) || (Trace.u32_Unsent > Trace.u32_Cnt))
+    {
+        memset(&Trace, 0, sizeof(Trace));
+        Trace.u32_Magic = FREC_MAGIC;
+    }
+
+    gettimeofday(&Now, NULL);
+    mod_frec_Add(FREC_TYPE_BOOT, 0, (uint16_t)(u32_ResetReason), (uint32_t)(Now.tv_sec));
+
+    if(b_Abnormal)
+        Trace.u32_Trigger = 1;
+}
+
+
+/// @brief             Records a dispatched event
+/// @param u8_Base     Index of the event base, see MOD_*_EVENTS_IDX in app_events.h
+/// @param s32_EventID Event ID
+/// @param pData       Event data. Can be NULL.
+/// @param DataSize    Size of the event data. Only the first 4 bytes are recorded.
+void mod_frec_Event(uint8_t u8_Base, int32_t s32_EventID, const void *pData, size_t DataSize)
+{
+    uint32_t u32_Data = 0;
+
+    if(pData != NULL)
+        memcpy(&u32_Data, pData, (DataSize < sizeof(u32_Data)) ? DataSize : sizeof(u32_Data));
+
+    mod_frec_Add(FREC_TYPE_EVENT, u8_Base, (uint16_t)(s32_EventID), u32_Data);
+}
+
+
+/// @brief           Records a state transition
+/// @param u8_From   Old state
+/// @param u8_To     New state
+/// @param s32_Event Event which caused the transition
+void mod_frec_State(uint8_t u8_From, uint8_t u8_To, int32_t s32_Event)
+{
+    mod_frec_Add(FREC_TYPE_STATE, u8_From, u8_To, (uint32_t)(s32_Event));
+}
+
+
+/// @brief          Records an error and triggers a flush. Use FREC_ERROR(..)
+/// @param u8_Src   FREC_SRC_ENUM_t
+/// @param u16_Line Source line
+/// @param s32_Err  Error code, e.g. esp_err_t
+void mod_frec_Error(uint8_t u8_Src, uint16_t u16_Line, int32_t s32_Err)
+{
+    mod_frec_Add(FREC_TYPE_ERROR, u8_Src, u16_Line, (uint32_t)(s32_Err));
+    Trace.u32_Trigger = 1;
+}
+
+
+/// @brief  Check if the trace should be sent in this cycle
+/// @return true if the unsent records contain an error or an abnormal reset
+///         or if the trace is three quarters full
+bool mod_frec_FlushDue(void)
+{
+    return ((Trace.u32_Trigger != 0) && (Trace.u32_Unsent > 0)) || (Trace.u32_Unsent >= FREC_FLUSH_LEVEL);
+}
+
+
+/// @brief               Copies the unsent records, oldest first, with the export header into pBuffer
+/// @param pBuffer       Destination. Should hold FREC_EXPORT_HDR_SIZE + CONFIG_APP_FLIGHT_REC_SIZE * sizeof(FREC_RECORD_t) bytes
+/// @param BufferSize    Size of pBuffer
+/// @param[out] pu32_Cnt Number of exported records. Records which do not fit are skipped (the latest).
+/// @return              Number of bytes written. 0 if the buffer cannot hold the header.
+/// @note                The records stay unsent until mod_frec_MarkSent(..) is called
+size_t mod_frec_Export(uint8_t *pBuffer, size_t BufferSize, uint32_t *pu32_Cnt)
+{
+    uint32_t u32_Cnt = 0;
+    size_t   Len     = 0;
+
+    *pu32_Cnt = 0;
+
+    if((pBuffer == NULL) || (BufferSize < FREC_EXPORT_HDR_SIZE))
+        return 0;
+
+    portENTER_CRITICAL(&FrecLock);
+    u32_Cnt = (BufferSize - FREC_EXPORT_HDR_SIZE) / sizeof(FREC_RECORD_t);
+    if(u32_Cnt > Trace.u32_Unsent)
+        u32_Cnt = Trace.u32_Unsent;
+
+    pBuffer[0] = 'F';
+    pBuffer[1] = 'R';
+    pBuffer[2] = FREC_EXPORT_VERSION;
+    pBuffer[3] = (uint8_t)sizeof(FREC_RECORD_t);
+    pBuffer[4] = (uint8_t)(u32_Cnt);
+    pBuffer[5] = (uint8_t)(u32_Cnt >> 8);
+    pBuffer[6] = (uint8_t)(Trace.u32_Lost);
+    pBuffer[7] = (uint8_t)(Trace.u32_Lost >> 8);
+    Len = FREC_EXPORT_HDR_SIZE;
+
+    for(uint32_t i = 0; i < u32_Cnt; i++)
+    {
+        memcpy(&pBuffer[Len], &Trace.Records[FREC_IDX(i)], sizeof(FREC_RECORD_t));
+        Len += sizeof(FREC_RECORD_t);
+    }
+    portEXIT_CRITICAL(&FrecLock);
+
+    *pu32_Cnt = u32_Cnt;
+
+    return Len;
+}
+
+
+/// @brief         Marks the oldest unsent records as sent. E.g. after they have been published.
+/// @param u32_Cnt Number of records returned by mod_frec_Export(..)
+void mod_frec_MarkSent(uint32_t u32_Cnt)
+{
+    portENTER_CRITICAL(&FrecLock);
+    if(u32_Cnt > Trace.u32_Unsent)
+        u32_Cnt = Trace.u32_Unsent;
+
+    Trace.u32_Unsent -= u32_Cnt;
+    Trace.u32_Lost    = 0;
+
+    if(Trace.u32_Unsent == 0)
+        Trace.u32_Trigger = 0;
+    portEXIT_CRITICAL(&FrecLock);
+}
+
+
+/// @brief Writes the unsent records as hex to the log, FREC_LOG_RECORDS per "FREC:" line, once per error or abnormal reset.
+///        Used where no backend is available (ESP-NOW).
+/// @note  A log line is no confirmed delivery. The records stay unsent, only the trigger is cleared. Once the trace
+///        is full the oldest records are overwritten.
+void mod_frec_Log(void)
+{
+    static uint8_t au8_Buffer[FREC_EXPORT_HDR_SIZE + FREC_SIZE * sizeof(FREC_RECORD_t)];
+    char     ac_Line[FREC_LOG_RECORDS * sizeof(FREC_RECORD_t) * 2 + 1];
+    uint32_t u32_Cnt;
+    size_t   Len;
+
+    if(Trace.u32_Trigger == 0)
+        return;
+
+    Len = mod_frec_Export(au8_Buffer, sizeof(au8_Buffer), &u32_Cnt);
+
+    for(size_t Pos = 0; Pos < Len; Pos += FREC_LOG_RECORDS * sizeof(FREC_RECORD_t))
+    {
+        size_t LineLen = Len - Pos;
+
+        if(LineLen > FREC_LOG_RECORDS * sizeof(FREC_RECORD_t))
+            LineLen = FREC_LOG_RECORDS * sizeof(FREC_RECORD_t);
+
+        for(size_t i = 0; i < LineLen; i++)
+            snprintf(&ac_Line[i * 2], 3, "%02x", au8_Buffer[Pos + i]);
+
+        ESP_LOGI(TAG_FREC, "%s", ac_Line);
+    }
+
+    portENTER_CRITICAL(&FrecLock);
+    Trace.u32_Trigger = 0;
+    portEXIT_CRITICAL(&FrecLock);
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief Adds a record with the current system time. Overwrites the oldest record if the trace is full.
+static void mod_frec_Add(uint8_t u8_Type, uint8_t u8_Src, uint16_t u16_ID, uint32_t u32_Data)
+{
+    struct timeval Now;
+    FREC_RECORD_t *pRecord;
+
+    //The system time is kept by the RTC timer during deep sleep
+    gettimeofday(&Now, NULL);
+
+    portENTER_CRITICAL(&FrecLock);
+    pRecord = &Trace.Records[Trace.u32_Head];
+
+    pRecord->u32_Time_ms = (uint32_t)((int64_t)(Now.tv_sec) * 1000 + Now.tv_usec / 1000);
+    pRecord->u8_Type     = u8_Type;
+    pRecord->u8_Src      = u8_Src;
+    pRecord->u16_ID      = u16_ID;
+    pRecord->u32_Data    = u32_Data;
+
+    Trace.u32_Head = (Trace.u32_Head + 1) % FREC_SIZE;
+
+    if(Trace.u32_Cnt < FREC_SIZE)
+        Trace.u32_Cnt++;
+
+    if(Trace.u32_Unsent < FREC_SIZE)
+        Trace.u32_Unsent++;
+    else
+        Trace.u32_Lost++;
+    portEXIT_CRITICAL(&FrecLock);
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,145 @@
+/**
+  ******************************************************************************
+  * @file    mod_flight_rec.h
+  * @author  The Embedded Dude
+  * @brief   Flight recorder. Binary trace of the dispatched app events, state
+  *          transitions and errors in RTC slow memory. Survives deep sleep,
+  *          panics and software resets.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Call mod_frec_Boot(..) once per boot before anything is recorded. An
+       invalid trace (power on) is cleared. A panic or watchdog reset triggers
+       a flush.
+    2. Record with mod_frec_Event(..), mod_frec_State(..) and FREC_ERROR(..).
+       An error triggers a flush.
+    3. Once connected check mod_frec_FlushDue(). mod_frec_Export(..) copies the
+       records which have not been sent yet. After a successful publish call
+       mod_frec_MarkSent(..). Without a backend mod_frec_Log() writes them to the
+       log after an error. They stay unsent, a log line is no confirmed delivery.
+    4. tools/flight_recorder/frec_decode.py decodes an export (binary file or
+       the "FREC:" log lines of mod_frec_Log())
+
+  @endverbatim
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_FLIGHT_REC_H_
+#define COMPONENTS_MODULE_FLIGHT_REC_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/* Exported constants --------------------------------------------------------*/
+#define FREC_EXPORT_VERSION     1
+#define FREC_EXPORT_HDR_SIZE    8           //!< 'F','R', version, record size, uint16 count, uint16 lost (little endian)
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Record types
+typedef enum
+{
+    FREC_TYPE_BOOT = 0,                  //!< ID: reset reason, Data: system time in s
+    FREC_TYPE_EVENT,                     //!< Src: event base index (app_events.h), ID: event ID, Data: first 4 bytes of the event data
+    FREC_TYPE_STATE,                     //!< Src: old MainApp state, ID: new state, Data: MainApp event
+    FREC_TYPE_ERROR                      //!< Src: FREC_SRC_ENUM_t, ID: source line, Data: error code
+
+}FREC_TYPE_ENUM_t;
+
+
+/// @brief Source of an error record
+typedef enum
+{
+    FREC_SRC_MAIN = 0,
+    FREC_SRC_WIFI,
+    FREC_SRC_BACKEND,
+    FREC_SRC_ESPNOW,
+    FREC_SRC_PWR,
+    FREC_SRC_SENSOR
+
+}FREC_SRC_ENUM_t;
+
+
+/// @brief One record. Little endian, exported as is.
+typedef struct FREC_RECORD_t
+{
+    uint32_t u32_Time_ms;           //!< System time in ms, lower 32 bits
+    uint8_t  u8_Type;               //!< FREC_TYPE_ENUM_t
+    uint8_t  u8_Src;
+    uint16_t u16_ID;
+    uint32_t u32_Data;
+
+}FREC_RECORD_t;
+
+
+/* Exported macro ------------------------------------------------------------*/
+#define FREC_ERROR(src, err)        mod_frec_Error((src), (uint16_t)(__LINE__), (int32_t)(err))
+
+
+/* Exported functions --------------------------------------------------------*/
+void mod_frec_Boot(uint32_t u32_ResetReason, bool b_Abnormal);
+void mod_frec_Event(uint8_t u8_Base, int32_t s32_EventID, const void *pData, size_t DataSize);
+void mod_frec_State(uint8_t u8_From, uint8_t u8_To, int32_t s32_Event);
+void mod_frec_Error(uint8_t u8_Src, uint16_t u16_Line, int32_t s32_Err);
+bool mod_frec_FlushDue(void);
+size_t mod_frec_Export(uint8_t *pBuffer, size_t BufferSize, uint32_t *pu32_Cnt);
+void mod_frec_MarkSent(uint32_t u32_Cnt);
+void mod_frec_Log(void);
+
+
+/* Initialization and de-initialization functions *****************************/
+
+
+/* IO operation functions *****************************************************/
+
+
+/* Private types -------------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private macros ------------------------------------------------------------*/
+
+
+/* Private functions ---------------------------------------------------------*/
+
+
+
+#endif /* COMPONENTS_MODULE_FLIGHT_REC_H_ */
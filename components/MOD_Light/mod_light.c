@@ -85,17 +85,23 @@ esp_err_t mod_light_init(void)
 {    
     esp_err_t ret = ESP_OK;
 
-    ESP_ERROR_CHECK(tsl2591_init_desc(&dev, 0, CONFIG_APP_I2C_MASTER_SDA_PIN, CONFIG_APP_I2C_MASTER_SCL_PIN));
-    ESP_ERROR_CHECK(tsl2591_init(&dev));
+    ret = tsl2591_init_desc(&dev, 0, CONFIG_APP_I2C_MASTER_SDA_PIN, CONFIG_APP_I2C_MASTER_SCL_PIN);
+
+    if(ret == ESP_OK)
+        ret = tsl2591_init(&dev);
 
     // Turn TSL2591 on
-    ESP_ERROR_CHECK(tsl2591_set_power_status(&dev, TSL2591_POWER_ON));
+    if(ret == ESP_OK)
+        ret = tsl2591_set_power_status(&dev, TSL2591_POWER_ON);
     // Turn ALS on
-    ESP_ERROR_CHECK(tsl2591_set_als_status(&dev, TSL2591_ALS_ON));
+    if(ret == ESP_OK)
+        ret = tsl2591_set_als_status(&dev, TSL2591_ALS_ON);
     // Set gain
-    ESP_ERROR_CHECK(tsl2591_set_gain(&dev, TSL2591_GAIN_MEDIUM));
+    if(ret == ESP_OK)
+        ret = tsl2591_set_gain(&dev, TSL2591_GAIN_MEDIUM);
     // Set integration time = 300ms
-    ESP_ERROR_CHECK(tsl2591_set_integration_time(&dev, TSL2591_INTEGRATION_300MS));
+    if(ret == ESP_OK)
+        ret = tsl2591_set_integration_time(&dev, TSL2591_INTEGRATION_300MS);
 
     return ret;
 }
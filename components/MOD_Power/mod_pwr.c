@@ -25,6 +25,11 @@
     5. If AutoLightSleep is used call mod_pwr_save_stop(..) to stop power saving.
        This is relevant if for example I2C is used and no Power Management Locks 
        are used. Withour power locks it can cause issues.   
+    6. The energy accountant estimates the charge used per report and in total.
+       Sleep modes and the sensor rail are tracked by this module. The app
+       reports its radio mode via mod_pwr_energy_SetMode(..) and its state via
+       mod_pwr_energy_SetState(..). Call mod_pwr_energy_Report(..) once per
+       report. The current table is configured via CONFIG_APP_PWR_CURRENT_*.
 
   @endverbatim
   ******************************************************************************
@@ -56,11 +61,14 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "esp_err.h"
 #include "esp_pm.h"
 #include "esp_timer.h"
 #include "esp_log.h"
 #include "esp_sleep.h"
+#include "esp_attr.h"
+#include "esp_system.h"
 #include "driver/gpio.h"
 #include "sdkconfig.h"
 #include "mod_pwr.h"
@@ -74,10 +82,18 @@
 
 /* Private define ------------------------------------------------------------*/
 
+#ifdef CONFIG_APP_ITWT_ENABLE
+#define MOD_PWR_ITWT_WAKE_INVL_MS   CONFIG_APP_ITWT_WAKE_INVL_MS
+#define MOD_PWR_ITWT_WAKE_DURA_US   CONFIG_APP_ITWT_SERVICE_PERIOD_US
+#else
+#define MOD_PWR_ITWT_WAKE_INVL_MS   (CONFIG_APP_REPORTING_INTERVAL_SEC * 1000UL)
+#define MOD_PWR_ITWT_WAKE_DURA_US   0
+#endif
+
 #ifdef CONFIG_APP_AUTO_LIGHT_SLEEP
 // Reporting frequency - how often readings are taken and published. Should be the same as TWT
-/* TWT Wake Interval_µSec = TWT Wake Interval Mantissa * (2 ^ TWT Wake Interval Exponent)*/
-static uint32_t u32_SleepTimeSec = (uint32_t)(CONFIG_APP_ITWT_WAKE_INVL_MANT * (1 << CONFIG_APP_ITWT_WAKE_INVL_EXPN)/1000000);
+// Replaced by the wake interval the AP agreed to (WIFI_ITWT_ESTABLISHED)
+static uint32_t u32_SleepTimeSec = (uint32_t)((MOD_PWR_ITWT_WAKE_INVL_MS + 500) / 1000);
 #else
 static uint32_t u32_SleepTimeSec = (uint32_t)(CONFIG_APP_REPORTING_INTERVAL_SEC);
 #endif
@@ -93,22 +109,49 @@ static uint32_t u32_SleepTimeSec = (uint32_t)(CONFIG_APP_REPORTING_INTERVAL_SEC)
 const char *TAG_PWR = "mod_pwr";
 
 
+/// @brief Current table of the energy accountant
+static const PWR_CURRENT_TABLE_t mod_pwr_Currents =
+{
+    .au32_Mode_uA =
+    {
+        [PWR_MODE_CPU_Active]  = CONFIG_APP_PWR_CURRENT_CPU_ACTIVE_UA,
+        [PWR_MODE_WiFi_TxRx]   = CONFIG_APP_PWR_CURRENT_WIFI_TXRX_UA,
+        [PWR_MODE_Modem_Sleep] = CONFIG_APP_PWR_CURRENT_MODEM_SLEEP_UA,
+        [PWR_MODE_Light_Sleep] = CONFIG_APP_PWR_CURRENT_LIGHT_SLEEP_UA,
+        [PWR_MODE_Deep_Sleep]  = CONFIG_APP_PWR_CURRENT_DEEP_SLEEP_UA,
+    },
+    .u32_SensorRail_uA = CONFIG_APP_PWR_CURRENT_SENSOR_RAIL_UA,
+};
+
+
 /* Private variables ---------------------------------------------------------*/
 esp_pm_config_t power_management_disabled;
 esp_pm_config_t power_management_enabled;
 
+/*The energy accountant keeps the cumulative charge over deep sleep*/
+RTC_DATA_ATTR static PWR_ENERGY_t mod_pwr_Energy;
+RTC_DATA_ATTR static bool b_mod_pwr_EnergyValid;
+static bool b_mod_pwr_EnergyInit = false;
+static portMUX_TYPE mod_pwr_EnergyLock = portMUX_INITIALIZER_UNLOCKED;
+#ifndef CONFIG_APP_EVENT_STATIC_ROUTING
+static EVENT_DISP_HANDLE_t mod_pwr_ItwtHandler = NULL;
+static EVENT_DISP_HANDLE_t mod_pwr_ItwtFailedHandler = NULL;
+#endif
+
 
 /* Private function prototypes -----------------------------------------------*/
-static void mod_pwr_wifi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+/*Not static, referenced by APP_EVENT_ROUTES in app_events.h*/
+void mod_pwr_wifi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
 static void mod_pwr_GoToSleep(uint32_t u32_SleepPeriodSec);
 static void mod_pwr_Init_IOs(void);
+static void mod_pwr_Energy_Init(void);
 
 
 /* Exported functions --------------------------------------------------------*/
 
 /// @brief  Init all IOs and store PowerManagement profilesif PM is enabled in SDK config
 /// @param  void
-/// @note   Subscribes to WIFI_ITWT_ESTABLISHED event. Needed if iTWT is used.
+/// @note   Subscribes to WIFI_ITWT_ESTABLISHED and WIFI_ITWT_FAILED events. Needed if iTWT is used.
 void mod_pwr_init(void)
 {      
     // get the current power management configuration and save it as a baseline for when power save mode is disabled
@@ -129,21 +172,29 @@ void mod_pwr_init(void)
     power_management_enabled = pm_config;   
 #endif
 
-    EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS, WIFI_ITWT_ESTABLISHED, mod_pwr_wifi_events_handler, NULL);
+#ifndef CONFIG_APP_EVENT_STATIC_ROUTING
+    //Only once, a second init must not add a second handler
+    if(mod_pwr_ItwtHandler == NULL)
+        EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS, WIFI_ITWT_ESTABLISHED, mod_pwr_wifi_events_handler, NULL, &mod_pwr_ItwtHandler);
+
+    if(mod_pwr_ItwtFailedHandler == NULL)
+        EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS, WIFI_ITWT_FAILED, mod_pwr_wifi_events_handler, NULL, &mod_pwr_ItwtFailedHandler);
+#endif
 
+    mod_pwr_Energy_Init( );
     mod_pwr_Init_IOs( );
 }
 
 
 /// @brief  Start power save mode. If AutoLightSleep is configured via SDK config
-///         iTWT session will be requested. 
+///         iTWT session will be resumed or requested. 
 ///         If deep sleep is configured deep sleep will be initiated
 /// @param  void
 /// @note   If deep sleep is configured the WiFi connection will be closed
 void mod_pwr_save_start(void)
 {
 #ifdef CONFIG_APP_AUTO_LIGHT_SLEEP   
-    mod_wifi_init_iTWT();             
+    mod_wifi_init_iTWT(MOD_PWR_ITWT_WAKE_INVL_MS, MOD_PWR_ITWT_WAKE_DURA_US);
 #endif
 
 #ifdef CONFIG_APP_DEEP_SLEEP
@@ -163,25 +214,41 @@ void mod_pwr_save_start(void)
     //Delay entering deep sleep otherwise the above statement wont be written.
     vTaskDelay(pdMS_TO_TICKS(50));
     ESP_ERROR_CHECK(esp_wifi_stop());
+    mod_pwr_energy_SetMode(PWR_MODE_Light_Sleep);
     ESP_ERROR_CHECK(esp_light_sleep_start( ));    
+    mod_pwr_energy_SetMode(PWR_MODE_CPU_Active);
 #endif
 }
 
 
+/// @brief Enter deep sleep for the reporting interval without touching Wi-Fi
+/// @note  Use in wake cycles which did not start Wi-Fi, e.g. if the sample is only stored
+void mod_pwr_deep_sleep_start(void)
+{
+    mod_pwr_GoToSleep(u32_SleepTimeSec);
+}
+
+
 /// @brief  Stop power save mode. If AutoLightSleep is configured via SDK config
 ///         Power management will be disabled when calling this function
 /// @param  void
 void mod_pwr_save_stop(void)
 {
 #ifdef CONFIG_APP_AUTO_LIGHT_SLEEP    
-    //ToDo: Suspending might be the better option to save time and energy. To be tested!
+#if CONFIG_APP_ITWT_WAKE_SUSPEND
+    //Keep the agreement, mod_pwr_save_start(..) resumes it instead of a new setup
+    mod_wifi_suspend_iTWT();
+#else
     mod_wifi_stop_iTWT();
+#endif
     ESP_ERROR_CHECK(esp_pm_configure(&power_management_disabled));
 #endif
 
 #ifdef CONFIG_APP_LIGHT_SLEEP_ESP_NOW  
     ESP_ERROR_CHECK(esp_pm_configure(&power_management_disabled));
 #endif
+
+    mod_pwr_energy_SetMode(PWR_MODE_CPU_Active);
 }
 
 
@@ -190,6 +257,13 @@ void mod_pwr_save_stop(void)
 /// @return        ESP_OK Success - ESP_ERR_INVALID_ARG GPIO number error
 esp_err_t mod_pwr_PeriphPWR(bool b_OnOff)
 {    
+    if(b_mod_pwr_EnergyInit == true)
+    {
+        taskENTER_CRITICAL(&mod_pwr_EnergyLock);
+        pwr_energy_SetSensorRail(&mod_pwr_Energy, b_OnOff, esp_timer_get_time( ));
+        taskEXIT_CRITICAL(&mod_pwr_EnergyLock);
+    }
+
     if(b_OnOff == true)
         return(gpio_set_level(GPIO_PERIPH_PWR, 1));
     else
@@ -197,6 +271,49 @@ esp_err_t mod_pwr_PeriphPWR(bool b_OnOff)
 }
 
 
+/// @brief      Tell the energy accountant the current radio/CPU mode
+/// @param Mode See PWR_MODE_t
+/// @note       Sleep modes are set by this module. Can be called from any task.
+void mod_pwr_energy_SetMode(PWR_MODE_t Mode)
+{
+    if(b_mod_pwr_EnergyInit == false)
+        return;
+
+    taskENTER_CRITICAL(&mod_pwr_EnergyLock);
+    pwr_energy_SetMode(&mod_pwr_Energy, Mode, esp_timer_get_time( ));
+    taskEXIT_CRITICAL(&mod_pwr_EnergyLock);
+}
+
+
+/// @brief          Tell the energy accountant the current app state. The charge is accounted per state as well.
+/// @param u8_State App state. Must be smaller than PWR_ENERGY_NUM_STATES
+void mod_pwr_energy_SetState(uint8_t u8_State)
+{
+    if(b_mod_pwr_EnergyInit == false)
+        return;
+
+    taskENTER_CRITICAL(&mod_pwr_EnergyLock);
+    pwr_energy_SetState(&mod_pwr_Energy, u8_State, esp_timer_get_time( ));
+    taskEXIT_CRITICAL(&mod_pwr_EnergyLock);
+}
+
+
+/// @brief         Get the charge used since the last report and the cumulative charge. Starts a new report period.
+/// @param pReport See PWR_ENERGY_REPORT_t
+/// @note          Call once per report. The charge since the last report includes the sleep period before.
+void mod_pwr_energy_Report(PWR_ENERGY_REPORT_t *pReport)
+{
+    memset(pReport, 0, sizeof(PWR_ENERGY_REPORT_t));
+
+    if(b_mod_pwr_EnergyInit == false)
+        return;
+
+    taskENTER_CRITICAL(&mod_pwr_EnergyLock);
+    pwr_energy_Report(&mod_pwr_Energy, esp_timer_get_time( ), pReport);
+    taskEXIT_CRITICAL(&mod_pwr_EnergyLock);
+}
+
+
 /* Private functions ---------------------------------------------------------*/
 
 /// @brief              WiFi events handler
@@ -204,20 +321,42 @@ esp_err_t mod_pwr_PeriphPWR(bool b_OnOff)
 /// @param base         Event base: check app_events.h for more details
 /// @param s32_EventID  Event ID:   check app_events.h for more details
 /// @param event_data   Event data provided for event. Depends on event type
-static void mod_pwr_wifi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+void mod_pwr_wifi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
 {    
     ESP_LOGI(TAG_PWR, "%s", app_wifi_event_to_str(s32_EventID));
 
-    if(s32_EventID == WIFI_ITWT_ESTABLISHED)
+    if(s32_EventID == WIFI_ITWT_ESTABLISHED && event_data != NULL)
+    {
+        //Sleep as long as agreed, otherwise the wake cycles drift against the service periods
+        u32_SleepTimeSec = (((const MOD_WIFI_ITWT_t *)event_data)->u32_WakeInvl_ms + 500) / 1000;
+
+        if(u32_SleepTimeSec == 0)
+            u32_SleepTimeSec = 1;
+    }
+
+    if(s32_EventID == WIFI_ITWT_FAILED)
+    {
+        ESP_LOGW(TAG_PWR, "No iTWT agreement. Light sleep with the beacon listen interval");
+        u32_SleepTimeSec = (uint32_t)((MOD_PWR_ITWT_WAKE_INVL_MS + 500) / 1000);
+    }
+
+    if(s32_EventID == WIFI_ITWT_ESTABLISHED || s32_EventID == WIFI_ITWT_FAILED)
     {         
         ESP_LOGI(TAG_PWR, "Sleep time: %lu seconds\n", u32_SleepTimeSec);
     
         //We need to send an event that all app tasks need to sleep for x seconds. 
         //This is because we are in another context here (Event handler context) and not main_app context!
-        EventDispatcher_PostEvent(MOD_POWER_EVENTS, PWR_GO_TO_SLEEP, (const void*)(&u32_SleepTimeSec), sizeof(u32_SleepTimeSec), portMAX_DELAY);
+        //Non-blocking, the dispatcher can only free a slot after this handler has returned.
+        uint32_t *pu32_SleepTimeSec = (uint32_t*)EventDispatcher_Borrow(sizeof(uint32_t), 0, EVENT_DISP_DROP_OLDEST);
+        if(pu32_SleepTimeSec != NULL)
+        {
+            *pu32_SleepTimeSec = u32_SleepTimeSec;
+            EventDispatcher_PostBorrowed(pu32_SleepTimeSec, MOD_POWER_EVENTS, PWR_GO_TO_SLEEP);
+        }
     
         /*iTWT is now active and we can try to go into AutoLightSleep mode.*/
         ESP_ERROR_CHECK(esp_pm_configure(&power_management_enabled));     
+        mod_pwr_energy_SetMode(PWR_MODE_Light_Sleep);
     }  
 }
 
@@ -236,6 +375,17 @@ static void mod_pwr_GoToSleep(uint32_t u32_SleepPeriodSec)
         vTaskDelay(pdMS_TO_TICKS(50)); 
         
         ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup((uint64_t)(u32_SleepPeriodSec*1000000)));
+
+        //esp_timer restarts after deep sleep. Account the sleep period now and continue with CPU active after boot.
+        if(b_mod_pwr_EnergyInit == true)
+        {
+            taskENTER_CRITICAL(&mod_pwr_EnergyLock);
+            pwr_energy_Update(&mod_pwr_Energy, esp_timer_get_time( ));
+            pwr_energy_AddDuration(&mod_pwr_Energy, PWR_MODE_Deep_Sleep, (uint64_t)(u32_SleepPeriodSec) * 1000);
+            mod_pwr_Energy.Mode = PWR_MODE_CPU_Active;
+            taskEXIT_CRITICAL(&mod_pwr_EnergyLock);
+        }
+
         esp_deep_sleep_start();
     }
     else
@@ -243,6 +393,20 @@ static void mod_pwr_GoToSleep(uint32_t u32_SleepPeriodSec)
 }
 
 
+/// @brief Init the energy accountant with the current table from SDK config.
+///        After waking up from deep sleep the cumulative values are kept and the time since boot is charged as CPU active.
+static void mod_pwr_Energy_Init(void)
+{
+    if(esp_reset_reason( ) == ESP_RST_DEEPSLEEP && b_mod_pwr_EnergyValid == true)
+        pwr_energy_Resume(&mod_pwr_Energy, 0);
+    else
+        pwr_energy_Init(&mod_pwr_Energy, &mod_pwr_Currents, PWR_MODE_CPU_Active, 0);
+
+    b_mod_pwr_EnergyValid = true;
+    b_mod_pwr_EnergyInit  = true;
+}
+
+
 /// @brief  Init IOs 
 /// @param  void
 static void mod_pwr_Init_IOs(void)
@@ -25,6 +25,11 @@
     5. If AutoLightSleep is used call mod_pwr_save_stop(..) to stop power saving.
        This is relevant if for example I2C is used and no Power Management Locks 
        are used. Withour power locks it can cause issues.   
+    6. The energy accountant estimates the charge used per report and in total.
+       Sleep modes and the sensor rail are tracked by this module. The app
+       reports its radio mode via mod_pwr_energy_SetMode(..) and its state via
+       mod_pwr_energy_SetState(..). Call mod_pwr_energy_Report(..) once per
+       report. The current table is configured via CONFIG_APP_PWR_CURRENT_*.
 
   @endverbatim
   ******************************************************************************
@@ -61,6 +66,7 @@
 
 
 /* Includes ------------------------------------------------------------------*/
+#include "mod_pwr_energy.h"
 
 
 /* Exported types ------------------------------------------------------------*/
@@ -76,9 +82,14 @@
 
 void mod_pwr_init(void);
 void mod_pwr_save_start(void);
+void mod_pwr_deep_sleep_start(void);
 void mod_pwr_save_stop(void);
 esp_err_t mod_pwr_PeriphPWR(bool b_OnOff);
 
+void mod_pwr_energy_SetMode(PWR_MODE_t Mode);
+void mod_pwr_energy_SetState(uint8_t u8_State);
+void mod_pwr_energy_Report(PWR_ENERGY_REPORT_t *pReport);
+
 
 /* Initialization and de-initialization functions *****************************/
 
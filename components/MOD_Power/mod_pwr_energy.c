@@ -0,0 +1,263 @@
+/**
+  ******************************************************************************
+  * @file    mod_pwr_energy.c
+  * @author  The Embedded Dude
+  * @brief   Energy accounting model.
+  *          Estimates the charge used per report and in total from the time
+  *          spent in each power mode and a table of current draws.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The model has no dependencies to ESP-IDF or FreeRTOS. All functions take
+       the current time in µs from the caller (esp_timer_get_time(..) on target,
+       a simulated clock on the host). The instance can be placed in RTC memory
+       to keep the cumulative values over deep sleep.
+    2. Init an instance with pwr_energy_Init(..) and a current table.
+    3. Report every change of power mode, app state or sensor rail via
+       pwr_energy_SetMode(..), pwr_energy_SetState(..) and
+       pwr_energy_SetSensorRail(..). The time since the last change is charged
+       with the current of the previous mode plus the sensor rail if it was on.
+    4. Time which cannot be measured by the caller (deep sleep) is added with
+       pwr_energy_AddDuration(..). After deep sleep call pwr_energy_Resume(..)
+       with the time base of the new boot.
+    5. pwr_energy_Report(..) returns the charge since the last report and the
+       cumulative charge and starts a new report period.
+    6. Charge is accumulated in µA*ms. 1µAh = 3600000µA*ms.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT) 
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  * 
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  * 
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "mod_pwr_energy.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+
+
+/* Private macro -------------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void pwr_energy_Charge(PWR_ENERGY_t *obj, PWR_MODE_t Mode, bool b_RailOn, uint64_t u64_Duration_us, bool b_AddToState);
+static float pwr_energy_to_uAh(uint64_t u64_Charge_uAms);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief            Init the energy accountant. All accumulated values are cleared.
+/// @param obj        Instance
+/// @param pCurrents  Current table. Copied into the instance
+/// @param Mode       Power mode at s64_Now_us
+/// @param s64_Now_us Current time in µs
+void pwr_energy_Init(PWR_ENERGY_t *obj, const PWR_CURRENT_TABLE_t *pCurrents, PWR_MODE_t Mode, int64_t s64_Now_us)
+{
+    memset(obj, 0, sizeof(PWR_ENERGY_t));
+
+    obj->Currents          = *pCurrents;
+    obj->Mode              = Mode;
+    obj->s64_LastUpdate_us = s64_Now_us;
+}
+
+
+/// @brief                 Continue accounting after the time base was reset (e.g. boot after deep sleep).
+///                        The time in between must have been added with pwr_energy_AddDuration(..).
+/// @param obj             Instance
+/// @param s64_TimeBase_us Time of the new time base from which on the current mode is charged. Usually 0 (boot).
+void pwr_energy_Resume(PWR_ENERGY_t *obj, int64_t s64_TimeBase_us)
+{
+    obj->s64_LastUpdate_us = s64_TimeBase_us;
+}
+
+
+/// @brief            Charges the time since the last update with the current mode and sensor rail state
+/// @param obj        Instance
+/// @param s64_Now_us Current time in µs
+void pwr_energy_Update(PWR_ENERGY_t *obj, int64_t s64_Now_us)
+{
+    if(s64_Now_us > obj->s64_LastUpdate_us)
+        pwr_energy_Charge(obj, obj->Mode, obj->b_SensorRailOn, (uint64_t)(s64_Now_us - obj->s64_LastUpdate_us), true);
+
+    obj->s64_LastUpdate_us = s64_Now_us;
+}
+
+
+/// @brief            Change the power mode
+/// @param obj        Instance
+/// @param Mode       New power mode
+/// @param s64_Now_us Current time in µs
+void pwr_energy_SetMode(PWR_ENERGY_t *obj, PWR_MODE_t Mode, int64_t s64_Now_us)
+{
+    if(Mode >= PWR_Num_Modes)
+        return;
+
+    pwr_energy_Update(obj, s64_Now_us);
+    obj->Mode = Mode;
+}
+
+
+/// @brief            Change the app state the following charge is accounted to
+/// @param obj        Instance
+/// @param u8_State   App state. Must be smaller than PWR_ENERGY_NUM_STATES
+/// @param s64_Now_us Current time in µs
+void pwr_energy_SetState(PWR_ENERGY_t *obj, uint8_t u8_State, int64_t s64_Now_us)
+{
+    if(u8_State >= PWR_ENERGY_NUM_STATES)
+        return;
+
+    pwr_energy_Update(obj, s64_Now_us);
+    obj->u8_State = u8_State;
+}
+
+
+/// @brief            Sensor rail switched on or off
+/// @param obj        Instance
+/// @param b_On       true if switched on
+/// @param s64_Now_us Current time in µs
+void pwr_energy_SetSensorRail(PWR_ENERGY_t *obj, bool b_On, int64_t s64_Now_us)
+{
+    pwr_energy_Update(obj, s64_Now_us);
+    obj->b_SensorRailOn = b_On;
+}
+
+
+/// @brief                 Adds time which could not be measured by the caller, e.g. the deep sleep period
+/// @param obj             Instance
+/// @param Mode            Power mode during u64_Duration_ms
+/// @param u64_Duration_ms Duration in ms
+/// @note                  The sensor rail state is taken into account. The charge is not added to an app state.
+void pwr_energy_AddDuration(PWR_ENERGY_t *obj, PWR_MODE_t Mode, uint64_t u64_Duration_ms)
+{
+    if(Mode >= PWR_Num_Modes)
+        return;
+
+    pwr_energy_Charge(obj, Mode, obj->b_SensorRailOn, u64_Duration_ms * 1000, false);
+}
+
+
+/// @brief            Returns the charge since the last report and the cumulative charge. Starts a new report period.
+/// @param obj        Instance
+/// @param s64_Now_us Current time in µs
+/// @param pReport    Report. See PWR_ENERGY_REPORT_t
+void pwr_energy_Report(PWR_ENERGY_t *obj, int64_t s64_Now_us, PWR_ENERGY_REPORT_t *pReport)
+{
+    pwr_energy_Update(obj, s64_Now_us);
+
+    obj->u32_Reports++;
+
+    pReport->f_Report_uAh = pwr_energy_to_uAh(obj->u64_Report_uAms);
+    pReport->f_Total_uAh  = pwr_energy_to_uAh(obj->u64_Total_uAms);
+    pReport->f_Rail_uAh   = pwr_energy_to_uAh(obj->u64_Rail_uAms);
+    pReport->u32_Report   = obj->u32_Reports;
+
+    for(int i = 0; i < PWR_Num_Modes; i++)
+    {
+        pReport->af_Mode_uAh[i]  = pwr_energy_to_uAh(obj->au64_Mode_uAms[i]);
+        pReport->au32_Mode_ms[i] = (uint32_t)(obj->au64_Mode_us[i] / 1000);
+    }
+
+    for(int i = 0; i < PWR_ENERGY_NUM_STATES; i++)
+        pReport->af_State_uAh[i] = pwr_energy_to_uAh(obj->au64_State_uAms[i]);
+
+    memset(obj->au64_Mode_uAms,  0, sizeof(obj->au64_Mode_uAms));
+    memset(obj->au64_Mode_us,    0, sizeof(obj->au64_Mode_us));
+    memset(obj->au64_State_uAms, 0, sizeof(obj->au64_State_uAms));
+    obj->u64_Rail_uAms   = 0;
+    obj->u64_Report_uAms = 0;
+}
+
+
+/// @brief      "Translates" PWR_MODE_t into string
+/// @param Mode PWR_MODE_t
+/// @return     translated string
+const char *pwr_energy_mode_to_str(PWR_MODE_t Mode)
+{
+    switch (Mode)
+    {
+        case PWR_MODE_CPU_Active:   return "CPU_Active";
+        case PWR_MODE_WiFi_TxRx:    return "WiFi_TxRx";
+        case PWR_MODE_Modem_Sleep:  return "Modem_Sleep";
+        case PWR_MODE_Light_Sleep:  return "Light_Sleep";
+        case PWR_MODE_Deep_Sleep:   return "Deep_Sleep";
+        default:                    return "UNKNOWN PWR_MODE";
+    }
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief                 Adds the charge of a period to all buckets
+/// @param obj             Instance
+/// @param Mode            Power mode during the period
+/// @param b_RailOn        Sensor rail was on during the period
+/// @param u64_Duration_us Duration of the period in µs
+/// @param b_AddToState    Add the charge to the current app state
+static void pwr_energy_Charge(PWR_ENERGY_t *obj, PWR_MODE_t Mode, bool b_RailOn, uint64_t u64_Duration_us, bool b_AddToState)
+{
+    uint64_t u64_Mode_uAms = (uint64_t)(obj->Currents.au32_Mode_uA[Mode]) * u64_Duration_us / 1000;
+    uint64_t u64_Rail_uAms = 0;
+
+    if(b_RailOn == true)
+        u64_Rail_uAms = (uint64_t)(obj->Currents.u32_SensorRail_uA) * u64_Duration_us / 1000;
+
+    obj->au64_Mode_uAms[Mode] += u64_Mode_uAms;
+    obj->au64_Mode_us[Mode]   += u64_Duration_us;
+    obj->u64_Rail_uAms        += u64_Rail_uAms;
+    obj->u64_Report_uAms      += u64_Mode_uAms + u64_Rail_uAms;
+    obj->u64_Total_uAms       += u64_Mode_uAms + u64_Rail_uAms;
+
+    if(b_AddToState == true)
+        obj->au64_State_uAms[obj->u8_State] += u64_Mode_uAms + u64_Rail_uAms;
+}
+
+
+/// @brief                 Converts µA*ms into µAh
+/// @param u64_Charge_uAms Charge in µA*ms
+/// @return                Charge in µAh
+static float pwr_energy_to_uAh(uint64_t u64_Charge_uAms)
+{
+    return (float)(u64_Charge_uAms) / (float)(PWR_ENERGY_UAMS_PER_UAH);
+}
+
+
+/*****************************END OF FILE**************************************/
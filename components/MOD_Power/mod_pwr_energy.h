@@ -0,0 +1,157 @@
+/**
+  ******************************************************************************
+  * @file    mod_pwr_energy.h
+  * @author  The Embedded Dude
+  * @brief   Energy accounting model.
+  *          Estimates the charge used per report and in total from the time
+  *          spent in each power mode and a table of current draws.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The model has no dependencies to ESP-IDF or FreeRTOS. All functions take
+       the current time in µs from the caller (esp_timer_get_time(..) on target,
+       a simulated clock on the host). The instance can be placed in RTC memory
+       to keep the cumulative values over deep sleep.
+    2. Init an instance with pwr_energy_Init(..) and a current table.
+    3. Report every change of power mode, app state or sensor rail via
+       pwr_energy_SetMode(..), pwr_energy_SetState(..) and
+       pwr_energy_SetSensorRail(..). The time since the last change is charged
+       with the current of the previous mode plus the sensor rail if it was on.
+    4. Time which cannot be measured by the caller (deep sleep) is added with
+       pwr_energy_AddDuration(..). After deep sleep call pwr_energy_Resume(..)
+       with the time base of the new boot.
+    5. pwr_energy_Report(..) returns the charge since the last report and the
+       cumulative charge and starts a new report period.
+    6. Charge is accumulated in µA*ms. 1µAh = 3600000µA*ms.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT) 
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  * 
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  * 
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_POWER_ENERGY_H_
+#define COMPONENTS_MODULE_POWER_ENERGY_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Exported constants --------------------------------------------------------*/
+#define PWR_ENERGY_NUM_STATES   8               //!< Max. number of app states which can be accounted separately
+#define PWR_ENERGY_UAMS_PER_UAH 3600000ULL      //!< µA*ms per µAh
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Radio/CPU power modes with a separate current draw
+typedef enum
+{
+    PWR_MODE_CPU_Active,                //!< CPU running, radio off
+    PWR_MODE_WiFi_TxRx,                 //!< Radio active. Scan, connect, transmit and receive
+    PWR_MODE_Modem_Sleep,               //!< Wi-Fi connected with modem power save. Radio sleeps in between beacons
+    PWR_MODE_Light_Sleep,               //!< (Auto) light sleep. Includes wake ups for iTWT service periods
+    PWR_MODE_Deep_Sleep,                //!< Deep sleep
+
+    PWR_Num_Modes                       //!< Number of modes. Must be the last entry
+
+}PWR_MODE_t;
+
+/// @brief Current draw of each mode in µA
+typedef struct PWR_CURRENT_TABLE_t
+{
+    uint32_t au32_Mode_uA[PWR_Num_Modes];           //!< Current of the device (SoC and board) per mode
+    uint32_t u32_SensorRail_uA;                     //!< Additional current while the sensor rail is switched on
+
+}PWR_CURRENT_TABLE_t;
+
+/// @brief Energy accountant instance
+typedef struct PWR_ENERGY_t
+{
+    PWR_CURRENT_TABLE_t Currents;                   //!< Current table used for the calculation
+
+    int64_t  s64_LastUpdate_us;                     //!< Time of the last accounted change
+    PWR_MODE_t Mode;                                //!< Current power mode
+    uint8_t  u8_State;                              //!< Current app state. Index into au64_State_uAms
+    bool     b_SensorRailOn;                        //!< Sensor rail is switched on
+
+    uint64_t au64_Mode_uAms[PWR_Num_Modes];         //!< Charge per mode since the last report
+    uint64_t au64_Mode_us[PWR_Num_Modes];           //!< Time per mode since the last report in µs
+    uint64_t au64_State_uAms[PWR_ENERGY_NUM_STATES];//!< Charge per app state since the last report. Time added via pwr_energy_AddDuration(..) is not included
+    uint64_t u64_Rail_uAms;                         //!< Charge of the sensor rail since the last report
+    uint64_t u64_Report_uAms;                       //!< Charge since the last report
+
+    uint64_t u64_Total_uAms;                        //!< Cumulative charge since pwr_energy_Init(..)
+    uint32_t u32_Reports;                           //!< Number of reports since pwr_energy_Init(..)
+
+}PWR_ENERGY_t;
+
+/// @brief Result of pwr_energy_Report(..)
+typedef struct PWR_ENERGY_REPORT_t
+{
+    float f_Report_uAh;                             //!< Charge since the previous report
+    float f_Total_uAh;                              //!< Cumulative charge
+    float af_Mode_uAh[PWR_Num_Modes];               //!< Charge per mode since the previous report
+    uint32_t au32_Mode_ms[PWR_Num_Modes];           //!< Time per mode since the previous report
+    float af_State_uAh[PWR_ENERGY_NUM_STATES];      //!< Charge per app state since the previous report
+    float f_Rail_uAh;                               //!< Charge of the sensor rail since the previous report
+    uint32_t u32_Report;                            //!< Report counter
+
+}PWR_ENERGY_REPORT_t;
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+void pwr_energy_Init(PWR_ENERGY_t *obj, const PWR_CURRENT_TABLE_t *pCurrents, PWR_MODE_t Mode, int64_t s64_Now_us);
+void pwr_energy_Resume(PWR_ENERGY_t *obj, int64_t s64_TimeBase_us);
+void pwr_energy_Update(PWR_ENERGY_t *obj, int64_t s64_Now_us);
+void pwr_energy_SetMode(PWR_ENERGY_t *obj, PWR_MODE_t Mode, int64_t s64_Now_us);
+void pwr_energy_SetState(PWR_ENERGY_t *obj, uint8_t u8_State, int64_t s64_Now_us);
+void pwr_energy_SetSensorRail(PWR_ENERGY_t *obj, bool b_On, int64_t s64_Now_us);
+void pwr_energy_AddDuration(PWR_ENERGY_t *obj, PWR_MODE_t Mode, uint64_t u64_Duration_ms);
+void pwr_energy_Report(PWR_ENERGY_t *obj, int64_t s64_Now_us, PWR_ENERGY_REPORT_t *pReport);
+const char *pwr_energy_mode_to_str(PWR_MODE_t Mode);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_MODULE_POWER_ENERGY_H_ */
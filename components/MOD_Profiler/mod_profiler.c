@@ -0,0 +1,344 @@
+/**
+  ******************************************************************************
+  * @file    mod_profiler.c
+  * @author  The Embedded Dude
+  * @brief   Wake cycle profiler.
+  *          Timestamps the phases of a wake cycle (boot, init, Wi-Fi connect,
+  *          backend connect, sensor read, publish, sleep entry) and keeps one
+  *          compact record per cycle in RTC slow memory so the records
+  *          survive deep sleep.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Call mod_prof_CycleStart(true) as early as possible after boot and
+       mod_prof_CycleStart(false) after waking up from light sleep.
+    2. Call mod_prof_PhaseBegin(..) and mod_prof_PhaseEnd(..) around each phase.
+       Phases may overlap (e.g. sensor read runs in parallel to the connect).
+       Both functions can be called from different tasks.
+    3. Call mod_prof_CycleEnd(..) right before entering sleep. Phases still
+       running are closed and the record is stored in RTC memory.
+    4. Once mod_prof_BatchReady(..) returns true emit the records either via
+       mod_prof_LogBatch(..) or mod_prof_FormatBatch(..) and clear them with
+       mod_prof_ClearBatch(..). The batch size is set via
+       CONFIG_APP_PROF_BATCH_SIZE. If the batch is not cleared the oldest
+       record gets overwritten.
+    5. All times are in ms relative to the cycle start. The boot phase uses
+       the time since esp_timer start and does not include the bootloader.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "mod_profiler.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+#define PROF_BATCH_SIZE     CONFIG_APP_PROF_BATCH_SIZE
+#define PROF_PHASE_IDLE     (-1)                            //!< Phase begin timestamp if the phase is not running
+
+
+/* Private macro -------------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+static const char *TAG_PROF = "mod_profiler";
+
+
+/* Private variables ---------------------------------------------------------*/
+/*Records survive deep sleep. They are zero initialized after power on.*/
+RTC_DATA_ATTR static PROF_RECORD_t Prof_Records[PROF_BATCH_SIZE];
+RTC_DATA_ATTR static uint32_t u32_Prof_RecordCnt;          //!< Number of valid records in Prof_Records
+RTC_DATA_ATTR static uint32_t u32_Prof_Head;               //!< Index the next record is written to
+RTC_DATA_ATTR static uint32_t u32_Prof_Cycle;              //!< Wake cycle counter since power on
+
+static PROF_RECORD_t Prof_Current;                          //!< Record of the running cycle
+static int64_t s64_CycleStart_us;
+static int64_t as64_PhaseBegin_us[PROF_Num_Phases];
+
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t mod_prof_us_to_ms16(int64_t s64_Time_us);
+static int mod_prof_FormatRecord(char *pBuffer, size_t BufferSize, const PROF_RECORD_t *pRecord);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief        Starts a new wake cycle record
+/// @param b_Boot true after power on or deep sleep. The cycle starts at esp_timer start and the boot phase is recorded.
+///               false after waking up from light sleep. The cycle starts now.
+void mod_prof_CycleStart(bool b_Boot)
+{
+    int64_t s64_Now_us = esp_timer_get_time( );
+
+    memset(&Prof_Current, 0, sizeof(Prof_Current));
+
+    for(int i = 0; i < PROF_Num_Phases; i++)
+    {
+        Prof_Current.au16_Start_ms[i] = PROF_NOT_RUN;
+        as64_PhaseBegin_us[i]         = PROF_PHASE_IDLE;
+    }
+
+    Prof_Current.u32_Cycle = u32_Prof_Cycle++;
+
+    if(b_Boot == true)
+    {
+        s64_CycleStart_us = 0;
+        Prof_Current.au16_Start_ms[PROF_Boot] = 0;
+        Prof_Current.au16_Dur_ms[PROF_Boot]   = mod_prof_us_to_ms16(s64_Now_us);
+    }
+    else
+        s64_CycleStart_us = s64_Now_us;
+}
+
+
+/// @brief             Closes all running phases and stores the record of the running cycle in RTC memory
+/// @param u32_Sleep_s Sleep time in seconds which follows this cycle
+/// @note              If the batch is full the oldest record is overwritten
+void mod_prof_CycleEnd(uint32_t u32_Sleep_s)
+{
+    int64_t s64_Now_us = esp_timer_get_time( );
+
+    for(int i = 0; i < PROF_Num_Phases; i++)
+        mod_prof_PhaseEnd((PROF_PHASE_t)(i));
+
+    Prof_Current.u32_Awake_ms = (uint32_t)((s64_Now_us - s64_CycleStart_us) / 1000);
+    Prof_Current.u32_Sleep_s  = u32_Sleep_s;
+
+    Prof_Records[u32_Prof_Head] = Prof_Current;
+    u32_Prof_Head = (u32_Prof_Head + 1) % PROF_BATCH_SIZE;
+
+    if(u32_Prof_RecordCnt < PROF_BATCH_SIZE)
+        u32_Prof_RecordCnt++;
+}
+
+
+/// @brief       Marks the start of a phase
+/// @param Phase See PROF_PHASE_t
+/// @note        If a phase is started twice in a cycle the first start time is kept and the durations are summed up
+void mod_prof_PhaseBegin(PROF_PHASE_t Phase)
+{
+    int64_t s64_Now_us = esp_timer_get_time( );
+
+    if(Phase >= PROF_Num_Phases)
+        return;
+
+    as64_PhaseBegin_us[Phase] = s64_Now_us;
+
+    if(Prof_Current.au16_Start_ms[Phase] == PROF_NOT_RUN)
+        Prof_Current.au16_Start_ms[Phase] = mod_prof_us_to_ms16(s64_Now_us - s64_CycleStart_us);
+}
+
+
+/// @brief       Marks the end of a phase. Does nothing if the phase is not running.
+/// @param Phase See PROF_PHASE_t
+void mod_prof_PhaseEnd(PROF_PHASE_t Phase)
+{
+    int64_t s64_Now_us = esp_timer_get_time( );
+    uint32_t u32_Dur_ms;
+
+    if(Phase >= PROF_Num_Phases || as64_PhaseBegin_us[Phase] == PROF_PHASE_IDLE)
+        return;
+
+    u32_Dur_ms = Prof_Current.au16_Dur_ms[Phase] + mod_prof_us_to_ms16(s64_Now_us - as64_PhaseBegin_us[Phase]);
+
+    Prof_Current.au16_Dur_ms[Phase] = (u32_Dur_ms > UINT16_MAX) ? UINT16_MAX : (uint16_t)(u32_Dur_ms);
+    as64_PhaseBegin_us[Phase]       = PROF_PHASE_IDLE;
+}
+
+
+/// @brief  Check if the configured number of records is available
+/// @return true if CONFIG_APP_PROF_BATCH_SIZE records are stored
+bool mod_prof_BatchReady(void)
+{
+    return (u32_Prof_RecordCnt >= PROF_BATCH_SIZE);
+}
+
+
+/// @brief Writes all stored records to the log. One line per record, oldest first.
+/// @note  Records are not cleared. Call mod_prof_ClearBatch(..) afterwards.
+void mod_prof_LogBatch(void)
+{
+    char s_Record[PROF_RECORD_STR_MAX_LEN];
+    uint32_t u32_Idx = (u32_Prof_Head + PROF_BATCH_SIZE - u32_Prof_RecordCnt) % PROF_BATCH_SIZE;
+
+    ESP_LOGI(TAG_PROF, "cycle,awake_ms,sleep_s,boot,init,wifi,backend,sensor,publish,sleep_entry (start:dur ms)");
+
+    for(uint32_t i = 0; i < u32_Prof_RecordCnt; i++)
+    {
+        mod_prof_FormatRecord(s_Record, sizeof(s_Record), &Prof_Records[u32_Idx]);
+        ESP_LOGI(TAG_PROF, "%s", s_Record);
+
+        u32_Idx = (u32_Idx + 1) % PROF_BATCH_SIZE;
+    }
+}
+
+
+/// @brief            Formats all stored records into pBuffer. One line per record, oldest first.
+/// @param pBuffer    Destination buffer. Should hold CONFIG_APP_PROF_BATCH_SIZE * PROF_RECORD_STR_MAX_LEN chars
+/// @param BufferSize Size of pBuffer
+/// @return           Number of chars written without the terminating 0. Records which do not fit are skipped.
+/// @note             Records are not cleared. Call mod_prof_ClearBatch(..) afterwards.
+int mod_prof_FormatBatch(char *pBuffer, size_t BufferSize)
+{
+    int s32_Len = 0;
+    int s32_Ret = 0;
+    uint32_t u32_Idx = (u32_Prof_Head + PROF_BATCH_SIZE - u32_Prof_RecordCnt) % PROF_BATCH_SIZE;
+
+    if(pBuffer == NULL || BufferSize == 0)
+        return 0;
+
+    pBuffer[0] = '\0';
+
+    for(uint32_t i = 0; i < u32_Prof_RecordCnt; i++)
+    {
+        s32_Ret = mod_prof_FormatRecord(&pBuffer[s32_Len], BufferSize - s32_Len, &Prof_Records[u32_Idx]);
+
+        /*Record did not fit. Drop the partly written record*/
+        if(s32_Ret < 0 || (size_t)(s32_Len + s32_Ret + 1) >= BufferSize)
+        {
+            pBuffer[s32_Len] = '\0';
+            break;
+        }
+
+        s32_Len += s32_Ret;
+        pBuffer[s32_Len++] = '\n';
+        pBuffer[s32_Len]   = '\0';
+
+        u32_Idx = (u32_Idx + 1) % PROF_BATCH_SIZE;
+    }
+
+    return s32_Len;
+}
+
+
+/// @brief Removes all records from RTC memory. The cycle counter keeps running.
+void mod_prof_ClearBatch(void)
+{
+    u32_Prof_RecordCnt = 0;
+    u32_Prof_Head      = 0;
+}
+
+
+/// @brief  Number of records stored in RTC memory
+/// @return Number of valid records. Max. CONFIG_APP_PROF_BATCH_SIZE
+uint32_t mod_prof_GetRecordCnt(void)
+{
+    return u32_Prof_RecordCnt;
+}
+
+
+/// @brief              Copies one stored record
+/// @param u32_Idx      Record index. 0 is the oldest, mod_prof_GetRecordCnt(..) - 1 the latest record
+/// @param[out] pRecord Destination of the record
+/// @return             false if u32_Idx is out of range
+bool mod_prof_GetRecord(uint32_t u32_Idx, PROF_RECORD_t *pRecord)
+{
+    if(pRecord == NULL || u32_Idx >= u32_Prof_RecordCnt)
+        return false;
+
+    *pRecord = Prof_Records[(u32_Prof_Head + PROF_BATCH_SIZE - u32_Prof_RecordCnt + u32_Idx) % PROF_BATCH_SIZE];
+
+    return true;
+}
+
+
+/// @brief       "Translates" PROF_PHASE_t into string
+/// @param Phase PROF_PHASE_t
+/// @return      translated string
+const char *mod_prof_phase_to_str(PROF_PHASE_t Phase)
+{
+    switch (Phase)
+    {
+        case PROF_Boot:             return "PROF_Boot";
+        case PROF_Init_Sys:         return "PROF_Init_Sys";
+        case PROF_WiFi_Connect:     return "PROF_WiFi_Connect";
+        case PROF_Backend_Connect:  return "PROF_Backend_Connect";
+        case PROF_Sensor_Read:      return "PROF_Sensor_Read";
+        case PROF_Publish:          return "PROF_Publish";
+        case PROF_Sleep_Entry:      return "PROF_Sleep_Entry";
+        default:                    return "UNKNOWN PROF";
+    }
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief             Converts a time in µs into ms. Saturates at 0xFFFE because 0xFFFF is PROF_NOT_RUN.
+/// @param s64_Time_us Time in µs
+/// @return            Time in ms
+static uint16_t mod_prof_us_to_ms16(int64_t s64_Time_us)
+{
+    int64_t s64_Time_ms = s64_Time_us / 1000;
+
+    if(s64_Time_ms < 0)
+        return 0;
+
+    if(s64_Time_ms >= PROF_NOT_RUN)
+        return PROF_NOT_RUN - 1;
+
+    return (uint16_t)(s64_Time_ms);
+}
+
+
+/// @brief            Formats one record as CSV: cycle,awake_ms,sleep_s followed by start:dur for each phase.
+///                   Phases which did not run are written as "-".
+/// @param pBuffer    Destination buffer
+/// @param BufferSize Size of pBuffer
+/// @param pRecord    Record to format
+/// @return           snprintf(..) like. Number of chars which would have been written.
+static int mod_prof_FormatRecord(char *pBuffer, size_t BufferSize, const PROF_RECORD_t *pRecord)
+{
+    int s32_Len = snprintf(pBuffer, BufferSize, "%lu,%lu,%lu", (unsigned long)(pRecord->u32_Cycle), (unsigned long)(pRecord->u32_Awake_ms), (unsigned long)(pRecord->u32_Sleep_s));
+
+    for(int i = 0; i < PROF_Num_Phases && s32_Len >= 0 && (size_t)(s32_Len) < BufferSize; i++)
+    {
+        if(pRecord->au16_Start_ms[i] == PROF_NOT_RUN)
+            s32_Len += snprintf(&pBuffer[s32_Len], BufferSize - s32_Len, ",-");
+        else
+            s32_Len += snprintf(&pBuffer[s32_Len], BufferSize - s32_Len, ",%u:%u", pRecord->au16_Start_ms[i], pRecord->au16_Dur_ms[i]);
+    }
+
+    return s32_Len;
+}
+
+
+/*****************************END OF FILE**************************************/
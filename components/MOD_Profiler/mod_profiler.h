@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file    mod_profiler.h
+  * @author  The Embedded Dude
+  * @brief   Wake cycle profiler.
+  *          Timestamps the phases of a wake cycle (boot, init, Wi-Fi connect,
+  *          backend connect, sensor read, publish, sleep entry) and keeps one
+  *          compact record per cycle in RTC slow memory so the records
+  *          survive deep sleep.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Call mod_prof_CycleStart(true) as early as possible after boot and
+       mod_prof_CycleStart(false) after waking up from light sleep.
+    2. Call mod_prof_PhaseBegin(..) and mod_prof_PhaseEnd(..) around each phase.
+       Phases may overlap (e.g. sensor read runs in parallel to the connect).
+       Both functions can be called from different tasks.
+    3. Call mod_prof_CycleEnd(..) right before entering sleep. Phases still
+       running are closed and the record is stored in RTC memory.
+    4. Once mod_prof_BatchReady(..) returns true emit the records either via
+       mod_prof_LogBatch(..) or mod_prof_FormatBatch(..) and clear them with
+       mod_prof_ClearBatch(..). The batch size is set via
+       CONFIG_APP_PROF_BATCH_SIZE. If the batch is not cleared the oldest
+       record gets overwritten.
+       Single records can be read via mod_prof_GetRecordCnt(..) and
+       mod_prof_GetRecord(..), e.g. by a host simulation.
+    5. All times are in ms relative to the cycle start. The boot phase uses
+       the time since esp_timer start and does not include the bootloader.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_PROFILER_H_
+#define COMPONENTS_MODULE_PROFILER_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Profiled phases of a wake cycle
+typedef enum
+{
+    PROF_Boot,                          //!< Boot until app_main. Only after power on or deep sleep
+    PROF_Init_Sys,                      //!< MAS_Init_Sys
+    PROF_WiFi_Connect,                  //!< MAS_Not_Connected - Wi-Fi connect until IP addr received
+    PROF_Backend_Connect,               //!< MAS_WiFi_Connected - Backend connect
+    PROF_Sensor_Read,                   //!< Sensor task sample. Runs in parallel to the connect phases
+    PROF_Publish,                       //!< MAS_Backend_Connected - Publish until all msgs acked
+    PROF_Sleep_Entry,                   //!< MAS_Data_Published - Disconnect, iTWT setup until sleep starts
+
+    PROF_Num_Phases                     //!< Number of phases. Must be the last entry
+
+}PROF_PHASE_t;
+
+/// @brief Timings of one wake cycle. Stored in RTC slow memory.
+typedef struct PROF_RECORD_t
+{
+    uint32_t u32_Cycle;                             //!< Wake cycle counter since power on
+    uint32_t u32_Awake_ms;                          //!< Cycle start until mod_prof_CycleEnd(..)
+    uint32_t u32_Sleep_s;                           //!< Sleep time requested at the end of the cycle
+    uint16_t au16_Start_ms[PROF_Num_Phases];        //!< Phase start relative to cycle start. PROF_NOT_RUN if phase did not run
+    uint16_t au16_Dur_ms[PROF_Num_Phases];          //!< Phase duration
+
+}PROF_RECORD_t;
+
+
+/* Exported constants --------------------------------------------------------*/
+#define PROF_NOT_RUN                0xFFFF      //!< Marks a phase which did not run in this cycle
+#define PROF_RECORD_STR_MAX_LEN     128         //!< Max. length of one record formatted by mod_prof_FormatBatch(..)
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+void mod_prof_CycleStart(bool b_Boot);
+void mod_prof_CycleEnd(uint32_t u32_Sleep_s);
+void mod_prof_PhaseBegin(PROF_PHASE_t Phase);
+void mod_prof_PhaseEnd(PROF_PHASE_t Phase);
+
+bool mod_prof_BatchReady(void);
+void mod_prof_LogBatch(void);
+int mod_prof_FormatBatch(char *pBuffer, size_t BufferSize);
+void mod_prof_ClearBatch(void);
+
+uint32_t mod_prof_GetRecordCnt(void);
+bool mod_prof_GetRecord(uint32_t u32_Idx, PROF_RECORD_t *pRecord);
+
+const char *mod_prof_phase_to_str(PROF_PHASE_t Phase);
+
+
+/* Initialization and de-initialization functions *****************************/
+
+
+/* IO operation functions *****************************************************/
+
+
+/* Private types -------------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private macros ------------------------------------------------------------*/
+
+
+/* Private functions ---------------------------------------------------------*/
+
+
+
+#endif /* COMPONENTS_MODULE_PROFILER_H_ */
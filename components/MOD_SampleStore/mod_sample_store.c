@@ -0,0 +1,217 @@
+/**
+  ******************************************************************************
+  * @file    mod_sample_store.c
+  * @author  The Embedded Dude
+  * @brief   Sample store for store-and-batch reporting.
+  *          Keeps the sensor samples of several wake cycles with a timestamp
+  *          in RTC slow memory until they are uploaded.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Call mod_samples_UploadDue(..) before the sample of this wake cycle is
+       added. If it returns false the sample can be stored with
+       mod_samples_Add(..) and the device can go back to sleep without
+       connecting.
+    2. Once connected add the sample of this wake cycle and hand the stored
+       samples over with mod_samples_Get(..) or mod_samples_FormatCSV(..).
+    3. Remove the uploaded samples with mod_samples_Remove(..) once the
+       upload has been acknowledged. Samples added meanwhile are kept.
+    4. The store holds CONFIG_APP_BATCH_BUFFER_SIZE samples. If it is full
+       the oldest sample is overwritten and counted as dropped.
+    5. The samples survive deep sleep. They are lost on any other reset.
+
+  @endverbatim
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <sys/time.h>
+#include "esp_attr.h"
+#include "sdkconfig.h"
+#include "mod_sample_store.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+#ifdef CONFIG_APP_BATCH_SAMPLES
+#define SAMPLES_BATCH_SIZE      CONFIG_APP_BATCH_SAMPLES
+#define SAMPLES_MAX             CONFIG_APP_BATCH_BUFFER_SIZE
+#else
+#define SAMPLES_BATCH_SIZE      1
+#define SAMPLES_MAX             1
+#endif
+
+#if SAMPLES_BATCH_SIZE > SAMPLES_MAX
+#error "CONFIG_APP_BATCH_SAMPLES must not be bigger than CONFIG_APP_BATCH_BUFFER_SIZE"
+#endif
+
+
+/* Private macro -------------------------------------------------------------*/
+#define SAMPLES_IDX(i)          ((u32_Samples_Head + SAMPLES_MAX - u32_Samples_Cnt + (i)) % SAMPLES_MAX)
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+/*Samples survive deep sleep. They are zero initialized after power on.*/
+RTC_DATA_ATTR static SAMPLE_RECORD_t Samples[SAMPLES_MAX];
+RTC_DATA_ATTR static uint32_t u32_Samples_Cnt;             //!< Number of valid samples
+RTC_DATA_ATTR static uint32_t u32_Samples_Head;            //!< Index the next sample is written to
+RTC_DATA_ATTR static uint32_t u32_Samples_Dropped;         //!< Samples overwritten because the store was full
+
+
+/* Private function prototypes -----------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief             Stores a sample with the current system time
+/// @param f_Temp_C    Temperature in °C
+/// @param f_Humi_PCT  Relative humidity in %
+/// @param f_Light_Lux Illuminance in lux
+/// @note              If the store is full the oldest sample is overwritten
+void mod_samples_Add(float f_Temp_C, float f_Humi_PCT, float f_Light_Lux)
+{
+    struct timeval Now;
+
+    //The system time is kept by the RTC timer during deep sleep
+    gettimeofday(&Now, NULL);
+
+    Samples[u32_Samples_Head].u32_Time_s  = (uint32_t)(Now.tv_sec);
+    Samples[u32_Samples_Head].f_Temp_C    = f_Temp_C;
+    Samples[u32_Samples_Head].f_Humi_PCT  = f_Humi_PCT;
+    Samples[u32_Samples_Head].f_Light_Lux = f_Light_Lux;
+
+    u32_Samples_Head = (u32_Samples_Head + 1) % SAMPLES_MAX;
+
+    if(u32_Samples_Cnt < SAMPLES_MAX)
+        u32_Samples_Cnt++;
+    else
+        u32_Samples_Dropped++;
+}
+
+
+/// @brief  Check if the samples have to be uploaded in this wake cycle
+/// @return true if the next sample completes a batch of CONFIG_APP_BATCH_SAMPLES or the store is nearly full
+/// @note   Call before the sample of this wake cycle is added
+bool mod_samples_UploadDue(void)
+{
+    return (u32_Samples_Cnt + 1 >= SAMPLES_BATCH_SIZE) || (u32_Samples_Cnt + 2 >= SAMPLES_MAX);
+}
+
+
+/// @brief  Number of stored samples
+/// @return Number of valid samples. Max. CONFIG_APP_BATCH_BUFFER_SIZE
+uint32_t mod_samples_GetCnt(void)
+{
+    return u32_Samples_Cnt;
+}
+
+
+/// @brief  Number of samples lost because the store was full
+/// @return Dropped samples since power on
+uint32_t mod_samples_GetDropped(void)
+{
+    return u32_Samples_Dropped;
+}
+
+
+/// @brief              Copies one stored sample
+/// @param u32_Idx      Sample index. 0 is the oldest, mod_samples_GetCnt(..) - 1 the latest sample
+/// @param[out] pSample Destination of the sample
+/// @return             false if u32_Idx is out of range
+bool mod_samples_Get(uint32_t u32_Idx, SAMPLE_RECORD_t *pSample)
+{
+    if(pSample == NULL || u32_Idx >= u32_Samples_Cnt)
+        return false;
+
+    *pSample = Samples[SAMPLES_IDX(u32_Idx)];
+
+    return true;
+}
+
+
+/// @brief         Removes the oldest samples. E.g. once they have been uploaded.
+/// @param u32_Cnt Number of samples to remove. Limited to the number of stored samples.
+void mod_samples_Remove(uint32_t u32_Cnt)
+{
+    if(u32_Cnt > u32_Samples_Cnt)
+        u32_Cnt = u32_Samples_Cnt;
+
+    u32_Samples_Cnt -= u32_Cnt;
+}
+
+
+/// @brief              Formats the stored samples as CSV into pBuffer. One line "time_s,temp_C,humi_pct,lux" per sample, oldest first.
+/// @param pBuffer      Destination buffer. Should hold CONFIG_APP_BATCH_BUFFER_SIZE * SAMPLE_STR_MAX_LEN chars
+/// @param BufferSize   Size of pBuffer
+/// @param[out] pu32_Cnt Number of samples written. Samples which do not fit are skipped. Can be NULL.
+/// @return             Number of chars written without the terminating 0
+/// @note               Samples are not removed. Call mod_samples_Remove(..) once the upload is acknowledged.
+int mod_samples_FormatCSV(char *pBuffer, size_t BufferSize, uint32_t *pu32_Cnt)
+{
+    int s32_Len = 0;
+    int s32_Ret = 0;
+    uint32_t i  = 0;
+
+    if(pBuffer != NULL && BufferSize > 0)
+    {
+        pBuffer[0] = '\0';
+
+        for(i = 0; i < u32_Samples_Cnt; i++)
+        {
+            const SAMPLE_RECORD_t *pSample = &Samples[SAMPLES_IDX(i)];
+
+            s32_Ret = snprintf(&pBuffer[s32_Len], BufferSize - s32_Len, "%lu,%.2f,%.2f,%.1f\n", (unsigned long)(pSample->u32_Time_s), pSample->f_Temp_C, pSample->f_Humi_PCT, pSample->f_Light_Lux);
+
+            /*Sample did not fit. Drop the partly written sample*/
+            if(s32_Ret < 0 || (size_t)(s32_Len + s32_Ret) >= BufferSize)
+            {
+                pBuffer[s32_Len] = '\0';
+                break;
+            }
+
+            s32_Len += s32_Ret;
+        }
+    }
+
+    if(pu32_Cnt != NULL)
+        *pu32_Cnt = i;
+
+    return s32_Len;
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file    mod_sample_store.h
+  * @author  The Embedded Dude
+  * @brief   Sample store for store-and-batch reporting.
+  *          Keeps the sensor samples of several wake cycles with a timestamp
+  *          in RTC slow memory until they are uploaded.
+  * @date    Git controlled
+  * @version Git controlled
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef COMPONENTS_MODULE_SAMPLE_STORE_H_
+#define COMPONENTS_MODULE_SAMPLE_STORE_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief One sample. Stored in RTC slow memory.
+typedef struct SAMPLE_RECORD_t
+{
+    uint32_t u32_Time_s;                //!< System time in seconds. Since power on unless the time has been set (e.g. SNTP)
+    float f_Temp_C;                     //!< Temperature in °C
+    float f_Humi_PCT;                   //!< Relative humidity in %
+    float f_Light_Lux;                  //!< Illuminance in lux
+
+}SAMPLE_RECORD_t;
+
+
+/* Exported constants --------------------------------------------------------*/
+#define SAMPLE_STR_MAX_LEN          40          //!< Max. length of one sample formatted by mod_samples_FormatCSV(..) incl. the line feed
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+void mod_samples_Add(float f_Temp_C, float f_Humi_PCT, float f_Light_Lux);
+bool mod_samples_UploadDue(void);
+uint32_t mod_samples_GetCnt(void);
+uint32_t mod_samples_GetDropped(void);
+bool mod_samples_Get(uint32_t u32_Idx, SAMPLE_RECORD_t *pSample);
+void mod_samples_Remove(uint32_t u32_Cnt);
+int mod_samples_FormatCSV(char *pBuffer, size_t BufferSize, uint32_t *pu32_Cnt);
+
+
+/* Initialization and de-initialization functions *****************************/
+
+
+/* IO operation functions *****************************************************/
+
+
+/* Private types -------------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private macros ------------------------------------------------------------*/
+
+
+/* Private functions ---------------------------------------------------------*/
+
+
+
+#endif /* COMPONENTS_MODULE_SAMPLE_STORE_H_ */
@@ -46,13 +46,50 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "mod_wifi.h"
+#ifdef CONFIG_APP_FLIGHT_REC
+#include "mod_flight_rec.h"
+#endif
+#include <stddef.h>
+#include "esp_attr.h"
+#include "esp_mac.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
 
 
 /* Private typedef -----------------------------------------------------------*/
+/// @brief AP of the last successful connect. Kept in RTC memory for a connect without a scan.
+typedef struct MOD_WIFI_FAST_t
+{
+    uint32_t u32_Magic;
+    uint32_t u32_SsidCrc;                       //!< SSID the entry belongs to
+    uint8_t  au8_Bssid[6];
+    uint8_t  u8_Channel;                        //!< Primary channel
+    uint8_t  u8_AuthMode;                       //!< wifi_auth_mode_t of the last connect
+    uint8_t  u8_PhyMode;                        //!< wifi_phy_mode_t negotiated on the last connect
+    uint32_t u32_Crc;                           //!< Over all fields above
+
+}MOD_WIFI_FAST_t;
+
+/// @brief State of the iTWT agreement
+typedef enum MOD_WIFI_ITWT_STATE_t
+{
+    MOD_WIFI_ITWT_NONE = 0,                     //!< No agreement. mod_wifi_init_iTWT(..) negotiates one
+    MOD_WIFI_ITWT_SETUP,                        //!< Setup requests in flight
+    MOD_WIFI_ITWT_ACTIVE,                       //!< Service periods running
+    MOD_WIFI_ITWT_SUSPENDING,                   //!< Suspend after waking up requested
+    MOD_WIFI_ITWT_SUSPENDED,                    //!< Suspended until s64_ItwtResume_us
+    MOD_WIFI_ITWT_RESUMING,                     //!< Resume before sleeping requested
+
+}MOD_WIFI_ITWT_STATE_t;
 
 
 /* Private define ------------------------------------------------------------*/
 #define APP_NETIF_DESC_STA "mod_wifi_netif_sta"
+#define MOD_WIFI_FAST_MAGIC 0x54534146      //!< "FAST"
+#define MOD_WIFI_ADDR_IP6_DEADLINE 0x80     //!< Not an address: deadline for the preferred IPv6 address passed
+#define MOD_WIFI_ITWT_MANT_MAX     UINT16_MAX
+#define MOD_WIFI_ITWT_EXPN_MAX     31
+#define MOD_WIFI_ITWT_RESUME_MS    1        //!< Suspend time of a resume. There is no resume call, a new suspend replaces the running one
 
 #if CONFIG_APP_WIFI_SCAN_METHOD_FAST
 #define CONFIG_APP_WIFI_SCAN_METHOD WIFI_FAST_SCAN
@@ -101,11 +138,11 @@
 #if defined(CONFIG_APP_CONNECT_IPV6_PREF_LOCAL_LINK)
 #define CONFIG_APP_CONNECT_PREFERRED_IPV6_TYPE ESP_IP6_ADDR_IS_LINK_LOCAL
 #elif defined(CONFIG_APP_CONNECT_IPV6_PREF_GLOBAL)
-#define CONFIG_APPCONNECT_PREFERRED_IPV6_TYPE ESP_IP6_ADDR_IS_GLOBAL
+#define CONFIG_APP_CONNECT_PREFERRED_IPV6_TYPE ESP_IP6_ADDR_IS_GLOBAL
 #elif defined(CONFIG_APP_CONNECT_IPV6_PREF_SITE_LOCAL)
-#define CONFIG_APPCONNECT_PREFERRED_IPV6_TYPE ESP_IP6_ADDR_IS_SITE_LOCAL
+#define CONFIG_APP_CONNECT_PREFERRED_IPV6_TYPE ESP_IP6_ADDR_IS_SITE_LOCAL
 #elif defined(CONFIG_APP_CONNECT_IPV6_PREF_UNIQUE_LOCAL)
-#define CONFIG_APPCONNECT_PREFERRED_IPV6_TYPE ESP_IP6_ADDR_IS_UNIQUE_LOCAL
+#define CONFIG_APP_CONNECT_PREFERRED_IPV6_TYPE ESP_IP6_ADDR_IS_UNIQUE_LOCAL
 #endif // if-elif CONFIG_EXAMPLE_CONNECT_IPV6_PREF_...
 #endif
 
@@ -113,12 +150,23 @@
 
 
 /* Private macro -------------------------------------------------------------*/
+/// @brief Readiness policy. True if the assigned addresses (MOD_WIFI_ADDR_x) are enough to post WIFI_CONNECTED_EVENT.
+#if CONFIG_APP_CONNECT_READY_ANY
+#define MOD_WIFI_ADDRS_READY(addrs) (((addrs) & (MOD_WIFI_ADDR_IPV4 | MOD_WIFI_ADDR_IPV6)) != 0)
+#elif CONFIG_APP_CONNECT_READY_PREFER_IPV6
+#define MOD_WIFI_ADDRS_READY(addrs) ((((addrs) & MOD_WIFI_ADDR_IPV6) != 0) || \
+                                     (((addrs) & (MOD_WIFI_ADDR_IPV4 | MOD_WIFI_ADDR_IP6_DEADLINE)) == (MOD_WIFI_ADDR_IPV4 | MOD_WIFI_ADDR_IP6_DEADLINE)))
+#else
+#define MOD_WIFI_ADDRS_READY(addrs) (((addrs) & MOD_WIFI_ADDR_IPV4) != 0)
+#endif
 
 
 
 /* Private constants ---------------------------------------------------------*/
 const char *TAG = "mod_wifi";
 
+_Static_assert(sizeof(MOD_WIFI_ITWT_t) <= MOD_EVENT_DISP_SLOT_SIZE, "MOD_WIFI_ITWT_t does not fit into an event slot");
+
 #if CONFIG_APP_CONNECT_IPV6
 /* types of ipv6 addresses to be displayed on ipv6 events */
 const char *ipv6_addr_types_to_str[6] = 
@@ -135,9 +183,9 @@ const char *ipv6_addr_types_to_str[6] =
 
 /* Private variables ---------------------------------------------------------*/
 static esp_netif_t       *s_app_sta_netif = NULL;
-static SemaphoreHandle_t  s_semph_get_ip_addrs = NULL;
-#if CONFIG_APP_CONNECT_IPV6
-static SemaphoreHandle_t s_semph_get_ip6_addrs = NULL;
+static esp_timer_handle_t s_conn_timeout  = NULL;     //!< CONFIG_APP_CONNECT_TIMEOUT_MS
+#if CONFIG_APP_CONNECT_READY_PREFER_IPV6
+static esp_timer_handle_t s_ip6_deadline  = NULL;     //!< CONFIG_APP_CONNECT_IPV6_DEADLINE_MS after the IPv4 address
 #endif
 
 #if CONFIG_EXAMPLE_ITWT_TRIGGER_ENABLE
@@ -170,6 +218,49 @@ volatile bool b_WiFi_Connected = false;
 static int s_retry_num = 0;
 static bool b_WiFi_Reconnect = true; //Determines if WiFi reconnect should be tried after disconnect
 
+static portMUX_TYPE ReadyLock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t u8_Addrs;                    //!< MOD_WIFI_ADDR_x assigned since the association
+static bool b_Settled;                      //!< WIFI_CONNECTED_EVENT or the timeout posted for this association
+
+static MOD_WIFI_CONN_TIMING_t ConnTiming;  //!< Last connect attempt. Written by the caller of mod_wifi_connect(..) and the event handlers
+
+static MOD_WIFI_ITWT_STATE_t ItwtState;     //!< Written by the iTWT calls and the event handlers
+static MOD_WIFI_ITWT_STATS_t ItwtStats;
+
+#if CONFIG_APP_ITWT_ENABLE
+static wifi_twt_setup_config_t ItwtSetup;   //!< Last iTWT setup request
+static uint64_t u64_ItwtAsked_us;           //!< Wake interval of mod_wifi_init_iTWT(..) after encoding
+static uint64_t u64_ItwtMin_us;             //!< Shortest wake interval accepted from the AP
+static uint8_t  u8_ItwtAskedDura;           //!< min_wake_dura of mod_wifi_init_iTWT(..)
+static uint8_t  u8_ItwtRequests;            //!< Setup requests of the running negotiation
+static uint8_t  u8_ItwtFlowId;              //!< Flow of the agreement
+static uint8_t  u8_ItwtFrames;              //!< TWT action frames since waking up
+static MOD_WIFI_ITWT_t ItwtAgreement;       //!< Agreed values. Posted again when resumed
+static int64_t  s64_ItwtStart_us;           //!< mod_wifi_init_iTWT(..) called
+static int64_t  s64_ItwtResume_us;          //!< Suspension ends on its own. From the actual suspend time of the AP
+#endif
+
+#if CONFIG_APP_WIFI_FAST_RECONNECT
+RTC_DATA_ATTR static MOD_WIFI_FAST_t WiFiFast;
+RTC_DATA_ATTR static MOD_WIFI_FAST_STATS_t WiFiFastStats;
+static bool b_FastPinned;                   //!< STA config is pinned to the cached BSSID and channel
+static bool b_FastPending;                  //!< First attempt with the cached AP not finished yet
+#endif
+
+/*Handlers of the default event loop. Registered by mod_wifi_sta_do_connect(..), released by mod_wifi_sta_do_disconnect(..)*/
+static esp_event_handler_instance_t s_instance_on_disconnect = NULL;
+static esp_event_handler_instance_t s_instance_on_got_ip     = NULL;
+static esp_event_handler_instance_t s_instance_on_connect    = NULL;
+#if CONFIG_APP_CONNECT_IPV6
+static esp_event_handler_instance_t s_instance_on_got_ip6    = NULL;
+#endif
+#if CONFIG_APP_ITWT_ENABLE
+static esp_event_handler_instance_t s_instance_itwt_setup    = NULL;
+static esp_event_handler_instance_t s_instance_itwt_teardown = NULL;
+static esp_event_handler_instance_t s_instance_itwt_suspend  = NULL;
+static esp_event_handler_instance_t s_instance_itwt_probe    = NULL;
+#endif
+
 
 /* Private function prototypes -----------------------------------------------*/
 static esp_err_t mod_wifi_init(void);
@@ -178,8 +269,9 @@ static void mod_wifi_shutdown(void);
 static void mod_wifi_start(void);
 static void mod_wifi_stop(void);
 
-static esp_err_t mod_wifi_sta_do_connect(wifi_config_t wifi_config, bool wait);
+static esp_err_t mod_wifi_sta_do_connect(wifi_config_t wifi_config);
 static esp_err_t mod_wifi_sta_do_disconnect(void);
+static void mod_wifi_handler_release(esp_event_base_t event_base, int32_t event_id, esp_event_handler_instance_t *pInstance);
 
 static void mod_wifi_handler_on_wifi_connect(void *esp_netif, esp_event_base_t event_base, int32_t event_id, void *event_data);
 static void mod_wifi_handler_on_wifi_disconnect(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
@@ -189,6 +281,15 @@ static void mod_wifi_handler_itwt_setup(void *arg, esp_event_base_t event_base,
 static void mod_wifi_handler_itwt_probe(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 static void mod_wifi_handler_itwt_suspend(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 static void mod_wifi_handler_itwt_teardown(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+static void mod_wifi_handler_conn_timeout(void *arg);
+#if CONFIG_APP_CONNECT_READY_PREFER_IPV6
+static void mod_wifi_handler_ip6_deadline(void *arg);
+#endif
+
+static void mod_wifi_ready_add(uint8_t u8_Addr);
+static void mod_wifi_ready_reset(void);
+static void mod_wifi_conn_timeout_arm(void);
+static void mod_wifi_reconnect(void);
 
 static bool mod_wifi_is_our_netif(const char *prefix, esp_netif_t *netif);
 static esp_netif_t *mod_wifi_get_netif_from_desc(const char *desc);
@@ -197,16 +298,40 @@ static void mod_wifi_print_all_netif_ips(const char *prefix);
 static void mod_wifi_set_static_ip(esp_netif_t *netif);
 static const char *mod_wifi_itwt_probe_status_to_str(wifi_itwt_probe_status_t status);
 static const char *mod_wifi_phy_mode_to_str(wifi_phy_mode_t wifi_phy_mode);
+#if CONFIG_APP_ITWT_ENABLE
+static void mod_wifi_itwt_encode(uint64_t u64_WakeInvl_us, wifi_twt_setup_config_t *pConfig);
+static uint64_t mod_wifi_itwt_invl_us(const wifi_twt_setup_config_t *pConfig);
+static esp_err_t mod_wifi_itwt_negotiate(void);
+static esp_err_t mod_wifi_itwt_request(wifi_twt_setup_cmds_t Cmd);
+static esp_err_t mod_wifi_itwt_resume(void);
+static void mod_wifi_itwt_established(const wifi_twt_setup_config_t *pConfig);
+static void mod_wifi_itwt_active(bool b_Resumed);
+static void mod_wifi_itwt_frames(uint8_t u8_Frames);
+#endif
+static void mod_wifi_itwt_failed(void);
+static void mod_wifi_timing_start(void);
+static void mod_wifi_timing_mark(uint16_t *pu16_Time_ms);
+static void mod_wifi_timing_done(esp_err_t Result);
+#if CONFIG_APP_WIFI_FAST_RECONNECT
+static void mod_wifi_fast_apply(wifi_config_t *pConfig);
+static void mod_wifi_fast_unpin(void);
+static void mod_wifi_fast_save(const wifi_event_sta_connected_t *pConnected, wifi_phy_mode_t PhyMode);
+static uint32_t mod_wifi_fast_crc(void);
+#endif
 
 
 
 /* Exported functions --------------------------------------------------------*/
 
-/// @brief  Init WiFi as STA and try to connect to AP
+/// @brief  Init WiFi as STA and start connecting to the AP. Does not wait for the connection.
+/// @note   WIFI_CONNECTED_EVENT is posted once the addresses of the CONFIG_APP_CONNECT_READY_x policy are assigned.
+///         WIFI_CONNECT_FAILED_EVENT after CONFIG_APP_WIFI_CONN_MAX_RETRY failed tries or CONFIG_APP_CONNECT_TIMEOUT_MS.
 /// @param  void
-/// @return ESP_OK on success
+/// @return ESP_OK if connecting started
 esp_err_t mod_wifi_connect(void)
 {
+    b_WiFi_Reconnect = true;
+
     if (mod_wifi_init() != ESP_OK) 
     {
         return ESP_FAIL;
@@ -215,10 +340,6 @@ esp_err_t mod_wifi_connect(void)
     //If we do a reset via  esp_restart() this handler is called prior to the restart. 
     //Deep sleep is not a restart (I assume)
     ESP_ERROR_CHECK(esp_register_shutdown_handler(&mod_wifi_shutdown));
-    
-    mod_wifi_print_all_netif_ips(APP_NETIF_DESC_STA);
-
-    b_WiFi_Reconnect = true;
 
     return ESP_OK;
 }
@@ -235,7 +356,7 @@ esp_err_t mod_wifi_disconnect(bool b_CreateEvent)
     if( b_CreateEvent == false )
     {
         //Unregister the Disconnect handler before shutting down otherwise we will get an WIFI_DISCONNECT Event
-        ESP_ERROR_CHECK(esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &mod_wifi_handler_on_wifi_disconnect));    
+        mod_wifi_handler_release(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &s_instance_on_disconnect);
     }
 
     mod_wifi_shutdown();
@@ -246,18 +367,21 @@ esp_err_t mod_wifi_disconnect(bool b_CreateEvent)
 }
 
 
-/// @brief Init iTWT
-/// @param void
+/// @brief                 Init iTWT. Resumes a suspended agreement, otherwise negotiates one with the AP.
+/// @param u32_WakeInvl_ms Target wake interval. Mantissa and exponent are computed from it.
+/// @param u32_WakeDura_us Service period (nominal minimum wake duration). Rounded up to 256 us units, max. 65280 us.
+/// @return                ESP_OK if the resume or the setup request was sent
 /// @note Ensure we are connected to WiFi and got an IP address before calling this function 
 /// @note If we are not in HE20 mode iTWT init will fail.
-void mod_wifi_init_iTWT(void)
+/// @note WIFI_ITWT_ESTABLISHED with the agreed MOD_WIFI_ITWT_t once the AP accepted or the agreement is resumed. A counter-offer
+///       of the AP within CONFIG_APP_ITWT_WAKE_INVL_MIN_MS and the target is taken, a reject is answered with half the interval.
+///       WIFI_ITWT_FAILED if there is no agreement after CONFIG_APP_ITWT_SETUP_MAX_REQUESTS requests.
+esp_err_t mod_wifi_init_iTWT(uint32_t u32_WakeInvl_ms, uint32_t u32_WakeDura_us)
 {
-    esp_err_t err = ESP_OK;
+    esp_err_t err = ESP_ERR_NOT_SUPPORTED;
 
     /* setup a trigger-based announce individual TWT agreement. */
     wifi_phy_mode_t phymode;
-    wifi_config_t sta_cfg = { 0, };
-    esp_wifi_get_config(WIFI_IF_STA, &sta_cfg);
     esp_wifi_sta_get_negotiated_phymode(&phymode);
 
     ESP_LOGI(TAG, "Wi-Fi Phy mode: %s", mod_wifi_phy_mode_to_str(phymode));
@@ -265,24 +389,24 @@ void mod_wifi_init_iTWT(void)
     if (phymode == WIFI_PHY_MODE_HE20) 
     {
 #if CONFIG_APP_ITWT_ENABLE        
-        
-        wifi_twt_setup_config_t setup_config = 
-        {
-            .setup_cmd       = TWT_REQUEST,
-            .flow_id         = 0,
-            .twt_id          = CONFIG_APP_ITWT_ID,
-            .flow_type       = flow_type_announced ? 0 : 1,
-            .min_wake_dura   = CONFIG_APP_ITWT_MIN_WAKE_DURA,
-            .wake_invl_expn  = CONFIG_APP_ITWT_WAKE_INVL_EXPN,
-            .wake_invl_mant  = CONFIG_APP_ITWT_WAKE_INVL_MANT,
-            .trigger         = trigger_enabled,
-            .timeout_time_ms = CONFIG_APP_ITWT_SETUP_TIMEOUT_TIME_MS,
-        };
-
-        err = esp_wifi_sta_itwt_setup(&setup_config);
-
-        if (err != ESP_OK) 
-            ESP_LOGE(TAG, "itwt setup failed, err:0x%x", err);        
+        uint32_t u32_MinWakeDura = (u32_WakeDura_us + 255) / 256;
+        wifi_twt_setup_config_t Target = { 0 };
+
+        mod_wifi_itwt_encode(u32_WakeInvl_ms * 1000ULL, &Target);
+
+        u64_ItwtAsked_us = mod_wifi_itwt_invl_us(&Target);
+        u64_ItwtMin_us   = CONFIG_APP_ITWT_WAKE_INVL_MIN_MS * 1000ULL;
+        u8_ItwtAskedDura = (u32_MinWakeDura < 1) ? 1 : ((u32_MinWakeDura > UINT8_MAX) ? UINT8_MAX : u32_MinWakeDura);
+        s64_ItwtStart_us = esp_timer_get_time( );
+
+        if (u64_ItwtMin_us > u64_ItwtAsked_us)
+            u64_ItwtMin_us = u64_ItwtAsked_us;
+
+        //A suspended agreement costs one frame, a negotiation at least two per request
+        err = mod_wifi_itwt_resume( );
+
+        if (err != ESP_OK)
+            err = mod_wifi_itwt_negotiate( );
 #else   
         ESP_LOGI(TAG, "iTWT is disabled. To enable set CONFIG_APP_ITWT_ENABLE");
 #endif
@@ -293,6 +417,11 @@ void mod_wifi_init_iTWT(void)
         ESP_LOGE(TAG, "iTWT setup not possible. Must be in 11ax mode to support iTWT.");
 #endif
     }
+
+    if (err != ESP_OK)
+        mod_wifi_itwt_failed( );
+
+    return err;
 }
 
 
@@ -306,6 +435,91 @@ void mod_wifi_stop_iTWT(void)
 
     if (err != ESP_OK) 
         ESP_LOGE(TAG, "itwt stop failed, err:0x%x", err);    
+#if CONFIG_APP_ITWT_ENABLE
+    else if (ItwtState != MOD_WIFI_ITWT_NONE)
+        mod_wifi_itwt_frames(1);
+#endif
+
+    ItwtState = MOD_WIFI_ITWT_NONE;
+}
+
+
+/// @brief Suspend iTWT after waking up. The agreement is kept and mod_wifi_init_iTWT(..) resumes it before sleeping.
+/// @param void
+/// @note  The AP ends the suspension on its own after CONFIG_APP_ITWT_SUSPEND_MS. Nothing happens without an active agreement.
+void mod_wifi_suspend_iTWT(void)
+{
+#if CONFIG_APP_ITWT_WAKE_SUSPEND
+    esp_err_t err;
+
+    if (ItwtState != MOD_WIFI_ITWT_ACTIVE)
+        return;
+
+    ItwtState = MOD_WIFI_ITWT_SUSPENDING;
+    err = esp_wifi_sta_itwt_suspend(u8_ItwtFlowId, CONFIG_APP_ITWT_SUSPEND_MS);
+
+    if (err != ESP_OK)
+    {
+        //E.g. torn down by the AP while sleeping. The next mod_wifi_init_iTWT(..) negotiates.
+        ESP_LOGW(TAG, "itwt suspend failed, err:0x%x", err);
+        ItwtState = MOD_WIFI_ITWT_NONE;
+        return;
+    }
+
+    mod_wifi_itwt_frames(1);
+#endif
+}
+
+
+/// @brief             RSSI of the connected AP
+/// @param[out] ps8_RSSI RSSI in dBm
+/// @return            ESP_OK on success, ESP_ERR_WIFI_NOT_CONNECT if not connected
+esp_err_t mod_wifi_get_rssi(int8_t *ps8_RSSI)
+{
+    wifi_ap_record_t ApInfo;
+    esp_err_t ret = esp_wifi_sta_get_ap_info(&ApInfo);
+
+    if(ret == ESP_OK)
+        *ps8_RSSI = ApInfo.rssi;
+
+    return ret;
+}
+
+
+/// @brief             Connects by the way the AP was found
+/// @param[out] pStats Statistics since the last cold boot. All 0 without CONFIG_APP_WIFI_FAST_RECONNECT
+void mod_wifi_get_fast_stats(MOD_WIFI_FAST_STATS_t *pStats)
+{
+#if CONFIG_APP_WIFI_FAST_RECONNECT
+    *pStats = WiFiFastStats;
+#else
+    memset(pStats, 0, sizeof(MOD_WIFI_FAST_STATS_t));
+#endif
+}
+
+
+/// @brief  Addresses assigned since the last association
+/// @param  void
+/// @return MOD_WIFI_ADDR_IPV4 and MOD_WIFI_ADDR_IPV6 flags. 0 if not connected
+uint8_t mod_wifi_get_addrs(void)
+{
+    return u8_Addrs & (MOD_WIFI_ADDR_IPV4 | MOD_WIFI_ADDR_IPV6);
+}
+
+
+/// @brief             Timing of the last connect attempt
+/// @param[out] pTiming Copy of the timing. Phases not reached yet are MOD_WIFI_T_NONE
+void mod_wifi_get_conn_timing(MOD_WIFI_CONN_TIMING_t *pTiming)
+{
+    *pTiming = ConnTiming;
+}
+
+
+/// @brief             iTWT agreements by setup and resume
+/// @param[out] pStats Statistics since boot. All 0 without CONFIG_APP_ITWT_ENABLE
+void mod_wifi_get_itwt_stats(MOD_WIFI_ITWT_STATS_t *pStats)
+{
+    *pStats = ItwtStats;
 }
 
 
@@ -325,9 +539,23 @@ static void mod_wifi_shutdown(void)
 /// @return ESP_OK on success
 static esp_err_t mod_wifi_init(void)
 {
+    esp_err_t ret;
+
     ESP_LOGI(TAG, "Wi-Fi connecting..");
-    
+
+    if (s_conn_timeout == NULL)
+    {
+        const esp_timer_create_args_t TimeoutArgs = { .callback = &mod_wifi_handler_conn_timeout, .name = "wifi_conn" };
+        ESP_ERROR_CHECK(esp_timer_create(&TimeoutArgs, &s_conn_timeout));
+#if CONFIG_APP_CONNECT_READY_PREFER_IPV6
+        const esp_timer_create_args_t DeadlineArgs = { .callback = &mod_wifi_handler_ip6_deadline, .name = "wifi_ip6" };
+        ESP_ERROR_CHECK(esp_timer_create(&DeadlineArgs, &s_ip6_deadline));
+#endif
+    }
+
+    mod_wifi_timing_start();
     mod_wifi_start();
+    mod_wifi_timing_mark(&ConnTiming.u16_WiFiStart_ms);
     
     wifi_config_t wifi_config = 
     {
@@ -352,75 +580,57 @@ static esp_err_t mod_wifi_init(void)
 #if CONFIG_APP_IP_ENABLE_STATIC_IP
     mod_wifi_set_static_ip(s_app_sta_netif);
 #endif
-   
-    return mod_wifi_sta_do_connect(wifi_config, true);
+
+#if CONFIG_APP_WIFI_FAST_RECONNECT
+    mod_wifi_fast_apply(&wifi_config);
+#endif
+
+    mod_wifi_ready_reset();
+    mod_wifi_conn_timeout_arm();
+
+    ret = mod_wifi_sta_do_connect(wifi_config);
+
+    if (ret != ESP_OK)
+    {
+        esp_timer_stop(s_conn_timeout);
+        mod_wifi_timing_done(ret);
+    }
+
+    return ret;
 }
 
 
-/// @brief             Try to connect to an AP
+/// @brief             Try to connect to an AP. The result is reported with events.
 /// @param wifi_config WiFi config 
-/// @param wait        false = not waiting until IP addr. assigned, true = waiting for IP addr.
-/// @return            ESP_OK on success
-static esp_err_t mod_wifi_sta_do_connect(wifi_config_t wifi_config, bool wait)
+/// @return            ESP_OK if esp_wifi_connect(..) started
+static esp_err_t mod_wifi_sta_do_connect(wifi_config_t wifi_config)
 {
-    if (wait)
-    {
-        s_semph_get_ip_addrs = xSemaphoreCreateBinary();
-        
-        if (s_semph_get_ip_addrs == NULL)         
-            return ESP_ERR_NO_MEM;
-        
-#if CONFIG_APP_CONNECT_IPV6
-        s_semph_get_ip6_addrs = xSemaphoreCreateBinary();
-        
-        if (s_semph_get_ip6_addrs == NULL) 
-        {
-            vSemaphoreDelete(s_semph_get_ip_addrs);
-            return ESP_ERR_NO_MEM;
-        }
-#endif
-    }
-    
     s_retry_num = 0;
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &mod_wifi_handler_on_wifi_disconnect, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT,   IP_EVENT_STA_GOT_IP,         &mod_wifi_handler_on_sta_got_ip,      NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED,    &mod_wifi_handler_on_wifi_connect,    s_app_sta_netif));
+    //All instances are released by mod_wifi_sta_do_disconnect(..). Otherwise each connect would add another set.
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &mod_wifi_handler_on_wifi_disconnect, NULL,            &s_instance_on_disconnect));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,   IP_EVENT_STA_GOT_IP,         &mod_wifi_handler_on_sta_got_ip,      NULL,            &s_instance_on_got_ip));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED,    &mod_wifi_handler_on_wifi_connect,    s_app_sta_netif, &s_instance_on_connect));
 
 #if CONFIG_APP_CONNECT_IPV6
-    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_GOT_IP6, &mod_wifi_handler_on_sta_got_ipv6, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_GOT_IP6, &mod_wifi_handler_on_sta_got_ipv6, NULL, &s_instance_on_got_ip6));
 #endif
 
 #if CONFIG_APP_ITWT_ENABLE    
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_SETUP,    &mod_wifi_handler_itwt_setup,    NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_TEARDOWN, &mod_wifi_handler_itwt_teardown, NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_SUSPEND,  &mod_wifi_handler_itwt_suspend,  NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_PROBE,    &mod_wifi_handler_itwt_probe,    NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_SETUP,    &mod_wifi_handler_itwt_setup,    NULL, &s_instance_itwt_setup));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_TEARDOWN, &mod_wifi_handler_itwt_teardown, NULL, &s_instance_itwt_teardown));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_SUSPEND,  &mod_wifi_handler_itwt_suspend,  NULL, &s_instance_itwt_suspend));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_ITWT_PROBE,    &mod_wifi_handler_itwt_probe,    NULL, &s_instance_itwt_probe));
 #endif
 
     ESP_LOGI(TAG, "Connecting to %s...", wifi_config.sta.ssid);
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));    
+    mod_wifi_timing_mark(&ConnTiming.u16_ConnectCall_ms);
     esp_err_t ret = esp_wifi_connect();
 
     if (ret != ESP_OK) 
-    {
         ESP_LOGE(TAG, "WiFi connect failed! ret:%x", ret);
-        return ret;
-    }
-    
-    if (wait) 
-    {
-        ESP_LOGI(TAG, "Waiting for IP(s)");
-#if CONFIG_APP_CONNECT_IPV4
-        xSemaphoreTake(s_semph_get_ip_addrs, portMAX_DELAY);
-#endif
-#if CONFIG_APP_CONNECT_IPV6
-        xSemaphoreTake(s_semph_get_ip6_addrs, portMAX_DELAY);
-#endif
-        if (s_retry_num > CONFIG_APP_WIFI_CONN_MAX_RETRY) 
-            return ESP_FAIL;        
-    }
 
-    return ESP_OK;
+    return ret;
 }
 
 
@@ -429,25 +639,45 @@ static esp_err_t mod_wifi_sta_do_connect(wifi_config_t wifi_config, bool wait)
 /// @return ESP_OK on success
 static esp_err_t mod_wifi_sta_do_disconnect(void)
 {
-    ESP_ERROR_CHECK(esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &mod_wifi_handler_on_wifi_disconnect));
-    ESP_ERROR_CHECK(esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, &mod_wifi_handler_on_sta_got_ip));
-    ESP_ERROR_CHECK(esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &mod_wifi_handler_on_wifi_connect));
+    mod_wifi_handler_release(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &s_instance_on_disconnect);
+    mod_wifi_handler_release(IP_EVENT,   IP_EVENT_STA_GOT_IP,         &s_instance_on_got_ip);
+    mod_wifi_handler_release(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED,    &s_instance_on_connect);
 
 #if CONFIG_APP_CONNECT_IPV6
-    ESP_ERROR_CHECK(esp_event_handler_unregister(IP_EVENT, IP_EVENT_GOT_IP6, &mod_wifi_handler_on_sta_got_ipv6));
+    mod_wifi_handler_release(IP_EVENT, IP_EVENT_GOT_IP6, &s_instance_on_got_ip6);
 #endif
-    
-    if (s_semph_get_ip_addrs) 
-        vSemaphoreDelete(s_semph_get_ip_addrs);
-    
-#if CONFIG_APP_CONNECT_IPV6
-    if (s_semph_get_ip6_addrs) 
-        vSemaphoreDelete(s_semph_get_ip6_addrs);    
+
+#if CONFIG_APP_ITWT_ENABLE    
+    mod_wifi_handler_release(WIFI_EVENT, WIFI_EVENT_ITWT_SETUP,    &s_instance_itwt_setup);
+    mod_wifi_handler_release(WIFI_EVENT, WIFI_EVENT_ITWT_TEARDOWN, &s_instance_itwt_teardown);
+    mod_wifi_handler_release(WIFI_EVENT, WIFI_EVENT_ITWT_SUSPEND,  &s_instance_itwt_suspend);
+    mod_wifi_handler_release(WIFI_EVENT, WIFI_EVENT_ITWT_PROBE,    &s_instance_itwt_probe);
 #endif
+
+    if (s_conn_timeout) 
+        esp_timer_stop(s_conn_timeout);
+
+    mod_wifi_ready_reset();
+    ItwtState = MOD_WIFI_ITWT_NONE;
+
     return esp_wifi_disconnect();
 }
 
 
+/// @brief            Unregister a handler instance of the default event loop
+/// @param event_base Event base of the registration
+/// @param event_id   Event ID of the registration
+/// @param pInstance  Instance of the registration. Set to NULL. Nothing happens if it is NULL already.
+static void mod_wifi_handler_release(esp_event_base_t event_base, int32_t event_id, esp_event_handler_instance_t *pInstance)
+{
+    if(*pInstance == NULL)
+        return;
+
+    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(event_base, event_id, *pInstance));
+    *pInstance = NULL;
+}
+
+
 /// @brief  Start WiFi module
 /// @param  void
 static void mod_wifi_start(void)
@@ -498,34 +728,58 @@ static void mod_wifi_stop(void)
 /// @param event_data The data for the event
 static void mod_wifi_handler_on_wifi_disconnect(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
+    bool b_InAttempt = (ConnTiming.u16_Done_ms == MOD_WIFI_T_NONE);
+
+    //The addresses are gone with the link. Readiness is checked again after the reconnect.
+    mod_wifi_ready_reset();
+
+    //The agreement belongs to the association
+    ItwtState = MOD_WIFI_ITWT_NONE;
+
+    if (b_InAttempt)
+        ConnTiming.u8_LastReason = ((wifi_event_sta_disconnected_t*)event_data)->reason;
+
+#if CONFIG_APP_WIFI_FAST_RECONNECT
+    if (b_FastPinned)
+    {
+        bool b_FirstAttempt = b_FastPending;
+
+        mod_wifi_fast_unpin();
+
+        //The cached AP did not answer. Scan instead, this does not count as a retry.
+        if (b_FirstAttempt)
+        {
+            ConnTiming.b_Fallback = true;
+            ESP_LOGW(TAG, "Cached AP not found (reason %d), scanning", ((wifi_event_sta_disconnected_t*)event_data)->reason);
+            mod_wifi_reconnect();
+            return;
+        }
+    }
+#endif
+
     s_retry_num++;
 
+    if (b_InAttempt && ConnTiming.u8_Retries < UINT8_MAX)
+        ConnTiming.u8_Retries++;
+
     if (s_retry_num > CONFIG_APP_WIFI_CONN_MAX_RETRY) 
     {
         ESP_LOGI(TAG, "WiFi Connect failed %d times, stop reconnect.", s_retry_num);
-        /* let mod_wifi_sta_do_connect() return */
-        if (s_semph_get_ip_addrs) 
-            xSemaphoreGive(s_semph_get_ip_addrs);
-        
-#if CONFIG_APP_CONNECT_IPV6
-        if (s_semph_get_ip6_addrs)
-            xSemaphoreGive(s_semph_get_ip6_addrs);        
-#endif
-        EventDispatcher_PostEvent(MOD_WIFI_EVENTS, WIFI_CONNECT_FAILED_EVENT, NULL, 0, portMAX_DELAY); 
+        esp_timer_stop(s_conn_timeout);
+        mod_wifi_timing_done(ESP_FAIL);
+        EventDispatcher_TryPostEvent(MOD_WIFI_EVENTS, WIFI_CONNECT_FAILED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST); 
         return;
     }
 
-    EventDispatcher_PostEvent(MOD_WIFI_EVENTS, WIFI_DISCONNECTED_EVENT, NULL, 0, portMAX_DELAY); 
+    EventDispatcher_TryPostEvent(MOD_WIFI_EVENTS, WIFI_DISCONNECTED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST); 
 
     if(b_WiFi_Reconnect == true)
     {
+#ifdef CONFIG_APP_FLIGHT_REC
+        FREC_ERROR(FREC_SRC_WIFI, ((wifi_event_sta_disconnected_t*)event_data)->reason);
+#endif
         ESP_LOGI(TAG, "Wi-Fi disconnected, trying to reconnect...");    
-        esp_err_t err = esp_wifi_connect();    
-
-        if (err == ESP_ERR_WIFI_NOT_STARTED)
-            return;
-    
-        ESP_ERROR_CHECK(err);
+        mod_wifi_reconnect();
     }
 }
 
@@ -541,6 +795,13 @@ static void mod_wifi_handler_on_wifi_connect(void *esp_netif, esp_event_base_t e
     esp_wifi_sta_get_negotiated_phymode(&phymode);
     ESP_LOGI(TAG, "Wi-Fi Phy mode: %s", mod_wifi_phy_mode_to_str(phymode));
 
+    mod_wifi_timing_mark(&ConnTiming.u16_Assoc_ms);
+    ConnTiming.u8_PhyMode = (uint8_t)(phymode);
+#if CONFIG_APP_WIFI_FAST_RECONNECT
+    ConnTiming.b_Fast = b_FastPending;
+    mod_wifi_fast_save((wifi_event_sta_connected_t *)event_data, phymode);
+#endif
+
 #if CONFIG_APP_CONNECT_IPV6
     esp_netif_create_ip6_linklocal(esp_netif);
 #endif // CONFIG_EXAMPLE_CONNECT_IPV6
@@ -561,14 +822,14 @@ static void mod_wifi_handler_on_sta_got_ip(void *arg, esp_event_base_t event_bas
     if (!mod_wifi_is_our_netif(APP_NETIF_DESC_STA, event->esp_netif)) 
         return;
     
+    mod_wifi_timing_mark(&ConnTiming.u16_GotIp_ms);
     ESP_LOGI(TAG, "Got IPv4 event: Interface \"%s\" address: " IPSTR, esp_netif_get_desc(event->esp_netif), IP2STR(&event->ip_info.ip));
-    
-    if (s_semph_get_ip_addrs) 
-        xSemaphoreGive(s_semph_get_ip_addrs);
-    else 
-        ESP_LOGI(TAG, "- IPv4 address: " IPSTR ",", IP2STR(&event->ip_info.ip));
 
-    EventDispatcher_PostEvent(MOD_WIFI_EVENTS, WIFI_CONNECTED_EVENT, NULL, 0, portMAX_DELAY);   
+#if CONFIG_APP_CONNECT_READY_PREFER_IPV6
+    esp_timer_stop(s_ip6_deadline);
+    ESP_ERROR_CHECK(esp_timer_start_once(s_ip6_deadline, CONFIG_APP_CONNECT_IPV6_DEADLINE_MS * 1000ULL));
+#endif
+    mod_wifi_ready_add(MOD_WIFI_ADDR_IPV4);
 
 //ToDo: Test if iTWT can be enabled after data has been send and then going to sleep
 #if CONFIG_APP_ITWT_ENABLE
@@ -597,11 +858,8 @@ static void mod_wifi_handler_on_sta_got_ipv6(void *arg, esp_event_base_t event_b
 
     if (ipv6_type == CONFIG_APP_CONNECT_PREFERRED_IPV6_TYPE) 
     {
-        if (s_semph_get_ip6_addrs) 
-            xSemaphoreGive(s_semph_get_ip6_addrs);
-        else 
-            ESP_LOGI(TAG, "- IPv6 address: " IPV6STR ", type: %s", IPV62STR(event->ip6_info.ip), ipv6_addr_types_to_str[ipv6_type]);
-        
+        mod_wifi_timing_mark(&ConnTiming.u16_GotIp6_ms);
+        mod_wifi_ready_add(MOD_WIFI_ADDR_IPV6);
     }
 #endif // CONFIG_APP_CONNECT_IPV6
 }
@@ -616,22 +874,71 @@ static void mod_wifi_handler_on_sta_got_ipv6(void *arg, esp_event_base_t event_b
 static void mod_wifi_handler_itwt_setup(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     wifi_event_sta_itwt_setup_t *setup = (wifi_event_sta_itwt_setup_t *) event_data;
-    
-    if (setup->config.setup_cmd == TWT_ACCEPT) 
+    uint64_t u64_Offer_us = mod_wifi_itwt_invl_us(&setup->config);
+    uint64_t u64_Invl_us;
+    esp_err_t err;
+
+    if (setup->status != ESP_OK)
     {
-        /* TWT Wake Interval = TWT Wake Interval Mantissa * (2 ^ TWT Wake Interval Exponent) */
-        ESP_LOGI(TAG, "<WIFI_EVENT_ITWT_SETUP>twt_id:%d, flow_id:%d, %s, %s, wake_dura:%d, wake_invl_e:%d, wake_invl_m:%d", setup->config.twt_id,
-                setup->config.flow_id, setup->config.trigger ? "trigger-enabled" : "non-trigger-enabled", setup->config.flow_type ? "unannounced" : "announced",
-                setup->config.min_wake_dura, setup->config.wake_invl_expn, setup->config.wake_invl_mant);
-        ESP_LOGI(TAG, "<WIFI_EVENT_ITWT_SETUP>wake duration:%d us, service period:%d us", setup->config.min_wake_dura << 8, setup->config.wake_invl_mant << setup->config.wake_invl_expn);
-    
-        EventDispatcher_PostEvent(MOD_WIFI_EVENTS, WIFI_ITWT_ESTABLISHED, NULL, 0, portMAX_DELAY);   
-    } 
-    else     
+        ESP_LOGW(TAG, "<WIFI_EVENT_ITWT_SETUP>twt_id:%d, no response, status:0x%x, reason:%d", setup->config.twt_id, setup->status, setup->reason);
+        err = mod_wifi_itwt_request(ItwtSetup.setup_cmd);
+    }
+    else switch (setup->config.setup_cmd)
     {
-        //ToDo: Other setup.cmd replies must be handled When setting the iTWT to 10min we get a REJECTED (ID7) as response. 
-        ESP_LOGE(TAG, "<WIFI_EVENT_ITWT_SETUP>twt_id:%d, unexpected setup command:%d", setup->config.twt_id, setup->config.setup_cmd);
+        case TWT_ACCEPT:
+            /* TWT Wake Interval = TWT Wake Interval Mantissa * (2 ^ TWT Wake Interval Exponent) */
+            ESP_LOGI(TAG, "<WIFI_EVENT_ITWT_SETUP>twt_id:%d, flow_id:%d, %s, %s, wake_dura:%d, wake_invl_e:%d, wake_invl_m:%d", setup->config.twt_id,
+                    setup->config.flow_id, setup->config.trigger ? "trigger-enabled" : "non-trigger-enabled", setup->config.flow_type ? "unannounced" : "announced",
+                    setup->config.min_wake_dura, setup->config.wake_invl_expn, setup->config.wake_invl_mant);
+            ESP_LOGI(TAG, "<WIFI_EVENT_ITWT_SETUP>wake duration:%d us, wake interval:%llu us", setup->config.min_wake_dura << (setup->config.wake_duration_unit ? 10 : 8), u64_Offer_us);
+
+            mod_wifi_itwt_established(&setup->config);
+            return;
+
+        case TWT_ALTERNATE:
+        case TWT_DICTATE:
+            ESP_LOGW(TAG, "<WIFI_EVENT_ITWT_SETUP>twt_id:%d, AP %s wake interval:%llu us, wake_dura:%d", setup->config.twt_id,
+                     (setup->config.setup_cmd == TWT_DICTATE) ? "dictates" : "offers", u64_Offer_us, setup->config.min_wake_dura);
+
+            if (u64_Offer_us < u64_ItwtMin_us || u64_Offer_us > u64_ItwtAsked_us)
+            {
+                ESP_LOGE(TAG, "iTWT wake interval of the AP out of %llu..%llu us", u64_ItwtMin_us, u64_ItwtAsked_us);
+                err = ESP_FAIL;
+                break;
+            }
+
+            //Within our limits, demand what the AP offered
+            ItwtSetup.wake_invl_mant     = setup->config.wake_invl_mant;
+            ItwtSetup.wake_invl_expn     = setup->config.wake_invl_expn;
+            ItwtSetup.min_wake_dura      = setup->config.min_wake_dura;
+            ItwtSetup.wake_duration_unit = setup->config.wake_duration_unit;
+            err = mod_wifi_itwt_request(TWT_DEMAND);
+            break;
+
+        case TWT_REJECT:
+            //No counter-offer. Some APs reject long intervals (10 min) without telling their limit, try half the interval.
+            u64_Invl_us = mod_wifi_itwt_invl_us(&ItwtSetup);
+            ESP_LOGW(TAG, "<WIFI_EVENT_ITWT_SETUP>twt_id:%d, rejected wake interval:%llu us", setup->config.twt_id, u64_Invl_us);
+
+            if (u64_Invl_us <= u64_ItwtMin_us)
+            {
+                err = ESP_FAIL;
+                break;
+            }
+
+            u64_Invl_us = (u64_Invl_us / 2 > u64_ItwtMin_us) ? (u64_Invl_us / 2) : u64_ItwtMin_us;
+            mod_wifi_itwt_encode(u64_Invl_us, &ItwtSetup);
+            err = mod_wifi_itwt_request(TWT_SUGGEST);
+            break;
+
+        default:
+            ESP_LOGE(TAG, "<WIFI_EVENT_ITWT_SETUP>twt_id:%d, unexpected setup command:%d", setup->config.twt_id, setup->config.setup_cmd);
+            err = ESP_FAIL;
+            break;
     }
+
+    if (err != ESP_OK)
+        mod_wifi_itwt_failed( );
 }
 
 
@@ -645,7 +952,9 @@ static void mod_wifi_handler_itwt_teardown(void *arg, esp_event_base_t event_bas
     wifi_event_sta_itwt_teardown_t *teardown = (wifi_event_sta_itwt_teardown_t *) event_data;
     ESP_LOGI(TAG, "<WIFI_EVENT_ITWT_TEARDOWN>flow_id %d%s", teardown->flow_id, (teardown->flow_id == 8) ? "(all twt)" : "");
 
-    EventDispatcher_PostEvent(MOD_WIFI_EVENTS, WIFI_ITWT_CLOSED, NULL, 0, portMAX_DELAY);   
+    //Ours or by the AP. A suspended agreement is gone as well, mod_wifi_init_iTWT(..) negotiates again.
+    ItwtState = MOD_WIFI_ITWT_NONE;
+    EventDispatcher_TryPostEvent(MOD_WIFI_EVENTS, WIFI_ITWT_CLOSED, NULL, 0, EVENT_DISP_DROP_OLDEST);   
 }
 
 
@@ -657,10 +966,42 @@ static void mod_wifi_handler_itwt_teardown(void *arg, esp_event_base_t event_bas
 static void mod_wifi_handler_itwt_suspend(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     wifi_event_sta_itwt_suspend_t *suspend = (wifi_event_sta_itwt_suspend_t *) event_data;
-    ESP_LOGI(TAG, "<WIFI_EVENT_ITWT_SUSPEND>status:%d, flow_id_bitmap:0x%x, actual_suspend_time_ms:[%lu %lu %lu %lu %lu %lu %lu %lu]",
+    uint32_t u32_Actual_ms = suspend->actual_suspend_time_ms[u8_ItwtFlowId];
+
+    ESP_LOGD(TAG, "<WIFI_EVENT_ITWT_SUSPEND>status:%d, flow_id_bitmap:0x%x, actual_suspend_time_ms:[%lu %lu %lu %lu %lu %lu %lu %lu]",
              suspend->status, suspend->flow_id_bitmap,
              suspend->actual_suspend_time_ms[0], suspend->actual_suspend_time_ms[1], suspend->actual_suspend_time_ms[2], suspend->actual_suspend_time_ms[3],
              suspend->actual_suspend_time_ms[4], suspend->actual_suspend_time_ms[5], suspend->actual_suspend_time_ms[6], suspend->actual_suspend_time_ms[7]);
+
+    if (ItwtState != MOD_WIFI_ITWT_SUSPENDING && ItwtState != MOD_WIFI_ITWT_RESUMING)
+        return;
+
+    if (suspend->status != ESP_OK || (suspend->flow_id_bitmap & (1 << u8_ItwtFlowId)) == 0)
+    {
+        ESP_LOGW(TAG, "<WIFI_EVENT_ITWT_SUSPEND>status:%d, flow_id_bitmap:0x%x. Agreement gone", suspend->status, suspend->flow_id_bitmap);
+
+        //Before sleeping: fall back to a full setup. After waking up: the next mod_wifi_init_iTWT(..) negotiates.
+        if (ItwtState == MOD_WIFI_ITWT_RESUMING && mod_wifi_itwt_negotiate( ) != ESP_OK)
+            mod_wifi_itwt_failed( );
+        else if (ItwtState == MOD_WIFI_ITWT_SUSPENDING)
+            ItwtState = MOD_WIFI_ITWT_NONE;
+
+        return;
+    }
+
+    if (ItwtState == MOD_WIFI_ITWT_SUSPENDING)
+    {
+        //The AP may shorten the suspension. Seen by mod_wifi_itwt_resume(..) if it ends before the awake phase.
+        s64_ItwtResume_us = esp_timer_get_time( ) + (int64_t)(u32_Actual_ms) * 1000;
+        ItwtState = MOD_WIFI_ITWT_SUSPENDED;
+
+#if CONFIG_APP_ITWT_WAKE_SUSPEND
+        if (u32_Actual_ms < CONFIG_APP_ITWT_SUSPEND_MS)
+            ESP_LOGW(TAG, "iTWT suspended for %lu ms instead of %d ms", u32_Actual_ms, CONFIG_APP_ITWT_SUSPEND_MS);
+#endif
+    }
+    else
+        mod_wifi_itwt_active(true);     //Service periods start after the actual suspend time
 }
 
 
@@ -773,6 +1114,455 @@ static void mod_wifi_print_all_netif_ips(const char *prefix)
 }
 
 
+/// @brief     esp_timer callback. No addresses of the readiness policy within CONFIG_APP_CONNECT_TIMEOUT_MS.
+///            DHCP or the router advertisement did not answer or the AP was not found in time.
+/// @param arg Not used
+static void mod_wifi_handler_conn_timeout(void *arg)
+{
+    bool b_Failed;
+
+    portENTER_CRITICAL(&ReadyLock);
+    b_Failed  = (b_Settled == false);
+    b_Settled = true;
+    portEXIT_CRITICAL(&ReadyLock);
+
+    if (b_Failed == false)
+        return;
+
+    ESP_LOGE(TAG, "No connection within %d ms (addresses 0x%02x), stop reconnect.", CONFIG_APP_CONNECT_TIMEOUT_MS, u8_Addrs);
+    b_WiFi_Reconnect = false;
+    mod_wifi_timing_done(ESP_ERR_TIMEOUT);
+    EventDispatcher_TryPostEvent(MOD_WIFI_EVENTS, WIFI_CONNECT_FAILED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST);
+}
+
+
+#if CONFIG_APP_CONNECT_READY_PREFER_IPV6
+/// @brief     esp_timer callback. The preferred IPv6 address did not come within CONFIG_APP_CONNECT_IPV6_DEADLINE_MS
+///            after the IPv4 address. Ready with IPv4.
+/// @param arg Not used
+static void mod_wifi_handler_ip6_deadline(void *arg)
+{
+    ESP_LOGW(TAG, "No IPv6 address within %d ms, continuing with IPv4", CONFIG_APP_CONNECT_IPV6_DEADLINE_MS);
+    mod_wifi_ready_add(MOD_WIFI_ADDR_IP6_DEADLINE);
+}
+#endif
+
+
+/// @brief         Adds an assigned address and posts WIFI_CONNECTED_EVENT once the readiness policy is met
+/// @param u8_Addr MOD_WIFI_ADDR_x or MOD_WIFI_ADDR_IP6_DEADLINE
+/// @note          Called from the default event loop and the esp_timer task
+static void mod_wifi_ready_add(uint8_t u8_Addr)
+{
+    bool b_Ready;
+
+    portENTER_CRITICAL(&ReadyLock);
+    u8_Addrs |= u8_Addr;
+    b_Ready = (b_Settled == false) && MOD_WIFI_ADDRS_READY(u8_Addrs);
+
+    if (b_Ready)
+        b_Settled = true;
+    portEXIT_CRITICAL(&ReadyLock);
+
+    if (b_Ready == false)
+        return;
+
+    esp_timer_stop(s_conn_timeout);
+#if CONFIG_APP_CONNECT_READY_PREFER_IPV6
+    esp_timer_stop(s_ip6_deadline);
+#endif
+
+    mod_wifi_print_all_netif_ips(APP_NETIF_DESC_STA);
+    EventDispatcher_TryPostEvent(MOD_WIFI_EVENTS, WIFI_CONNECTED_EVENT, NULL, 0, EVENT_DISP_DROP_OLDEST);
+    mod_wifi_timing_mark(&ConnTiming.u16_Connected_ms);
+    mod_wifi_timing_done(ESP_OK);
+}
+
+
+/// @brief Forgets the addresses of the last association
+static void mod_wifi_ready_reset(void)
+{
+    portENTER_CRITICAL(&ReadyLock);
+    u8_Addrs  = 0;
+    b_Settled = false;
+    portEXIT_CRITICAL(&ReadyLock);
+
+#if CONFIG_APP_CONNECT_READY_PREFER_IPV6
+    if (s_ip6_deadline)
+        esp_timer_stop(s_ip6_deadline);
+#endif
+}
+
+
+/// @brief Starts CONFIG_APP_CONNECT_TIMEOUT_MS unless it is running already. Retries do not extend it.
+static void mod_wifi_conn_timeout_arm(void)
+{
+    if (esp_timer_is_active(s_conn_timeout))
+        return;
+
+    ESP_ERROR_CHECK(esp_timer_start_once(s_conn_timeout, CONFIG_APP_CONNECT_TIMEOUT_MS * 1000ULL));
+}
+
+
+/// @brief Next connect attempt after a disconnect unless the reconnect has been stopped
+/// @note  Does not abort. If the attempt cannot be started CONFIG_APP_CONNECT_TIMEOUT_MS ends the connect.
+static void mod_wifi_reconnect(void)
+{
+    esp_err_t err;
+
+    if (b_WiFi_Reconnect == false)
+        return;
+
+    mod_wifi_conn_timeout_arm();
+    err = esp_wifi_connect();
+
+    //Wi-Fi has been stopped in between, e.g. by mod_wifi_disconnect(..)
+    if (err != ESP_OK && err != ESP_ERR_WIFI_NOT_STARTED)
+        ESP_LOGE(TAG, "Reconnect failed: %s", esp_err_to_name(err));
+}
+
+
+#if CONFIG_APP_ITWT_ENABLE
+/// @brief                 Mantissa and exponent of a wake interval
+/// @param u64_WakeInvl_us Wake interval
+/// @param pConfig         Gets wake_invl_mant and wake_invl_expn
+/// @note                  The smallest exponent which fits the mantissa into 16 bit has the finest resolution
+static void mod_wifi_itwt_encode(uint64_t u64_WakeInvl_us, wifi_twt_setup_config_t *pConfig)
+{
+    uint8_t  u8_Expn = 0;
+    uint64_t u64_Mant;
+
+    //Rounded to the nearest mantissa
+    while (u8_Expn < MOD_WIFI_ITWT_EXPN_MAX && ((u64_WakeInvl_us + ((1ULL << u8_Expn) >> 1)) >> u8_Expn) > MOD_WIFI_ITWT_MANT_MAX)
+        u8_Expn++;
+
+    u64_Mant = (u64_WakeInvl_us + ((1ULL << u8_Expn) >> 1)) >> u8_Expn;
+
+    pConfig->wake_invl_expn = u8_Expn;
+    pConfig->wake_invl_mant = (u64_Mant < 1) ? 1 : ((u64_Mant > MOD_WIFI_ITWT_MANT_MAX) ? MOD_WIFI_ITWT_MANT_MAX : (uint16_t)(u64_Mant));
+}
+
+
+/// @brief         Wake interval of a setup config
+/// @param pConfig Setup config
+/// @return        wake_invl_mant * 2^wake_invl_expn in us
+static uint64_t mod_wifi_itwt_invl_us(const wifi_twt_setup_config_t *pConfig)
+{
+    return (uint64_t)(pConfig->wake_invl_mant) << pConfig->wake_invl_expn;
+}
+
+
+/// @brief  Starts a negotiation with the target of mod_wifi_init_iTWT(..)
+/// @return ESP_OK if the setup request was sent
+static esp_err_t mod_wifi_itwt_negotiate(void)
+{
+    ItwtSetup = (wifi_twt_setup_config_t)
+    {
+        .setup_cmd       = TWT_SUGGEST,
+        .flow_id         = 0,
+        .twt_id          = CONFIG_APP_ITWT_ID,
+        .flow_type       = flow_type_announced ? 0 : 1,
+        .min_wake_dura   = u8_ItwtAskedDura,
+        .trigger         = trigger_enabled,
+        .timeout_time_ms = CONFIG_APP_ITWT_SETUP_TIMEOUT_TIME_MS,
+    };
+    mod_wifi_itwt_encode(u64_ItwtAsked_us, &ItwtSetup);
+
+    ESP_LOGD(TAG, "iTWT wake interval: mantissa %d, exponent %d = %llu us, wake duration %d us",
+             ItwtSetup.wake_invl_mant, ItwtSetup.wake_invl_expn, u64_ItwtAsked_us, ItwtSetup.min_wake_dura << 8);
+
+    u8_ItwtRequests = 0;
+    ItwtState       = MOD_WIFI_ITWT_SETUP;
+
+    return mod_wifi_itwt_request(TWT_SUGGEST);
+}
+
+
+/// @brief     Sends ItwtSetup
+/// @param Cmd TWT_SUGGEST: the AP may answer with a counter-offer, TWT_DEMAND: takes a counter-offer of the AP
+/// @return    ESP_FAIL after CONFIG_APP_ITWT_SETUP_MAX_REQUESTS requests
+static esp_err_t mod_wifi_itwt_request(wifi_twt_setup_cmds_t Cmd)
+{
+    esp_err_t err;
+
+    if (u8_ItwtRequests >= CONFIG_APP_ITWT_SETUP_MAX_REQUESTS)
+    {
+        ESP_LOGE(TAG, "No iTWT agreement after %d setup requests", u8_ItwtRequests);
+        return ESP_FAIL;
+    }
+
+    u8_ItwtRequests++;
+    ItwtSetup.setup_cmd = Cmd;
+    err = esp_wifi_sta_itwt_setup(&ItwtSetup);
+
+    if (err != ESP_OK) 
+        ESP_LOGE(TAG, "itwt setup failed, err:0x%x", err);
+    else
+        mod_wifi_itwt_frames(2);        //Request and response
+
+    return err;
+}
+
+
+/// @brief  Resumes the agreement suspended by mod_wifi_suspend_iTWT(..)
+/// @return ESP_OK if the agreement is active or the resume was sent. Otherwise it has to be negotiated.
+/// @note   There is no resume call. A suspend with MOD_WIFI_ITWT_RESUME_MS replaces the running suspension, 
+///         WIFI_EVENT_ITWT_SUSPEND reports when the service periods start again.
+static esp_err_t mod_wifi_itwt_resume(void)
+{
+    esp_err_t err;
+
+    if (ItwtState != MOD_WIFI_ITWT_SUSPENDING && ItwtState != MOD_WIFI_ITWT_SUSPENDED)
+        return ESP_ERR_INVALID_STATE;
+
+    //Suspension already over, downlink frames of the awake phase waited for the service periods
+    if (ItwtState == MOD_WIFI_ITWT_SUSPENDED && esp_timer_get_time( ) >= s64_ItwtResume_us)
+    {
+        ESP_LOGW(TAG, "iTWT resumed before the end of the awake phase, CONFIG_APP_ITWT_SUSPEND_MS too short");
+        mod_wifi_itwt_active(true);
+        return ESP_OK;
+    }
+
+    ItwtState = MOD_WIFI_ITWT_RESUMING;
+    err = esp_wifi_sta_itwt_suspend(u8_ItwtFlowId, MOD_WIFI_ITWT_RESUME_MS);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "itwt resume failed, err:0x%x", err);
+        ItwtState = MOD_WIFI_ITWT_NONE;
+        return err;
+    }
+
+    mod_wifi_itwt_frames(1);
+
+    return ESP_OK;
+}
+
+
+/// @brief         Keeps the agreement and activates it
+/// @param pConfig Setup config accepted by the AP
+static void mod_wifi_itwt_established(const wifi_twt_setup_config_t *pConfig)
+{
+    uint64_t u64_WakeInvl_ms = (mod_wifi_itwt_invl_us(pConfig) + 500) / 1000;
+
+    u8_ItwtFlowId = pConfig->flow_id;
+    ItwtAgreement = (MOD_WIFI_ITWT_t)
+    {
+        .u32_WakeInvl_ms  = (u64_WakeInvl_ms > UINT32_MAX) ? UINT32_MAX : (uint32_t)(u64_WakeInvl_ms),
+        .u32_WakeDura_us  = (uint32_t)(pConfig->min_wake_dura) << (pConfig->wake_duration_unit ? 10 : 8),
+        .u16_WakeInvlMant = pConfig->wake_invl_mant,
+        .u8_WakeInvlExpn  = pConfig->wake_invl_expn,
+        .u8_MinWakeDura   = pConfig->min_wake_dura,
+        .u8_Requests      = u8_ItwtRequests,
+        .b_Modified       = (mod_wifi_itwt_invl_us(pConfig) != u64_ItwtAsked_us) || (pConfig->min_wake_dura != u8_ItwtAskedDura) ||
+                            (pConfig->wake_duration_unit != 0),
+    };
+
+    if (ItwtAgreement.b_Modified)
+        ESP_LOGW(TAG, "iTWT agreed with modified values after %d requests: wake interval %lu ms, wake duration %lu us",
+                 ItwtAgreement.u8_Requests, ItwtAgreement.u32_WakeInvl_ms, ItwtAgreement.u32_WakeDura_us);
+
+    mod_wifi_itwt_active(false);
+}
+
+
+/// @brief           Agreement active before sleeping. Updates ItwtStats and posts WIFI_ITWT_ESTABLISHED with ItwtAgreement.
+/// @param b_Resumed true: suspended agreement resumed, false: negotiated
+static void mod_wifi_itwt_active(bool b_Resumed)
+{
+    uint32_t u32_Latency_ms = (uint32_t)((esp_timer_get_time( ) - s64_ItwtStart_us) / 1000);
+
+#if CONFIG_APP_ITWT_WAKE_SUSPEND
+    //Suspended agreements are resumed. Every setup after the first one replaces an agreement which was gone.
+    if (b_Resumed == false && (ItwtStats.u32_Setups + ItwtStats.u32_Resumes) > 0)
+        ItwtStats.u32_Fallbacks++;
+#endif
+
+    if (b_Resumed)
+    {
+        ItwtStats.u32_Resumes++;
+        ItwtStats.u32_SumResume_ms += u32_Latency_ms;
+    }
+    else
+    {
+        ItwtStats.u32_Setups++;
+        ItwtStats.u32_SumSetup_ms += u32_Latency_ms;
+    }
+
+    ItwtStats.u32_Last_ms   = u32_Latency_ms;
+    ItwtStats.u8_LastFrames = u8_ItwtFrames;
+    ItwtStats.b_LastResumed = b_Resumed;
+    u8_ItwtFrames = 0;
+    ItwtState     = MOD_WIFI_ITWT_ACTIVE;
+
+    ESP_LOGI(TAG, "iTWT %s in %lu ms, %d frames. Setups %lu x %lu ms, resumes %lu x %lu ms, fallbacks %lu, %lu frames",
+             b_Resumed ? "resumed" : "negotiated", u32_Latency_ms, ItwtStats.u8_LastFrames,
+             ItwtStats.u32_Setups,  ItwtStats.u32_Setups  ? (ItwtStats.u32_SumSetup_ms  / ItwtStats.u32_Setups)  : 0,
+             ItwtStats.u32_Resumes, ItwtStats.u32_Resumes ? (ItwtStats.u32_SumResume_ms / ItwtStats.u32_Resumes) : 0,
+             ItwtStats.u32_Fallbacks, ItwtStats.u32_Frames);
+
+    EventDispatcher_TryPostEvent(MOD_WIFI_EVENTS, WIFI_ITWT_ESTABLISHED, &ItwtAgreement, sizeof(ItwtAgreement), EVENT_DISP_DROP_OLDEST);
+}
+
+
+/// @brief           Counts TWT action frames on air
+/// @param u8_Frames Frames of the exchange
+static void mod_wifi_itwt_frames(uint8_t u8_Frames)
+{
+    ItwtStats.u32_Frames += u8_Frames;
+
+    if (u8_ItwtFrames <= UINT8_MAX - u8_Frames)
+        u8_ItwtFrames += u8_Frames;
+}
+#endif
+
+
+/// @brief Posts WIFI_ITWT_FAILED. mod_pwr sleeps without an agreement.
+static void mod_wifi_itwt_failed(void)
+{
+    ItwtState = MOD_WIFI_ITWT_NONE;
+    ItwtStats.u32_Failed++;
+#if CONFIG_APP_ITWT_ENABLE
+    u8_ItwtFrames = 0;
+#endif
+
+    EventDispatcher_TryPostEvent(MOD_WIFI_EVENTS, WIFI_ITWT_FAILED, NULL, 0, EVENT_DISP_DROP_OLDEST);
+}
+
+
+/// @brief Starts the timing of a connect attempt
+static void mod_wifi_timing_start(void)
+{
+    memset(&ConnTiming, 0, sizeof(ConnTiming));
+    ConnTiming.u16_WiFiStart_ms   = MOD_WIFI_T_NONE;
+    ConnTiming.u16_ConnectCall_ms = MOD_WIFI_T_NONE;
+    ConnTiming.u16_Assoc_ms       = MOD_WIFI_T_NONE;
+    ConnTiming.u16_GotIp_ms       = MOD_WIFI_T_NONE;
+    ConnTiming.u16_GotIp6_ms      = MOD_WIFI_T_NONE;
+    ConnTiming.u16_Connected_ms   = MOD_WIFI_T_NONE;
+    ConnTiming.u16_Done_ms        = MOD_WIFI_T_NONE;
+    ConnTiming.s64_Start_us       = esp_timer_get_time();
+}
+
+
+/// @brief              Sets a phase of the running connect attempt to now
+/// @param pu16_Time_ms Field of ConnTiming. Later tries overwrite earlier ones. Ignored after the attempt is done.
+static void mod_wifi_timing_mark(uint16_t *pu16_Time_ms)
+{
+    int64_t s64_Time_ms = (esp_timer_get_time() - ConnTiming.s64_Start_us) / 1000;
+
+    if (ConnTiming.u16_Done_ms != MOD_WIFI_T_NONE)
+        return;
+
+    *pu16_Time_ms = (s64_Time_ms < MOD_WIFI_T_NONE) ? (uint16_t)(s64_Time_ms) : (MOD_WIFI_T_NONE - 1);
+}
+
+
+/// @brief        Ends the connect attempt and logs the phases
+/// @param Result ESP_OK if ready, ESP_FAIL after the retries, ESP_ERR_TIMEOUT after CONFIG_APP_CONNECT_TIMEOUT_MS
+static void mod_wifi_timing_done(esp_err_t Result)
+{
+    if (ConnTiming.u16_Done_ms != MOD_WIFI_T_NONE)
+        return;     /*Reconnect after a link loss*/
+
+    mod_wifi_timing_mark(&ConnTiming.u16_Done_ms);
+
+    ESP_LOGI(TAG, "Connect %s%s: wifi start %u, connect %u, assoc %u, IPv4 %u, IPv6 %u, event %u, done %u ms. Retries %u, reason %u",
+             (Result == ESP_OK) ? "ok" : "failed", ConnTiming.b_Fast ? " (cached AP)" : (ConnTiming.b_Fallback ? " (fallback scan)" : ""),
+             ConnTiming.u16_WiFiStart_ms, ConnTiming.u16_ConnectCall_ms, ConnTiming.u16_Assoc_ms, ConnTiming.u16_GotIp_ms,
+             ConnTiming.u16_GotIp6_ms, ConnTiming.u16_Connected_ms, ConnTiming.u16_Done_ms, ConnTiming.u8_Retries, ConnTiming.u8_LastReason);
+}
+
+
+#if CONFIG_APP_WIFI_FAST_RECONNECT
+/// @brief              Pins the STA config to the cached AP if the cache is valid
+/// @param[in,out] pConfig STA config with SSID and password
+static void mod_wifi_fast_apply(wifi_config_t *pConfig)
+{
+    b_FastPinned  = false;
+    b_FastPending = false;
+
+    if (WiFiFast.u32_Magic != MOD_WIFI_FAST_MAGIC || WiFiFast.u32_Crc != mod_wifi_fast_crc() ||
+        WiFiFast.u32_SsidCrc != esp_rom_crc32_le(0, (const uint8_t *)(DEFAULT_SSID), sizeof(DEFAULT_SSID) - 1))
+    {
+        ESP_LOGI(TAG, "No cached AP, scanning");
+        return;
+    }
+
+    //With a channel set only this channel is probed
+    pConfig->sta.bssid_set   = true;
+    memcpy(pConfig->sta.bssid, WiFiFast.au8_Bssid, sizeof(pConfig->sta.bssid));
+    pConfig->sta.channel     = WiFiFast.u8_Channel;
+    pConfig->sta.scan_method = WIFI_FAST_SCAN;
+
+    b_FastPinned  = true;
+    b_FastPending = true;
+
+    ESP_LOGI(TAG, "Fast connect to cached AP " MACSTR " on channel %d", MAC2STR(WiFiFast.au8_Bssid), WiFiFast.u8_Channel);
+}
+
+
+/// @brief Releases the STA config from the cached AP. The next connect scans with the configured scan method.
+/// @note  Drops the cache and counts a fallback if the first attempt with the cached AP failed
+static void mod_wifi_fast_unpin(void)
+{
+    wifi_config_t Config;
+
+    if (b_FastPending)
+    {
+        WiFiFast.u32_Magic = 0;
+        WiFiFastStats.u32_Fallback++;
+    }
+
+    b_FastPinned  = false;
+    b_FastPending = false;
+
+    esp_wifi_get_config(WIFI_IF_STA, &Config);
+    Config.sta.bssid_set   = false;
+    Config.sta.channel     = 0;
+    Config.sta.scan_method = DEFAULT_WIFI_SCAN_METHOD;
+    esp_wifi_set_config(WIFI_IF_STA, &Config);
+}
+
+
+/// @brief            Caches the AP of a successful connect
+/// @param pConnected Data of WIFI_EVENT_STA_CONNECTED
+/// @param PhyMode    Negotiated PHY mode
+static void mod_wifi_fast_save(const wifi_event_sta_connected_t *pConnected, wifi_phy_mode_t PhyMode)
+{
+    if (b_FastPending)
+    {
+        WiFiFastStats.u32_Fast++;
+
+        if ((WiFiFast.u8_AuthMode != pConnected->authmode) || (WiFiFast.u8_PhyMode != PhyMode))
+            ESP_LOGW(TAG, "Cached AP changed: auth mode %d -> %d, %s -> %s", WiFiFast.u8_AuthMode, pConnected->authmode,
+                     mod_wifi_phy_mode_to_str(WiFiFast.u8_PhyMode), mod_wifi_phy_mode_to_str(PhyMode));
+    }
+    else
+        WiFiFastStats.u32_Scan++;
+
+    b_FastPending = false;
+
+    WiFiFast.u32_Magic   = MOD_WIFI_FAST_MAGIC;
+    WiFiFast.u32_SsidCrc = esp_rom_crc32_le(0, (const uint8_t *)(DEFAULT_SSID), sizeof(DEFAULT_SSID) - 1);
+    memcpy(WiFiFast.au8_Bssid, pConnected->bssid, sizeof(WiFiFast.au8_Bssid));
+    WiFiFast.u8_Channel  = pConnected->channel;
+    WiFiFast.u8_AuthMode = (uint8_t)(pConnected->authmode);
+    WiFiFast.u8_PhyMode  = (uint8_t)(PhyMode);
+    WiFiFast.u32_Crc     = mod_wifi_fast_crc();
+
+    ESP_LOGI(TAG, "Connects fast: %lu, scan: %lu, fallback: %lu", WiFiFastStats.u32_Fast, WiFiFastStats.u32_Scan, WiFiFastStats.u32_Fallback);
+}
+
+
+/// @brief  CRC of the cached AP
+/// @return CRC over all fields before u32_Crc
+static uint32_t mod_wifi_fast_crc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)(&WiFiFast), offsetof(MOD_WIFI_FAST_t, u32_Crc));
+}
+#endif
+
+
 /// @brief        "Translates" wifi_itwt_probe_status_t into string
 /// @param status See wifi_itwt_probe_status_t 
 /// @return       translated string
@@ -67,16 +67,86 @@
 
 
 /* Exported types ------------------------------------------------------------*/
+/// @brief Connects since the last cold boot by the way the AP was found
+typedef struct MOD_WIFI_FAST_STATS_t
+{
+    uint32_t u32_Fast;                          //!< Connected to the cached AP without a scan
+    uint32_t u32_Scan;                          //!< Connected after a scan (no cache or fallback)
+    uint32_t u32_Fallback;                      //!< Cached AP did not answer, fell back to a scan
+
+}MOD_WIFI_FAST_STATS_t;
+
+/// @brief Timing of one connect attempt (mod_wifi_connect(..)). Times in ms since its start, MOD_WIFI_T_NONE if not reached.
+/// @note  The driver reports no end of the connect scan. u16_Assoc_ms includes scan, authentication, association and
+///        the WPA handshake. Compare attempts with and without b_Fast (no scan) to see the scan share.
+typedef struct MOD_WIFI_CONN_TIMING_t
+{
+    int64_t  s64_Start_us;                      //!< esp_timer time of the start
+    uint16_t u16_WiFiStart_ms;                  //!< esp_wifi_init(..) and esp_wifi_start(..) done
+    uint16_t u16_ConnectCall_ms;                //!< esp_wifi_connect(..) called. Scan starts
+    uint16_t u16_Assoc_ms;                      //!< WIFI_EVENT_STA_CONNECTED of the successful try
+    uint16_t u16_GotIp_ms;                      //!< IP_EVENT_STA_GOT_IP. DHCP or static IP
+    uint16_t u16_GotIp6_ms;                     //!< Preferred IPv6 address. Link local incl. DAD
+    uint16_t u16_Connected_ms;                  //!< WIFI_CONNECTED_EVENT posted
+    uint16_t u16_Done_ms;                       //!< Readiness policy met or the attempt failed
+    uint8_t  u8_Retries;                        //!< Disconnects during the attempt, see CONFIG_APP_WIFI_CONN_MAX_RETRY
+    uint8_t  u8_LastReason;                     //!< wifi_err_reason_t of the last disconnect. 0 = none
+    uint8_t  u8_PhyMode;                        //!< Negotiated wifi_phy_mode_t
+    bool     b_Fast;                            //!< Connected to the cached AP without a scan
+    bool     b_Fallback;                        //!< Cached AP failed, connected after a scan
+
+}MOD_WIFI_CONN_TIMING_t;
+
+/// @brief iTWT agreement with the AP. Data of WIFI_ITWT_ESTABLISHED.
+typedef struct MOD_WIFI_ITWT_t
+{
+    uint32_t u32_WakeInvl_ms;                   //!< Agreed wake interval, wake_invl_mant * 2^wake_invl_expn us
+    uint32_t u32_WakeDura_us;                   //!< Agreed service period (nominal minimum wake duration)
+    uint16_t u16_WakeInvlMant;                  //!< Wake interval mantissa
+    uint8_t  u8_WakeInvlExpn;                   //!< Wake interval exponent
+    uint8_t  u8_MinWakeDura;                    //!< Wake duration in units of 256 us (1024 us if the AP set the unit)
+    uint8_t  u8_Requests;                       //!< Setup requests until the agreement
+    bool     b_Modified;                        //!< The AP did not agree to the requested values
+
+}MOD_WIFI_ITWT_t;
+
+/// @brief iTWT agreements since boot by the way they were (re)activated before sleeping. Compares CONFIG_APP_ITWT_WAKE_x.
+/// @note  Latency is the time from mod_wifi_init_iTWT(..) until the agreement is active, the device is awake for it.
+///        Frames are the TWT action frames on air, the airtime of the agreement handling: setup request and response,
+///        teardown and suspend (TWT information frame).
+typedef struct MOD_WIFI_ITWT_STATS_t
+{
+    uint32_t u32_Setups;                        //!< Agreements negotiated with setup requests
+    uint32_t u32_Resumes;                       //!< Suspended agreements resumed without a setup
+    uint32_t u32_Fallbacks;                     //!< Agreement gone while suspended, negotiated again. Included in u32_Setups
+    uint32_t u32_Failed;                        //!< No agreement, see WIFI_ITWT_FAILED
+    uint32_t u32_Frames;                        //!< TWT action frames
+    uint32_t u32_SumSetup_ms;                   //!< Sum of the setup latencies
+    uint32_t u32_SumResume_ms;                  //!< Sum of the resume latencies
+    uint32_t u32_Last_ms;                       //!< Latency of the last agreement
+    uint8_t  u8_LastFrames;                     //!< Frames of the last cycle, from waking up until the agreement
+    bool     b_LastResumed;                     //!< The last agreement was resumed
+
+}MOD_WIFI_ITWT_STATS_t;
 
 
 /* Exported constants --------------------------------------------------------*/
+#define MOD_WIFI_T_NONE             0xFFFF      //!< Connect phase not reached
+#define MOD_WIFI_ADDR_IPV4          0x01        //!< IPv4 address assigned
+#define MOD_WIFI_ADDR_IPV6          0x02        //!< Preferred IPv6 address assigned (CONFIG_APP_CONNECT_PREFERRED_IPV6)
 
 
 /* Exported functions --------------------------------------------------------*/
 esp_err_t mod_wifi_connect(void);
 esp_err_t mod_wifi_disconnect(bool b_CreateEvent);
-void mod_wifi_init_iTWT(void);
+esp_err_t mod_wifi_init_iTWT(uint32_t u32_WakeInvl_ms, uint32_t u32_WakeDura_us);
 void mod_wifi_stop_iTWT(void);
+void mod_wifi_suspend_iTWT(void);
+void mod_wifi_get_itwt_stats(MOD_WIFI_ITWT_STATS_t *pStats);
+esp_err_t mod_wifi_get_rssi(int8_t *ps8_RSSI);
+void mod_wifi_get_fast_stats(MOD_WIFI_FAST_STATS_t *pStats);
+void mod_wifi_get_conn_timing(MOD_WIFI_CONN_TIMING_t *pTiming);
+uint8_t mod_wifi_get_addrs(void);
 
 
 /* Initialization and de-initialization functions *****************************/
@@ -37,10 +37,20 @@
 /* Includes ------------------------------------------------------------------*/
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_pm.h"
 #include "esp_timer.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_rom_crc.h"
 #include "sdkconfig.h"
 #include "mod_wifi.h"
 #include "mod_backend.h"
@@ -49,76 +59,141 @@
 #include "mod_th_meas.h"
 #include "mod_light.h"
 #include "mod_esp_now.h"
+#include "esp_now.h"
+#include "mod_sample_store.h"
 #include "i2cdev.h"
 #include "esp_mac.h"
+#include "mod_profiler.h"
+#include "main_app_sm.h"
+#ifdef CONFIG_APP_FLIGHT_REC
+#include "mod_flight_rec.h"
+#endif
+#if defined(CONFIG_APP_ESPNOW_PAYLOAD_CBOR) || defined(CONFIG_APP_STORE_FWD)
+#include "mod_codec.h"
+#endif
+#ifdef CONFIG_APP_STORE_FWD
+#include "mod_flash_queue.h"
+#endif
 
 
 /* Private constants ---------------------------------------------------------*/
 const char *TAG_APP = "MAIN_APP";
 
 
+/* Private define ------------------------------------------------------------*/
+#define MAIN_APP_EVENT_QUEUE_SIZE  10
+#define MAIN_APP_EVENT_QUEUE_RSVD   2           //!< Queue slots only the main task posts into. Its own transitions are never dropped
+#define SENSOR_TASK_STACK_SIZE     3072
+#define SENSOR_DATA_TIMEOUT_MS     3000         //!< Max. time MASH_Backend_Connected waits for the sensor task      
+#define BACKEND_ACK_TIMEOUT_MS     500          //!< Max. time MASH_Backend_Connected waits for all msgs to be acked
+#define MAS_SLEEP_WAKE_SETTLE_MS   200          //!< Time to wait for a Wi-Fi disconnect event after waking up in MASH_Sleep
+#define MAS_ERROR_LOG_INTERVAL_MS  180000
+#ifdef CONFIG_APP_ESPNOW_PAYLOAD_CBOR
+#define MAIN_APP_ESPNOW_HDR_SIZE   CODEC_REPORT_MAX_LEN                               //!< CBOR map of the report without samples
+#else
+#define MAIN_APP_ESPNOW_HDR_SIZE   (sizeof(TEMP_HUMID_VALUES_t) + 3 * sizeof(float))  //!< Temp/humidity, light, charge of the report and total charge
+#endif
+#define MAIN_APP_RTC_MAGIC         0x57415244   //!< Marks a valid MAIN_APP_RTC_t. Change if the struct changes
+#define MAIN_APP_DEADBAND_LUX_MIN  1.0f         //!< Min. light deadband in lux. The relative deadband is too small in the dark
+
+/*Store and batch: the radio is only started every CONFIG_APP_BATCH_SAMPLES wake cycles*/
+#if defined(CONFIG_APP_BATCH_SAMPLES) && CONFIG_APP_BATCH_SAMPLES > 1
+#define MAIN_APP_BATCH_MODE        1
+#define MAIN_APP_ESPNOW_DATA_SIZE  ESP_NOW_MAX_DATA_LEN   //!< Header followed by as many stored samples as fit
+#define MAIN_APP_ESPNOW_MAX_SAMPLES ((ESP_NOW_MAX_DATA_LEN - MAIN_APP_ESPNOW_HDR_SIZE) / sizeof(SAMPLE_RECORD_t))
+#else
+#define MAIN_APP_ESPNOW_DATA_SIZE  MAIN_APP_ESPNOW_HDR_SIZE
+#endif
+
+/*Store and forward with deep sleep: an error ends the wake cycle. The sample is kept in flash and sent in a later cycle*/
+#if defined(CONFIG_APP_STORE_FWD) && defined(CONFIG_APP_DEEP_SLEEP)
+#define MAIN_APP_STORE_FWD_RETRY   1
+#define BACKEND_CONNECT_TIMEOUT_MS 20000        //!< Max. time MASH_WiFi_Connected waits for the broker. Two esp-mqtt reconnects
+#endif
+
+/*Radio mode while connected. With modem power save the radio sleeps in between beacons while waiting for the network*/
+#if defined(CONFIG_APP_WIFI_POWER_SAVE_NONE) || defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+#define MAS_CONNECTED_PWR_MODE     PWR_MODE_WiFi_TxRx
+#else
+#define MAS_CONNECTED_PWR_MODE     PWR_MODE_Modem_Sleep
+#endif
+
+
 /* Private typedef -----------------------------------------------------------*/
-/// @brief Main App State machine states (MAS)
-typedef enum 
-{
-    MAS_Init_Sys          = 0,
-    MAS_Not_Connected     = 1,          //!< System is initialized but Wi-Fi is not connected. Try to connect to AP.
-    MAS_WiFi_Connected    = 2,          //!< Wi-Fi connected. IP addr received. Try to connect to backend.          
-    MAS_Backend_Connected = 3,          //!< Backend connected. Try to publish data.                                
-    MAS_Data_Published    = 4,          //!< All data has been sent to backend. Prepare for sleep                   
-    MAS_Sleep             = 5,          //!< Go to sleep depending configuration. Handle wake from auto light sleep.
-    MAS_Error             = 6           //!< We could not recover from a situation.                                 
-
-} MainApp_State;
-
-/// @brief Main App state machine events (MAE)
-typedef enum 
-{   
-    MAE_Sys_Init_Done,                  //!< System init after boot done               
-    MAE_Sys_Init_Failed,                //!< System init failed                        
-    MAE_Sensor_Read_Failed,             //!< Sensor data could not be read
-    MAE_WiFi_Failed,                    //!< WiFi connection could not be established      
-    MAE_WiFi_Connection_Established,    //!< Wi-Fi connected. IP addr received         
-    MAE_WiFi_Connection_Lost,           //!< Wi-Fi connection lost - not intended      
-    MAE_Backend_Failed,                 //!< Connection or reporting to backend failed 
-    MAE_Backend_Connection_Established, //!< Backend connection established            
-    MAE_Backend_Connection_Lost,        //!< Backend connection lost - not intended    
-    MAE_Data_Sent_To_Backend,           //!< All data has been sent to backend         
-    MAE_Enter_Sleep_Mode                //!< Enter the sleep state                     
-
-} MainApp_Event;
+/// @brief Event posted into the main app event queue
+typedef struct MAIN_APP_EVENT_t
+{
+    MainApp_Event Event;                //!< Event that occured                                      
+    int32_t s32_Data;                   //!< Optional event data. See MainApp_Event for details     
+
+}MAIN_APP_EVENT_t;
 
 typedef struct MAIN_APP_t
 {
-    MainApp_State CurrentState;         //!< Hold the current state machine state.                            
+    MainApp_State CurrentState;         //!< Hold the current state machine state. Only changed in main task context                            
+    QueueHandle_t EventQueue;           //!< MAIN_APP_EVENT_t queue. The main task blocks on it until something happens
+    TickType_t TimeoutTick;             //!< Absolute tick count when MAE_Timeout is generated    
+    bool b_TimeoutArmed;                //!< A timeout has been armed by the current state handler
+    TaskHandle_t MainTask_hdl;          //!< Main task. Posts into the reserved queue slots
+    uint32_t u32_EventsDropped;         //!< Events dropped by MainApp_PostEvent(..) because the queue was full
           
     bool b_WaitingForWiFiCon;           //!< Used in MASH_Not_Connected(..) to avoid multilpe connect atempts  
-    bool b_WaitingForBackendCon;        //!< Used in MASH_WiFi_Connected(..) to avoid multilpe connect atempts  
-    bool b_WaitingForDataToBeSent;      //!< USed in MASH_Backend_Connected(..) to avoid race conditions with event handler
-    bool b_WaitToGoToSleep;             //!< Used in MASH_Data_Published(..) to avoid multilpe shutdown atempts    
+    bool b_WaitingForDataToBeSent;      //!< Used in MASH_Backend_Connected(..). Data has been handed over to backend/ESP-NOW. Cleared by the first result (ack or timeout)
      
-    int BackendMsgIDs[3];               //!< Holds the backend msg ids to check if all 3 msgs hae been sent   
     uint32_t u32_SleepTimeSec;          //!< Sleep time in seconds to achieve required reporting intervals    
+    uint32_t u32_SleepLeftSec;          //!< MASH_Sleep: sleep time left once the armed sleep timeout expired
+    int64_t s64_SleepStart_us;          //!< MASH_Sleep: time the sleep started
+    bool b_Asleep;                      //!< MASH_Sleep: the sleep timeout is armed. Events are held until the wake up
+    bool b_LinkLostAsleep;              //!< MASH_Sleep: the last Wi-Fi event while asleep was a disconnect
        
-    TEMP_HUMID_VALUES_t TH_Values;      //!< Holds the temp and humidity sensor readings to send to backend   
-    float f_Light_Lux;                  //!< Holds the light sensor reading in lux which will be send to the backend   
+    TaskHandle_t SensorTask_hdl;        //!< Sensor acquisition task running in parallel to the Wi-Fi/backend connect
+    esp_err_t SensorStatus;             //!< ESP_ERR_NOT_FINISHED while sampling, ESP_OK if TH_Values and f_Light_Lux are valid
+
+    TEMP_HUMID_VALUES_t TH_Values;      //!< Holds the temp and humidity sensor readings to send to backend. Written by sensor task only  
+    float f_Light_Lux;                  //!< Holds the light sensor reading in lux which will be send to the backend. Written by sensor task only   
+    PWR_ENERGY_REPORT_t EnergyReport;   //!< Estimated charge since the last report. Sent together with the sensor data
+    uint32_t u32_SamplesSent;           //!< Stored samples handed over to the backend/ESP-NOW. Removed from the store once acked
+
+    bool b_SampleQueued;                //!< The sample of this wake cycle is in the sample store (batch mode) or in the flash queue
+    bool b_ReportAcked;                 //!< The report of this wake cycle has been acked. Samples of the flash queue are only sent then
+    bool b_Draining;                    //!< MASH_Data_Published is sending samples of the flash queue
+    uint32_t u32_StoredSent;            //!< Samples of the flash queue in flight. Marked as sent once acked
+    uint32_t u32_DrainMsgs;             //!< Messages with samples of the flash queue in this wake cycle
     
 }MAIN_APP_t;
 
 
-typedef void (*fp_StateHandler)(MAIN_APP_t * obj);
+/// @brief Init state of the last cold boot kept in RTC memory. Restored by the fast wake path after deep sleep.
+typedef struct MAIN_APP_RTC_t
+{
+    uint32_t u32_Magic;                 //!< MAIN_APP_RTC_MAGIC once the cold boot init completed
+    uint32_t u32_FastWakes;             //!< Number of fast wakes since the last cold boot
+    uint8_t  au8_PeerMac[6];            //!< CONFIG_APP_ESPNOW_PEER_MAC parsed on cold boot
+    bool     b_Reported;                //!< The values below hold the last acked report
+    uint32_t u32_LastReport_s;          //!< System time of the last acked report
+    float    f_LastTemp_C;              //!< Temperature of the last acked report
+    float    f_LastHumi_PCT;            //!< Humidity of the last acked report
+    float    f_LastLux;                 //!< Illuminance of the last acked report
+    uint32_t u32_Crc;                   //!< CRC32 of all members above
+
+}MAIN_APP_RTC_t;
+
+
+/// @brief State handler. Called with pEvent = NULL on state entry and with every event that did not cause a transition
+typedef void (*fp_StateHandler)(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
 
 /*Main App state handler - MASH*/
-static void MASH_Init_Sys(MAIN_APP_t * obj);
-static void MASH_Not_Connected(MAIN_APP_t * obj);
-static void MASH_WiFi_Connected(MAIN_APP_t * obj);
-static void MASH_Backend_Connected(MAIN_APP_t * obj);
-static void MASH_Data_Published(MAIN_APP_t * obj);
-static void MASH_Sleep(MAIN_APP_t * obj);
-static void MASH_Error(MAIN_APP_t * obj);
+static void MASH_Init_Sys(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MASH_Not_Connected(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MASH_WiFi_Connected(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MASH_Backend_Connected(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MASH_Data_Published(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MASH_Sleep(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MASH_Error(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MASH_Store_Sample(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
 
 /// @note Handler position in array must correspond to state value defined in MainApp_State enum
-static fp_StateHandler MA_StateHandler[] = 
+static fp_StateHandler MA_StateHandler[MAS_Num_States] = 
 {
     &MASH_Init_Sys,
     &MASH_Not_Connected,
@@ -126,35 +201,124 @@ static fp_StateHandler MA_StateHandler[] =
     &MASH_Backend_Connected,
     &MASH_Data_Published,
     &MASH_Sleep,
-    &MASH_Error   
+    &MASH_Error,
+    &MASH_Store_Sample
 };
 
+/// @brief Profiled phase of each state. PROF_Num_Phases if the state is not profiled.
+/// @note  Position in array must correspond to state value defined in MainApp_State enum
+static const PROF_PHASE_t MA_StatePhase[MAS_Num_States] =
+{
+    PROF_Init_Sys,
+    PROF_WiFi_Connect,
+    PROF_Backend_Connect,
+    PROF_Publish,
+    PROF_Sleep_Entry,
+    PROF_Num_Phases,
+    PROF_Num_Phases,
+    PROF_Num_Phases
+};
+
+/// @brief Power mode of each state for the energy accountant. PWR_Num_Modes if the mode is set by mod_pwr (sleep).
+/// @note  Position in array must correspond to state value defined in MainApp_State enum
+static const PWR_MODE_t MA_StatePwrMode[MAS_Num_States] =
+{
+    PWR_MODE_CPU_Active,
+    PWR_MODE_WiFi_TxRx,
+    MAS_CONNECTED_PWR_MODE,
+    MAS_CONNECTED_PWR_MODE,
+    MAS_CONNECTED_PWR_MODE,
+    PWR_Num_Modes,
+    MAS_CONNECTED_PWR_MODE,
+    PWR_MODE_CPU_Active
+};
+
+_Static_assert(MAS_Num_States <= PWR_ENERGY_NUM_STATES, "Energy accountant cannot hold all MainApp states");
+
 /* Private variables ---------------------------------------------------------*/
 MAIN_APP_t MainApp_obj;
 
+RTC_DATA_ATTR static MAIN_APP_RTC_t MainApp_Rtc;
+
+#if defined(CONFIG_APP_PROF_OUTPUT_MQTT) && !defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) && !defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+static char s_ProfBatch[CONFIG_APP_PROF_BATCH_SIZE * PROF_RECORD_STR_MAX_LEN];
+#endif
+
+#if defined(MAIN_APP_BATCH_MODE) && defined(CONFIG_APP_DEEP_SLEEP)
+static char s_Samples[CONFIG_APP_BATCH_BUFFER_SIZE * SAMPLE_STR_MAX_LEN];
+#endif
+
+#ifdef CONFIG_APP_STORE_FWD
+static uint8_t s_Stored[2 + CONFIG_APP_STORE_FWD_BATCH * FQ_RECORD_MAX_LEN];     //!< CBOR array of flash queue records
+#endif
+
+#if defined(CONFIG_APP_FLIGHT_REC) && !defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) && !defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+static uint8_t s_FlightRec[FREC_EXPORT_HDR_SIZE + CONFIG_APP_FLIGHT_REC_SIZE * sizeof(FREC_RECORD_t)];
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
-static void Backend_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
-static void PWR_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
-static void WiFi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
-static void ESPNOW_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+/*Event handlers are not static. They are referenced by APP_EVENT_ROUTES in app_events.h*/
+void Backend_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+void PWR_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+void WiFi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+void ESPNOW_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+
+static void MainApp_PostEvent(MAIN_APP_t * obj, MainApp_Event event, int32_t s32_Data);
+static void MainApp_ProcessEvent(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void MainApp_ArmTimeout(MAIN_APP_t * obj, uint32_t u32_Timeout_ms);
+static TickType_t MainApp_TicksToTimeout(MAIN_APP_t * obj);
+static void MainApp_SleepArm(MAIN_APP_t * obj);
+static void MainApp_SleepWakeUp(MAIN_APP_t * obj);
+
+static bool MainApp_RtcRestore(void);
+static void MainApp_RtcSave(void);
+static esp_err_t MainApp_ColdBootInit(void);
+static esp_err_t MainApp_RadioInit(void);
+static bool MainApp_ReportDue(MAIN_APP_t * obj);
+static void MainApp_ReportDone(MAIN_APP_t * obj);
 
 static void Print_Reset_Reason(esp_reset_reason_t reason);
-static MainApp_State MAS_Handle_Transition(MainApp_State currentState, MainApp_Event event);
 static esp_err_t GetSensorMeasurements(TEMP_HUMID_VALUES_t *p_TH_Values, float *pf_Lux);
+static void SensorTask(void *pvParameters);
+static void SensorTask_Trigger(MAIN_APP_t * obj);
+static void Backend_PublishSample(MAIN_APP_t * obj);
+static void Backend_SamplesAcked(MAIN_APP_t * obj);
 static esp_err_t Backend_PublishData(MAIN_APP_t * obj);
-static void GoToSleep(uint32_t u32_SleepTimeSec);
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+static void EspNow_AddData(MAIN_APP_t * obj);
+#endif
+static void StoreFwd_Store(MAIN_APP_t * obj);
+static bool StoreFwd_Drain(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent);
+static void Profiler_EmitBatch(void);
+static void FlightRec_Flush(void);
 
 
 /* Exported functions --------------------------------------------------------*/
 void app_main(void)
 {    
-    fp_StateHandler CurrentHandler = NULL;
+    MAIN_APP_EVENT_t Event;
+
+    mod_prof_CycleStart(true);
+
+    MainApp_obj.EventQueue = xQueueCreate(MAIN_APP_EVENT_QUEUE_SIZE, sizeof(MAIN_APP_EVENT_t));
+    ESP_ERROR_CHECK(MainApp_obj.EventQueue == NULL ? ESP_ERR_NO_MEM : ESP_OK);
+    MainApp_obj.MainTask_hdl = xTaskGetCurrentTaskHandle();
+
     MainApp_obj.CurrentState = MAS_Init_Sys;
+    mod_prof_PhaseBegin(MA_StatePhase[MainApp_obj.CurrentState]);
+    MA_StateHandler[MainApp_obj.CurrentState](&MainApp_obj, NULL);
 
     while(1)     
     {
-        CurrentHandler = MA_StateHandler[MainApp_obj.CurrentState];
-        CurrentHandler(&MainApp_obj);
+        /*Block until an event has been posted or the timeout of the current state expired*/
+        if( xQueueReceive(MainApp_obj.EventQueue, &Event, MainApp_TicksToTimeout(&MainApp_obj)) != pdTRUE )
+        {
+            MainApp_obj.b_TimeoutArmed = false;
+            Event.Event    = MAE_Timeout;
+            Event.s32_Data = 0;
+        }
+
+        MainApp_ProcessEvent(&MainApp_obj, &Event);
     }
 }
 
@@ -164,43 +328,34 @@ void app_main(void)
 /* Event Handler -------------------------------------------------------------*/
 
 /// @brief              Handles all backend events such as connected, disconnected, failures, etc.
-/// @param handler_args MainApp_obj
+/// @param handler_args Not used
 /// @param base         Event base: check app_events.h for more details
 /// @param s32_EventID  Event ID:   check app_events.h for more details
 /// @param event_data   Event data provided for event. Depends on event type.
 /// @note               The s32_EventID can be the same for different event bases. If the event handler has to handle different event bases
 /// @note               the "esp_event_base_t base" must be checked as well. Better solution is to have one handler per event base!
-static void Backend_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+void Backend_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
 {    
-    MAIN_APP_t *obj = (MAIN_APP_t*)(handler_args);
+    MAIN_APP_t *obj = &MainApp_obj;     /*No handler args with static routing*/
 
     ESP_LOGI(TAG_APP, "%s", app_backend_event_to_str(s32_EventID));
 
     switch(s32_EventID)
     {
         case BACKEND_CONNECTED_EVENT:            
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Backend_Connection_Established);
+            MainApp_PostEvent(obj, MAE_Backend_Connection_Established, 0);
         break;
 
         case BACKEND_DISCONNECTED_EVENT:            
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Backend_Connection_Lost);
+            MainApp_PostEvent(obj, MAE_Backend_Connection_Lost, 0);
         break;
 
         case BACKEND_CONNECT_FAILED_EVENT:            
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Backend_Failed);
+            MainApp_PostEvent(obj, MAE_Backend_Failed, 0);
         break;
 
-        case BACKEND_SEND_MESSAGE_DONE:
-        {
-            int* ps32_MsgID = (int*)(event_data);        
-
-            if(*ps32_MsgID == obj->BackendMsgIDs[0])
-                obj->BackendMsgIDs[0] = 0;
-            if(*ps32_MsgID == obj->BackendMsgIDs[1])
-                obj->BackendMsgIDs[1] = 0;
-            if(*ps32_MsgID == obj->BackendMsgIDs[2])
-                obj->BackendMsgIDs[2] = 0;          
-        }
+        case BACKEND_ALL_MSGS_ACKED:
+            MainApp_PostEvent(obj, MAE_Data_Sent_To_Backend, 1);
         break;
 
         default:
@@ -210,58 +365,48 @@ static void Backend_events_handler(void* handler_args, esp_event_base_t base, in
 
 
 /// @brief              Handles all power events. For now only the go_to_sleep event
-/// @param handler_args MainApp_obj 
+/// @param handler_args Not used
 /// @param base         Event base: check app_events.h for more details
 /// @param s32_EventID  Event ID:   check app_events.h for more details
 /// @param event_data   Event data provided for event. Depends on event type.
-static void PWR_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+void PWR_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
 {
-    MAIN_APP_t *obj = (MAIN_APP_t*)(handler_args);
+    MAIN_APP_t *obj = &MainApp_obj;     /*No handler args with static routing*/
 
     ESP_LOGI(TAG_APP, "%s", app_power_event_to_str(s32_EventID));
 
     if(s32_EventID == PWR_GO_TO_SLEEP)
     {
-        obj->u32_SleepTimeSec = *(uint32_t*)(event_data);
-        ESP_LOGI(TAG_APP,"Sleep time:%lu", obj->u32_SleepTimeSec);
+        ESP_LOGI(TAG_APP,"Sleep time:%lu", *(uint32_t*)(event_data));
         
-        obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Enter_Sleep_Mode);
+        MainApp_PostEvent(obj, MAE_Enter_Sleep_Mode, (int32_t)(*(uint32_t*)(event_data)));
     }
 }
 
 
 /// @brief              Handles all WiFi Events.
-/// @param handler_args MainApp_obj 
+/// @param handler_args Not used
 /// @param base         Event base: check app_events.h for more details
 /// @param s32_EventID  Event ID:   check app_events.h for more details
 /// @param event_data   Event data provided for event. Depends on event type.
-static void WiFi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+void WiFi_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
 {
-    MAIN_APP_t *obj = (MAIN_APP_t*)(handler_args);
+    MAIN_APP_t *obj = &MainApp_obj;     /*No handler args with static routing*/
 
     ESP_LOGI(TAG_APP, "%s", app_wifi_event_to_str(s32_EventID));
 
     switch(s32_EventID)
     {
         case WIFI_CONNECTED_EVENT:
-        {
-            //ESP_LOGI(TAG_APP, "Wi-Fi connected %s:%ld", base, s32_EventID);                        
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_WiFi_Connection_Established);            
-        }
+            MainApp_PostEvent(obj, MAE_WiFi_Connection_Established, 0);
         break;
 
         case WIFI_DISCONNECTED_EVENT:
-        {            
-            //ESP_LOGI(TAG_APP, "Wi-Fi disconnected %s:%ld", base, s32_EventID);            
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_WiFi_Connection_Lost);
-        }
+            MainApp_PostEvent(obj, MAE_WiFi_Connection_Lost, 0);
         break;
 
         case WIFI_CONNECT_FAILED_EVENT:
-        {            
-            //ESP_LOGI(TAG_APP, "Wi-Fi failed to connect %s:%ld", base, s32_EventID);                        
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_WiFi_Failed);      
-        }
+            MainApp_PostEvent(obj, MAE_WiFi_Failed, 0);
         break;
 
         default: //Dont do anything.
@@ -270,13 +415,13 @@ static void WiFi_events_handler(void* handler_args, esp_event_base_t base, int32
 
 
 /// @brief              Handles all ESPNOW Events.
-/// @param handler_args MainApp_obj 
+/// @param handler_args Not used
 /// @param base         Event base: check app_events.h for more details
 /// @param s32_EventID  Event ID:   check app_events.h for more details
 /// @param event_data   Event data provided for event. Depends on event type.
-static void ESPNOW_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+void ESPNOW_events_handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
 {
-    MAIN_APP_t *obj = (MAIN_APP_t*)(handler_args);
+    MAIN_APP_t *obj = &MainApp_obj;     /*No handler args with static routing*/
 
    //ESP_LOGI(TAG_APP, "%s", app_espnow_event_to_str(s32_EventID));
 
@@ -284,10 +429,8 @@ static void ESPNOW_events_handler(void* handler_args, esp_event_base_t base, int
     {
         case ESPNOW_DATA_SENT:           
         case ESPNOW_DATA_SENT_FAILED: /*If we could sent the data we just continue*/
-        {
-            obj->b_WaitingForDataToBeSent = false;            
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Data_Sent_To_Backend);     
-        }
+            MainApp_PostEvent(obj, MAE_Data_Sent_To_Backend, (s32_EventID == ESPNOW_DATA_SENT) ? 1 : 0);
+        break;
         
         default: //Dont do anything.
     }
@@ -296,389 +439,742 @@ static void ESPNOW_events_handler(void* handler_args, esp_event_base_t base, int
 
 /* MainAPP State (MAS) machine logic and state handler -----------------------*/
 
-/// @brief              Main app state machine. Depending on the current state and event occurrence the 
-/// @brief              logic switches to a new state or remains in the current state. 
-/// @brief              Check the state machine diagram for more details
-/// @param currentState The actual state we are in
-/// @param event        Event that occured
-/// @return             Returns the new state. If no action required it will return the current state
-static MainApp_State MAS_Handle_Transition(MainApp_State currentState, MainApp_Event event) 
-{    
-    switch (currentState) 
+/// @brief          Post an event into the main app event queue. Can be called from any task.
+/// @param obj      MainApp object
+/// @param event    Event to post
+/// @param s32_Data Optional event data. See MainApp_Event for details
+/// @note           The state is only changed by the main task. Other tasks must use this function.
+/// @note           Never blocks. The event dispatcher must not stall behind the main task and the main task
+///                 would wait for itself. Other tasks leave MAIN_APP_EVENT_QUEUE_RSVD slots for the main task.
+static void MainApp_PostEvent(MAIN_APP_t * obj, MainApp_Event event, int32_t s32_Data)
+{
+    MAIN_APP_EVENT_t Event = { .Event = event, .s32_Data = s32_Data };
+    bool b_MainTask = (xTaskGetCurrentTaskHandle() == obj->MainTask_hdl);
+
+    if( (b_MainTask == true || uxQueueSpacesAvailable(obj->EventQueue) > MAIN_APP_EVENT_QUEUE_RSVD) &&
+        xQueueSend(obj->EventQueue, &Event, 0) == pdTRUE )
+        return;
+
+    //Not atomic. Good enough for a diagnostic counter, the state timeouts recover from the lost event.
+    obj->u32_EventsDropped++;
+    ESP_LOGE(TAG_APP, "Event %s dropped, queue full. %lu dropped", MAS_Event_to_str(event), obj->u32_EventsDropped);
+}
+
+
+/// @brief        Runs the transition for an event. On a state change the new state handler is called for the
+///               state entry, otherwise the event is passed to the current state handler.
+/// @param obj    MainApp object
+/// @param pEvent Event taken from the main app event queue
+/// @note         Must be called from the main task only.
+static void MainApp_ProcessEvent(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
+{
+    MainApp_State NextState;
+
+    /*Event data which is needed regardless of the current state*/
+    switch(pEvent->Event)
     {
-        case MAS_Init_Sys:
-        {
-            if( event == MAE_Sys_Init_Done )
-                return MAS_Not_Connected; 
+        case MAE_Enter_Sleep_Mode:
+            obj->u32_SleepTimeSec = (uint32_t)(pEvent->s32_Data);
+        break;
 
-            if( event == MAE_Sys_Init_Failed )
-                return MAS_Error; 
-        }
+        case MAE_Sensor_Data_Ready:
+            obj->SensorStatus = ESP_OK;
         break;
 
-        case MAS_Not_Connected:
-        {
-            if( event == MAE_WiFi_Connection_Established )
+        case MAE_Sensor_Read_Failed:
+            obj->SensorStatus = ESP_FAIL;
+        break;
+
+        case MAE_Data_Sent_To_Backend:
+            if(obj->b_Draining == true)
+                break;                  /*Ack of flash queue samples. See StoreFwd_Drain(..)*/
+
+            /*Only the first result of the report counts. An ack after the ack timeout stored the sample
+              would upload it twice, a timeout after the ack would store an acked sample.*/
+            if(obj->CurrentState != MAS_Backend_Connected || obj->b_WaitingForDataToBeSent == false)
             {
-#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
-                return MAS_Backend_Connected; //ESP-NOW does not connect to a backend as such. Dirty workaround
-#endif
-                return MAS_WiFi_Connected; 
-            }   
+                ESP_LOGW(TAG_APP, "Late %s of the report ignored", (pEvent->s32_Data == 1) ? "ack" : "timeout");
+                return;
+            }
 
-            if( event == MAE_WiFi_Failed )
-                return MAS_Error;    
+            obj->b_WaitingForDataToBeSent = false;
+            obj->b_ReportAcked            = (pEvent->s32_Data == 1);
 
-            if( event == MAE_Sensor_Read_Failed)
-                return MAS_Error;    
-        }
+            if(pEvent->s32_Data == 1)
+            {
+                Backend_SamplesAcked(obj);
+                MainApp_ReportDone(obj);
+            }
+            else
+                StoreFwd_Store(obj);    /*Might get lost with the connection*/
         break;
 
-        case MAS_WiFi_Connected:
-        {
-            if( event == MAE_Backend_Connection_Established )
-                return MAS_Backend_Connected;
+        default:
+        break;
+    }
 
-            if( event == MAE_WiFi_Connection_Lost )
-                return MAS_Not_Connected;         
+    /*MASH_Sleep(..) holds the events until the wake up*/
+    if(obj->CurrentState == MAS_Sleep && obj->b_Asleep == true)
+    {
+        MA_StateHandler[obj->CurrentState](obj, pEvent);
+        return;
+    }
 
-            if( event == MAE_Backend_Failed )
-                return MAS_Error;
-        }
-        break;
+    NextState = MAS_Handle_Transition(obj->CurrentState, pEvent->Event);
 
-        case MAS_Backend_Connected:
-        {            
-            if( event == MAE_Data_Sent_To_Backend ) 
-                return MAS_Data_Published;
-            
-            if( event == MAE_Backend_Connection_Lost )
-                return MAS_WiFi_Connected;
-            
-            if( event == MAE_WiFi_Connection_Lost ) 
-                return MAS_Not_Connected;   
-            
-            if( event == MAE_Backend_Failed || event == MAE_Sensor_Read_Failed)
-                return MAS_Error;
-        }
-        break;
+    if(NextState != obj->CurrentState)
+    {
+        ESP_LOGD(TAG_APP, "%s --%s--> %s", MAS_State_to_str(obj->CurrentState), MAS_Event_to_str(pEvent->Event), MAS_State_to_str(NextState));
+        
+#ifdef CONFIG_APP_FLIGHT_REC
+        mod_frec_State((uint8_t)(obj->CurrentState), (uint8_t)(NextState), (int32_t)(pEvent->Event));
 
-        case MAS_Data_Published:
-        {
-            if(event == MAE_Enter_Sleep_Mode )
-                return MAS_Sleep;                      
-        }
-        break;
+        if(NextState == MAS_Error)
+            FREC_ERROR(FREC_SRC_MAIN, pEvent->Event);
+#endif
 
-        case MAS_Sleep:
-        {
-            if(event == MAE_WiFi_Connection_Established)
-            {
-#ifdef CONFIG_APP_LIGHT_SLEEP_ESP_NOW                
-                return MAS_Backend_Connected;
+        mod_prof_PhaseEnd(MA_StatePhase[obj->CurrentState]);
+        mod_prof_PhaseBegin(MA_StatePhase[NextState]);
+        mod_pwr_energy_SetState((uint8_t)(NextState));
+        mod_pwr_energy_SetMode(MA_StatePwrMode[NextState]);
+
+        obj->CurrentState   = NextState;
+        obj->b_TimeoutArmed = false;
+        MA_StateHandler[obj->CurrentState](obj, NULL);
+    }
+    else
+        MA_StateHandler[obj->CurrentState](obj, pEvent);
+}
+
+
+/// @brief                Arm a timeout for the current state. MAE_Timeout will be passed to the state handler
+///                       if no transition happens within u32_Timeout_ms. A state change disarms the timeout.
+/// @param obj            MainApp object
+/// @param u32_Timeout_ms Timeout in ms
+static void MainApp_ArmTimeout(MAIN_APP_t * obj, uint32_t u32_Timeout_ms)
+{
+    obj->TimeoutTick    = xTaskGetTickCount() + pdMS_TO_TICKS(u32_Timeout_ms);
+    obj->b_TimeoutArmed = true;
+}
+
+
+/// @brief     Ticks left until the armed timeout expires
+/// @param obj MainApp object
+/// @return    portMAX_DELAY if no timeout is armed
+static TickType_t MainApp_TicksToTimeout(MAIN_APP_t * obj)
+{
+    TickType_t Now = xTaskGetTickCount();
+
+    if(obj->b_TimeoutArmed == false)
+        return portMAX_DELAY;
+
+    /*Handles tick counter overflow as long as the timeout is shorter than half the tick range*/
+    if((int32_t)(obj->TimeoutTick - Now) <= 0)
+        return 0;
+
+    return obj->TimeoutTick - Now;
+}
+
+
+/// @brief     Arms the sleep timeout of MASH_Sleep for the sleep time left
+/// @param obj MainApp object
+/// @note      Blocking the main task on the event queue puts the device into Auto-Light-Sleep mode
+static void MainApp_SleepArm(MAIN_APP_t * obj)
+{
+    uint32_t u32_Sec = obj->u32_SleepLeftSec;
+
+#if defined(CONFIG_APP_ITWT_ENABLE) && defined (CONFIG_APP_ITWT_ASUS_BUG_WORKAROUND)
+    //ToDo: Different sleep modes to be implemented   
+    //The Asus AP always deauthenticates after 5min and 30sec regardless of accepting the TWT request
+    //Sleep times more than 5min dont work. we need to wake up and make a TWT probe after 5min latest
+    if(u32_Sec > CONFIG_APP_ITWT_ASUS_BUG_INTERVAL)
+        u32_Sec = CONFIG_APP_ITWT_ASUS_BUG_INTERVAL;
 #endif
-                return MAS_WiFi_Connected;
-            }
 
-            if( event == MAE_WiFi_Connection_Lost )
-                return MAS_Not_Connected; 
-        }
-        break;
+    obj->u32_SleepLeftSec -= u32_Sec;
+    MainApp_ArmTimeout(obj, u32_Sec * 1000);
+}
 
-        case MAS_Error:          
-        default:        
-        //ToDo: Implement error handling
+
+/// @brief     Back from sleeping. Stops power saving and takes the next sample.
+/// @param obj MainApp object
+/// @note      A Wi-Fi disconnect while asleep is posted again. Otherwise the disconnect event is expected
+///            within MAS_SLEEP_WAKE_SETTLE_MS.
+static void MainApp_SleepWakeUp(MAIN_APP_t * obj)
+{
+    obj->b_Asleep = false;
+
+    ESP_LOGI(TAG_APP,"MainApp awake again after %d sec.", (int) ((esp_timer_get_time( ) - obj->s64_SleepStart_us) / 1000000));
+    mod_prof_CycleStart(false);
+    mod_pwr_save_stop( );    
+
+    //Take the next sample while we check the connection state and reconnect to the backend
+    SensorTask_Trigger(obj);
+
+    if(obj->b_LinkLostAsleep == true)
+    {
+        MainApp_PostEvent(obj, MAE_WiFi_Connection_Lost, 0);
+        return;
+    }
+
+    //If we've lost the WiFi connection the disconnect event is expected within the settle time.
+    //Otherwise we would jump to the connected state and start the backend connection which then fails.
+    MainApp_ArmTimeout(obj, MAS_SLEEP_WAKE_SETTLE_MS);
+}
+
+
+/// @brief  Checks if this boot can take the fast wake path
+/// @return true after a timer wake up from deep sleep with a valid MainApp_Rtc
+/// @note   Always false if CONFIG_APP_FAST_WAKE is not set
+static bool MainApp_RtcRestore(void)
+{
+#ifdef CONFIG_APP_FAST_WAKE
+    if( esp_reset_reason( ) != ESP_RST_DEEPSLEEP || esp_sleep_get_wakeup_cause( ) != ESP_SLEEP_WAKEUP_TIMER )
+        return false;
+
+    if( MainApp_Rtc.u32_Magic != MAIN_APP_RTC_MAGIC )
+        return false;
+
+    return MainApp_Rtc.u32_Crc == esp_rom_crc32_le(0, (const uint8_t*)(&MainApp_Rtc), offsetof(MAIN_APP_RTC_t, u32_Crc));
+#else
+    return false;
+#endif
+}
+
+
+/// @brief Marks MainApp_Rtc as valid and updates the CRC. Call after every change of MainApp_Rtc.
+static void MainApp_RtcSave(void)
+{
+    MainApp_Rtc.u32_Magic = MAIN_APP_RTC_MAGIC;
+    MainApp_Rtc.u32_Crc   = esp_rom_crc32_le(0, (const uint8_t*)(&MainApp_Rtc), offsetof(MAIN_APP_RTC_t, u32_Crc));
+}
+
+
+/// @brief  Init steps only needed once after power on or a reset. Fills MainApp_Rtc.
+/// @return ESP_OK on success, ESP_FAIL if CONFIG_APP_ESPNOW_PEER_MAC is not a valid MAC address
+/// @note   MainApp_Rtc is not valid until MainApp_RtcSave(..) is called
+static esp_err_t MainApp_ColdBootInit(void)
+{
+    uint8_t u8_Mac[6];
+
+    memset(&MainApp_Rtc, 0, sizeof(MainApp_Rtc));
+
+    Print_Reset_Reason(esp_reset_reason());
+
+    ESP_ERROR_CHECK(esp_read_mac(u8_Mac, ESP_MAC_BASE));
+    ESP_LOGI(TAG_APP, "MAC Addr: %02X:%02X:%02X:%02X:%02X:%02X", u8_Mac[0], u8_Mac[1], u8_Mac[2], u8_Mac[3], u8_Mac[4], u8_Mac[5]);
+
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    uint8_t *pu8_Peer = MainApp_Rtc.au8_PeerMac;
+
+    if( sscanf( CONFIG_APP_ESPNOW_PEER_MAC, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &pu8_Peer[0], &pu8_Peer[1], &pu8_Peer[2], &pu8_Peer[3], &pu8_Peer[4], &pu8_Peer[5] ) != 6 )
+    {
+        ESP_LOGE(TAG_APP, "Invalid ESP-NOW peer MAC: %s", CONFIG_APP_ESPNOW_PEER_MAC);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG_APP, "Peer MAC Addr: %02X:%02X:%02X:%02X:%02X:%02X", pu8_Peer[0], pu8_Peer[1], pu8_Peer[2], pu8_Peer[3], pu8_Peer[4], pu8_Peer[5]);
+#endif
+
+    return ESP_OK;
+}
+
+
+/// @brief  Init steps only needed if the radio is used in this wake cycle
+/// @return ESP_OK on success
+static esp_err_t MainApp_RadioInit(void)
+{
+    esp_err_t ret = nvs_flash_init();    
+
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) 
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    return mod_espnow_init( MAIN_APP_ESPNOW_DATA_SIZE, MainApp_Rtc.au8_PeerMac );
+#else
+    return Backend_Init( );
+#endif
+}
+
+
+/// @brief     Report on change. Compares the sample of this wake cycle against the last acked report.
+/// @param obj MainApp object holding a valid sample
+/// @return    true if a value moved beyond its deadband or the heartbeat interval expired. Always false without CONFIG_APP_REPORT_ON_CHANGE.
+static bool MainApp_ReportDue(MAIN_APP_t * obj)
+{
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+    struct timeval Now;
+    float f_LuxDeadband = fmaxf(MainApp_Rtc.f_LastLux * CONFIG_APP_DEADBAND_LUX_PCT / 100.0f, MAIN_APP_DEADBAND_LUX_MIN);
+
+    if(MainApp_Rtc.b_Reported == false)
+        return true;
+
+    //Half a reporting interval early. The wake ups do not hit the heartbeat exactly.
+    gettimeofday(&Now, NULL);
+    if( (uint32_t)(Now.tv_sec) - MainApp_Rtc.u32_LastReport_s + CONFIG_APP_REPORTING_INTERVAL_SEC / 2 >= CONFIG_APP_REPORT_HEARTBEAT_SEC )
+    {
+        ESP_LOGI(TAG_APP, "Heartbeat report");
+        return true;
+    }
+
+    if( fabsf(obj->TH_Values.f_Temp_C   - MainApp_Rtc.f_LastTemp_C)   >= CONFIG_APP_DEADBAND_TEMP_DECI_C   / 10.0f ||
+        fabsf(obj->TH_Values.f_Humi_PCT - MainApp_Rtc.f_LastHumi_PCT) >= CONFIG_APP_DEADBAND_HUMI_DECI_PCT / 10.0f ||
+        fabsf(obj->f_Light_Lux          - MainApp_Rtc.f_LastLux)      >= f_LuxDeadband )
+    {
+        ESP_LOGI(TAG_APP, "Sample changed: %.2fC %.2f%% %.1flux", obj->TH_Values.f_Temp_C, obj->TH_Values.f_Humi_PCT, obj->f_Light_Lux);
+        return true;
     }
+#endif
 
-    // If no transition occurs, stay in the current state
-    return currentState;
+    return false;
 }
 
 
-/// @brief     Call this function after boot before calling any other function to ensure the system is initialized.
+/// @brief     Remembers the sample of this wake cycle as the last acked report in RTC memory
 /// @param obj MainApp object
-static void MASH_Init_Sys(MAIN_APP_t * obj)
+/// @note      Only used with CONFIG_APP_REPORT_ON_CHANGE
+static void MainApp_ReportDone(MAIN_APP_t * obj)
+{
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+    struct timeval Now;
+
+    gettimeofday(&Now, NULL);
+
+    MainApp_Rtc.b_Reported       = true;
+    MainApp_Rtc.u32_LastReport_s = (uint32_t)(Now.tv_sec);
+    MainApp_Rtc.f_LastTemp_C     = obj->TH_Values.f_Temp_C;
+    MainApp_Rtc.f_LastHumi_PCT   = obj->TH_Values.f_Humi_PCT;
+    MainApp_Rtc.f_LastLux        = obj->f_Light_Lux;
+    MainApp_RtcSave( );
+#endif
+}
+
+
+/// @brief        Call this function after boot before calling any other function to ensure the system is initialized.
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+/// @note         After a deep sleep timer wake up the cold boot steps are skipped. See MainApp_RtcRestore(..)
+static void MASH_Init_Sys(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
 {
     esp_err_t ret = ESP_OK;
+    bool b_Upload = true;
+
+    if(pEvent != NULL)
+        return;
 
     ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Init_Sys");
     
     obj->b_WaitingForWiFiCon      = false;  
-    obj->b_WaitingForBackendCon   = false;    
     obj->b_WaitingForDataToBeSent = false;
-    obj->b_WaitToGoToSleep        = false;    
+    obj->b_TimeoutArmed           = false;
     obj->u32_SleepTimeSec         = 0;
-    obj->BackendMsgIDs[0]         = -1;
-    obj->BackendMsgIDs[1]         = -1;
-    obj->BackendMsgIDs[2]         = -1;
+    obj->b_Asleep                 = false;
     obj->TH_Values.f_Humi_PCT     = 0.0;
     obj->TH_Values.f_Temp_C       = 0.0;
     obj->f_Light_Lux              = 0.0;
-    obj->CurrentState             = MAS_Init_Sys;
+    obj->SensorStatus             = ESP_ERR_NOT_FINISHED;
+    obj->u32_SamplesSent          = 0;
+    obj->b_SampleQueued           = false;
+    obj->b_ReportAcked            = false;
+    obj->b_Draining               = false;
+    obj->u32_StoredSent           = 0;
+    obj->u32_DrainMsgs            = 0;
+
+#ifdef CONFIG_APP_FLIGHT_REC
+    //First record of this boot. Panic, watchdog and brownout resets trigger a flush in the next connected cycle.
+    esp_reset_reason_t Reason = esp_reset_reason( );
+
+    mod_frec_Boot((uint32_t)(Reason), (Reason == ESP_RST_PANIC) || (Reason == ESP_RST_INT_WDT) || (Reason == ESP_RST_TASK_WDT) ||
+                                      (Reason == ESP_RST_WDT)   || (Reason == ESP_RST_BROWNOUT));
+#endif
 
-    Print_Reset_Reason(esp_reset_reason());
-    
-    ret = nvs_flash_init();    
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) 
+    //After a timer wake up from deep sleep the state of the cold boot is taken from RTC memory.
+    //Everything else is gone with the RAM and is initialized again.
+    if( MainApp_RtcRestore( ) == true )
     {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+        MainApp_Rtc.u32_FastWakes++;
+        ESP_LOGI(TAG_APP, "Fast wake %lu", MainApp_Rtc.u32_FastWakes);
     }
-    
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    else if( MainApp_ColdBootInit( ) != ESP_OK )
+    {
+        MainApp_PostEvent(obj, MAE_Sys_Init_Failed, 0);
+        return;
+    }
+
+#if defined(MAIN_APP_BATCH_MODE) || defined(CONFIG_APP_REPORT_ON_CHANGE)
+    //Upload right away after a cold boot. Otherwise only if the sample of this cycle completes a batch
+    //or, with report on change, once the sample is available. See MASH_Store_Sample(..)
+    b_Upload = (esp_reset_reason( ) != ESP_RST_DEEPSLEEP);
+#ifdef MAIN_APP_BATCH_MODE
+    b_Upload = b_Upload || mod_samples_UploadDue( );
+    ESP_LOGI(TAG_APP, "Stored samples: %lu, upload: %d", mod_samples_GetCnt( ), b_Upload);
+#endif
+#endif
         
     EventDispatcher_Start( );
-    EventDispatcher_RegisterEventHandler(MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT,   Backend_events_handler,  (void*)(obj));
-    EventDispatcher_RegisterEventHandler(MOD_BACKEND_EVENTS, BACKEND_SEND_MESSAGE_DONE, Backend_events_handler,  (void*)(obj));
-    EventDispatcher_RegisterEventHandler(MOD_POWER_EVENTS,   PWR_GO_TO_SLEEP,           PWR_events_handler,      (void*)(obj));        
-    EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS,    WIFI_CONNECTED_EVENT,      WiFi_events_handler,     (void*)(obj));
-    EventDispatcher_RegisterEventHandler(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT,          ESPNOW_events_handler,   (void*)(obj));
-    EventDispatcher_RegisterEventHandler(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT_FAILED,   ESPNOW_events_handler,   (void*)(obj));
+#ifndef CONFIG_APP_EVENT_STATIC_ROUTING     /*Otherwise routed by APP_EVENT_ROUTES in app_events.h*/
+    //Registered once per boot for the lifetime of the app. No handles needed.
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    EventDispatcher_RegisterEventHandler(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT,             ESPNOW_events_handler,   NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_ESPNOW_EVENTS,  ESPNOW_DATA_SENT_FAILED,      ESPNOW_events_handler,   NULL, NULL);
+#else
+    EventDispatcher_RegisterEventHandler(MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT,      Backend_events_handler,  NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_BACKEND_EVENTS, BACKEND_DISCONNECTED_EVENT,   Backend_events_handler,  NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_BACKEND_EVENTS, BACKEND_CONNECT_FAILED_EVENT, Backend_events_handler,  NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_BACKEND_EVENTS, BACKEND_ALL_MSGS_ACKED,       Backend_events_handler,  NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS,    WIFI_CONNECTED_EVENT,         WiFi_events_handler,     NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS,    WIFI_DISCONNECTED_EVENT,      WiFi_events_handler,     NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS,    WIFI_CONNECT_FAILED_EVENT,    WiFi_events_handler,     NULL, NULL);
+#endif
+    EventDispatcher_RegisterEventHandler(MOD_POWER_EVENTS,   PWR_GO_TO_SLEEP,              PWR_events_handler,      NULL, NULL);        
+#endif
       
     //Power module should be initialized before other modules except for EventDispatcher
     //Also inits all Power related IOs
     mod_pwr_init();  
 
-    uint8_t u8_Mac[6];
-    char s_Mac[18];
+    //Start reading the sensors right away. The sample is taken while Wi-Fi and backend are connecting
+    //and handed over to the state machine via MAE_Sensor_Data_Ready.
+    if( xTaskCreate(SensorTask, "app_sensor_task", SENSOR_TASK_STACK_SIZE, (void*)(obj), uxTaskPriorityGet(NULL), &obj->SensorTask_hdl) != pdPASS )
+    {
+        ESP_LOGE(TAG_APP, "Sensor task could not be created");
+        MainApp_PostEvent(obj, MAE_Sys_Init_Failed, 0);
+        return;
+    }
 
-    ESP_ERROR_CHECK(esp_read_mac(u8_Mac, ESP_MAC_BASE));
-    snprintf(s_Mac, 18, "%02X:%02X:%02X:%02X:%02X:%02X", u8_Mac[0], u8_Mac[1], u8_Mac[2], u8_Mac[3], u8_Mac[4], u8_Mac[5]);
-    ESP_LOGI(TAG_APP, "MAC Addr: %s", s_Mac);
-    
-    sscanf( CONFIG_APP_ESPNOW_PEER_MAC, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &u8_Mac[0], &u8_Mac[1], &u8_Mac[2], &u8_Mac[3], &u8_Mac[4], &u8_Mac[5] );
-    
-    snprintf(s_Mac, 18, "%02X:%02X:%02X:%02X:%02X:%02X", u8_Mac[0], u8_Mac[1], u8_Mac[2], u8_Mac[3], u8_Mac[4], u8_Mac[5]);
-    ESP_LOGI(TAG_APP, "MAC Addr: %s", s_Mac);
-     
+    SensorTask_Trigger(obj);
 
-#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
-    ret = mod_espnow_init( 12 );
-#else
-    ret = Backend_Init( );
-#endif
+    if( b_Upload == false )
+    {
+        MainApp_RtcSave( );
+        MainApp_PostEvent(obj, MAE_Upload_Not_Due, 0);
+        return;
+    }
+
+    ret = MainApp_RadioInit( );
 
     if( ret != ESP_OK ) 
-        obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Sys_Init_Failed);    
+        MainApp_PostEvent(obj, MAE_Sys_Init_Failed, 0);
     else
-        obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Sys_Init_Done);    
+    {
+        MainApp_RtcSave( );
+        MainApp_PostEvent(obj, MAE_Sys_Init_Done, 0);
+    }
 }
 
 
-/// @brief     State machine - Not connected state handler
-/// @param obj MainApp object
-static void MASH_Not_Connected(MAIN_APP_t * obj)
+/// @brief        State machine - Not connected state handler
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+static void MASH_Not_Connected(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
 {
     esp_err_t ret = ESP_OK;
 
-    ESP_LOGI(TAG_APP,"MASH_Not_Connected state");
+    if(pEvent != NULL)
+        return;     /*Waiting for WiFi module to connect. Transition triggered by WiFi events*/
+
+    ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Not_Connected");
 
 #if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
-    obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_WiFi_Connection_Established);
+    MainApp_PostEvent(obj, MAE_WiFi_Connection_Established, 0);
     return;
  #endif
 
-    obj->b_WaitingForBackendCon = false;
-
     if(obj->b_WaitingForWiFiCon == false)
     {
-        ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Not_Connected");
-    
         /*Make sure esp_event_default_loop, esp_netif and nvs_flash are initiated before calling this*/
         //Note: This will throw an error if WiFi cannot connect which will cause a reset or core dump    
         ret = mod_wifi_connect( );
          
         if( ret != ESP_OK ) 
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_WiFi_Failed);         
+            MainApp_PostEvent(obj, MAE_WiFi_Failed, 0);
 
         obj->b_WaitingForWiFiCon = true;     
     }
-    else
-    {
-        /*Waiting for WiFi module to connect. Transition triggered in WiFi event handler*/
-        vTaskDelay(pdMS_TO_TICKS(10)); 
-    }
 }
 
 
-/// @brief     State machine - WiFi connected state handler
-/// @param obj MainApp object
-static void MASH_WiFi_Connected(MAIN_APP_t * obj)
+/// @brief        State machine - WiFi connected state handler
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+static void MASH_WiFi_Connected(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
 {    
-    if(obj->b_WaitingForBackendCon == false)
+    esp_err_t ret =  ESP_OK;
+
+    if(pEvent != NULL)
     {
-        ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_WiFi_Connected");
-        
-        esp_err_t ret =  ESP_OK;
-        ret = Backend_Connect( );
+#ifdef MAIN_APP_STORE_FWD_RETRY
+        if(pEvent->Event == MAE_Timeout)
+        {
+            ESP_LOGE(TAG_APP, "Timeout waiting for the backend");
+            MainApp_PostEvent(obj, MAE_Backend_Failed, 0);
+        }
+#endif
+        return;     /*Waiting for backend module to connect. Transition triggered by backend events*/
+    }
 
-        ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_WiFi_Connected. Backend_Connect ret= %d", ret);
-        
-        if(ret != ESP_OK)
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Backend_Failed);
+    ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_WiFi_Connected");
+    
+    ret = Backend_Connect( );
 
-        obj->b_WaitingForBackendCon = true;
-    }
+    ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_WiFi_Connected. Backend_Connect ret= %d", ret);
+    
+    if(ret != ESP_OK)
+        MainApp_PostEvent(obj, MAE_Backend_Failed, 0);
+#ifdef MAIN_APP_STORE_FWD_RETRY
     else
-    {
-        /*Waiting for backend module to connect. Transition triggered in backend event handler*/
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
+        MainApp_ArmTimeout(obj, BACKEND_CONNECT_TIMEOUT_MS);   /*esp-mqtt retries forever*/
+#endif
 }
 
 
-/// @brief State machine - Backend connected state handler
-/// @param obj MainApp object
-static void MASH_Backend_Connected(MAIN_APP_t * obj)
+/// @brief        State machine - Backend connected state handler
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+/// @note         Publishes the sample as soon as the sensor task provided it and waits for all msgs to be acked.
+static void MASH_Backend_Connected(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
 {    
-    //static bool b_WaitingForDataToBeSent = false;
-    static uint32_t u32_Timeout = 0;
-    
-    obj->b_WaitingForBackendCon = false;
-    
-    //ToDo: Bug Watchdog timeout if not all messages have been sent and the state machine is locked in this state.
-    //A timeout is needed after we continue or throw an error.
-    //According to the MQTT backlog all 3 messages have been sent. Must be a bug where we are not getting the feedback correctly
-    if(obj->b_WaitingForDataToBeSent == false)
+    if(pEvent == NULL)
     {
         ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Backend_Connected");
         
-        if( GetSensorMeasurements( &obj->TH_Values, &obj->f_Light_Lux) != ESP_OK )
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Sensor_Read_Failed);    
+        obj->b_WaitingForDataToBeSent = false;
+        obj->b_ReportAcked            = false;
+        obj->u32_DrainMsgs            = 0;
+        
+        if(obj->SensorStatus == ESP_ERR_NOT_FINISHED)
+            MainApp_ArmTimeout(obj, SENSOR_DATA_TIMEOUT_MS);    /*Sensor task is still busy. Wait for MAE_Sensor_Data_Ready*/
         else
-        {
-#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
-            ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (&obj->TH_Values),   sizeof(obj->TH_Values )));     
-            ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (&obj->f_Light_Lux), sizeof(obj->f_Light_Lux) ));
-            ESP_ERROR_CHECK( mod_espnow_send_data( ));            
-            
-#else
-            ESP_ERROR_CHECK(Backend_PublishData(obj));            
-#endif
-            obj->b_WaitingForDataToBeSent = true;
-            u32_Timeout = 50;
-        }
-    }
-    else if( obj->BackendMsgIDs[0] == 0 && 
-             obj->BackendMsgIDs[1] == 0 && 
-             obj->BackendMsgIDs[2] == 0)
-    {
-        ESP_LOGI(TAG_APP,"All messages sent to backend successfully");
-        obj->b_WaitingForDataToBeSent = false;                
-        obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Data_Sent_To_Backend);
+            Backend_PublishSample(obj);
+
+        return;
     }
-    else
+
+    switch(pEvent->Event)
     {
-        //We are waiting for all messages to be sent
-        vTaskDelay(pdMS_TO_TICKS(10));   
-        if(u32_Timeout > 0 )
-            u32_Timeout--;
-        else
+        case MAE_Sensor_Data_Ready:
+            if(obj->b_WaitingForDataToBeSent == false)
+                Backend_PublishSample(obj);
+        break;
+
+        case MAE_Timeout:
         {
-            ESP_LOGW(TAG_APP,"STATE_MACHINE - MAS_Backend_Connected. MSG_Timeout.");
-            obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Data_Sent_To_Backend);
+            if(obj->b_WaitingForDataToBeSent == false)
+            {
+                ESP_LOGE(TAG_APP, "Timeout waiting for sensor data");
+#ifdef CONFIG_APP_FLIGHT_REC
+                FREC_ERROR(FREC_SRC_SENSOR, ESP_ERR_TIMEOUT);
+#endif
+                MainApp_PostEvent(obj, MAE_Sensor_Read_Failed, 0);
+            }
+            else
+            {
+#if !defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) && !defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+                BACKEND_TRACKER_STATS_t Stats;
+
+                Backend_GetPublishStats(&Stats);
+                ESP_LOGW(TAG_APP,"STATE_MACHINE - MAS_Backend_Connected. MSG_Timeout. %lu msgs not acked", Stats.u32_InFlight);
+#else
+                ESP_LOGW(TAG_APP,"STATE_MACHINE - MAS_Backend_Connected. MSG_Timeout.");
+#endif
+#ifdef CONFIG_APP_FLIGHT_REC
+                FREC_ERROR(FREC_SRC_MAIN, ESP_ERR_TIMEOUT);
+#endif
+                MainApp_PostEvent(obj, MAE_Data_Sent_To_Backend, 0);
+            }
         }
+        break;
+
+        default:
+        break;
     }
 }
 
 
-/// @brief     State machine - Data published state handler
-/// @param obj MainApp object
-static void MASH_Data_Published(MAIN_APP_t * obj)
+/// @brief        State machine - Data published state handler
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+static void MASH_Data_Published(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
 {
-    if(obj->b_WaitToGoToSleep == false)          
+    if(pEvent == NULL)
     {
         ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Data_Published");
-       
+
+#ifdef CONFIG_APP_EVENT_DISP_HANDLER_AUDIT
+        EventDispatcher_AuditHandlers( );
+#endif
+        if(StoreFwd_Drain(obj, NULL) == true)
+            return;     /*Samples of the flash queue in flight. Sleep once they are acked*/
+    }
+    else if(obj->b_Draining == false || StoreFwd_Drain(obj, pEvent) == true)
+        return;     /*Waiting for PWR_GO_TO_SLEEP or the ack of the flash queue samples*/
+   
 #ifdef CONFIG_APP_DEEP_SLEEP_ESP_NOW
-        mod_espnow_deinit( );   
+    mod_espnow_deinit( );   
 #endif
 
-#if defined(CONFIG_APP_AUTO_LIGHT_SLEEP) || defined(CONFIG_APP_DEEP_SLEEP)
-        Backend_Disconnect( );                                
+#if (defined(CONFIG_APP_AUTO_LIGHT_SLEEP) && !defined(CONFIG_APP_MQTT_PERSISTENT_SESSION)) || defined(CONFIG_APP_DEEP_SLEEP)
+    Backend_Disconnect( );          /*With a persistent session the connection stays open while sleeping with iTWT*/
+#endif
+
+#if defined(CONFIG_APP_DEEP_SLEEP) || defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    //Deep sleep and the forced light sleep are entered inside mod_pwr_save_start(..). Store the cycle timings before.
+    mod_prof_CycleEnd(CONFIG_APP_REPORTING_INTERVAL_SEC);
+#endif
+#ifdef CONFIG_APP_LIGHT_SLEEP_ESP_NOW
+    obj->s64_SleepStart_us = esp_timer_get_time( );
 #endif
-        mod_pwr_save_start( );
+    mod_pwr_save_start( );
 
 #ifdef CONFIG_APP_LIGHT_SLEEP_ESP_NOW
-        //mod_espnow_deinit( );        
-        obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_Enter_Sleep_Mode);
+    //mod_espnow_deinit( );        
+    MainApp_PostEvent(obj, MAE_Enter_Sleep_Mode, (int32_t)(obj->u32_SleepTimeSec));
 #endif 
-        obj->b_WaitToGoToSleep = true;
-    }
-    else
-        vTaskDelay(pdMS_TO_TICKS(10));    
 }
 
 
-/// @brief     State machine - Sleep state handler (Only for AutoLighSleep)
-/// @param obj MainApp object
-static void MASH_Sleep(MAIN_APP_t * obj)
+/// @brief        State machine - Sleep state handler (Only for AutoLighSleep)
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+/// @note         The sleep is an armed timeout. The main task keeps draining the event queue while the device
+///               is in Auto-Light-Sleep. Wi-Fi events are held and handled after the wake up.
+static void MASH_Sleep(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
 {
-    static uint32_t u32_MaxDelay_ms = 200;     
-    int64_t s64_TimeBefore_us = esp_timer_get_time( ); 
-    int64_t s64_TimeAfter_us  = 0; 
-
-    ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Sleep");
+    if(pEvent == NULL)
+    {
+        ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Sleep");
 
-    obj->b_WaitToGoToSleep = false;    
+        obj->b_LinkLostAsleep = false;
 
 #ifdef CONFIG_APP_LIGHT_SLEEP_ESP_NOW     
-    mod_pwr_save_start( );    
+        MainApp_SleepWakeUp(obj);   /*Back from the forced light sleep of MASH_Data_Published(..)*/
 #else
-#if defined(CONFIG_APP_ITWT_ENABLE) && defined (CONFIG_APP_ITWT_ASUS_BUG_WORKAROUND)
-    //ToDo: Different sleep modes to be implemented   
-    //The Asus AP always deauthenticates after 5min and 30sec regardless of accepting the TWT request
-    //Sleep times more than 5min dont work. we need to wake up and make a TWT probe after 5min latest
-    if(obj->u32_SleepTimeSec > CONFIG_APP_ITWT_ASUS_BUG_INTERVAL)
+        mod_prof_CycleEnd(obj->u32_SleepTimeSec);
+        obj->s64_SleepStart_us = esp_timer_get_time( );
+        obj->b_Asleep          = true;
+        obj->u32_SleepLeftSec  = obj->u32_SleepTimeSec;
+        MainApp_SleepArm(obj);
+#endif
+        return;
+    }
+
+    if(obj->b_Asleep == true)
     {
-        for(int i = 0; i< obj->u32_SleepTimeSec/CONFIG_APP_ITWT_ASUS_BUG_INTERVAL ; i++)
+        if(pEvent->Event == MAE_WiFi_Connection_Lost || pEvent->Event == MAE_WiFi_Connection_Established)
+            obj->b_LinkLostAsleep = (pEvent->Event == MAE_WiFi_Connection_Lost);
+        else if(pEvent->Event == MAE_Timeout && obj->u32_SleepLeftSec > 0)
         {
-            GoToSleep( CONFIG_APP_ITWT_ASUS_BUG_INTERVAL ); 
+#if defined(CONFIG_APP_ITWT_ENABLE) && defined (CONFIG_APP_ITWT_ASUS_BUG_WORKAROUND)
             ESP_LOGI(TAG_APP, "TWT probe request with 100ms timeout. err= %d", esp_wifi_sta_itwt_send_probe_req(100));
+#endif
+            MainApp_SleepArm(obj);
         }
+        else if(pEvent->Event == MAE_Timeout)
+            MainApp_SleepWakeUp(obj);
 
-        GoToSleep( obj->u32_SleepTimeSec % CONFIG_APP_ITWT_ASUS_BUG_INTERVAL ); 
+        return;
     }
-    else
-        GoToSleep( obj->u32_SleepTimeSec ); 
-#else
-    GoToSleep( obj->u32_SleepTimeSec ); 
-#endif
-#endif   
-
-    /*Back from sleeping so lets stop power saving and connect to the backend again.*/       
-    s64_TimeAfter_us = esp_timer_get_time( );
-    ESP_LOGI(TAG_APP,"MainApp awake again after %d sec.", (int) ((s64_TimeAfter_us - s64_TimeBefore_us) / 1000000));
-    mod_pwr_save_stop( );    
-
-    while(u32_MaxDelay_ms > 0 && obj->CurrentState == MAS_Sleep)
-    {
-        /*Lets try with a wait state before jumping to next state.*/
-        /*ToDo: More clean would be to ping the backend server. To Be implemented*/
-        vTaskDelay(pdMS_TO_TICKS(10)); 
-        u32_MaxDelay_ms -= 10;
-    }    
 
     //When using ESP-NOW with Auto Light Sleep we dont use an Access Point so it does not matter.
-    //Assuming we still have a WiFi connection after Auto Light Sleep with iTWT.    
-    //ToDo: Bug to be fixed!
-    //If we've lost the WiFi connection we get a race condition when jumping to connected state before we get the WiFi disconnect state.
-    //We go to the WiFi connected state and start the backend connection which then fails.
-    if(obj->CurrentState == MAS_Sleep)
+    //Assuming we still have a WiFi connection after Auto Light Sleep with iTWT if no disconnect event
+    //arrived within MAS_SLEEP_WAKE_SETTLE_MS.
+    //ToDo: More clean would be to ping the backend server. To Be implemented
+    if(pEvent->Event == MAE_Timeout)
     {
         ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Sleep --> Assuming WiFi is connected.");
-        obj->CurrentState = MAS_Handle_Transition(obj->CurrentState, MAE_WiFi_Connection_Established);
-    }    
+        MainApp_PostEvent(obj, MAE_WiFi_Connection_Established, 0);
+    }
 }
 
 
-/// @brief     State machine - Error state handler. We are just waiting here for now.
-/// @param obj MainApp object
-static void MASH_Error(MAIN_APP_t * obj)
+/// @brief        State machine - Error state handler. The sample of this cycle is kept in the flash queue (CONFIG_APP_STORE_FWD).
+///               With deep sleep the cycle ends and the next one tries again. Otherwise we are just waiting here for now.
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+static void MASH_Error(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
 {
+    //If the sensor task is still busy the sample is stored with MAE_Sensor_Data_Ready
+    if(pEvent == NULL || pEvent->Event == MAE_Sensor_Data_Ready)
+        StoreFwd_Store(obj);
+
+#ifdef MAIN_APP_STORE_FWD_RETRY
+    if(obj->SensorStatus == ESP_ERR_NOT_FINISHED && (pEvent == NULL || pEvent->Event != MAE_Timeout))
+    {
+        if(pEvent == NULL)
+            MainApp_ArmTimeout(obj, SENSOR_DATA_TIMEOUT_MS);
+        return;
+    }
+
+    ESP_LOGW(TAG_APP,"STATE_MACHINE - MAS_Error. Retry in the next cycle, %lu samples in flash", mod_fq_GetCnt( ));
+
+    //Deep sleep is entered inside mod_pwr_deep_sleep_start(..). Store the cycle timings before.
+    mod_prof_CycleEnd(CONFIG_APP_REPORTING_INTERVAL_SEC);
+    mod_pwr_deep_sleep_start( );
+#else
+    if(pEvent != NULL && pEvent->Event != MAE_Timeout)
+        return;
+
     ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Error");
-    vTaskDelay(pdMS_TO_TICKS(180000));    
+    MainApp_ArmTimeout(obj, MAS_ERROR_LOG_INTERVAL_MS);
+#endif
+}
+
+
+/// @brief        State machine - Store sample state handler. Wi-Fi has not been started in this wake cycle.
+/// @param obj    MainApp object
+/// @param pEvent NULL on state entry, otherwise event without transition
+/// @note         Once the sensor task provided the sample it is checked against the deadbands (CONFIG_APP_REPORT_ON_CHANGE).
+///               A due report starts the radio. Otherwise the sample is stored (batch mode) and deep sleep is entered.
+static void MASH_Store_Sample(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
+{
+    if(pEvent == NULL)
+    {
+        ESP_LOGI(TAG_APP,"STATE_MACHINE - MAS_Store_Sample");
+
+        if(obj->SensorStatus == ESP_ERR_NOT_FINISHED)
+        {
+            MainApp_ArmTimeout(obj, SENSOR_DATA_TIMEOUT_MS);    /*Sensor task is still busy. Wait for MAE_Sensor_Data_Ready*/
+            return;
+        }
+    }
+    else if(pEvent->Event == MAE_Timeout)
+    {
+        ESP_LOGE(TAG_APP, "Timeout waiting for sensor data");
+#ifdef CONFIG_APP_FLIGHT_REC
+        FREC_ERROR(FREC_SRC_SENSOR, ESP_ERR_TIMEOUT);
+#endif
+        MainApp_PostEvent(obj, MAE_Sensor_Read_Failed, 0);
+        return;
+    }
+    else if(pEvent->Event != MAE_Sensor_Data_Ready)
+        return;
+
+    if( MainApp_ReportDue(obj) == true )
+    {
+        //The sample is added to the store by Backend_PublishSample(..)
+        if( MainApp_RadioInit( ) != ESP_OK )
+            MainApp_PostEvent(obj, MAE_Sys_Init_Failed, 0);
+        else
+            MainApp_PostEvent(obj, MAE_Sys_Init_Done, 0);
+        return;
+    }
+
+#ifdef MAIN_APP_BATCH_MODE
+    mod_samples_Add(obj->TH_Values.f_Temp_C, obj->TH_Values.f_Humi_PCT, obj->f_Light_Lux);
+    ESP_LOGI(TAG_APP, "Sample stored. %lu samples in store", mod_samples_GetCnt( ));
+#else
+    ESP_LOGI(TAG_APP, "No change. Back to sleep");
+#endif
+
+    //Deep sleep is entered inside mod_pwr_deep_sleep_start(..). Store the cycle timings before.
+    mod_prof_CycleEnd(CONFIG_APP_REPORTING_INTERVAL_SEC);
+    mod_pwr_deep_sleep_start( );
 }
 
 
@@ -734,41 +1230,183 @@ static void Print_Reset_Reason(esp_reset_reason_t reason)
 /// @return                 ESP_OK if no error
 /// @note                   This function will block the calling task by at least 900ms due to necessary wait times
 /// @note                   This function will turn the power to the sensors on and off.  
+/// @note                   Only called from SensorTask(..) so the wait times do not block the state machine.
 static esp_err_t GetSensorMeasurements(TEMP_HUMID_VALUES_t *p_TH_Values, float *pf_Lux)
 {
-    esp_err_t ret = ESP_OK;
+    esp_err_t ret       = ESP_OK;
+    esp_err_t err       = ESP_OK;
+    bool b_LightInit    = false;
+    bool b_TH_Init      = false;
 
     //Must be called before the I2C sensor init functions to enable power to the sensors
-    ESP_ERROR_CHECK(mod_pwr_PeriphPWR(true));
+    ret = mod_pwr_PeriphPWR(true);
 
     //Enable power to the I2C devices again and re-init the sensors if needed            
-    ESP_ERROR_CHECK(i2cdev_init());
-
-    ESP_ERROR_CHECK(mod_light_init());
-    ESP_ERROR_CHECK(mod_th_meas_init());
-
-    ESP_ERROR_CHECK(mod_th_meas_GetValues(p_TH_Values));    
-    //ToDo: Optimization. The light sensor should be initialized much earlier to be ready with the data when needed.
-    //ToDo: Create task to get the data in parallel to state machine getting ready with the connections.    
-    vTaskDelay(pdMS_TO_TICKS(400));    
-    ESP_ERROR_CHECK(mod_light_Get(pf_Lux));    
-  	
-    ESP_ERROR_CHECK(i2cdev_done());    
-    ESP_ERROR_CHECK(mod_pwr_PeriphPWR(false));     
-
-    ESP_ERROR_CHECK(mod_light_Deinit( ));
-    ESP_ERROR_CHECK(mod_th_meas_Deinit( ));
+    if(ret == ESP_OK)
+        ret = i2cdev_init();
+
+    if(ret == ESP_OK)
+    {
+        b_LightInit = true;
+        ret = mod_light_init();
+    }
+    if(ret == ESP_OK)
+    {
+        b_TH_Init = true;
+        ret = mod_th_meas_init();
+    }
+
+    if(ret == ESP_OK)
+        ret = mod_th_meas_GetValues(p_TH_Values);
+    if(ret == ESP_OK)
+    {
+        vTaskDelay(pdMS_TO_TICKS(400));    
+        ret = mod_light_Get(pf_Lux);
+    }
+
+    if(ret != ESP_OK)
+        ESP_LOGE(TAG_APP, "Sensor read failed: %s", esp_err_to_name(ret));
+
+    //Always power down and release the sensors again, the first error is returned
+    err = i2cdev_done();
+    ret = (ret == ESP_OK) ? err : ret;
+    err = mod_pwr_PeriphPWR(false);
+    ret = (ret == ESP_OK) ? err : ret;
+
+    //Only the device descriptors that have been created in this cycle can be freed
+    err = b_LightInit ? mod_light_Deinit( ) : ESP_OK;
+    ret = (ret == ESP_OK) ? err : ret;
+    err = b_TH_Init ? mod_th_meas_Deinit( ) : ESP_OK;
+    ret = (ret == ESP_OK) ? err : ret;
     
     return ret;        
 }
 
 
-/// @brief     Sends the temp, humid and lux data to the backend.
+/// @brief              Sensor acquisition task. Waits for a trigger from the state machine, reads all sensors
+///                     and posts MAE_Sensor_Data_Ready or MAE_Sensor_Read_Failed once the sample is done.
+/// @param pvParameters MainApp_obj
+/// @note               Runs concurrently to mod_wifi_connect(..) and Backend_Connect(..) to keep the radio on time short
+static void SensorTask(void *pvParameters)
+{
+    MAIN_APP_t *obj = (MAIN_APP_t*)(pvParameters);
+    esp_err_t ret   = ESP_OK;
+
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        mod_prof_PhaseBegin(PROF_Sensor_Read);
+        ret = GetSensorMeasurements(&obj->TH_Values, &obj->f_Light_Lux);
+        mod_prof_PhaseEnd(PROF_Sensor_Read);
+
+        if( ret == ESP_OK )
+            MainApp_PostEvent(obj, MAE_Sensor_Data_Ready, 0);
+        else
+            MainApp_PostEvent(obj, MAE_Sensor_Read_Failed, 0);
+    }
+}
+
+
+/// @brief     Start a new sensor sample in the sensor task. Invalidates the previous sample.
+/// @param obj MainApp object
+/// @note      Must be called from the main task
+static void SensorTask_Trigger(MAIN_APP_t * obj)
+{
+    obj->SensorStatus   = ESP_ERR_NOT_FINISHED;
+    obj->b_SampleQueued = false;
+    xTaskNotifyGive(obj->SensorTask_hdl);
+}
+
+
+/// @brief     Hands the sample of this wake cycle over to the backend or ESP-NOW and arms the ack timeout.
+/// @param obj MainApp object
+/// @note      Posts MAE_Sensor_Read_Failed if the sensor task could not read the sensors
+static void Backend_PublishSample(MAIN_APP_t * obj)
+{
+    if(obj->SensorStatus != ESP_OK)
+    {
+        MainApp_PostEvent(obj, MAE_Sensor_Read_Failed, 0);
+        return;
+    }
+
+    mod_pwr_energy_Report(&obj->EnergyReport);
+    ESP_LOGI(TAG_APP, "Energy report %lu: %.1fuAh, total: %.1fuAh", obj->EnergyReport.u32_Report, obj->EnergyReport.f_Report_uAh, obj->EnergyReport.f_Total_uAh);
+
+    for(int i = 0; i < PWR_Num_Modes; i++)
+        ESP_LOGD(TAG_APP, "  %s: %lums %.1fuAh", pwr_energy_mode_to_str((PWR_MODE_t)(i)), obj->EnergyReport.au32_Mode_ms[i], obj->EnergyReport.af_Mode_uAh[i]);
+
+    for(int i = 0; i < MAS_Num_States; i++)
+        ESP_LOGD(TAG_APP, "  %s: %.1fuAh", MAS_State_to_str((MainApp_State)(i)), obj->EnergyReport.af_State_uAh[i]);
+
+#ifdef MAIN_APP_BATCH_MODE
+    //The sample of this cycle is uploaded together with the stored ones
+    mod_samples_Add(obj->TH_Values.f_Temp_C, obj->TH_Values.f_Humi_PCT, obj->f_Light_Lux);
+    obj->b_SampleQueued = true;
+#endif
+
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    EspNow_AddData(obj);
+    ESP_ERROR_CHECK( mod_espnow_send_data( ));            
+#else
+    Backend_PublishBegin( );
+    ESP_ERROR_CHECK(Backend_PublishData(obj));            
+#endif
+
+    obj->b_WaitingForDataToBeSent = true;
+    MainApp_ArmTimeout(obj, BACKEND_ACK_TIMEOUT_MS);
+
+    Profiler_EmitBatch( );
+    FlightRec_Flush( );
+
+#if !defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) && !defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    /*BACKEND_ALL_MSGS_ACKED is posted once all msgs are acked. Right away with QoS0*/
+    Backend_PublishEnd( );
+#endif
+}
+
+
+/// @brief     The stored samples handed over with this upload have been acked. Removes them from the sample store.
+/// @param obj MainApp object
+static void Backend_SamplesAcked(MAIN_APP_t * obj)
+{
+    if(obj->u32_SamplesSent == 0)
+        return;
+
+    ESP_LOGI(TAG_APP, "%lu stored samples uploaded", obj->u32_SamplesSent);
+    mod_samples_Remove(obj->u32_SamplesSent);
+    obj->u32_SamplesSent = 0;
+}
+
+
+/// @brief     Sends the temp, humid, lux and energy data to the backend. As one report message or
+///            one message per value, see CONFIG_APP_MQTT_PAYLOAD_LAYOUT.
 /// @param obj MainApp object holding the data to send
 /// @return    ESP_OK if no errors otherwise ESP_FAIL
 static esp_err_t Backend_PublishData(MAIN_APP_t * obj)
 {
     esp_err_t ret = ESP_OK;    
+
+#ifdef CONFIG_APP_MQTT_PAYLOAD_REPORT
+    //All values in one message. One publish and one ack instead of four.
+    BACKEND_REPORT_t Report =
+    {
+        .f_Temp_C     = obj->TH_Values.f_Temp_C,
+        .f_Humi_PCT   = obj->TH_Values.f_Humi_PCT,
+        .f_Light_Lux  = obj->f_Light_Lux,
+        .f_Report_uAh = obj->EnergyReport.f_Report_uAh,
+        .f_Total_uAh  = obj->EnergyReport.f_Total_uAh,
+        .u8_Fields    = 0,
+    };
+
+#ifdef CONFIG_APP_MQTT_REPORT_RSSI
+    if( mod_wifi_get_rssi(&Report.s8_RSSI_dBm) == ESP_OK )
+        Report.u8_Fields |= BACKEND_REPORT_HAS_RSSI;
+#endif
+
+    //Like Backend_SendMessage(..) a failed publish is not waited for. See BACKEND_TRACKER_STATS_t::u32_Failed
+    Backend_PublishReport(&Report);
+#else
     BACKEND_MESSAGE_t backend_msg;
 
     //Get Temperature reading and send to backend        
@@ -776,7 +1414,6 @@ static esp_err_t Backend_PublishData(MAIN_APP_t * obj)
     {            
         backend_msg.topic = AmbientTempC;        
         Backend_SendMessage(&backend_msg);
-        obj->BackendMsgIDs[0] = backend_msg.s32_Msg_ID;
     }
     else
         ret = ESP_FAIL;
@@ -786,7 +1423,6 @@ static esp_err_t Backend_PublishData(MAIN_APP_t * obj)
     {            
         backend_msg.topic = Humidity;        
         Backend_SendMessage(&backend_msg);            
-        obj->BackendMsgIDs[1] = backend_msg.s32_Msg_ID;
     }
     else
         ret = ESP_FAIL;
@@ -796,21 +1432,243 @@ static esp_err_t Backend_PublishData(MAIN_APP_t * obj)
     {
         backend_msg.topic = Light;
         Backend_SendMessage(&backend_msg);            
-        obj->BackendMsgIDs[2] = backend_msg.s32_Msg_ID;
     }
     else
         ret = ESP_FAIL;
+
+    //Send the estimated charge since the last report and in total: "<report uAh>,<total uAh>"
+    if( snprintf( backend_msg.str_Data, sizeof(backend_msg.str_Data), "%.1f,%.0f", obj->EnergyReport.f_Report_uAh, obj->EnergyReport.f_Total_uAh ) > 0)
+    {
+        backend_msg.topic = Energy;
+        Backend_SendMessage(&backend_msg);            
+    }
+    else
+        ret = ESP_FAIL;
+#endif
+
+#if defined(MAIN_APP_BATCH_MODE) && defined(CONFIG_APP_DEEP_SLEEP)
+    //Send all stored samples incl. the one of this cycle. They stay in the store until all msgs are acked.
+    int s32_Len = mod_samples_FormatCSV( s_Samples, sizeof(s_Samples), &obj->u32_SamplesSent );
+
+    if( Backend_PublishSamples( s_Samples, s32_Len ) < 0 )
+        obj->u32_SamplesSent = 0;       /*Keep the samples and try again with the next upload*/
+#endif
     
     return ret;
 }
 
 
-/// @brief                  Function to pause calling task via vTaskDelay(..)
-/// @param u32_SleepTimeSec Sleep time in seconds
-static void GoToSleep(uint32_t u32_SleepTimeSec)
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+/// @brief     Adds the temp, humid, lux and energy data to the ESP-NOW frame. In batch mode followed by
+///            the oldest stored samples which fit into the frame. The rest is sent with the next upload.
+///            Encoding see CONFIG_APP_ESPNOW_PAYLOAD.
+/// @param obj MainApp object holding the data to send
+static void EspNow_AddData(MAIN_APP_t * obj)
 {
-    //Putting the main task to sleep will put the device into Auto-Light-Sleep mode
-    vTaskDelay(pdMS_TO_TICKS(u32_SleepTimeSec*1000));    
+#ifdef MAIN_APP_BATCH_MODE
+    SAMPLE_RECORD_t Sample;
+#endif
+    obj->u32_SamplesSent = 0;
+
+#ifdef CONFIG_APP_ESPNOW_PAYLOAD_CBOR
+    uint8_t au8_Frame[MAIN_APP_ESPNOW_DATA_SIZE];
+    CODEC_WRITER_t Writer;
+
+    codec_Init(&Writer, au8_Frame, sizeof(au8_Frame));
+#ifdef MAIN_APP_BATCH_MODE
+    struct timeval Now;
+
+    gettimeofday(&Now, NULL);
+    codec_MapBegin(&Writer, 6);
+#else
+    codec_MapBegin(&Writer, 5);
+#endif
+    codec_PutValue(&Writer, CODEC_KEY_TEMP_C,     obj->TH_Values.f_Temp_C);
+    codec_PutValue(&Writer, CODEC_KEY_HUMI_PCT,   obj->TH_Values.f_Humi_PCT);
+    codec_PutValue(&Writer, CODEC_KEY_LIGHT_LUX,  obj->f_Light_Lux);
+    codec_PutValue(&Writer, CODEC_KEY_REPORT_UAH, obj->EnergyReport.f_Report_uAh);
+    codec_PutValue(&Writer, CODEC_KEY_TOTAL_UAH,  obj->EnergyReport.f_Total_uAh);
+#ifdef MAIN_APP_BATCH_MODE
+    codec_PutKey(&Writer, CODEC_KEY_SAMPLES);
+    codec_ArrayBeginIndef(&Writer);
+
+    while( mod_samples_Get(obj->u32_SamplesSent, &Sample) )
+    {
+        if( codec_PutSample(&Writer, (uint32_t)(Now.tv_sec) - Sample.u32_Time_s, Sample.f_Temp_C, Sample.f_Humi_PCT, Sample.f_Light_Lux) == false )
+            break;
+
+        obj->u32_SamplesSent++;
+    }
+
+    codec_Break(&Writer);
+#endif
+    ESP_ERROR_CHECK( codec_Len(&Writer) < 0 ? ESP_ERR_NO_MEM : ESP_OK );
+    ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (au8_Frame), (size_t)(codec_Len(&Writer)) ));
+#else
+    ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (&obj->TH_Values),   sizeof(obj->TH_Values )));     
+    ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (&obj->f_Light_Lux), sizeof(obj->f_Light_Lux) ));
+    ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (&obj->EnergyReport.f_Report_uAh), sizeof(obj->EnergyReport.f_Report_uAh) ));
+    ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (&obj->EnergyReport.f_Total_uAh),  sizeof(obj->EnergyReport.f_Total_uAh) ));
+#ifdef MAIN_APP_BATCH_MODE
+    for(; obj->u32_SamplesSent < MAIN_APP_ESPNOW_MAX_SAMPLES; obj->u32_SamplesSent++)
+    {
+        if( mod_samples_Get(obj->u32_SamplesSent, &Sample) == false )
+            break;
+
+        ESP_ERROR_CHECK( mod_espnow_add_send_data( (void*) (&Sample), sizeof(Sample) ));
+    }
+#endif
+#endif
+}
+#endif
+
+
+/// @brief     Appends the sample of this wake cycle to the flash queue. Published by StoreFwd_Drain(..)
+///            once a report is acked again. Only with CONFIG_APP_STORE_FWD.
+/// @param obj MainApp object
+/// @note      Skipped without a valid sample or if the sample is queued already (e.g. in the sample store in batch mode)
+static void StoreFwd_Store(MAIN_APP_t * obj)
+{
+#ifdef CONFIG_APP_STORE_FWD
+    uint8_t au8_Record[FQ_RECORD_MAX_LEN];
+    CODEC_WRITER_t Writer;
+    struct timeval Now;
+
+    if(obj->SensorStatus != ESP_OK || obj->b_SampleQueued == true)
+        return;
+
+    gettimeofday(&Now, NULL);
+
+    codec_Init(&Writer, au8_Record, sizeof(au8_Record));
+    codec_MapBegin(&Writer, 4);
+    codec_PutValue(&Writer, CODEC_KEY_TEMP_C,    obj->TH_Values.f_Temp_C);
+    codec_PutValue(&Writer, CODEC_KEY_HUMI_PCT,  obj->TH_Values.f_Humi_PCT);
+    codec_PutValue(&Writer, CODEC_KEY_LIGHT_LUX, obj->f_Light_Lux);
+    codec_PutKey(&Writer, CODEC_KEY_TIME_S);
+    codec_PutUint(&Writer, (uint32_t)(Now.tv_sec));
+
+    if( codec_Len(&Writer) < 0 || mod_fq_Append(au8_Record, (size_t)(codec_Len(&Writer))) != ESP_OK )
+        return;
+
+    obj->b_SampleQueued = true;
+    ESP_LOGI(TAG_APP, "Sample stored in flash. %lu samples in flash", mod_fq_GetCnt( ));
+#endif
+}
+
+
+/// @brief        Publishes the samples of the flash queue, oldest first, up to CONFIG_APP_STORE_FWD_BATCH per message.
+///               The next message is only published once the previous one has been acked. At most
+///               CONFIG_APP_STORE_FWD_DRAIN_BATCHES messages per wake cycle, the rest follows in the next cycles.
+/// @param obj    MainApp object
+/// @param pEvent NULL to start. Otherwise an event passed to MASH_Data_Published while draining.
+/// @return       true while a message is in flight. false once done or if the backend failed.
+/// @note         Only started if the report of this wake cycle has been acked
+static bool StoreFwd_Drain(MAIN_APP_t * obj, const MAIN_APP_EVENT_t *pEvent)
+{
+#ifdef CONFIG_APP_STORE_FWD
+    size_t Len = 0;
+
+    if(pEvent == NULL)
+    {
+        if(obj->b_ReportAcked == false || mod_fq_GetCnt( ) == 0)
+            return false;
+
+        obj->b_Draining = true;
+    }
+    else if(pEvent->Event == MAE_Data_Sent_To_Backend && pEvent->s32_Data == 1)
+    {
+        mod_fq_MarkSent(obj->u32_StoredSent);
+        ESP_LOGI(TAG_APP, "%lu samples of the flash queue uploaded, %lu left", obj->u32_StoredSent, mod_fq_GetCnt( ));
+    }
+    else if(pEvent->Event == MAE_Data_Sent_To_Backend || pEvent->Event == MAE_Timeout ||
+            pEvent->Event == MAE_Backend_Connection_Lost || pEvent->Event == MAE_WiFi_Connection_Lost)
+    {
+        ESP_LOGW(TAG_APP, "Samples of the flash queue not acked. Sent again in the next cycle");
+        obj->b_Draining = false;
+        return false;
+    }
+    else
+        return true;
+
+    obj->u32_StoredSent = 0;
+
+    if(obj->u32_DrainMsgs < CONFIG_APP_STORE_FWD_DRAIN_BATCHES)
+    {
+        //CBOR array of indefinite length (0x9F .. 0xFF). The records are CBOR maps and are copied as they are.
+        mod_fq_ReadOldest(&s_Stored[1], sizeof(s_Stored) - 2, CONFIG_APP_STORE_FWD_BATCH, &obj->u32_StoredSent, &Len);
+    }
+
+    if(obj->u32_StoredSent > 0)
+    {
+        s_Stored[0]       = 0x9F;
+        s_Stored[1 + Len] = 0xFF;
+
+        Backend_PublishBegin( );
+
+        if( Backend_PublishStored(s_Stored, (int)(Len + 2)) >= 0 )
+        {
+            obj->u32_DrainMsgs++;
+            MainApp_ArmTimeout(obj, BACKEND_ACK_TIMEOUT_MS);
+
+            /*BACKEND_ALL_MSGS_ACKED is posted once the message is acked. Right away with QoS0*/
+            Backend_PublishEnd( );
+            return true;
+        }
+    }
+
+    obj->b_Draining = false;
+#endif
+    return false;
+}
+
+
+/// @brief Emits the profiling records of the last CONFIG_APP_PROF_BATCH_SIZE wake cycles once available.
+///        Depending on the configuration they are written to the log or published to the diagnostics topic.
+/// @note  Call only while the backend is connected. ESP-NOW modes always use the log.
+static void Profiler_EmitBatch(void)
+{
+    if(mod_prof_BatchReady() == false)
+        return;
+
+#if defined(CONFIG_APP_PROF_OUTPUT_MQTT) && !defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) && !defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    if( Backend_PublishDiagnostics(s_ProfBatch, mod_prof_FormatBatch(s_ProfBatch, sizeof(s_ProfBatch))) < 0 )
+        return;     /*Keep the records and try again in the next cycle*/
+#elif !defined(CONFIG_APP_PROF_OUTPUT_NONE)
+    mod_prof_LogBatch( );
+#endif
+
+    mod_prof_ClearBatch( );
+
+#ifdef CONFIG_APP_PROF_EVENT_DISP_STATS
+    EventDispatcher_DumpStats( );
+#endif
+}
+
+
+/// @brief Sends the flight recorder records if a flush is due (error, abnormal reset or trace filling up).
+///        MQTT modes publish the binary export to the flight recorder topic and mark the records sent.
+///        ESP-NOW modes have no transport with confirmed delivery. The records stay unsent in RTC memory
+///        and are only written to the log after an error or abnormal reset.
+/// @note  Call only while the backend is connected. Decode with tools/flight_recorder/frec_decode.py
+static void FlightRec_Flush(void)
+{
+#ifdef CONFIG_APP_FLIGHT_REC
+    if(mod_frec_FlushDue() == false)
+        return;
+
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+    mod_frec_Log( );
+#else
+    uint32_t u32_Cnt;
+    size_t   Len = mod_frec_Export(s_FlightRec, sizeof(s_FlightRec), &u32_Cnt);
+
+    if( Backend_PublishFlightRec(s_FlightRec, (int)(Len)) < 0 )
+        return;     /*Keep the records and try again in the next cycle*/
+
+    ESP_LOGI(TAG_APP, "Flight recorder: %lu records published", u32_Cnt);
+    mod_frec_MarkSent(u32_Cnt);
+#endif
+#endif
 }
 
 
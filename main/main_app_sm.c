@@ -0,0 +1,191 @@
+/**
+  ******************************************************************************
+  * @file    main_app_sm.c
+  * @author  The Embedded Dude
+  * @brief   Main App state machine (MAS) states, events and transition table
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The module has no dependencies to ESP-IDF or FreeRTOS and can be built
+       on the host to unit test the transition table.
+       ESP-NOW transitions are selected by CONFIG_APP_DEEP_SLEEP_ESP_NOW or
+       CONFIG_APP_LIGHT_SLEEP_ESP_NOW. On the host define them via compiler flags.
+       The host test in tools/main_app_sm checks every state/event pair.
+    2. MAS_Handle_Transition(..) returns the next state for a state/event pair.
+       If no transition is defined the current state is returned.
+    3. MAS_State_to_str(..) and MAS_Event_to_str(..) translate states and events
+       into strings for logging.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+#include "main_app_sm.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+#define MAS_ESPNOW_MODE 1               //!< ESP-NOW does not connect to a backend. Wi-Fi connected jumps directly to backend connected
+#endif
+
+
+/* Private macro -------------------------------------------------------------*/
+
+
+/* Private constants ---------------------------------------------------------*/
+
+/// @brief Transition table. Check the state machine diagram for more details
+/// @note  The first matching row wins. State/event pairs not listed do not cause a transition.
+const MAS_TRANSITION_t MAS_TransitionTable[] =
+{
+    /* Current state           Event                                 Next state           */
+    { MAS_Init_Sys,            MAE_Sys_Init_Done,                    MAS_Not_Connected     },
+    { MAS_Init_Sys,            MAE_Sys_Init_Failed,                  MAS_Error             },
+    { MAS_Init_Sys,            MAE_Upload_Not_Due,                   MAS_Store_Sample      },
+
+    { MAS_Store_Sample,        MAE_Sys_Init_Done,                    MAS_Not_Connected     },
+    { MAS_Store_Sample,        MAE_Sys_Init_Failed,                  MAS_Error             },
+    { MAS_Store_Sample,        MAE_Sensor_Read_Failed,               MAS_Error             },
+
+#ifdef MAS_ESPNOW_MODE
+    { MAS_Not_Connected,       MAE_WiFi_Connection_Established,      MAS_Backend_Connected },
+#else
+    { MAS_Not_Connected,       MAE_WiFi_Connection_Established,      MAS_WiFi_Connected    },
+#endif
+    { MAS_Not_Connected,       MAE_WiFi_Failed,                      MAS_Error             },
+    { MAS_Not_Connected,       MAE_Sensor_Read_Failed,               MAS_Error             },
+
+    { MAS_WiFi_Connected,      MAE_Backend_Connection_Established,   MAS_Backend_Connected },
+    { MAS_WiFi_Connected,      MAE_WiFi_Connection_Lost,             MAS_Not_Connected     },
+    { MAS_WiFi_Connected,      MAE_Backend_Failed,                   MAS_Error             },
+
+    { MAS_Backend_Connected,   MAE_Data_Sent_To_Backend,             MAS_Data_Published    },
+    { MAS_Backend_Connected,   MAE_Backend_Connection_Lost,          MAS_WiFi_Connected    },
+    { MAS_Backend_Connected,   MAE_WiFi_Connection_Lost,             MAS_Not_Connected     },
+    { MAS_Backend_Connected,   MAE_Backend_Failed,                   MAS_Error             },
+    { MAS_Backend_Connected,   MAE_Sensor_Read_Failed,               MAS_Error             },
+
+    { MAS_Data_Published,      MAE_Enter_Sleep_Mode,                 MAS_Sleep             },
+
+#ifdef CONFIG_APP_LIGHT_SLEEP_ESP_NOW
+    { MAS_Sleep,               MAE_WiFi_Connection_Established,      MAS_Backend_Connected },
+#else
+    { MAS_Sleep,               MAE_WiFi_Connection_Established,      MAS_WiFi_Connected    },
+#endif
+    { MAS_Sleep,               MAE_WiFi_Connection_Lost,             MAS_Not_Connected     },
+
+    //ToDo: Implement error handling. MAS_Error has no way out for now.
+};
+
+const size_t MAS_TransitionTableSize = sizeof(MAS_TransitionTable) / sizeof(MAS_TransitionTable[0]);
+
+
+/* Private variables ---------------------------------------------------------*/
+
+
+/* Private function prototypes -----------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief              Main app state machine. Depending on the current state and event occurrence the
+/// @brief              logic switches to a new state or remains in the current state.
+/// @param currentState The actual state we are in
+/// @param event        Event that occured
+/// @return             Returns the new state. If no action required it will return the current state
+MainApp_State MAS_Handle_Transition(MainApp_State currentState, MainApp_Event event)
+{
+    for(size_t i = 0; i < MAS_TransitionTableSize; i++)
+    {
+        if( MAS_TransitionTable[i].CurrentState == currentState && MAS_TransitionTable[i].Event == event )
+            return MAS_TransitionTable[i].NextState;
+    }
+
+    // If no transition occurs, stay in the current state
+    return currentState;
+}
+
+
+/// @brief       "Translates" MainApp_State into string
+/// @param state MainApp_State
+/// @return      translated string
+const char *MAS_State_to_str(MainApp_State state)
+{
+    switch (state)
+    {
+        case MAS_Init_Sys:          return "MAS_Init_Sys";
+        case MAS_Not_Connected:     return "MAS_Not_Connected";
+        case MAS_WiFi_Connected:    return "MAS_WiFi_Connected";
+        case MAS_Backend_Connected: return "MAS_Backend_Connected";
+        case MAS_Data_Published:    return "MAS_Data_Published";
+        case MAS_Sleep:             return "MAS_Sleep";
+        case MAS_Error:             return "MAS_Error";
+        case MAS_Store_Sample:      return "MAS_Store_Sample";
+        default:                    return "UNKNOWN MAS";
+    }
+}
+
+
+/// @brief       "Translates" MainApp_Event into string
+/// @param event MainApp_Event
+/// @return      translated string
+const char *MAS_Event_to_str(MainApp_Event event)
+{
+    switch (event)
+    {
+        case MAE_Sys_Init_Done:                  return "MAE_Sys_Init_Done";
+        case MAE_Sys_Init_Failed:                return "MAE_Sys_Init_Failed";
+        case MAE_Sensor_Read_Failed:             return "MAE_Sensor_Read_Failed";
+        case MAE_WiFi_Failed:                    return "MAE_WiFi_Failed";
+        case MAE_WiFi_Connection_Established:    return "MAE_WiFi_Connection_Established";
+        case MAE_WiFi_Connection_Lost:           return "MAE_WiFi_Connection_Lost";
+        case MAE_Backend_Failed:                 return "MAE_Backend_Failed";
+        case MAE_Backend_Connection_Established: return "MAE_Backend_Connection_Established";
+        case MAE_Backend_Connection_Lost:        return "MAE_Backend_Connection_Lost";
+        case MAE_Data_Sent_To_Backend:           return "MAE_Data_Sent_To_Backend";
+        case MAE_Enter_Sleep_Mode:               return "MAE_Enter_Sleep_Mode";
+        case MAE_Sensor_Data_Ready:              return "MAE_Sensor_Data_Ready";
+        case MAE_Timeout:                        return "MAE_Timeout";
+        case MAE_Upload_Not_Due:                 return "MAE_Upload_Not_Due";
+        default:                                 return "UNKNOWN MAE";
+    }
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file    main_app_sm.h
+  * @author  The Embedded Dude
+  * @brief   Main App state machine (MAS) states, events and transition table
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The module has no dependencies to ESP-IDF or FreeRTOS and can be built
+       on the host to unit test the transition table.
+       ESP-NOW transitions are selected by CONFIG_APP_DEEP_SLEEP_ESP_NOW or
+       CONFIG_APP_LIGHT_SLEEP_ESP_NOW. On the host define them via compiler flags.
+    2. MAS_Handle_Transition(..) returns the next state for a state/event pair.
+       If no transition is defined the current state is returned.
+    3. MAS_State_to_str(..) and MAS_Event_to_str(..) translate states and events
+       into strings for logging.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef MAIN_APP_SM_H_
+#define MAIN_APP_SM_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Exported types ------------------------------------------------------------*/
+/// @brief Main App State machine states (MAS)
+typedef enum
+{
+    MAS_Init_Sys          = 0,
+    MAS_Not_Connected     = 1,          //!< System is initialized but Wi-Fi is not connected. Try to connect to AP.
+    MAS_WiFi_Connected    = 2,          //!< Wi-Fi connected. IP addr received. Try to connect to backend.
+    MAS_Backend_Connected = 3,          //!< Backend connected. Try to publish data.
+    MAS_Data_Published    = 4,          //!< All data has been sent to backend. Prepare for sleep
+    MAS_Sleep             = 5,          //!< Go to sleep depending configuration. Handle wake from auto light sleep.
+    MAS_Error             = 6,          //!< We could not recover from a situation.
+    MAS_Store_Sample      = 7,          //!< Radio is off. Store or check the sample. Back to deep sleep unless a report is due.
+
+    MAS_Num_States                      //!< Number of states. Must be the last entry
+
+} MainApp_State;
+
+/// @brief Main App state machine events (MAE)
+typedef enum
+{
+    MAE_Sys_Init_Done,                  //!< System init after boot done
+    MAE_Sys_Init_Failed,                //!< System init failed
+    MAE_Sensor_Read_Failed,             //!< Sensor data could not be read
+    MAE_WiFi_Failed,                    //!< WiFi connection could not be established
+    MAE_WiFi_Connection_Established,    //!< Wi-Fi connected. IP addr received
+    MAE_WiFi_Connection_Lost,           //!< Wi-Fi connection lost - not intended
+    MAE_Backend_Failed,                 //!< Connection or reporting to backend failed
+    MAE_Backend_Connection_Established, //!< Backend connection established
+    MAE_Backend_Connection_Lost,        //!< Backend connection lost - not intended
+    MAE_Data_Sent_To_Backend,           //!< All data has been sent to backend. Event data: 1 if acked, 0 on timeout or send failure
+    MAE_Enter_Sleep_Mode,               //!< Enter the sleep state. Event data: sleep time in seconds
+    MAE_Sensor_Data_Ready,              //!< Sensor task finished the sample of this wake cycle
+    MAE_Timeout,                        //!< Timeout armed by the current state handler expired
+    MAE_Upload_Not_Due,                 //!< System init done without the radio. The sample decides if a report is due
+
+    MAE_Num_Events                      //!< Number of events. Must be the last entry
+
+} MainApp_Event;
+
+/// @brief One row of the transition table
+typedef struct MAS_TRANSITION_t
+{
+    MainApp_State CurrentState;         //!< State the transition starts from
+    MainApp_Event Event;                //!< Event that triggers the transition
+    MainApp_State NextState;            //!< State after the transition
+
+} MAS_TRANSITION_t;
+
+
+/* Exported constants --------------------------------------------------------*/
+extern const MAS_TRANSITION_t MAS_TransitionTable[];
+extern const size_t           MAS_TransitionTableSize;
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+
+/* Exported functions --------------------------------------------------------*/
+MainApp_State MAS_Handle_Transition(MainApp_State currentState, MainApp_Event event);
+const char *MAS_State_to_str(MainApp_State state);
+const char *MAS_Event_to_str(MainApp_Event event);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_APP_SM_H_ */
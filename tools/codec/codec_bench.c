@@ -0,0 +1,296 @@
+/**
+  ******************************************************************************
+  * @file    codec_bench.c
+  * @author  The Embedded Dude
+  * @brief   Host benchmark of the payload encodings.
+  *          Compares encode time and size of the per-topic strings, the CSV/JSON
+  *          report and the CBOR report (MOD_Codec) plus the raw and the CBOR
+  *          ESP-NOW frame.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. cmake -S tools/codec -B build_codec && cmake --build build_codec
+    2. ./build_codec/codec_bench [iterations]
+       Prints payload bytes, MQTT PUBLISH bytes (QoS 1, default topics) and
+       ns per encode for each encoding.
+    3. ./build_codec/codec_bench --hex | python3 tools/codec/codec_decode.py --hex -
+       Prints one CBOR report and one CBOR ESP-NOW frame as hex and decodes them.
+    4. Host timings only show the relation between the encodings. The float
+       formatting of newlib on the RISC-V target (no FPU) is far slower.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mod_codec.h"
+#include "mod_backend_report.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+/// @brief One encoding under test. Returns the payload bytes and adds the MQTT PUBLISH bytes to *pu32_Wire
+typedef int (*fp_Encode)(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire);
+
+typedef struct BENCH_ENC_t
+{
+    const char *pName;
+    fp_Encode   Encode;
+
+}BENCH_ENC_t;
+
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_REPORTS               256         //!< Different reports encoded in turn
+#define BENCH_ITERATIONS            200000      //!< Default number of encodes per encoding
+#define BENCH_SAMPLES               6           //!< Stored samples in the ESP-NOW frame (CONFIG_APP_BATCH_SAMPLES)
+#define BENCH_BUFFER_SIZE           250         //!< ESP_NOW_MAX_DATA_LEN
+
+/*Default topics of mod_backend.c: CONFIG_APP_MQTT_DEVICE_LOCATION "/" CONFIG_APP_MQTT_DEVICE_ID "/..."*/
+#define BENCH_TOPIC_PREFIX          "Office/myMQTT_DeviceID/"
+#define BENCH_MQTT_PUBLISH_HDR      6           //!< Fixed header (2), topic length (2) and packet ID (2) of a QoS 1 PUBLISH
+
+
+/* Private macro -------------------------------------------------------------*/
+#define BENCH_PUBLISH_BYTES(topic, len)  (BENCH_MQTT_PUBLISH_HDR + sizeof(BENCH_TOPIC_PREFIX topic) - 1 + (uint32_t)(len))
+
+
+/* Private constants ---------------------------------------------------------*/
+
+
+/* Private variables ---------------------------------------------------------*/
+static BACKEND_REPORT_t Reports[BENCH_REPORTS];
+
+
+/* Private function prototypes -----------------------------------------------*/
+static int bench_EncodePerTopic(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire);
+static int bench_EncodeCSV(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire);
+static int bench_EncodeJSON(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire);
+static int bench_EncodeCBOR(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire);
+static int bench_EncodeEspNowRaw(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire);
+static int bench_EncodeEspNowCBOR(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire);
+static void bench_PrintHex(const uint8_t *pu8_Data, int s32_Len);
+static float bench_Rand(float f_Min, float f_Max);
+
+static const BENCH_ENC_t Encodings[] =
+{
+    { "mqtt per topic (legacy)", bench_EncodePerTopic   },
+    { "mqtt report CSV",         bench_EncodeCSV        },
+    { "mqtt report JSON",        bench_EncodeJSON       },
+    { "mqtt report CBOR",        bench_EncodeCBOR       },
+    { "esp-now raw (legacy)",    bench_EncodeEspNowRaw  },
+    { "esp-now CBOR",            bench_EncodeEspNowCBOR },
+};
+
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    uint8_t  au8_Buffer[BENCH_BUFFER_SIZE];
+    uint32_t u32_Iterations = BENCH_ITERATIONS;
+    uint32_t u32_Wire;
+    uint32_t u32_Sink = 0;
+    struct timespec Start, End;
+
+    srand(1);
+    for(int i = 0; i < BENCH_REPORTS; i++)
+    {
+        Reports[i].f_Temp_C     = bench_Rand(-10.0f, 40.0f);
+        Reports[i].f_Humi_PCT   = bench_Rand(10.0f, 95.0f);
+        Reports[i].f_Light_Lux  = bench_Rand(0.0f, 2000.0f);
+        Reports[i].f_Report_uAh = bench_Rand(5.0f, 80.0f);
+        Reports[i].f_Total_uAh  = bench_Rand(0.0f, 500000.0f);
+        Reports[i].s8_RSSI_dBm  = (int8_t)(bench_Rand(-90.0f, -30.0f));
+        Reports[i].u8_Fields    = BACKEND_REPORT_HAS_RSSI;
+    }
+
+    if(argc > 1 && strcmp(argv[1], "--hex") == 0)
+    {
+        bench_PrintHex(au8_Buffer, bench_EncodeCBOR(&Reports[0], au8_Buffer, sizeof(au8_Buffer), &u32_Wire));
+        bench_PrintHex(au8_Buffer, bench_EncodeEspNowCBOR(&Reports[0], au8_Buffer, sizeof(au8_Buffer), &u32_Wire));
+        return 0;
+    }
+
+    if(argc > 1)
+        u32_Iterations = (uint32_t)(strtoul(argv[1], NULL, 0));
+
+    printf("%-24s %8s %8s %10s\n", "encoding", "payload", "publish", "ns/encode");
+
+    for(size_t e = 0; e < sizeof(Encodings) / sizeof(Encodings[0]); e++)
+    {
+        uint32_t u32_Payload = 0;
+        uint32_t u32_WireTotal = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &Start);
+        for(uint32_t i = 0; i < u32_Iterations; i++)
+        {
+            u32_Wire = 0;
+            int s32_Len = Encodings[e].Encode(&Reports[i % BENCH_REPORTS], au8_Buffer, sizeof(au8_Buffer), &u32_Wire);
+
+            u32_Payload   += (uint32_t)(s32_Len);
+            u32_WireTotal += u32_Wire;
+            u32_Sink      += au8_Buffer[0];
+        }
+        clock_gettime(CLOCK_MONOTONIC, &End);
+
+        double d_ns = (double)(End.tv_sec - Start.tv_sec) * 1e9 + (double)(End.tv_nsec - Start.tv_nsec);
+
+        printf("%-24s %8.1f %8.1f %10.1f\n", Encodings[e].pName, (double)(u32_Payload) / u32_Iterations,
+               (double)(u32_WireTotal) / u32_Iterations, d_ns / u32_Iterations);
+    }
+
+    printf("(publish: bytes of all MQTT PUBLISH packets. ESP-NOW frames with %d stored samples. sink %u)\n", BENCH_SAMPLES, u32_Sink & 1);
+
+    return 0;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief Backend_PublishData(..) with CONFIG_APP_MQTT_PAYLOAD_PER_TOPIC: s32_Convert*_f_to_str(..) and four publishes
+static int bench_EncodePerTopic(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire)
+{
+    char  *str_Data = (char*)(pu8_Buffer);
+    size_t DataLen  = (Size < 24) ? Size : 24;          /*BACKEND_MESSAGE_t::str_Data*/
+    int    s32_Len;
+    int    s32_Total = 0;
+
+    s32_Len    = snprintf(str_Data, DataLen, "%.2f", pReport->f_Temp_C);
+    *pu32_Wire += BENCH_PUBLISH_BYTES("AmbientTempCel", s32_Len);
+    s32_Total  += s32_Len;
+
+    s32_Len    = snprintf(str_Data, DataLen, "%0.2f", pReport->f_Humi_PCT);
+    *pu32_Wire += BENCH_PUBLISH_BYTES("Humidity", s32_Len);
+    s32_Total  += s32_Len;
+
+    s32_Len    = snprintf(str_Data, DataLen, "%0.2f", pReport->f_Light_Lux);
+    *pu32_Wire += BENCH_PUBLISH_BYTES("Light", s32_Len);
+    s32_Total  += s32_Len;
+
+    s32_Len    = snprintf(str_Data, DataLen, "%.1f,%.0f", pReport->f_Report_uAh, pReport->f_Total_uAh);
+    *pu32_Wire += BENCH_PUBLISH_BYTES("Energy", s32_Len);
+    s32_Total  += s32_Len;
+
+    return s32_Total;
+}
+
+static int bench_EncodeCSV(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire)
+{
+    int s32_Len = backend_report_Encode(pReport, BACKEND_REPORT_ENC_CSV, (char*)(pu8_Buffer), Size);
+
+    *pu32_Wire += BENCH_PUBLISH_BYTES("Report", s32_Len);
+    return s32_Len;
+}
+
+static int bench_EncodeJSON(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire)
+{
+    int s32_Len = backend_report_Encode(pReport, BACKEND_REPORT_ENC_JSON, (char*)(pu8_Buffer), Size);
+
+    *pu32_Wire += BENCH_PUBLISH_BYTES("Report", s32_Len);
+    return s32_Len;
+}
+
+static int bench_EncodeCBOR(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire)
+{
+    int s32_Len = backend_report_Encode(pReport, BACKEND_REPORT_ENC_CBOR, (char*)(pu8_Buffer), Size);
+
+    *pu32_Wire += BENCH_PUBLISH_BYTES("Report", s32_Len);
+    return s32_Len;
+}
+
+/// @brief EspNow_AddData(..) of main.c with CONFIG_APP_ESPNOW_PAYLOAD_RAW: floats and SAMPLE_RECORD_t (16 bytes)
+static int bench_EncodeEspNowRaw(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire)
+{
+    size_t Len = 5 * sizeof(float);
+
+    (void)Size;
+    (void)pu32_Wire;
+
+    memcpy(pu8_Buffer, pReport, Len);           /*The 5 floats at the start of BACKEND_REPORT_t*/
+
+    for(int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        uint32_t u32_Time_s = 1000 + i * 600;
+
+        memcpy(&pu8_Buffer[Len], &u32_Time_s, sizeof(u32_Time_s));
+        memcpy(&pu8_Buffer[Len + 4], pReport, 3 * sizeof(float));
+        Len += 16;
+    }
+
+    return (int)(Len);
+}
+
+/// @brief EspNow_AddData(..) of main.c with CONFIG_APP_ESPNOW_PAYLOAD_CBOR
+static int bench_EncodeEspNowCBOR(const BACKEND_REPORT_t *pReport, uint8_t *pu8_Buffer, size_t Size, uint32_t *pu32_Wire)
+{
+    CODEC_WRITER_t Writer;
+
+    (void)pu32_Wire;
+
+    codec_Init(&Writer, pu8_Buffer, Size);
+    codec_MapBegin(&Writer, 6);
+    codec_PutValue(&Writer, CODEC_KEY_TEMP_C,     pReport->f_Temp_C);
+    codec_PutValue(&Writer, CODEC_KEY_HUMI_PCT,   pReport->f_Humi_PCT);
+    codec_PutValue(&Writer, CODEC_KEY_LIGHT_LUX,  pReport->f_Light_Lux);
+    codec_PutValue(&Writer, CODEC_KEY_REPORT_UAH, pReport->f_Report_uAh);
+    codec_PutValue(&Writer, CODEC_KEY_TOTAL_UAH,  pReport->f_Total_uAh);
+    codec_PutKey(&Writer, CODEC_KEY_SAMPLES);
+    codec_ArrayBeginIndef(&Writer);
+
+    for(int i = BENCH_SAMPLES - 1; i >= 0; i--)
+        codec_PutSample(&Writer, (uint32_t)(i * 600), pReport->f_Temp_C, pReport->f_Humi_PCT, pReport->f_Light_Lux);
+
+    codec_Break(&Writer);
+
+    return codec_Len(&Writer);
+}
+
+static void bench_PrintHex(const uint8_t *pu8_Data, int s32_Len)
+{
+    for(int i = 0; i < s32_Len; i++)
+        printf("%02x", pu8_Data[i]);
+
+    printf("\n");
+}
+
+static float bench_Rand(float f_Min, float f_Max)
+{
+    return f_Min + (f_Max - f_Min) * ((float)(rand()) / (float)(RAND_MAX));
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Decodes the CBOR payloads of MOD_Codec (MQTT report, stored reports, ESP-NOW frame).
+
+Keys and scale factors are taken from CODEC_SCHEMA in mod_codec.h, so the
+decoder stays in sync with the firmware. Unknown keys are printed raw.
+
+    python3 tools/codec/codec_decode.py report.bin
+    python3 tools/codec/codec_decode.py --hex a600190c81...
+    mosquitto_sub -t Office/myMQTT_DeviceID/Report -C 1 | python3 tools/codec/codec_decode.py -
+    ./build_codec/codec_bench --hex | python3 tools/codec/codec_decode.py --hex -
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+REPO_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+CODEC_H = os.path.join(REPO_DIR, "components", "MOD_Codec", "mod_codec.h")
+
+BREAK = object()
+
+
+def parse_schema(path):
+    """Returns {CBOR key: (name, scale)} of the X(key, id, scale, name) entries of CODEC_SCHEMA"""
+    text = open(path).read()
+    return {int(key): (name, int(scale))
+            for key, scale, name in re.findall(r"X\(\s*\w+\s*,\s*(\d+)\s*,\s*(\d+)\s*,\s*\"(\w+)\"\s*\)", text)}
+
+
+class CborReader:
+    """Minimal CBOR (RFC 8949) decoder for the subset written by mod_codec.c plus floats, strings and tags"""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise ValueError("payload truncated at byte %d" % self.pos)
+        self.pos += 1
+        return self.data[self.pos - 1]
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise ValueError("payload truncated at byte %d" % self.pos)
+        self.pos += n
+        return self.data[self.pos - n:self.pos]
+
+    def argument(self, info):
+        if info < 24:
+            return info
+        if info in (24, 25, 26, 27):
+            return int.from_bytes(self.take(1 << (info - 24)), "big")
+        if info == 31:
+            return None                                 # indefinite length
+        raise ValueError("invalid additional info %d at byte %d" % (info, self.pos - 1))
+
+    def item(self):
+        initial = self.byte()
+        major, info = initial >> 5, initial & 0x1F
+
+        if initial == 0xFF:
+            return BREAK
+        if major == 7:
+            if info == 25:
+                return struct.unpack(">e", self.take(2))[0]
+            if info == 26:
+                return struct.unpack(">f", self.take(4))[0]
+            if info == 27:
+                return struct.unpack(">d", self.take(8))[0]
+            return {20: False, 21: True, 22: None, 23: None}.get(info, "simple(%d)" % info)
+
+        arg = self.argument(info)
+        if major == 0:
+            return arg
+        if major == 1:
+            return -1 - arg
+        if major in (2, 3):
+            raw = self.take(arg) if arg is not None else b"".join(iter(self.item, BREAK))
+            return raw.decode(errors="replace") if major == 3 else raw.hex()
+        if major == 4:
+            return list(iter(self.item, BREAK)) if arg is None else [self.item() for _ in range(arg)]
+        if major == 5:
+            pairs = {}
+            while arg is None or len(pairs) < arg:
+                key = self.item()
+                if key is BREAK:
+                    break
+                pairs[key] = self.item()
+            return pairs
+        return {"tag": arg, "value": self.item()}
+
+
+class Decoder:
+    def __init__(self):
+        self.schema = parse_schema(CODEC_H)
+        self.scale = {name: scale for name, scale in self.schema.values()}
+
+    def value(self, name, raw):
+        scale = self.scale.get(name, 0)
+        if raw is None or scale <= 1 or not isinstance(raw, int):
+            return raw
+        return round(raw / scale, len(str(scale)) - 1)
+
+    def samples(self, items):
+        out = []
+        for item in items:
+            age, temp, humi, lux = (list(item) + [None] * 4)[:4]
+            out.append({"age_s": age, "temp_C": self.value("temp_C", temp),
+                        "humi_pct": self.value("humi_pct", humi), "lux": self.value("lux", lux)})
+        return out
+
+    def report(self, item):
+        if not isinstance(item, dict):
+            raise ValueError("not a MOD_Codec payload: item is %s" % type(item).__name__)
+
+        result = {}
+        for key, raw in item.items():
+            name, scale = self.schema.get(key, ("key_%s" % key, 1))
+            result[name] = self.samples(raw) if name == "samples" else self.value(name, raw)
+        return result
+
+    def decode(self, blob):
+        reader = CborReader(blob)
+        top = reader.item()
+
+        # The Stored topic carries an array of reports from the flash queue
+        if isinstance(top, list):
+            result = {"stored": [self.report(item) for item in top]}
+        else:
+            result = self.report(top)
+
+        if reader.pos != len(blob):
+            result["trailing_bytes"] = len(blob) - reader.pos
+        result["payload_bytes"] = reader.pos
+        return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode CBOR payloads of MOD_Codec")
+    parser.add_argument("input", help="binary payload file, hex string with --hex, - for stdin")
+    parser.add_argument("--hex", action="store_true", help="input is hex, one payload per line")
+    args = parser.parse_args()
+
+    decoder = Decoder()
+
+    if args.hex:
+        text = sys.stdin.read() if args.input == "-" else (open(args.input).read() if os.path.isfile(args.input) else args.input)
+        blobs = [bytes.fromhex(line.strip()) for line in text.splitlines() if line.strip()]
+    else:
+        stream = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+        blobs = [stream.read()]
+
+    for blob in blobs:
+        print(json.dumps(decoder.decode(blob)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,541 @@
+/**
+  ******************************************************************************
+  * @file    evd_test.c
+  * @author  The Embedded Dude
+  * @brief   Host test of the event dispatcher lanes and overflow policy.
+  *          Events are posted while the dispatcher task is stopped. The task
+  *          then runs until all lanes are empty and the dispatch order is
+  *          compared against the expected one.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. cmake -S tools/event_dispatcher -B build_evd && cmake --build build_evd
+    2. ctest --test-dir build_evd --output-on-failure
+    3. ./build_evd/evd_test -v prints the dispatcher log and every dispatched
+       event.
+    4. Only the FreeRTOS and esp_timer functions used by mod_eventDispatcher.c
+       are faked below. If the dispatcher starts using another one, add it here.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <setjmp.h>
+#include <stdarg.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "mod_eventDispatcher.h"
+#include "app_events.h"
+#include "mod_flight_rec.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+/// @brief One dispatched event
+typedef struct
+{
+    esp_event_base_t Base;
+    int32_t          s32_EventID;
+    uint32_t         u32_Data;                  //!< First 4 bytes of the event data, 0 without data
+
+}EVD_RECORD_t;
+
+
+/// @brief Event to post or expected to be dispatched
+typedef struct
+{
+    const esp_event_base_t *pBase;              //!< The bases are not constant expressions
+    int32_t           s32_EventID;
+
+}EVD_EVENT_t;
+
+
+/// @brief Queue fake. Only the pool index queue of the dispatcher is needed.
+struct sim_queue
+{
+    uint8_t     au8[MOD_EVENT_DISP_POOL_SIZE * sizeof(uint32_t)];
+    UBaseType_t uxItemSize;
+    UBaseType_t uxLength;
+    UBaseType_t uxHead;
+    UBaseType_t uxCnt;
+};
+
+
+struct sim_task
+{
+    TaskFunction_t pxTaskCode;
+};
+
+
+/* Private define ------------------------------------------------------------*/
+#define EVD_MAX_RECORDS     32
+#define EVD_CNT(a)          (sizeof(a) / sizeof((a)[0]))
+
+
+/* Private variables ---------------------------------------------------------*/
+static bool             b_Verbose = false;
+static int64_t          s64_Now_us;
+static struct sim_queue Queue;
+static struct sim_task  Task;
+static jmp_buf          TaskIdle;       /*Dispatcher task waits for the next notification*/
+static uint32_t         u32_Notified;
+static EVD_RECORD_t     Records[EVD_MAX_RECORDS];
+static uint32_t         u32_RecordCnt;
+static bool             b_InTask;       /*Dispatcher task is running*/
+static EVENT_DISP_HANDLE_t Unregistered;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void Handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+static void Post(const EVD_EVENT_t *pEvents, size_t Cnt);
+static void RunDispatcher(void);
+static int  Check(const char *pc_Name, const EVD_EVENT_t *pExpected, size_t Cnt);
+static int  Test_LinkState(void);
+static int  Test_Overflow(void);
+static int  Test_Coalesce(void);
+static int  Test_Unregister(void);
+static void Handler_Unregister(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data);
+
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    int s32_Errors = 0;
+
+    b_Verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+
+    EventDispatcher_Start();
+    EventDispatcher_RegisterEventHandler(MOD_WIFI_EVENTS,    ESP_EVENT_ANY_ID, Handler, NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_BACKEND_EVENTS, ESP_EVENT_ANY_ID, Handler, NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_POWER_EVENTS,   ESP_EVENT_ANY_ID, Handler, NULL, NULL);
+    EventDispatcher_RegisterEventHandler(MOD_ESPNOW_EVENTS,  ESP_EVENT_ANY_ID, Handler, NULL, NULL);
+
+    s32_Errors += Test_LinkState();
+    s32_Errors += Test_Overflow();
+    s32_Errors += Test_Coalesce();
+    s32_Errors += Test_Unregister();
+
+    printf("%s: %d errors\n", (s32_Errors == 0) ? "PASS" : "FAIL", s32_Errors);
+
+    return (s32_Errors == 0) ? 0 : 1;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief Link state events of a base must be dispatched in post order, the latest state last
+/// @return Number of errors
+static int Test_LinkState(void)
+{
+    int s32_Errors = 0;
+
+    //Wi-Fi connects and is lost again before the dispatcher runs
+    {
+        const EVD_EVENT_t Posted[]   = { { &MOD_WIFI_EVENTS, WIFI_CONNECTED_EVENT }, { &MOD_WIFI_EVENTS, WIFI_DISCONNECTED_EVENT } };
+        const EVD_EVENT_t Expected[] = { { &MOD_WIFI_EVENTS, WIFI_DISCONNECTED_EVENT } };
+
+        Post(Posted, EVD_CNT(Posted));
+        RunDispatcher();
+        s32_Errors += Check("wifi connected, disconnected", Expected, EVD_CNT(Expected));
+    }
+
+    //Reconnect after a loss
+    {
+        const EVD_EVENT_t Posted[]   = { { &MOD_WIFI_EVENTS, WIFI_DISCONNECTED_EVENT }, { &MOD_WIFI_EVENTS, WIFI_CONNECTED_EVENT } };
+        const EVD_EVENT_t Expected[] = { { &MOD_WIFI_EVENTS, WIFI_CONNECTED_EVENT } };
+
+        Post(Posted, EVD_CNT(Posted));
+        RunDispatcher();
+        s32_Errors += Check("wifi disconnected, connected", Expected, EVD_CNT(Expected));
+    }
+
+    //Routine events of the base stay queued, link states of other bases keep their order
+    {
+        const EVD_EVENT_t Posted[]   = { { &MOD_BACKEND_EVENTS, BACKEND_ALL_MSGS_ACKED }, { &MOD_BACKEND_EVENTS, BACKEND_CONNECTED_EVENT },
+                                         { &MOD_WIFI_EVENTS, WIFI_DISCONNECTED_EVENT },   { &MOD_BACKEND_EVENTS, BACKEND_DISCONNECTED_EVENT } };
+        const EVD_EVENT_t Expected[] = { { &MOD_WIFI_EVENTS, WIFI_DISCONNECTED_EVENT },   { &MOD_BACKEND_EVENTS, BACKEND_DISCONNECTED_EVENT },
+                                         { &MOD_BACKEND_EVENTS, BACKEND_ALL_MSGS_ACKED } };
+
+        Post(Posted, EVD_CNT(Posted));
+        RunDispatcher();
+        s32_Errors += Check("backend connected, wifi and backend disconnected", Expected, EVD_CNT(Expected));
+    }
+
+    return s32_Errors;
+}
+
+
+/// @brief Only droppable events are taken over if the pool is full
+/// @return Number of errors
+static int Test_Overflow(void)
+{
+    int s32_Errors = 0;
+    EVD_EVENT_t Posted[MOD_EVENT_DISP_POOL_SIZE];
+    EVD_EVENT_t Expected[MOD_EVENT_DISP_POOL_SIZE];
+    EVENT_DISP_STATS_t Before;
+    EVENT_DISP_STATS_t After;
+
+    //One droppable event, the rest carries a state
+    Posted[0] = (EVD_EVENT_t){ &MOD_BACKEND_EVENTS, BACKEND_SEND_MESSAGE_DONE };
+    for(size_t i = 1; i < EVD_CNT(Posted); i++)
+    {
+        Posted[i]       = (EVD_EVENT_t){ &MOD_BACKEND_EVENTS, BACKEND_ALL_MSGS_ACKED };
+        Expected[i - 1] = Posted[i];
+    }
+    Expected[EVD_CNT(Expected) - 1] = (EVD_EVENT_t){ &MOD_ESPNOW_EVENTS, ESPNOW_DATA_SENT };
+
+    EventDispatcher_GetStats(&Before);
+    Post(Posted, EVD_CNT(Posted));
+
+    if(EventDispatcher_TryPostEvent(MOD_ESPNOW_EVENTS, ESPNOW_DATA_SENT, NULL, 0, EVENT_DISP_DROP_OLDEST) != ESP_OK)
+    {
+        printf("FAIL overflow: droppable event has not been taken over\n");
+        s32_Errors++;
+    }
+
+    if(EventDispatcher_TryPostEvent(MOD_ESPNOW_EVENTS, ESPNOW_DATA_SENT_FAILED, NULL, 0, EVENT_DISP_DROP_OLDEST) != ESP_ERR_NO_MEM)
+    {
+        printf("FAIL overflow: event carrying a state has been taken over\n");
+        s32_Errors++;
+    }
+
+    RunDispatcher();
+    s32_Errors += Check("overflow", Expected, EVD_CNT(Expected));
+
+    EventDispatcher_GetStats(&After);
+    if(After.u32_Dropped - Before.u32_Dropped != 2)
+    {
+        printf("FAIL overflow: %lu events counted as dropped, expected 2\n", (unsigned long)(After.u32_Dropped - Before.u32_Dropped));
+        s32_Errors++;
+    }
+
+    return s32_Errors;
+}
+
+
+/// @brief A coalesced event carries the data of the latest post and waits since the first post
+/// @return Number of errors
+static int Test_Coalesce(void)
+{
+    const EVD_EVENT_t Expected[] = { { &MOD_POWER_EVENTS, PWR_GO_TO_SLEEP } };
+    EVENT_DISP_EVENT_STATS_t Event;
+    int s32_Errors = 0;
+
+    u32_RecordCnt = 0;
+    for(uint32_t u32_SleepSec = 10; u32_SleepSec <= 30; u32_SleepSec += 10)
+    {
+        EventDispatcher_TryPostEvent(MOD_POWER_EVENTS, PWR_GO_TO_SLEEP, &u32_SleepSec, sizeof(u32_SleepSec), EVENT_DISP_DROP_NEWEST);
+        s64_Now_us += 1000;
+    }
+
+    RunDispatcher();
+    s32_Errors += Check("coalesce", Expected, EVD_CNT(Expected));
+
+    if(u32_RecordCnt > 0 && Records[0].u32_Data != 30)
+    {
+        printf("FAIL coalesce: sleep time %lu, expected 30\n", (unsigned long)(Records[0].u32_Data));
+        s32_Errors++;
+    }
+
+    for(uint32_t u32_Idx = 0; EventDispatcher_GetEventStats(u32_Idx, &Event); u32_Idx++)
+    {
+        if(Event.Base == MOD_POWER_EVENTS && Event.s32_EventID == PWR_GO_TO_SLEEP && Event.u32_MaxWait_us != 3000)
+        {
+            printf("FAIL coalesce: waited %lu us, expected 3000 us since the first post\n", (unsigned long)(Event.u32_MaxWait_us));
+            s32_Errors++;
+        }
+    }
+
+    return s32_Errors;
+}
+
+
+/// @brief A handler unregistered by another handler of the same event is not called anymore
+/// @return Number of errors
+static int Test_Unregister(void)
+{
+    const EVD_EVENT_t Posted[]   = { { &MOD_ESPNOW_EVENTS, ESPNOW_DATA_SENT_FAILED } };
+    const EVD_EVENT_t Expected[] = { { &MOD_ESPNOW_EVENTS, ESPNOW_DATA_SENT_FAILED } };
+    EVENT_DISP_HANDLE_t First;
+    int s32_Errors = 0;
+
+    //Handler_Unregister runs first and unregisters the second handler of the event
+    EventDispatcher_RegisterEventHandler(MOD_ESPNOW_EVENTS, ESPNOW_DATA_SENT_FAILED, Handler_Unregister, NULL, &First);
+    EventDispatcher_RegisterEventHandler(MOD_ESPNOW_EVENTS, ESPNOW_DATA_SENT_FAILED, Handler,            NULL, &Unregistered);
+
+    Post(Posted, EVD_CNT(Posted));
+    RunDispatcher();
+
+    //Only the handler registered for all events of the base is left
+    s32_Errors += Check("unregister while dispatching", Expected, EVD_CNT(Expected));
+
+    EventDispatcher_UnregisterEventHandler(&First);
+    if(First != NULL || Unregistered != NULL)
+    {
+        printf("FAIL unregister: handle not cleared\n");
+        s32_Errors++;
+    }
+
+    return s32_Errors;
+}
+
+
+/// @brief Unregisters the handler of Test_Unregister()
+static void Handler_Unregister(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+{
+    EventDispatcher_UnregisterEventHandler(&Unregistered);
+}
+
+
+/// @brief Records every dispatched event
+static void Handler(void* handler_args, esp_event_base_t base, int32_t s32_EventID, void* event_data)
+{
+    if(u32_RecordCnt < EVD_MAX_RECORDS)
+    {
+        Records[u32_RecordCnt].Base        = base;
+        Records[u32_RecordCnt].s32_EventID = s32_EventID;
+        Records[u32_RecordCnt].u32_Data    = 0;
+        if(event_data != NULL)
+            memcpy(&Records[u32_RecordCnt].u32_Data, event_data, sizeof(uint32_t));
+    }
+    u32_RecordCnt++;
+
+    if(b_Verbose == true)
+        printf("     dispatched %s\n", app_event_to_str(base, s32_EventID));
+}
+
+
+/// @brief        Post events without data while the dispatcher task is stopped
+/// @param pEvents Events
+/// @param Cnt     Number of events
+static void Post(const EVD_EVENT_t *pEvents, size_t Cnt)
+{
+    u32_RecordCnt = 0;
+
+    for(size_t i = 0; i < Cnt; i++)
+    {
+        EventDispatcher_TryPostEvent(*pEvents[i].pBase, pEvents[i].s32_EventID, NULL, 0, EVENT_DISP_DROP_NEWEST);
+        s64_Now_us += 1000;
+    }
+}
+
+
+/// @brief Runs the dispatcher task until it waits for the next notification
+static void RunDispatcher(void)
+{
+    if(u32_Notified == 0)
+        return;
+
+    u32_Notified = 0;
+
+    b_InTask = true;
+    if(setjmp(TaskIdle) == 0)
+        Task.pxTaskCode(NULL);
+    b_InTask = false;
+}
+
+
+/// @brief           Compares the dispatched events against the expected ones
+/// @param pc_Name   Name of the test case
+/// @param pExpected Expected events in dispatch order
+/// @param Cnt       Number of expected events
+/// @return          0 on success, 1 on mismatch
+static int Check(const char *pc_Name, const EVD_EVENT_t *pExpected, size_t Cnt)
+{
+    bool b_Match = (u32_RecordCnt == Cnt);
+
+    for(size_t i = 0; b_Match && i < Cnt; i++)
+    {
+        b_Match = (Records[i].Base == *pExpected[i].pBase) && (Records[i].s32_EventID == pExpected[i].s32_EventID);
+    }
+
+    if(b_Match == false)
+    {
+        printf("FAIL %s: dispatched", pc_Name);
+        for(uint32_t i = 0; i < u32_RecordCnt && i < EVD_MAX_RECORDS; i++)
+            printf(" [%s]", app_event_to_str(Records[i].Base, Records[i].s32_EventID));
+        printf(", expected");
+        for(size_t i = 0; i < Cnt; i++)
+            printf(" [%s]", app_event_to_str(*pExpected[i].pBase, pExpected[i].s32_EventID));
+        printf("\n");
+        return 1;
+    }
+
+    if(b_Verbose == true)
+        printf("ok   %s\n", pc_Name);
+
+    return 0;
+}
+
+
+/* Fakes of the IDF and FreeRTOS functions used by the dispatcher -------------*/
+int64_t esp_timer_get_time(void)
+{
+    return s64_Now_us;
+}
+
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    va_list args;
+
+    if(b_Verbose == false)
+        return;
+
+    va_start(args, format);
+    printf("     %s: ", tag);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return (code == ESP_OK) ? "ESP_OK" : "ESP_ERR";
+}
+
+
+void sim_error_check_failed(esp_err_t rc, const char *file, int line, const char *function, const char *expression)
+{
+    printf("FAIL %s:%d %s: %s = 0x%x\n", file, line, function, expression, rc);
+    exit(1);
+}
+
+
+void mod_frec_Event(uint8_t u8_Base, int32_t s32_EventID, const void *pData, size_t DataSize)
+{
+}
+
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    if(uxQueueLength * uxItemSize > sizeof(Queue.au8))
+        return NULL;
+
+    Queue.uxItemSize = uxItemSize;
+    Queue.uxLength   = uxQueueLength;
+
+    return &Queue;
+}
+
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    if(xQueue->uxCnt == xQueue->uxLength)
+        return pdFALSE;
+
+    memcpy(&xQueue->au8[((xQueue->uxHead + xQueue->uxCnt) % xQueue->uxLength) * xQueue->uxItemSize], pvItemToQueue, xQueue->uxItemSize);
+    xQueue->uxCnt++;
+
+    return pdTRUE;
+}
+
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    if(xQueue->uxCnt == 0)
+        return pdFALSE;     /*Nobody else runs, waiting would not help*/
+
+    memcpy(pvBuffer, &xQueue->au8[xQueue->uxHead * xQueue->uxItemSize], xQueue->uxItemSize);
+    xQueue->uxHead = (xQueue->uxHead + 1) % xQueue->uxLength;
+    xQueue->uxCnt--;
+
+    return pdTRUE;
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask)
+{
+    Task.pxTaskCode = pxTaskCode;
+    *pxCreatedTask  = &Task;
+
+    return pdPASS;
+}
+
+
+UBaseType_t uxTaskPriorityGet(const TaskHandle_t xTask)
+{
+    return 1;
+}
+
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+    return MOD_EVENT_DISP_STACK_SIZE;
+}
+
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return b_InTask ? &Task : NULL;
+}
+
+
+/// @note Nothing else runs. A task waiting for the dispatcher would wait forever.
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    printf("FAIL vTaskDelay(..) called, the dispatcher cannot make progress\n");
+    exit(1);
+}
+
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    u32_Notified++;
+
+    return pdPASS;
+}
+
+
+/// @note The dispatcher task takes the notification once per RunDispatcher(). The next wait stops it.
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    static bool b_Taken = false;
+
+    if(b_Taken == true)
+    {
+        b_Taken = false;
+        longjmp(TaskIdle, 1);
+    }
+
+    b_Taken = true;
+
+    return 1;
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Decodes the records of the flight recorder (MOD_FlightRec).
+
+Input is either the binary payload of the <location>/<device ID>/FlightRec topic
+or a log with the "FREC: <hex>" lines of mod_frec_Log() (ESP-NOW modes).
+Event, state and source names are taken from the firmware headers, so the
+decoder stays in sync with app_events.h and main_app_sm.h.
+
+    python3 tools/flight_recorder/frec_decode.py flightrec.bin
+    python3 tools/flight_recorder/frec_decode.py --log monitor.txt
+    mosquitto_sub -t Office/myMQTT_DeviceID/FlightRec -C 1 | python3 tools/flight_recorder/frec_decode.py -
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+REPO_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+APP_EVENTS_H = os.path.join(REPO_DIR, "components", "MOD_EventDispatcher", "app_events.h")
+MAIN_APP_SM_H = os.path.join(REPO_DIR, "main", "main_app_sm.h")
+FLIGHT_REC_H = os.path.join(REPO_DIR, "components", "MOD_FlightRec", "mod_flight_rec.h")
+
+EXPORT_HDR = struct.Struct("<2sBBHH")       # 'F','R', version, record size, count, lost
+RECORD = struct.Struct("<IBBHI")            # FREC_RECORD_t
+EXPORT_VERSION = 1
+
+# esp_reset_reason_t of ESP-IDF v5.2
+RESET_REASONS = ["UNKNOWN", "POWERON", "EXT", "SW", "PANIC", "INT_WDT", "TASK_WDT", "WDT",
+                 "DEEPSLEEP", "BROWNOUT", "SDIO", "USB", "JTAG", "EFUSE", "PWR_GLITCH", "CPU_LOCKUP"]
+
+ESP_ERRORS = {-1: "ESP_FAIL", 0x101: "ESP_ERR_NO_MEM", 0x102: "ESP_ERR_INVALID_ARG",
+              0x103: "ESP_ERR_INVALID_STATE", 0x105: "ESP_ERR_NOT_FOUND", 0x107: "ESP_ERR_TIMEOUT"}
+
+
+def strip_comments(text):
+    return re.sub(r"//[^\n]*|/\*.*?\*/", "", text, flags=re.S)
+
+
+def parse_enums(path):
+    """Returns {typedef name: {value: enumerator}} of all typedef enums in a header"""
+    enums = {}
+    text = strip_comments(open(path).read())
+
+    for body, name in re.findall(r"typedef\s+enum\s*\w*\s*\{(.*?)\}\s*(\w+)\s*;", text, flags=re.S):
+        values = {}
+        value = -1
+        for entry in body.split(","):
+            entry = entry.strip()
+            if not entry:
+                continue
+            if "=" in entry:
+                entry, init = (s.strip() for s in entry.split("=", 1))
+                value = int(init, 0)
+            else:
+                value += 1
+            values[value] = entry
+        enums[name] = values
+
+    return enums
+
+
+def parse_base_indices(path):
+    """Returns {base index: event enum} from the MOD_*_EVENTS_IDX defines of app_events.h"""
+    enums = parse_enums(path)
+    bases = {}
+
+    for base, idx in re.findall(r"#define\s+(MOD_\w+_EVENTS)_IDX\s+(\d+)", open(path).read()):
+        bases[int(idx)] = (base, enums.get(base + "_ENUM_t", {}))
+
+    return bases
+
+
+class Decoder:
+    def __init__(self):
+        frec = parse_enums(FLIGHT_REC_H)
+        main_app = parse_enums(MAIN_APP_SM_H)
+
+        self.types = frec["FREC_TYPE_ENUM_t"]
+        self.sources = frec["FREC_SRC_ENUM_t"]
+        self.states = main_app["MainApp_State"]
+        self.events = main_app["MainApp_Event"]
+        self.bases = parse_base_indices(APP_EVENTS_H)
+
+    @staticmethod
+    def name(table, value):
+        return table.get(value, str(value))
+
+    def describe(self, rec_type, src, rec_id, data):
+        signed = struct.unpack("<i", struct.pack("<I", data))[0]
+        kind = self.types.get(rec_type)
+
+        if kind == "FREC_TYPE_BOOT":
+            reason = RESET_REASONS[rec_id] if rec_id < len(RESET_REASONS) else str(rec_id)
+            return "BOOT    reset=ESP_RST_%s time=%us" % (reason, data)
+
+        if kind == "FREC_TYPE_EVENT":
+            base, events = self.bases.get(src, ("base_%d" % src, {}))
+            return "EVENT   %s/%s data=0x%08x" % (base, self.name(events, rec_id), data)
+
+        if kind == "FREC_TYPE_STATE":
+            return "STATE   %s --%s--> %s" % (self.name(self.states, src), self.name(self.events, signed),
+                                              self.name(self.states, rec_id))
+
+        if kind == "FREC_TYPE_ERROR":
+            source = self.name(self.sources, src)
+            if source == "FREC_SRC_WIFI":
+                err = "reason=%d" % signed              # wifi_err_reason_t of the disconnect
+            else:
+                err = ESP_ERRORS.get(signed, "err=%d (0x%x)" % (signed, data))
+            return "ERROR   %s line %d %s" % (source, rec_id, err)
+
+        return "type %d src=%d id=%d data=0x%08x" % (rec_type, src, rec_id, data)
+
+    def decode(self, blob):
+        if len(blob) < EXPORT_HDR.size:
+            raise ValueError("export too short: %d bytes" % len(blob))
+
+        magic, version, rec_size, count, lost = EXPORT_HDR.unpack_from(blob)
+        if magic != b"FR" or version != EXPORT_VERSION or rec_size != RECORD.size:
+            raise ValueError("not a flight recorder export v%d (magic %r, version %d, record size %d)"
+                             % (EXPORT_VERSION, magic, version, rec_size))
+
+        print("%d records, %d lost before the first one" % (count, lost))
+
+        last_ms = None
+        for i in range(count):
+            time_ms, rec_type, src, rec_id, data = RECORD.unpack_from(blob, EXPORT_HDR.size + i * RECORD.size)
+            delta = "" if last_ms is None else "+%d" % ((time_ms - last_ms) & 0xFFFFFFFF)
+            last_ms = time_ms
+            print("%12.3f %10s  %s" % (time_ms / 1000.0, delta, self.describe(rec_type, src, rec_id, data)))
+
+
+def exports_from_log(text):
+    """Joins the "FREC: <hex>" lines of a log into exports. A line starting with the header starts a new one."""
+    exports = []
+
+    for hexdata in re.findall(r"FREC:\s*([0-9a-fA-F]+)\s*$", text, flags=re.M):
+        chunk = bytes.fromhex(hexdata)
+        if chunk.startswith(b"FR") or not exports:
+            exports.append(bytearray())
+        exports[-1] += chunk
+
+    return [bytes(e) for e in exports]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode flight recorder exports of MOD_FlightRec")
+    parser.add_argument("file", help="binary export or log file, - for stdin")
+    parser.add_argument("--log", action="store_true", help="input is a log with FREC: lines")
+    args = parser.parse_args()
+
+    stream = sys.stdin.buffer if args.file == "-" else open(args.file, "rb")
+    data = stream.read()
+    decoder = Decoder()
+
+    exports = exports_from_log(data.decode(errors="replace")) if args.log else [data]
+    for n, blob in enumerate(exports):
+        if n > 0:
+            print()
+        decoder.decode(blob)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,40 @@
+/* Host simulation shim - ESP-NOW subset. Implemented in sim/sim_wifi.c */
+#ifndef SIM_ESP_NOW_H_
+#define SIM_ESP_NOW_H_
+
+#include "esp_wifi.h"
+
+#define ESP_NOW_ETH_ALEN        6
+#define ESP_NOW_KEY_LEN         16
+#define ESP_NOW_MAX_DATA_LEN    250
+
+typedef enum
+{
+    ESP_NOW_SEND_SUCCESS = 0,
+    ESP_NOW_SEND_FAIL,
+
+} esp_now_send_status_t;
+
+typedef struct
+{
+    uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t lmk[ESP_NOW_KEY_LEN];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+    void *priv;
+
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_send_cb_t)(const uint8_t *mac_addr, esp_now_send_status_t status);
+
+esp_err_t esp_now_init(void);
+esp_err_t esp_now_deinit(void);
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_unregister_send_cb(void);
+esp_err_t esp_now_set_pmk(const uint8_t *pmk);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer);
+esp_err_t esp_now_set_wake_window(uint16_t window);
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len);
+
+#endif /* SIM_ESP_NOW_H_ */
@@ -0,0 +1,60 @@
+/* Host simulation shim - esp-tls subset. Implemented in sim/sim_tls.c */
+#ifndef SIM_ESP_TLS_H_
+#define SIM_ESP_TLS_H_
+
+#include <sys/types.h>
+#include "sim_idf.h"
+
+#define ESP_TLS_ERR_SSL_WANT_READ   (-0x6900)
+#define ESP_TLS_ERR_SSL_WANT_WRITE  (-0x6880)
+#define ESP_TLS_ERR_SSL_TIMEOUT     (-0x6800)
+
+#define ESP_ERR_ESP_TLS_BASE                    0x8000
+#define ESP_ERR_ESP_TLS_CANNOT_RESOLVE_HOSTNAME (ESP_ERR_ESP_TLS_BASE + 0x01)
+#define ESP_ERR_ESP_TLS_FAILED_CONNECT_TO_HOST  (ESP_ERR_ESP_TLS_BASE + 0x04)
+#define ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT      (ESP_ERR_ESP_TLS_BASE + 0x06)
+#define ESP_ERR_MBEDTLS_SSL_HANDSHAKE_FAILED    (ESP_ERR_ESP_TLS_BASE + 0x1A)
+
+typedef struct esp_tls esp_tls_t;
+typedef struct esp_tls_client_session esp_tls_client_session_t;
+
+typedef struct esp_tls_last_error
+{
+    esp_err_t last_error;
+    int esp_tls_error_code;                     //!< Negated mbedtls error
+    int esp_tls_flags;
+
+} esp_tls_last_error_t;
+
+typedef struct esp_tls_last_error *esp_tls_error_handle_t;
+
+typedef struct esp_tls_cfg
+{
+    const char **alpn_protos;
+    const unsigned char *cacert_buf;
+    unsigned int cacert_bytes;
+    const unsigned char *clientcert_buf;
+    unsigned int clientcert_bytes;
+    const unsigned char *clientkey_buf;
+    unsigned int clientkey_bytes;
+    bool non_block;
+    bool use_secure_element;
+    int timeout_ms;
+    bool use_global_ca_store;
+    const char *common_name;
+    bool skip_common_name;
+    esp_tls_client_session_t *client_session;
+
+} esp_tls_cfg_t;
+
+esp_tls_t *esp_tls_init(void);
+int esp_tls_conn_new_sync(const char *hostname, int hostlen, int port, const esp_tls_cfg_t *cfg, esp_tls_t *tls);
+ssize_t esp_tls_conn_read(esp_tls_t *tls, void *data, size_t datalen);
+ssize_t esp_tls_conn_write(esp_tls_t *tls, const void *data, size_t datalen);
+ssize_t esp_tls_get_bytes_avail(esp_tls_t *tls);
+esp_err_t esp_tls_get_conn_sockfd(esp_tls_t *tls, int *sockfd);
+int esp_tls_conn_destroy(esp_tls_t *tls);
+void *esp_tls_get_ssl_context(esp_tls_t *tls);
+esp_err_t esp_tls_get_error_handle(esp_tls_t *tls, esp_tls_error_handle_t *error_handle);
+
+#endif /* SIM_ESP_TLS_H_ */
@@ -0,0 +1,248 @@
+/* Host simulation shim - Wi-Fi station, esp_netif and IP event subset. Implemented in sim/sim_wifi.c */
+#ifndef SIM_ESP_WIFI_H_
+#define SIM_ESP_WIFI_H_
+
+#include "sim_idf.h"
+
+
+/* esp_wifi_types ------------------------------------------------------------*/
+typedef enum { WIFI_MODE_NULL = 0, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA } wifi_mode_t;
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+typedef enum { WIFI_FAST_SCAN = 0, WIFI_ALL_CHANNEL_SCAN } wifi_scan_method_t;
+typedef enum { WIFI_CONNECT_AP_BY_SIGNAL = 0, WIFI_CONNECT_AP_BY_SECURITY } wifi_sort_method_t;
+typedef enum { WIFI_BW_HT20 = 1, WIFI_BW_HT40 } wifi_bandwidth_t;
+typedef enum { WIFI_SECOND_CHAN_NONE = 0, WIFI_SECOND_CHAN_ABOVE, WIFI_SECOND_CHAN_BELOW } wifi_second_chan_t;
+typedef enum { WIFI_STORAGE_FLASH, WIFI_STORAGE_RAM } wifi_storage_t;
+
+typedef enum
+{
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+    WIFI_AUTH_WPA_WPA2_PSK,
+    WIFI_AUTH_WPA2_ENTERPRISE,
+    WIFI_AUTH_WPA3_PSK,
+    WIFI_AUTH_WPA2_WPA3_PSK,
+    WIFI_AUTH_WAPI_PSK,
+
+} wifi_auth_mode_t;
+
+typedef enum
+{
+    WIFI_PHY_MODE_LR,
+    WIFI_PHY_MODE_11B,
+    WIFI_PHY_MODE_11G,
+    WIFI_PHY_MODE_HT20,
+    WIFI_PHY_MODE_HT40,
+    WIFI_PHY_MODE_HE20,
+
+} wifi_phy_mode_t;
+
+#define WIFI_PROTOCOL_11B       0x01
+#define WIFI_PROTOCOL_11G       0x02
+#define WIFI_PROTOCOL_11N       0x04
+#define WIFI_PROTOCOL_LR        0x08
+#define WIFI_PROTOCOL_11AX      0x10
+
+#define ESP_IF_WIFI_STA         WIFI_IF_STA
+
+typedef struct
+{
+    int8_t rssi;
+    wifi_auth_mode_t authmode;
+
+} wifi_scan_threshold_t;
+
+typedef struct
+{
+    uint8_t ssid[32];
+    uint8_t password[64];
+    wifi_scan_method_t scan_method;
+    bool bssid_set;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint16_t listen_interval;
+    wifi_sort_method_t sort_method;
+    wifi_scan_threshold_t threshold;
+    uint8_t failure_retry_cnt;
+
+} wifi_sta_config_t;
+
+typedef union
+{
+    wifi_sta_config_t sta;
+
+} wifi_config_t;
+
+typedef struct
+{
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int8_t  rssi;
+
+} wifi_ap_record_t;
+
+typedef struct
+{
+    int magic;
+
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT()  { .magic = 0x1F2F3F4F }
+
+
+/* esp_netif -----------------------------------------------------------------*/
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct { uint32_t addr; } esp_ip4_addr_t;
+typedef struct { uint32_t addr[4]; uint8_t zone; } esp_ip6_addr_t;
+
+typedef struct
+{
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+
+} esp_netif_ip_info_t;
+
+typedef struct
+{
+    esp_ip6_addr_t ip;
+
+} esp_netif_ip6_info_t;
+
+typedef enum
+{
+    ESP_IP6_ADDR_IS_UNKNOWN,
+    ESP_IP6_ADDR_IS_GLOBAL,
+    ESP_IP6_ADDR_IS_LINK_LOCAL,
+    ESP_IP6_ADDR_IS_SITE_LOCAL,
+    ESP_IP6_ADDR_IS_UNIQUE_LOCAL,
+    ESP_IP6_ADDR_IS_IPV4_MAPPED_IPV6
+
+} esp_ip6_addr_type_t;
+
+typedef struct
+{
+    const char *if_desc;
+    int route_prio;
+
+} esp_netif_inherent_config_t;
+
+#define ESP_NETIF_INHERENT_DEFAULT_WIFI_STA()   { .if_desc = "sta", .route_prio = 100 }
+
+#define IP2STR(ipaddr)  (int)(((ipaddr)->addr >> 0) & 0xff), (int)(((ipaddr)->addr >> 8) & 0xff), \
+                        (int)(((ipaddr)->addr >> 16) & 0xff), (int)(((ipaddr)->addr >> 24) & 0xff)
+#define IPSTR           "%d.%d.%d.%d"
+#define IPV62STR(ipaddr) (unsigned)((ipaddr).addr[0] & 0xffff), (unsigned)((ipaddr).addr[0] >> 16), \
+                         (unsigned)((ipaddr).addr[1] & 0xffff), (unsigned)((ipaddr).addr[1] >> 16), \
+                         (unsigned)((ipaddr).addr[2] & 0xffff), (unsigned)((ipaddr).addr[2] >> 16), \
+                         (unsigned)((ipaddr).addr[3] & 0xffff), (unsigned)((ipaddr).addr[3] >> 16)
+#define IPV6STR         "%04x:%04x:%04x:%04x:%04x:%04x:%04x:%04x"
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_wifi(wifi_interface_t wifi_if, const esp_netif_inherent_config_t *esp_netif_config);
+void esp_netif_destroy(esp_netif_t *esp_netif);
+const char *esp_netif_get_desc(esp_netif_t *esp_netif);
+esp_netif_t *esp_netif_next_unsafe(esp_netif_t *esp_netif);
+size_t esp_netif_get_nr_of_ifs(void);
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_set_ip_info(esp_netif_t *esp_netif, const esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *esp_netif);
+esp_err_t esp_netif_create_ip6_linklocal(esp_netif_t *esp_netif);
+int esp_netif_get_all_ip6(esp_netif_t *esp_netif, esp_ip6_addr_t if_ip6[]);
+esp_ip6_addr_type_t esp_netif_ip6_get_addr_type(esp_ip6_addr_t *ip6_addr);
+uint32_t ipaddr_addr(const char *cp);
+
+
+/* esp_wifi ------------------------------------------------------------------*/
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_deinit(void);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_stop(void);
+esp_err_t esp_wifi_connect(void);
+esp_err_t esp_wifi_disconnect(void);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf);
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf);
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t ifx, wifi_bandwidth_t bw);
+esp_err_t esp_wifi_set_protocol(wifi_interface_t ifx, uint8_t protocol_bitmap);
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+esp_err_t esp_wifi_sta_get_negotiated_phymode(wifi_phy_mode_t *phymode);
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info);
+esp_err_t esp_wifi_connectionless_module_set_wake_interval(uint16_t wake_interval);
+esp_err_t esp_wifi_set_default_wifi_sta_handlers(void);
+esp_err_t esp_wifi_clear_default_wifi_driver_and_handlers(void *esp_netif);
+
+
+/* Events --------------------------------------------------------------------*/
+ESP_EVENT_DECLARE_BASE(WIFI_EVENT);
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+typedef enum
+{
+    WIFI_EVENT_WIFI_READY = 0,
+    WIFI_EVENT_SCAN_DONE,
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_STOP,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED,
+    WIFI_EVENT_ITWT_SETUP = 37,
+    WIFI_EVENT_ITWT_TEARDOWN,
+    WIFI_EVENT_ITWT_PROBE,
+    WIFI_EVENT_ITWT_SUSPEND,
+
+} wifi_event_t;
+
+typedef enum
+{
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+    IP_EVENT_AP_STAIPASSIGNED,
+    IP_EVENT_GOT_IP6,
+
+} ip_event_t;
+
+typedef struct
+{
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t channel;
+    wifi_auth_mode_t authmode;
+    uint16_t aid;
+
+} wifi_event_sta_connected_t;
+
+typedef struct
+{
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+    int8_t rssi;
+
+} wifi_event_sta_disconnected_t;
+
+typedef struct
+{
+    esp_netif_t *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+
+} ip_event_got_ip_t;
+
+typedef struct
+{
+    esp_netif_t *esp_netif;
+    esp_netif_ip6_info_t ip6_info;
+    int ip_index;
+
+} ip_event_got_ip6_t;
+
+#endif /* SIM_ESP_WIFI_H_ */
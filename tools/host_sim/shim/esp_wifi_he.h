@@ -0,0 +1,81 @@
+/* Host simulation shim - Wi-Fi 6 individual TWT subset. Implemented in sim/sim_wifi.c */
+#ifndef SIM_ESP_WIFI_HE_H_
+#define SIM_ESP_WIFI_HE_H_
+
+#include "esp_wifi.h"
+
+#define FLOW_ID_ALL     (8)
+
+typedef enum
+{
+    TWT_REQUEST,
+    TWT_SUGGEST,
+    TWT_DEMAND,
+    TWT_GROUPING,
+    TWT_ACCEPT,
+    TWT_ALTERNATE,
+    TWT_DICTATE,
+    TWT_REJECT,
+
+} wifi_twt_setup_cmds_t;
+
+typedef struct
+{
+    wifi_twt_setup_cmds_t setup_cmd;
+    uint16_t trigger :1;
+    uint16_t flow_type :1;
+    uint16_t flow_id :3;
+    uint16_t wake_invl_expn :5;
+    uint16_t wake_duration_unit :1;
+    uint16_t reserved :5;
+    uint8_t min_wake_dura;
+    uint16_t wake_invl_mant;
+    uint16_t twt_id;
+    uint16_t timeout_time_ms;
+
+} wifi_twt_setup_config_t;
+
+typedef enum
+{
+    ITWT_PROBE_FAIL = 0,
+    ITWT_PROBE_SUCCESS,
+    ITWT_PROBE_TIMEOUT,
+    ITWT_PROBE_STA_DISCONNECTED,
+
+} wifi_itwt_probe_status_t;
+
+typedef struct
+{
+    wifi_twt_setup_config_t config;
+    esp_err_t status;
+    uint8_t reason;
+
+} wifi_event_sta_itwt_setup_t;
+
+typedef struct
+{
+    uint8_t flow_id;
+
+} wifi_event_sta_itwt_teardown_t;
+
+typedef struct
+{
+    esp_err_t status;
+    uint8_t flow_id_bitmap;
+    uint32_t actual_suspend_time_ms[8];
+
+} wifi_event_sta_itwt_suspend_t;
+
+typedef struct
+{
+    wifi_itwt_probe_status_t status;
+    uint8_t reason;
+
+} wifi_event_sta_itwt_probe_t;
+
+esp_err_t esp_wifi_sta_itwt_setup(wifi_twt_setup_config_t *setup_config);
+esp_err_t esp_wifi_sta_itwt_teardown(int flow_id);
+esp_err_t esp_wifi_sta_itwt_suspend(int flow_id, int suspend_time_ms);
+esp_err_t esp_wifi_sta_itwt_send_probe_req(int timeout_ms);
+
+#endif /* SIM_ESP_WIFI_HE_H_ */
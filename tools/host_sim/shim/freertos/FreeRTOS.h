@@ -0,0 +1,3 @@
+/* Host simulation shim - see sim_idf.h */
+#pragma once
+#include "../sim_idf.h"
@@ -0,0 +1,38 @@
+/* Host simulation shim - mbedtls session subset. Implemented in sim/sim_tls.c */
+#ifndef SIM_MBEDTLS_SSL_H_
+#define SIM_MBEDTLS_SSL_H_
+
+#include "sim_idf.h"
+
+#define MBEDTLS_PRIVATE(member)             member
+#define MBEDTLS_ERR_SSL_BAD_INPUT_DATA      (-0x7100)
+#define MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL    (-0x6A00)
+#define MBEDTLS_ERR_SSL_WANT_READ           (-0x6900)
+#define MBEDTLS_ERR_SSL_WANT_WRITE          (-0x6880)
+#define MBEDTLS_ERR_SSL_TIMEOUT             (-0x6800)
+#define MBEDTLS_ERR_SSL_CONN_EOF            (-0x7280)
+#define MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE (-0x7780)
+
+/// @brief Session as far as the fake broker needs it. The ticket models the serialized size.
+typedef struct mbedtls_ssl_session
+{
+    unsigned char master[48];
+    int64_t  s64_Issued_us;                     //!< World time the broker issued the session
+    uint16_t u16_TicketLen;
+    unsigned char ticket[192];
+
+} mbedtls_ssl_session;
+
+typedef struct mbedtls_ssl_context
+{
+    mbedtls_ssl_session session;
+
+} mbedtls_ssl_context;
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session);
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len, size_t *olen);
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len);
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session);
+
+#endif /* SIM_MBEDTLS_SSL_H_ */
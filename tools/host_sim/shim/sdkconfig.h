@@ -0,0 +1,158 @@
+/* Host simulation shim - sdkconfig.h with the Kconfig defaults of main/Kconfig.projbuild.
+ * The power save method (CONFIG_APP_AUTO_LIGHT_SLEEP, CONFIG_APP_DEEP_SLEEP, ...) and the
+ * Wi-Fi power save mode are set per executable by tools/host_sim/CMakeLists.txt. */
+#ifndef SIM_SDKCONFIG_H_
+#define SIM_SDKCONFIG_H_
+
+#if !defined(CONFIG_APP_AUTO_LIGHT_SLEEP) && !defined(CONFIG_APP_DEEP_SLEEP) && \
+    !defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) && !defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+#error "sdkconfig: no power save method defined"
+#endif
+
+#if !defined(CONFIG_APP_WIFI_POWER_SAVE_NONE) && !defined(CONFIG_APP_WIFI_POWER_SAVE_MIN) && \
+    !defined(CONFIG_APP_WIFI_POWER_SAVE_MAX)
+#error "sdkconfig: no Wi-Fi power save mode defined"
+#endif
+
+/* Target */
+#define CONFIG_IDF_TARGET_ESP32C6 1
+#define CONFIG_PM_ENABLE 1
+#define CONFIG_FREERTOS_USE_TICKLESS_IDLE 1
+#define CONFIG_LWIP_IPV4 1
+#define CONFIG_I2CDEV_TIMEOUT 1000
+
+/* Application configuration */
+#define CONFIG_APP_PERIPH_PWR_PIN 1
+#define CONFIG_APP_I2C_MASTER_SCL_PIN 19
+#define CONFIG_APP_I2C_MASTER_SDA_PIN 18
+#define CONFIG_APP_I2C_CLOCK_HZ 100000
+#define CONFIG_APP_REPORTING_INTERVAL_SEC 600
+#if defined(CONFIG_APP_DEEP_SLEEP) || defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW)
+#define CONFIG_APP_FAST_WAKE 1
+#ifndef CONFIG_APP_BATCH_SAMPLES
+#define CONFIG_APP_BATCH_SAMPLES 1
+#endif
+#define CONFIG_APP_BATCH_BUFFER_SIZE 32
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+#define CONFIG_APP_REPORT_HEARTBEAT_SEC 3600
+#define CONFIG_APP_DEADBAND_TEMP_DECI_C 3
+#define CONFIG_APP_DEADBAND_HUMI_DECI_PCT 20
+#define CONFIG_APP_DEADBAND_LUX_PCT 20
+#endif
+#else
+#undef CONFIG_APP_BATCH_SAMPLES                 /*depends on the deep sleep modes, even if set by SIM_EXTRA_DEFINES*/
+#undef CONFIG_APP_REPORT_ON_CHANGE
+#endif
+#define CONFIG_APP_MAX_CPU_FREQ_80 1
+#define CONFIG_APP_MAX_CPU_FREQ_MHZ 80
+#define CONFIG_APP_MIN_CPU_FREQ_10M 1
+#define CONFIG_APP_MIN_CPU_FREQ_MHZ 10
+#define CONFIG_APP_PWR_CURRENT_CPU_ACTIVE_UA 25000
+#define CONFIG_APP_PWR_CURRENT_WIFI_TXRX_UA 80000
+#define CONFIG_APP_PWR_CURRENT_MODEM_SLEEP_UA 20000
+#define CONFIG_APP_PWR_CURRENT_LIGHT_SLEEP_UA 200
+#define CONFIG_APP_PWR_CURRENT_DEEP_SLEEP_UA 10
+#define CONFIG_APP_PWR_CURRENT_SENSOR_RAIL_UA 400
+
+/* Wi-Fi Configuration */
+#define CONFIG_APP_WIFI_SSID "MY_WIFI_NETWORK"
+#define CONFIG_APP_WIFI_PASSWORD "mypassword"
+#define CONFIG_APP_WIFI_CONN_MAX_RETRY 6
+#define CONFIG_APP_WIFI_SCAN_METHOD_ALL_CHANNEL 1
+#ifndef CONFIG_APP_WIFI_FAST_RECONNECT_DISABLE     /*Scan on every connect with -DSIM_EXTRA_DEFINES="CONFIG_APP_WIFI_FAST_RECONNECT_DISABLE=1"*/
+#define CONFIG_APP_WIFI_FAST_RECONNECT 1
+#endif
+#define CONFIG_APP_WIFI_SCAN_RSSI_THRESHOLD -127
+#define CONFIG_APP_WIFI_AUTH_OPEN 1
+#define CONFIG_APP_WIFI_CONNECT_AP_BY_SIGNAL 1
+#define CONFIG_APP_CONNECT_IPV4 1
+#define CONFIG_APP_CONNECT_IPV6 1
+#define CONFIG_APP_CONNECT_IPV6_PREF_LOCAL_LINK 1
+#if !defined(CONFIG_APP_CONNECT_READY_ANY) && !defined(CONFIG_APP_CONNECT_READY_PREFER_IPV6)   /*Select with -DSIM_EXTRA_DEFINES*/
+#define CONFIG_APP_CONNECT_READY_IPV4 1
+#endif
+#ifndef CONFIG_APP_CONNECT_IPV6_DEADLINE_MS
+#define CONFIG_APP_CONNECT_IPV6_DEADLINE_MS 1500
+#endif
+#define CONFIG_APP_CONNECT_TIMEOUT_MS 15000
+#define CONFIG_APP_IP_ENABLE_STATIC_IP 1
+#define CONFIG_APP_IP_STATIC_IP_ADDR "192.168.178.201"
+#define CONFIG_APP_IP_STATIC_NETMASK_ADDR "255.255.255.0"
+#define CONFIG_APP_IP_STATIC_GW_ADDR "192.168.178.1"
+
+/* iTWT Configuration */
+#define CONFIG_APP_ITWT_ENABLE 1
+#define CONFIG_APP_ITWT_TRIGGER_ENABLE 1
+#define CONFIG_APP_ITWT_ANNOUNCED 1
+#define CONFIG_APP_ITWT_WAKE_INVL_MS 30000
+#define CONFIG_APP_ITWT_WAKE_INVL_MIN_MS 1000
+#define CONFIG_APP_ITWT_SERVICE_PERIOD_US 65280
+#define CONFIG_APP_ITWT_SETUP_MAX_REQUESTS 4
+#define CONFIG_APP_ITWT_ID 0
+#define CONFIG_APP_ITWT_SETUP_TIMEOUT_TIME_MS 5000
+#ifndef CONFIG_APP_ITWT_WAKE_TEARDOWN               /*Setup every cycle with -DSIM_EXTRA_DEFINES="CONFIG_APP_ITWT_WAKE_TEARDOWN=1"*/
+#define CONFIG_APP_ITWT_WAKE_SUSPEND 1
+#define CONFIG_APP_ITWT_SUSPEND_MS 10000
+#endif
+#define CONFIG_APP_ITWT_ASUS_BUG_WORKAROUND 1
+#define CONFIG_APP_ITWT_ASUS_BUG_INTERVAL 300
+
+/* ESP-NOW application data */
+#define CONFIG_APP_ESPNOW_ENABLE 1
+#define CONFIG_APP_ESPNOW_PMK "pmk1234567890123"
+#define CONFIG_APP_ESPNOW_LMK "lmk1234567890123"
+#define CONFIG_APP_ESPNOW_CHANNEL 1
+#define CONFIG_APP_ESPNOW_PEER_MAC "FF:FF:FF:FF:FF:FF"
+#ifndef CONFIG_APP_ESPNOW_PAYLOAD_RAW              /*Legacy frame with -DSIM_EXTRA_DEFINES="CONFIG_APP_ESPNOW_PAYLOAD_RAW=1"*/
+#define CONFIG_APP_ESPNOW_PAYLOAD_CBOR 1
+#endif
+
+/* MQTT Configuration */
+#define CONFIG_APP_MQTT_BROKER_IP_ADR "192.168.178.5"
+#ifdef CONFIG_APP_MQTT_TLS                          /*mqtts with -DSIM_EXTRA_DEFINES="CONFIG_APP_MQTT_TLS=1"*/
+#define CONFIG_APP_MQTT_BROKER_IP_PORT 8883
+#define CONFIG_APP_MQTT_TLS_CA_CERT_PATH "certs/mqtt_ca.pem"
+#define CONFIG_APP_MQTT_TLS_COMMON_NAME "mqtt-broker"
+#ifndef CONFIG_APP_MQTT_TLS_SESSION_CACHE_DISABLE   /*Full handshake on every connect with CONFIG_APP_MQTT_TLS_SESSION_CACHE_DISABLE=1*/
+#define CONFIG_APP_MQTT_TLS_SESSION_CACHE 1
+#define CONFIG_APP_MQTT_TLS_SESSION_CACHE_SIZE 1024
+#define CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS 1
+#define CONFIG_ESP_TLS_USING_MBEDTLS 1
+#endif
+#else
+#define CONFIG_APP_MQTT_BROKER_IP_PORT 1883
+#endif
+#define CONFIG_APP_MQTT_BROKER_USER_NAME "myUserName"
+#define CONFIG_APP_MQTT_BROKER_USER_PW "myPassword"
+#define CONFIG_APP_MQTT_DEVICE_ID "myMQTT_DeviceID"
+#define CONFIG_APP_MQTT_DEVICE_LOCATION "Office"
+#define CONFIG_APP_MQTT_QoS_1 1
+#define CONFIG_APP_MQTT_QoS 1
+#if defined(CONFIG_APP_AUTO_LIGHT_SLEEP) && !defined(CONFIG_APP_MQTT_PERSISTENT_SESSION_DISABLE)
+#define CONFIG_APP_MQTT_PERSISTENT_SESSION 1        /*Off with -DSIM_EXTRA_DEFINES="CONFIG_APP_MQTT_PERSISTENT_SESSION_DISABLE=1"*/
+#define CONFIG_APP_MQTT_KEEPALIVE_TWT_INVL 4
+#endif
+#ifndef CONFIG_APP_MQTT_PAYLOAD_PER_TOPIC          /*Legacy layout with -DSIM_EXTRA_DEFINES="CONFIG_APP_MQTT_PAYLOAD_PER_TOPIC=1"*/
+#define CONFIG_APP_MQTT_PAYLOAD_REPORT 1
+#if !defined(CONFIG_APP_MQTT_REPORT_CSV) && !defined(CONFIG_APP_MQTT_REPORT_JSON)
+#define CONFIG_APP_MQTT_REPORT_CBOR 1
+#endif
+#define CONFIG_APP_MQTT_REPORT_RSSI 1
+#endif
+
+/* Store and forward */
+#if (defined(CONFIG_APP_DEEP_SLEEP) || defined(CONFIG_APP_AUTO_LIGHT_SLEEP)) && !defined(CONFIG_APP_STORE_FWD_DISABLE)
+#define CONFIG_APP_STORE_FWD 1                      /*Off with -DSIM_EXTRA_DEFINES="CONFIG_APP_STORE_FWD_DISABLE=1"*/
+#define CONFIG_APP_STORE_FWD_BATCH 16
+#define CONFIG_APP_STORE_FWD_DRAIN_BATCHES 4
+#endif
+
+/* Profiling */
+#define CONFIG_APP_PROF_BATCH_SIZE 6
+#define CONFIG_APP_PROF_OUTPUT_LOG 1
+
+/* Flight recorder */
+#define CONFIG_APP_FLIGHT_REC 1
+#define CONFIG_APP_FLIGHT_REC_SIZE 96
+
+#endif /* SIM_SDKCONFIG_H_ */
@@ -0,0 +1,442 @@
+/**
+  ******************************************************************************
+  * @file    sim_idf.h
+  * @author  The Embedded Dude
+  * @brief   Host simulation - ESP-IDF and FreeRTOS API subset.
+  *          Declares the parts of ESP-IDF and FreeRTOS used by main and the
+  *          MOD_* components. Implemented by the sim/sim_*.c files on top of a
+  *          virtual clock.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Do not include this file directly. The ESP-IDF header names in the shim
+       folder (esp_log.h, freertos/task.h, ...) include it.
+    2. Only what the app uses is declared. If a module starts using another
+       IDF function, declare it here and implement it in the matching sim file.
+    3. Types only need to be source compatible with the app code, not binary
+       compatible with ESP-IDF.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SIM_IDF_H_
+#define SIM_IDF_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* esp_err -------------------------------------------------------------------*/
+typedef int esp_err_t;
+
+#define ESP_OK                          0
+#define ESP_FAIL                        -1
+#define ESP_ERR_NO_MEM                  0x101
+#define ESP_ERR_INVALID_ARG             0x102
+#define ESP_ERR_INVALID_STATE           0x103
+#define ESP_ERR_INVALID_SIZE            0x104
+#define ESP_ERR_NOT_FOUND               0x105
+#define ESP_ERR_NOT_SUPPORTED           0x106
+#define ESP_ERR_TIMEOUT                 0x107
+#define ESP_ERR_INVALID_RESPONSE        0x108
+#define ESP_ERR_INVALID_CRC             0x109
+#define ESP_ERR_INVALID_VERSION         0x10A
+#define ESP_ERR_NOT_FINISHED            0x10C
+#define ESP_ERR_NVS_NO_FREE_PAGES       0x1105
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   0x1110
+#define ESP_ERR_WIFI_NOT_INIT           0x3001
+#define ESP_ERR_WIFI_NOT_STARTED        0x3002
+#define ESP_ERR_WIFI_NOT_CONNECT        0x300F
+
+const char *esp_err_to_name(esp_err_t code);
+void sim_error_check_failed(esp_err_t rc, const char *file, int line, const char *function, const char *expression);
+
+/// @brief Same as on target: logs the error and aborts. The sim treats the abort as a panic reset.
+#define ESP_ERROR_CHECK(x) do {                                                     \
+        esp_err_t err_rc_ = (x);                                                    \
+        if (err_rc_ != ESP_OK)                                                      \
+            sim_error_check_failed(err_rc_, __FILE__, __LINE__, __func__, #x);      \
+    } while(0)
+
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) ({                                         \
+        esp_err_t err_rc_ = (x);                                                    \
+        if (err_rc_ != ESP_OK)                                                      \
+            esp_log_write(ESP_LOG_ERROR, "sim", "%s failed: %s", #x, esp_err_to_name(err_rc_)); \
+        err_rc_;                                                                    \
+    })
+
+#define BIT0        0x00000001
+#define BIT1        0x00000002
+#define BIT2        0x00000004
+#define BIT3        0x00000008
+#define BIT(nr)     (1UL << (nr))
+
+
+/* esp_log -------------------------------------------------------------------*/
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+
+} esp_log_level_t;
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+uint32_t esp_log_timestamp(void);
+
+#define ESP_LOGE(tag, format, ...)  esp_log_write(ESP_LOG_ERROR,   tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  esp_log_write(ESP_LOG_WARN,    tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)  esp_log_write(ESP_LOG_INFO,    tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  esp_log_write(ESP_LOG_DEBUG,   tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)  esp_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+
+/* esp_attr ------------------------------------------------------------------*/
+/*RTC slow memory is a linker section. Its content is saved on deep sleep and restored on the next boot.
+  sim_rtc_noinit is also kept over panic and software resets. Both are lost on power on.*/
+#define RTC_DATA_ATTR       __attribute__((section("sim_rtc")))
+#define RTC_NOINIT_ATTR     __attribute__((section("sim_rtc_noinit")))
+#define RTC_SLOW_ATTR       __attribute__((section("sim_rtc")))
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+
+/* FreeRTOS ------------------------------------------------------------------*/
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct sim_task   *TaskHandle_t;
+typedef struct sim_queue  *QueueHandle_t;
+typedef struct sim_queue  *SemaphoreHandle_t;
+
+#define pdFALSE                         ((BaseType_t)0)
+#define pdTRUE                          ((BaseType_t)1)
+#define pdPASS                          pdTRUE
+#define pdFAIL                          pdFALSE
+#define portMAX_DELAY                   ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ              1000
+#define portTICK_PERIOD_MS              ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs)        ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define pdTICKS_TO_MS(xTicks)           ((TickType_t)(((uint64_t)(xTicks) * 1000U) / configTICK_RATE_HZ))
+#define configMAX_PRIORITIES            25
+#define tskNO_AFFINITY                  0x7FFFFFFF
+
+/*Only one sim task runs at a time. Critical sections are not needed.*/
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+#define taskENTER_CRITICAL(mux)         ((void)(mux))
+#define taskEXIT_CRITICAL(mux)          ((void)(mux))
+
+typedef enum
+{
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+
+} eNotifyAction;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, const BaseType_t xCoreID);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+void vTaskDelay(const TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount(void);
+UBaseType_t uxTaskPriorityGet(const TaskHandle_t xTask);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+const char *pcTaskGetName(TaskHandle_t xTaskToQuery);
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction);
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue, TickType_t xTicksToWait);
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue);
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue);
+void vQueueDelete(QueueHandle_t xQueue);
+#define xQueueSendToBack(q, item, ticks)    xQueueSend((q), (item), (ticks))
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+#define vSemaphoreDelete(sem)               vQueueDelete(sem)
+
+
+/* esp_timer / esp_system ----------------------------------------------------*/
+int64_t esp_timer_get_time(void);
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t       callback;
+    void                *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char          *name;
+    bool                 skip_unhandled_events;
+}esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+
+typedef enum
+{
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO
+
+} esp_reset_reason_t;
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_reset_reason_t esp_reset_reason(void);
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle);
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handle);
+void esp_restart(void) __attribute__((noreturn));
+uint32_t esp_random(void);
+uint32_t esp_get_free_heap_size(void);
+
+typedef enum
+{
+    ESP_MAC_WIFI_STA,
+    ESP_MAC_WIFI_SOFTAP,
+    ESP_MAC_BT,
+    ESP_MAC_ETH,
+    ESP_MAC_IEEE802154,
+    ESP_MAC_BASE,
+
+} esp_mac_type_t;
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+#define MAC2STR(a)      (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+#define MACSTR          "%02x:%02x:%02x:%02x:%02x:%02x"
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+
+/* esp_sleep / esp_pm --------------------------------------------------------*/
+typedef enum
+{
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER,
+
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+void esp_deep_sleep_start(void) __attribute__((noreturn));
+esp_err_t esp_light_sleep_start(void);
+
+typedef struct
+{
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+
+} esp_pm_config_t;
+
+esp_err_t esp_pm_configure(const void *config);
+esp_err_t esp_pm_get_configuration(void *config);
+
+
+/* driver/gpio ---------------------------------------------------------------*/
+typedef int gpio_num_t;
+
+typedef enum { GPIO_INTR_DISABLE = 0 } gpio_int_type_t;
+typedef enum { GPIO_MODE_DISABLE = 0, GPIO_MODE_INPUT, GPIO_MODE_OUTPUT } gpio_mode_t;
+
+typedef struct
+{
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    int pull_up_en;
+    int pull_down_en;
+    gpio_int_type_t intr_type;
+
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+int gpio_get_level(gpio_num_t gpio_num);
+esp_err_t gpio_hold_en(gpio_num_t gpio_num);
+esp_err_t gpio_hold_dis(gpio_num_t gpio_num);
+
+
+/* driver/i2c ----------------------------------------------------------------*/
+typedef int i2c_port_t;
+
+typedef struct
+{
+    int mode;
+    int sda_io_num;
+    int scl_io_num;
+    bool sda_pullup_en;
+    bool scl_pullup_en;
+    struct
+    {
+        uint32_t clk_speed;
+    } master;
+    uint32_t clk_flags;
+
+} i2c_config_t;
+
+
+/* nvs_flash -----------------------------------------------------------------*/
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+
+/* esp_partition -------------------------------------------------------------*/
+/*One data partition "flashqueue" of flash.queue_kb. The content survives all resets.*/
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP  = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_ANY = 0xFF,
+
+} esp_partition_subtype_t;
+
+typedef struct
+{
+    esp_partition_type_t    type;
+    esp_partition_subtype_t subtype;
+    uint32_t                address;
+    uint32_t                size;
+    uint32_t                erase_size;
+    char                    label[17];
+    bool                    encrypted;
+
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+
+/* esp_event -----------------------------------------------------------------*/
+typedef const char *esp_event_base_t;
+typedef struct sim_event_loop *esp_event_loop_handle_t;
+typedef void (*esp_event_handler_t)(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+typedef struct sim_event_handler *esp_event_handler_instance_t;
+
+#define ESP_EVENT_ANY_BASE              NULL
+#define ESP_EVENT_ANY_ID                -1
+#define ESP_EVENT_DECLARE_BASE(id)      extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id)       esp_event_base_t const id = #id
+
+typedef struct
+{
+    int32_t queue_size;
+    const char *task_name;
+    UBaseType_t task_priority;
+    uint32_t task_stack_size;
+    BaseType_t task_core_id;
+
+} esp_event_loop_args_t;
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *event_loop_args, esp_event_loop_handle_t *event_loop);
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size, TickType_t ticks_to_wait);
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size, TickType_t ticks_to_wait);
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg);
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler);
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg, esp_event_handler_instance_t *instance);
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_instance_t instance);
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg);
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler);
+esp_err_t esp_event_handler_instance_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg, esp_event_handler_instance_t *instance);
+esp_err_t esp_event_handler_instance_unregister_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_instance_t instance);
+
+
+/* esp_idf_version -----------------------------------------------------------*/
+#define ESP_IDF_VERSION_VAL(major, minor, patch)    ((major << 16) | (minor << 8) | (patch))
+#define ESP_IDF_VERSION                             ESP_IDF_VERSION_VAL(5, 2, 1)
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_IDF_H_ */
@@ -0,0 +1,3 @@
+/* Host simulation shim - I2C timeout register field used by i2cdev.h */
+#pragma once
+#define I2C_TIME_OUT_VALUE_V 0x0000001F
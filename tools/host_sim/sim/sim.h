@@ -0,0 +1,269 @@
+/**
+  ******************************************************************************
+  * @file    sim.h
+  * @author  The Embedded Dude
+  * @brief   Host simulation - Internal interface between the sim_*.c files.
+  *          Virtual time kernel, simulation parameters, counters and the
+  *          state shared with the supervisor process.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Time only advances when no task is ready. A task which wants to model a
+       duration blocks with sim_wait(..) or sim_busy_us(..).
+    2. Fakes model radio or bus latency with sim_timer_after(..). The callback
+       runs in the sim timer task and may post events or give semaphores.
+    3. All model values are parameters (SIM_PARAMS). Read them with SIM_P(..).
+       They can be changed on the command line (-p name=value).
+    4. Use the sim_rand_*(..) functions for everything random. The generator
+       state is kept in the shared state so a run is reproducible by its seed,
+       also over deep sleep.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SIM_H_
+#define SIM_H_
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_idf.h"
+
+
+/* Exported constants --------------------------------------------------------*/
+#define SIM_FOREVER             (-1LL)          //!< No deadline for sim_wait(..)
+
+#define SIM_TASK_PRIO_TIMER     22              //!< esp_timer task on target
+#define SIM_TASK_PRIO_EVENT     20              //!< Default event loop task (sys_evt) on target
+#define SIM_TASK_PRIO_MQTT      5               //!< esp-mqtt client task on target
+#define SIM_TASK_PRIO_MAIN      1               //!< app_main task on target
+
+#define SIM_RTC_MAX_SIZE        (16 * 1024)     //!< RTC slow memory size of the ESP32-C6
+#define SIM_FLASH_MAX_SIZE      (256 * 1024)    //!< Max. size of the simulated flashqueue partition
+
+/// @brief Exit codes of one boot (child process)
+#define SIM_EXIT_DONE           0               //!< Requested number of cycles completed
+#define SIM_EXIT_DEEP_SLEEP     10              //!< esp_deep_sleep_start(..). Supervisor boots again
+#define SIM_EXIT_RESTART        11              //!< esp_restart(..). Supervisor boots again
+#define SIM_EXIT_PANIC          12              //!< abort(..), ESP_ERROR_CHECK(..) or a crash. Supervisor boots again
+#define SIM_EXIT_STALLED        13              //!< No task ready and no timeout pending
+#define SIM_EXIT_STUCK          14              //!< No cycle end within the watchdog time
+
+
+/* Exported macro ------------------------------------------------------------*/
+
+/// @brief Simulation parameters: id, name, default value, description
+#define SIM_PARAMS(X)                                                                                           \
+    X(BOOT_BOOTLOADER_MS,   "boot.bootloader_ms",     45.0, "ROM and 2nd stage bootloader. Not seen by esp_timer") \
+    X(BOOT_STARTUP_MS,      "boot.startup_ms",       110.0, "App startup until app_main. Seen by esp_timer")       \
+    X(LOG_UART_CHAR_US,     "log.uart_char_us",       86.8, "Console time per char of an I/W/E log line. 115200 baud") \
+    X(NVS_INIT_MS,          "nvs.init_ms",            25.0, "First nvs_flash_init(..) of a boot")                  \
+    X(NVS_REINIT_MS,        "nvs.reinit_ms",           0.2, "nvs_flash_init(..) when already initialized")         \
+    X(FLASH_QUEUE_KB,       "flash.queue_kb",         64.0, "Size of the flashqueue partition. 0 = no partition")  \
+    X(FLASH_ERASE_MS,       "flash.erase_ms",         45.0, "Erase of one 4 kB sector")                            \
+    X(FLASH_WRITE_US,       "flash.write_us",         30.0, "Program of up to one page (256 bytes)")               \
+    X(WIFI_INIT_MS,         "wifi.init_ms",           40.0, "esp_wifi_init(..)")                                   \
+    X(WIFI_START_MS,        "wifi.start_ms",          25.0, "esp_wifi_start(..) incl. PHY calibration")            \
+    X(WIFI_ASSOC_MS,        "wifi.assoc_ms",         320.0, "Scan, authentication and association")                \
+    X(WIFI_FAST_ASSOC_MS,   "wifi.fast_assoc_ms",     60.0, "Same with BSSID and channel set: probe of one channel") \
+    X(WIFI_AP_MOVED_PCT,    "wifi.ap_moved_pct",       0.0, "Probability the AP left its BSSID/channel since the last wake") \
+    X(WIFI_ASSOC_JITTER_MS, "wifi.assoc_jitter_ms",  120.0, "Uniform jitter added to wifi.assoc_ms")               \
+    X(WIFI_ASSOC_FAIL_PCT,  "wifi.assoc_fail_pct",     2.0, "Probability an association attempt fails")           \
+    X(WIFI_DHCP_MS,         "wifi.dhcp_ms",          650.0, "DHCP lease if no static IP is set")                   \
+    X(WIFI_STATIC_IP_MS,    "wifi.static_ip_ms",       3.0, "GOT_IP delay with a static IP")                       \
+    X(WIFI_IP6_LL_MS,       "wifi.ip6_ll_ms",        900.0, "IPv6 link local address incl. DAD")                   \
+    X(WIFI_NO_IP_PCT,       "wifi.no_ip_pct",          0.0, "Probability GOT_IP never comes after an association") \
+    X(WIFI_NO_IP6_PCT,      "wifi.no_ip6_pct",         0.0, "Probability the IPv6 address never comes")            \
+    X(WIFI_BEACON_MS,       "wifi.beacon_ms",        102.4, "Beacon interval. Downlink latency with modem sleep")  \
+    X(WIFI_LISTEN_INTERVAL, "wifi.listen_interval",    3.0, "Beacons per wake with WIFI_PS_MAX_MODEM")             \
+    X(WIFI_LINK_MTBF_S,     "wifi.link_mtbf_s",     7200.0, "Mean time between AP link losses. 0 = never")         \
+    X(ITWT_SETUP_MS,        "itwt.setup_ms",          35.0, "iTWT setup request until response")                   \
+    X(ITWT_REJECT_PCT,      "itwt.reject_pct",         0.0, "Probability the AP rejects the iTWT agreement")       \
+    X(ITWT_MAX_INVL_S,      "itwt.max_invl_s",         0.0, "Longest wake interval of the AP. Longer: counter-offer or reject. 0 = no limit") \
+    X(ITWT_PROBE_MS,        "itwt.probe_ms",           6.0, "iTWT probe request until response")                   \
+    X(ITWT_SUSPEND_MS,      "itwt.suspend_ms",         4.0, "iTWT suspend (TWT information frame) until the event") \
+    X(ITWT_LOST_PCT,        "itwt.lost_pct",           0.0, "Probability the AP dropped the agreement during a sleep") \
+    X(MQTT_CONNECT_MS,      "mqtt.connect_ms",        45.0, "TCP and MQTT CONNECT until CONNACK")                  \
+    X(MQTT_CONNECT_FAIL_PCT,"mqtt.connect_fail_pct",   1.0, "Probability a broker connect fails")                  \
+    X(MQTT_RECONNECT_MS,    "mqtt.reconnect_ms",   10000.0, "esp-mqtt auto reconnect timeout")                     \
+    X(MQTT_RTT_MS,          "mqtt.rtt_ms",            12.0, "Round trip to the broker without modem sleep")        \
+    X(MQTT_ACK_LOSS_PCT,    "mqtt.ack_loss_pct",       1.0, "Probability a QoS>0 exchange is lost")                \
+    X(MQTT_RETRANSMIT_MS,   "mqtt.retransmit_ms",   1000.0, "esp-mqtt message retransmit timeout")                 \
+    X(TLS_FULL_MS,          "tls.full_ms",           450.0, "CPU time of a full TLS handshake. Certificate chain and ECDHE") \
+    X(TLS_RESUME_MS,        "tls.resume_ms",          15.0, "CPU time of a resumed TLS handshake")                 \
+    X(TLS_TICKET_LIFETIME_S,"tls.ticket_lifetime_s", 7200.0, "Broker accepts a cached session up to this age")    \
+    X(TLS_REJECT_PCT,       "tls.reject_pct",          0.0, "Probability the broker rejects a valid session")      \
+    X(TLS_ALERT_PCT,        "tls.alert_pct",           0.0, "Probability the broker aborts a resumed handshake with an alert") \
+    X(ESPNOW_TX_MS,         "espnow.tx_ms",            2.5, "ESP-NOW send until the send callback")                \
+    X(ESPNOW_FAIL_PCT,      "espnow.fail_pct",         2.0, "Probability an ESP-NOW frame is not acked")           \
+    X(I2C_FAIL_PCT,         "i2c.fail_pct",            0.0, "Probability of an I2C transfer timeout")              \
+    X(ENV_TEMP_C,           "env.temp_c",             21.0, "Initial temperature")                                 \
+    X(ENV_RH_PCT,           "env.rh_pct",             45.0, "Initial relative humidity")                           \
+    X(ENV_LUX,              "env.lux",               320.0, "Initial illuminance")                                 \
+    X(ENV_WALK,             "env.walk",                0.02, "Relative random walk step per sample")               \
+    X(BATTERY_MAH,          "battery.mah",          2000.0, "Battery capacity for the life time estimation")       \
+    X(WATCHDOG_S,           "watchdog_s",            120.0, "Max. awake time of one cycle before the run is stuck")
+
+/// @brief Event counters: id, name
+#define SIM_COUNTERS(X)                             \
+    X(BOOT,                 "boots")                \
+    X(PANIC,                "panics")               \
+    X(NVS_INIT,             "nvs inits")            \
+    X(FLASH_ERASE,          "flash erases")         \
+    X(FLASH_WRITE,          "flash writes")         \
+    X(WIFI_INIT,            "wifi inits")           \
+    X(WIFI_CONNECT,         "wifi connects")        \
+    X(WIFI_FAST_CONNECT,    "wifi fast connects")   \
+    X(WIFI_ASSOC_FAIL,      "wifi assoc fails")     \
+    X(WIFI_LINK_LOSS,       "wifi link losses")     \
+    X(ITWT_SETUP,           "itwt setups")          \
+    X(ITWT_REJECT,          "itwt rejects")         \
+    X(ITWT_ALTERNATE,       "itwt counter-offers")  \
+    X(ITWT_SUSPEND,         "itwt suspends")        \
+    X(ITWT_TEARDOWN,        "itwt teardowns")       \
+    X(ITWT_LOST,            "itwt agreements lost") \
+    X(MQTT_CONNECT,         "mqtt connects")        \
+    X(MQTT_CONNECT_FAIL,    "mqtt connect fails")   \
+    X(MQTT_PUBLISH,         "mqtt publishes")       \
+    X(MQTT_RETRANSMIT,      "mqtt retransmits")     \
+    X(MQTT_PING,            "mqtt pings")           \
+    X(TLS_FULL,             "tls full handshakes")  \
+    X(TLS_RESUMED,          "tls resumed handshakes") \
+    X(ESPNOW_SEND,          "espnow sends")         \
+    X(ESPNOW_FAIL,          "espnow fails")         \
+    X(I2C_XFER,             "i2c transfers")        \
+    X(I2C_FAIL,             "i2c fails")
+
+#define SIM_P(id)           (sim_shm->af_Param[SIM_P_##id])
+#define SIM_COUNT(id)       (sim_shm->au32_Cnt[SIM_CNT_##id]++)
+
+
+/* Exported types ------------------------------------------------------------*/
+#define SIM_PARAM_ENUM(id, name, def, help)     SIM_P_##id,
+#define SIM_COUNTER_ENUM(id, name)              SIM_CNT_##id,
+
+typedef enum { SIM_PARAMS(SIM_PARAM_ENUM) SIM_Num_Params } SIM_PARAM_ID_t;
+typedef enum { SIM_COUNTERS(SIM_COUNTER_ENUM) SIM_Num_Counters } SIM_COUNTER_ID_t;
+
+/// @brief Energy report captured from the firmware
+typedef struct SIM_REPORT_t
+{
+    int64_t  s64_World_us;                      //!< World time of the report
+    float    f_Report_uAh;                      //!< Charge since the previous report
+    uint32_t u32_Cycle;                         //!< Completed cycles at the time of the report
+
+}SIM_REPORT_t;
+
+/// @brief State shared between the supervisor and the boots. Lives in MAP_SHARED memory.
+typedef struct SIM_SHARED_t
+{
+    double   af_Param[SIM_Num_Params];          //!< Parameter values
+    uint32_t au32_Cnt[SIM_Num_Counters];        //!< Event counters
+
+    uint64_t u64_Rng;                           //!< Random generator state
+    double   f_Env_Temp_C;                      //!< Environment seen by the sensors
+    double   f_Env_RH_Pct;
+    double   f_Env_Lux;
+
+    int64_t  s64_World_us;                      //!< World time at the start of the current boot
+    esp_reset_reason_t ResetReason;             //!< Reset reason of the current boot
+    uint32_t u32_PanicsInRow;                   //!< Consecutive panics without a completed cycle
+
+    bool     b_RtcValid;                        //!< au8_Rtc holds a saved RTC image
+    bool     b_NoInitValid;                     //!< au8_NoInit holds a saved RTC image
+    size_t   RtcLen;
+    size_t   NoInitLen;
+    uint8_t  au8_Rtc[SIM_RTC_MAX_SIZE];
+    uint8_t  au8_NoInit[SIM_RTC_MAX_SIZE];
+    uint8_t  au8_Flash[SIM_FLASH_MAX_SIZE];     //!< flashqueue partition. Erased (0xFF) on the first power on
+
+    uint32_t u32_CyclesWanted;                  //!< Stop after this number of cycles
+    uint32_t u32_Cycles;                        //!< Completed cycles
+    uint32_t u32_Reports;                       //!< Captured energy reports
+    int32_t  s32_State;                         //!< Last app state reported to the energy accountant
+    int      ExitCode;                          //!< SIM_EXIT_* of the last boot
+    char     ac_ExitMsg[160];                   //!< Reason for SIM_EXIT_STALLED/STUCK/PANIC
+
+}SIM_SHARED_t;
+
+typedef struct sim_task sim_task_t;
+
+/// @brief Tasks waiting for a sim_signal(..). Ordered by priority, FIFO within a priority.
+typedef struct SIM_WAITQ_t
+{
+    sim_task_t *pHead;
+
+}SIM_WAITQ_t;
+
+
+/* Exported variables --------------------------------------------------------*/
+extern SIM_SHARED_t *sim_shm;
+extern const char * const sim_param_names[SIM_Num_Params];
+extern const char * const sim_param_help[SIM_Num_Params];
+extern const double sim_param_defaults[SIM_Num_Params];
+extern const char * const sim_counter_names[SIM_Num_Counters];
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/* sim_kernel.c */
+void sim_kernel_start(int64_t s64_Start_us);
+int64_t sim_now_us(void);
+bool sim_wait(SIM_WAITQ_t *pWaitQ, int64_t s64_Deadline_us);
+bool sim_signal(SIM_WAITQ_t *pWaitQ);
+void sim_busy_us(int64_t s64_Duration_us);
+void sim_timer_after(int64_t s64_Delay_us, void (*pFunc)(void *), void *pArg);
+void sim_skip_us(int64_t s64_Duration_us);
+void sim_watchdog_set(int64_t s64_Deadline_us);
+
+/* sim_main.c */
+void sim_exit(int ExitCode, const char *pFormat, ...) __attribute__((noreturn, format(printf, 2, 3)));
+void sim_deep_sleep(int64_t s64_Sleep_us) __attribute__((noreturn));
+int64_t sim_world_us(void);
+
+/* sim_system.c */
+uint32_t sim_rand_u32(void);
+double sim_rand_unit(void);
+bool sim_rand_pct(double f_Pct);
+int64_t sim_rand_ms_us(double f_Ms, double f_JitterMs);
+void sim_log_level_set(esp_log_level_t Level);
+
+/* sim_wifi.c */
+int64_t sim_wifi_rx_delay_us(void);
+bool sim_wifi_has_ip(void);
+
+/* sim_i2c.c */
+void sim_i2c_power(bool b_On);
+
+
+#endif /* SIM_H_ */
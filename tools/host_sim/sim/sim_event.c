@@ -0,0 +1,402 @@
+/**
+  ******************************************************************************
+  * @file    sim_event.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - esp_event loops.
+  *          Each loop has a queue and a task like on target. Handlers are
+  *          called in the order of ESP-IDF.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. esp_event_loop_create_default(..) creates the default loop with the
+       priority of the sys_evt task. Only loops with a dedicated task are
+       supported.
+    2. For each event the handlers registered for any base are called first,
+       then the handlers for any id of the base, then the handlers for the id.
+       Within each group in registration order.
+    3. Registering the same (non instance) handler again only updates its
+       argument. Unregistering a handler which is not registered returns
+       ESP_OK like on target.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+struct sim_event_handler
+{
+    esp_event_base_t     Base;                  //!< ESP_EVENT_ANY_BASE for all bases
+    int32_t              s32_ID;                //!< ESP_EVENT_ANY_ID for all ids
+    esp_event_handler_t  pFunc;
+    void                *pArg;
+    bool                 b_Instance;            //!< Registered via esp_event_handler_instance_register(..)
+    bool                 b_Removed;             //!< Unlinked after the running dispatch
+    struct sim_event_handler *pNext;
+};
+
+struct sim_event_loop
+{
+    QueueHandle_t        Queue;
+    TaskHandle_t         Task;
+    struct sim_event_handler *pHandlers;
+    uint32_t             u32_DispatchDepth;
+};
+
+typedef struct SIM_EVENT_t
+{
+    esp_event_base_t     Base;
+    int32_t              s32_ID;
+    void                *pData;                 //!< Copy of the event data. NULL if no data
+
+}SIM_EVENT_t;
+
+typedef enum
+{
+    SIM_MATCH_AnyBase,
+    SIM_MATCH_AnyID,
+    SIM_MATCH_ID,
+
+    SIM_MATCH_Num
+
+}SIM_MATCH_t;
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_DEFAULT_LOOP_QUEUE_SIZE     32
+
+
+/* Private variables ---------------------------------------------------------*/
+static esp_event_loop_handle_t DefaultLoop;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void sim_event_task(void *pArg);
+static void sim_event_dispatch(esp_event_loop_handle_t pLoop, const SIM_EVENT_t *pEvent);
+static void sim_event_cleanup(esp_event_loop_handle_t pLoop);
+static esp_err_t sim_event_register(esp_event_loop_handle_t pLoop, esp_event_base_t Base, int32_t s32_ID, esp_event_handler_t pFunc, void *pArg, esp_event_handler_instance_t *pInstance);
+static esp_err_t sim_event_unregister(esp_event_loop_handle_t pLoop, esp_event_base_t Base, int32_t s32_ID, esp_event_handler_t pFunc, esp_event_handler_instance_t Instance);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *event_loop_args, esp_event_loop_handle_t *event_loop)
+{
+    esp_event_loop_handle_t pLoop;
+
+    if(event_loop_args == NULL || event_loop == NULL || event_loop_args->task_name == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    pLoop = calloc(1, sizeof(struct sim_event_loop));
+    if(pLoop == NULL)
+        return ESP_ERR_NO_MEM;
+
+    pLoop->Queue = xQueueCreate(event_loop_args->queue_size, sizeof(SIM_EVENT_t));
+    if(pLoop->Queue == NULL)
+    {
+        free(pLoop);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *event_loop = pLoop;
+    xTaskCreate(sim_event_task, event_loop_args->task_name, event_loop_args->task_stack_size, pLoop, event_loop_args->task_priority, &pLoop->Task);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    esp_event_loop_args_t LoopArgs =
+    {
+        .queue_size      = SIM_DEFAULT_LOOP_QUEUE_SIZE,
+        .task_name       = "sys_evt",
+        .task_priority   = SIM_TASK_PRIO_EVENT,
+        .task_stack_size = 2304,
+        .task_core_id    = 0,
+    };
+
+    if(DefaultLoop != NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    return esp_event_loop_create(&LoopArgs, &DefaultLoop);
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    SIM_EVENT_t Event = { .Base = event_base, .s32_ID = event_id, .pData = NULL };
+
+    if(event_loop == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(event_data != NULL && event_data_size > 0)
+    {
+        Event.pData = malloc(event_data_size);
+        if(Event.pData == NULL)
+            return ESP_ERR_NO_MEM;
+
+        memcpy(Event.pData, event_data, event_data_size);
+    }
+
+    if(xQueueSend(event_loop->Queue, &Event, ticks_to_wait) != pdTRUE)
+    {
+        free(Event.pData);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    if(DefaultLoop == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    return esp_event_post_to(DefaultLoop, event_base, event_id, event_data, event_data_size, ticks_to_wait);
+}
+
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    return sim_event_register(event_loop, event_base, event_id, event_handler, event_handler_arg, NULL);
+}
+
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler)
+{
+    return sim_event_unregister(event_loop, event_base, event_id, event_handler, NULL);
+}
+
+esp_err_t esp_event_handler_instance_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg, esp_event_handler_instance_t *instance)
+{
+    esp_event_handler_instance_t Dummy;
+
+    //The instance is optional on target as well. The handler then cannot be unregistered.
+    return sim_event_register(event_loop, event_base, event_id, event_handler, event_handler_arg, (instance != NULL) ? instance : &Dummy);
+}
+
+esp_err_t esp_event_handler_instance_unregister_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id, esp_event_handler_instance_t instance)
+{
+    if(instance == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return sim_event_unregister(event_loop, event_base, event_id, NULL, instance);
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    if(DefaultLoop == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    return esp_event_handler_register_with(DefaultLoop, event_base, event_id, event_handler, event_handler_arg);
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler)
+{
+    if(DefaultLoop == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    return esp_event_handler_unregister_with(DefaultLoop, event_base, event_id, event_handler);
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg, esp_event_handler_instance_t *instance)
+{
+    if(DefaultLoop == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    return esp_event_handler_instance_register_with(DefaultLoop, event_base, event_id, event_handler, event_handler_arg, instance);
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_instance_t instance)
+{
+    if(DefaultLoop == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    return esp_event_handler_instance_unregister_with(DefaultLoop, event_base, event_id, instance);
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief      Event loop task. Dispatches the posted events.
+/// @param pArg Event loop
+static void sim_event_task(void *pArg)
+{
+    esp_event_loop_handle_t pLoop = pArg;
+    SIM_EVENT_t Event;
+
+    for(;;)
+    {
+        if(xQueueReceive(pLoop->Queue, &Event, portMAX_DELAY) != pdTRUE)
+            continue;
+
+        sim_event_dispatch(pLoop, &Event);
+        free(Event.pData);
+    }
+}
+
+
+/// @brief        Calls all handlers matching an event
+/// @param pLoop  Event loop
+/// @param pEvent Event
+static void sim_event_dispatch(esp_event_loop_handle_t pLoop, const SIM_EVENT_t *pEvent)
+{
+    pLoop->u32_DispatchDepth++;
+
+    for(SIM_MATCH_t Match = SIM_MATCH_AnyBase; Match < SIM_MATCH_Num; Match++)
+    {
+        for(struct sim_event_handler *pHandler = pLoop->pHandlers; pHandler != NULL; pHandler = pHandler->pNext)
+        {
+            bool b_Match;
+
+            if(pHandler->b_Removed)
+                continue;
+
+            switch(Match)
+            {
+                case SIM_MATCH_AnyBase: b_Match = (pHandler->Base == ESP_EVENT_ANY_BASE);                                              break;
+                case SIM_MATCH_AnyID:   b_Match = (pHandler->Base == pEvent->Base && pHandler->s32_ID == ESP_EVENT_ANY_ID);            break;
+                default:                b_Match = (pHandler->Base == pEvent->Base && pHandler->s32_ID == pEvent->s32_ID);              break;
+            }
+
+            if(b_Match)
+                pHandler->pFunc(pHandler->pArg, pEvent->Base, pEvent->s32_ID, pEvent->pData);
+        }
+    }
+
+    pLoop->u32_DispatchDepth--;
+    sim_event_cleanup(pLoop);
+}
+
+
+/// @brief       Frees the handlers unregistered while dispatching
+/// @param pLoop Event loop
+static void sim_event_cleanup(esp_event_loop_handle_t pLoop)
+{
+    struct sim_event_handler **ppPos = &pLoop->pHandlers;
+
+    if(pLoop->u32_DispatchDepth > 0)
+        return;
+
+    while(*ppPos != NULL)
+    {
+        struct sim_event_handler *pHandler = *ppPos;
+
+        if(pHandler->b_Removed)
+        {
+            *ppPos = pHandler->pNext;
+            free(pHandler);
+        }
+        else
+            ppPos = &pHandler->pNext;
+    }
+}
+
+
+/// @brief           Registers a handler
+/// @param pLoop     Event loop
+/// @param Base      Event base or ESP_EVENT_ANY_BASE
+/// @param s32_ID    Event id or ESP_EVENT_ANY_ID
+/// @param pFunc     Handler
+/// @param pArg      Handler argument
+/// @param pInstance NULL for a non instance handler, otherwise returns the instance
+/// @return          ESP_OK on success
+static esp_err_t sim_event_register(esp_event_loop_handle_t pLoop, esp_event_base_t Base, int32_t s32_ID, esp_event_handler_t pFunc, void *pArg, esp_event_handler_instance_t *pInstance)
+{
+    struct sim_event_handler **ppPos;
+    struct sim_event_handler *pHandler;
+
+    if(pLoop == NULL || pFunc == NULL || (Base == ESP_EVENT_ANY_BASE && s32_ID != ESP_EVENT_ANY_ID))
+        return ESP_ERR_INVALID_ARG;
+
+    for(ppPos = &pLoop->pHandlers; *ppPos != NULL; ppPos = &(*ppPos)->pNext)
+    {
+        pHandler = *ppPos;
+
+        if(pInstance == NULL && pHandler->b_Instance == false && pHandler->b_Removed == false &&
+           pHandler->Base == Base && pHandler->s32_ID == s32_ID && pHandler->pFunc == pFunc)
+        {
+            pHandler->pArg = pArg;
+            return ESP_OK;
+        }
+    }
+
+    pHandler = calloc(1, sizeof(struct sim_event_handler));
+    if(pHandler == NULL)
+        return ESP_ERR_NO_MEM;
+
+    pHandler->Base       = Base;
+    pHandler->s32_ID     = s32_ID;
+    pHandler->pFunc      = pFunc;
+    pHandler->pArg       = pArg;
+    pHandler->b_Instance = (pInstance != NULL);
+    *ppPos = pHandler;
+
+    if(pInstance != NULL)
+        *pInstance = pHandler;
+
+    return ESP_OK;
+}
+
+
+/// @brief          Unregisters a handler
+/// @param pLoop    Event loop
+/// @param Base     Event base
+/// @param s32_ID   Event id
+/// @param pFunc    Handler of a non instance registration. NULL if Instance is used
+/// @param Instance Instance of an instance registration
+/// @return         ESP_OK, also if the handler is not registered
+static esp_err_t sim_event_unregister(esp_event_loop_handle_t pLoop, esp_event_base_t Base, int32_t s32_ID, esp_event_handler_t pFunc, esp_event_handler_instance_t Instance)
+{
+    if(pLoop == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    for(struct sim_event_handler *pHandler = pLoop->pHandlers; pHandler != NULL; pHandler = pHandler->pNext)
+    {
+        if(pHandler->b_Removed || pHandler->Base != Base || pHandler->s32_ID != s32_ID)
+            continue;
+
+        if((Instance != NULL && pHandler == Instance) || (Instance == NULL && pHandler->b_Instance == false && pHandler->pFunc == pFunc))
+        {
+            pHandler->b_Removed = true;
+            break;
+        }
+    }
+
+    sim_event_cleanup(pLoop);
+
+    return ESP_OK;
+}
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,498 @@
+/**
+  ******************************************************************************
+  * @file    sim_i2c.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - i2cdev with an emulated SHT4x and TSL2591.
+  *          Replaces DRV_I2Cdev. The real sensor drivers run on top and see
+  *          the timing and the register behaviour of the sensors.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. The sensors are only powered while CONFIG_APP_PERIPH_PWR_PIN is high.
+       Without power every transfer fails and power off resets the sensors.
+    2. Each transfer takes the bus time of its bytes at the clock of the
+       device descriptor. i2c.fail_pct makes a transfer time out.
+    3. The environment (temperature, humidity, illuminance) does a random walk
+       of env.walk per power on, i.e. per sample.
+    4. SHT4x: serial number, soft reset and the three single shot
+       measurements. Reading before the measurement is done is NACKed.
+       TSL2591: register file with ENABLE, CONTROL, PERSIST, STATUS and the
+       channel data. The channels are valid one integration time after
+       PON and AEN are set or CONTROL is written.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim.h"
+#include "i2cdev.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct SIM_SHT4X_t
+{
+    uint8_t  au8_Res[6];                        //!< Response of the last command
+    bool     b_ResValid;                        //!< A response can be read
+    int64_t  s64_Ready_us;                      //!< Response available from
+
+}SIM_SHT4X_t;
+
+typedef struct SIM_TSL2591_t
+{
+    uint8_t  au8_Reg[32];
+    int64_t  s64_Valid_us;                      //!< Channel data valid from. SIM_FOREVER if not integrating
+
+}SIM_TSL2591_t;
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_SHT4X_ADDR              0x44
+#define SIM_SHT4X_SERIAL            0x1A2B3C4DUL
+#define SIM_SHT4X_CMD_SERIAL        0x89
+#define SIM_SHT4X_CMD_RESET         0x94
+#define SIM_SHT4X_CMD_MEAS_HIGH     0xFD
+#define SIM_SHT4X_CMD_MEAS_MED      0xF6
+#define SIM_SHT4X_CMD_MEAS_LOW      0xE0
+
+#define SIM_TSL2591_ADDR            0x29
+#define SIM_TSL2591_CMD             0x80
+#define SIM_TSL2591_TRANSACTION     0x60
+#define SIM_TSL2591_SPECIAL         0x60
+#define SIM_TSL2591_REG_MASK        0x1F
+#define SIM_TSL2591_REG_ENABLE      0x00
+#define SIM_TSL2591_REG_CONTROL     0x01
+#define SIM_TSL2591_REG_ID          0x12
+#define SIM_TSL2591_REG_STATUS      0x13
+#define SIM_TSL2591_REG_C0DATAL     0x14
+#define SIM_TSL2591_ID              0x50
+#define SIM_TSL2591_ENABLE_PON      0x01
+#define SIM_TSL2591_ENABLE_AEN      0x02
+#define SIM_TSL2591_STATUS_AVALID   0x01
+#define SIM_TSL2591_CH1_RATIO       0.3         //!< IR share of the full spectrum channel
+#define SIM_TSL2591_LUX_DF          408.0
+
+#define SIM_I2C_DEFAULT_CLK_HZ      100000
+
+
+/* Private variables ---------------------------------------------------------*/
+static bool b_Powered;
+static SIM_SHT4X_t Sht4x;
+static SIM_TSL2591_t Tsl2591;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static esp_err_t sim_i2c_xfer(const i2c_dev_t *dev, size_t Bytes);
+static void sim_i2c_env_step(void);
+static uint8_t sim_sht4x_crc(const uint8_t *pData);
+static void sim_sht4x_set_word(uint8_t *pRes, double f_Value);
+static esp_err_t sim_sht4x_write(const uint8_t *pData, size_t Size);
+static esp_err_t sim_sht4x_read(uint8_t *pData, size_t Size);
+static void sim_tsl2591_update(void);
+static esp_err_t sim_tsl2591_write(const uint8_t *pData, size_t Size);
+static esp_err_t sim_tsl2591_read(uint8_t u8_Cmd, uint8_t *pData, size_t Size);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief      Sensor supply switched
+/// @param b_On true if the sensors are powered now
+void sim_i2c_power(bool b_On)
+{
+    b_Powered = b_On;
+
+    memset(&Sht4x, 0, sizeof(Sht4x));
+    memset(&Tsl2591, 0, sizeof(Tsl2591));
+    Tsl2591.au8_Reg[SIM_TSL2591_REG_ID] = SIM_TSL2591_ID;
+    Tsl2591.s64_Valid_us = SIM_FOREVER;
+
+    if(b_On)
+        sim_i2c_env_step( );
+}
+
+
+/* i2cdev --------------------------------------------------------------------*/
+
+esp_err_t i2cdev_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2cdev_done(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev)
+{
+    if(dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    dev->mutex = xSemaphoreCreateMutex( );
+
+    return (dev->mutex != NULL) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t i2c_dev_delete_mutex(i2c_dev_t *dev)
+{
+    if(dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    vSemaphoreDelete(dev->mutex);
+    dev->mutex = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_take_mutex(i2c_dev_t *dev)
+{
+    if(dev == NULL || dev->mutex == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return (xSemaphoreTake(dev->mutex, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT)) == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t i2c_dev_give_mutex(i2c_dev_t *dev)
+{
+    if(dev == NULL || dev->mutex == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return (xSemaphoreGive(dev->mutex) == pdTRUE) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t i2c_dev_probe(const i2c_dev_t *dev, i2c_dev_type_t operation_type)
+{
+    esp_err_t Err = sim_i2c_xfer(dev, 0);
+
+    (void)operation_type;
+
+    if(Err == ESP_OK && dev->addr != SIM_SHT4X_ADDR && dev->addr != SIM_TSL2591_ADDR)
+        Err = ESP_FAIL;
+
+    return Err;
+}
+
+esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
+    esp_err_t Err;
+
+    if(dev == NULL || in_data == NULL || in_size == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    Err = sim_i2c_xfer(dev, out_size + in_size);
+    if(Err != ESP_OK)
+        return Err;
+
+    if(dev->addr == SIM_SHT4X_ADDR)
+    {
+        if(out_size > 0)
+        {
+            Err = sim_sht4x_write(out_data, out_size);
+            if(Err != ESP_OK)
+                return Err;
+        }
+        return sim_sht4x_read(in_data, in_size);
+    }
+
+    if(dev->addr == SIM_TSL2591_ADDR && out_size > 0)
+        return sim_tsl2591_read(((const uint8_t *)out_data)[0], in_data, in_size);
+
+    return ESP_FAIL;
+}
+
+esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+{
+    uint8_t au8_Buf[64];
+    esp_err_t Err;
+
+    if(dev == NULL || out_data == NULL || out_size == 0 || out_reg_size + out_size > sizeof(au8_Buf))
+        return ESP_ERR_INVALID_ARG;
+
+    Err = sim_i2c_xfer(dev, out_reg_size + out_size);
+    if(Err != ESP_OK)
+        return Err;
+
+    if(out_reg_size > 0)
+        memcpy(au8_Buf, out_reg, out_reg_size);
+    memcpy(&au8_Buf[out_reg_size], out_data, out_size);
+
+    if(dev->addr == SIM_SHT4X_ADDR)
+        return sim_sht4x_write(au8_Buf, out_reg_size + out_size);
+
+    if(dev->addr == SIM_TSL2591_ADDR)
+        return sim_tsl2591_write(au8_Buf, out_reg_size + out_size);
+
+    return ESP_FAIL;
+}
+
+esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *in_data, size_t in_size)
+{
+    return i2c_dev_read(dev, &reg, 1, in_data, in_size);
+}
+
+esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *out_data, size_t out_size)
+{
+    return i2c_dev_write(dev, &reg, 1, out_data, out_size);
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief       Bus time and errors of one transfer
+/// @param dev   Device descriptor
+/// @param Bytes Data bytes of the transfer
+/// @return      ESP_OK if the device acknowledged
+static esp_err_t sim_i2c_xfer(const i2c_dev_t *dev, size_t Bytes)
+{
+    uint32_t u32_Clk_Hz = dev->cfg.master.clk_speed ? dev->cfg.master.clk_speed : SIM_I2C_DEFAULT_CLK_HZ;
+
+    //9 clocks per byte incl. ACK, plus address and start/stop
+    sim_busy_us((int64_t)((Bytes + 2) * 9) * 1000000 / u32_Clk_Hz);
+    SIM_COUNT(I2C_XFER);
+
+    if(b_Powered == false)
+    {
+        SIM_COUNT(I2C_FAIL);
+        return ESP_FAIL;
+    }
+
+    if(sim_rand_pct(SIM_P(I2C_FAIL_PCT)))
+    {
+        SIM_COUNT(I2C_FAIL);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+
+/// @brief Random walk of the environment
+static void sim_i2c_env_step(void)
+{
+    double f_Walk = SIM_P(ENV_WALK);
+
+    sim_shm->f_Env_Temp_C += (2.0 * sim_rand_unit( ) - 1.0) * f_Walk * 10.0;
+    sim_shm->f_Env_RH_Pct *= 1.0 + (2.0 * sim_rand_unit( ) - 1.0) * f_Walk;
+    sim_shm->f_Env_Lux    *= 1.0 + (2.0 * sim_rand_unit( ) - 1.0) * f_Walk;
+
+    if(sim_shm->f_Env_RH_Pct > 100.0)
+        sim_shm->f_Env_RH_Pct = 100.0;
+}
+
+
+/// @brief       CRC-8 of a SHT4x word. Polynomial 0x31, init 0xFF.
+/// @param pData 2 bytes
+/// @return      CRC
+static uint8_t sim_sht4x_crc(const uint8_t *pData)
+{
+    uint8_t u8_Crc = 0xFF;
+
+    for(int i = 0; i < 2; i++)
+    {
+        u8_Crc ^= pData[i];
+        for(int Bit = 0; Bit < 8; Bit++)
+            u8_Crc = (u8_Crc & 0x80) ? (uint8_t)((u8_Crc << 1) ^ 0x31) : (uint8_t)(u8_Crc << 1);
+    }
+
+    return u8_Crc;
+}
+
+
+/// @brief         Writes a word and its CRC into a response
+/// @param pRes    3 bytes of the response
+/// @param f_Value Raw value
+static void sim_sht4x_set_word(uint8_t *pRes, double f_Value)
+{
+    uint16_t u16_Raw;
+
+    if(f_Value < 0.0)
+        f_Value = 0.0;
+    if(f_Value > 65535.0)
+        f_Value = 65535.0;
+
+    u16_Raw = (uint16_t)(f_Value + 0.5);
+    pRes[0] = (uint8_t)(u16_Raw >> 8);
+    pRes[1] = (uint8_t)u16_Raw;
+    pRes[2] = sim_sht4x_crc(pRes);
+}
+
+
+/// @brief       Command to the SHT4x
+/// @param pData Command
+/// @param Size  Size of the command
+/// @return      ESP_FAIL if the command is NACKed
+static esp_err_t sim_sht4x_write(const uint8_t *pData, size_t Size)
+{
+    double f_Meas_ms;
+
+    if(Size != 1)
+        return ESP_FAIL;
+
+    switch(pData[0])
+    {
+        case SIM_SHT4X_CMD_SERIAL:
+            sim_sht4x_set_word(&Sht4x.au8_Res[0], (double)(SIM_SHT4X_SERIAL >> 16));
+            sim_sht4x_set_word(&Sht4x.au8_Res[3], (double)(SIM_SHT4X_SERIAL & 0xFFFF));
+            Sht4x.b_ResValid   = true;
+            Sht4x.s64_Ready_us = sim_now_us( ) + 1000;
+            return ESP_OK;
+
+        case SIM_SHT4X_CMD_RESET:
+            Sht4x.b_ResValid = false;
+            return ESP_OK;
+
+        case SIM_SHT4X_CMD_MEAS_HIGH: f_Meas_ms = 8.3; break;
+        case SIM_SHT4X_CMD_MEAS_MED:  f_Meas_ms = 4.5; break;
+        case SIM_SHT4X_CMD_MEAS_LOW:  f_Meas_ms = 1.7; break;
+
+        default:
+            return ESP_FAIL;
+    }
+
+    sim_sht4x_set_word(&Sht4x.au8_Res[0], (sim_shm->f_Env_Temp_C + 45.0) * 65535.0 / 175.0);
+    sim_sht4x_set_word(&Sht4x.au8_Res[3], (sim_shm->f_Env_RH_Pct + 6.0) * 65535.0 / 125.0);
+    Sht4x.b_ResValid   = true;
+    Sht4x.s64_Ready_us = sim_now_us( ) + (int64_t)(f_Meas_ms * 1000.0);
+
+    return ESP_OK;
+}
+
+
+/// @brief       Reads the response of the last SHT4x command
+/// @param pData Response
+/// @param Size  Bytes to read
+/// @return      ESP_FAIL if no response is available (NACK)
+static esp_err_t sim_sht4x_read(uint8_t *pData, size_t Size)
+{
+    if(Sht4x.b_ResValid == false || sim_now_us( ) < Sht4x.s64_Ready_us || Size > sizeof(Sht4x.au8_Res))
+        return ESP_FAIL;
+
+    memcpy(pData, Sht4x.au8_Res, Size);
+    Sht4x.b_ResValid = false;
+
+    return ESP_OK;
+}
+
+
+/// @brief Updates STATUS and the channel data of the TSL2591
+static void sim_tsl2591_update(void)
+{
+    static const double af_Gain[4] = { 1.0, 25.0, 428.0, 9876.0 };
+    uint8_t u8_Control = Tsl2591.au8_Reg[SIM_TSL2591_REG_CONTROL];
+    uint8_t u8_ITime   = u8_Control & 0x07;
+    double f_ATime_ms, f_Cpl, f_C0, f_C1, f_Max;
+
+    if(Tsl2591.s64_Valid_us == SIM_FOREVER || sim_now_us( ) < Tsl2591.s64_Valid_us)
+        return;
+
+    if(u8_ITime > 5)
+        u8_ITime = 0;
+
+    f_ATime_ms = 100.0 * (u8_ITime + 1);
+    f_Cpl      = f_ATime_ms * af_Gain[(u8_Control >> 4) & 0x03] / SIM_TSL2591_LUX_DF;
+    f_Max      = (u8_ITime == 0) ? 36863.0 : 65535.0;
+
+    //Inverse of the driver's lux formula with CH1 = ratio * CH0
+    f_C0 = sim_shm->f_Env_Lux * f_Cpl / ((1.0 - SIM_TSL2591_CH1_RATIO) * (1.0 - SIM_TSL2591_CH1_RATIO));
+    if(f_C0 > f_Max)
+        f_C0 = f_Max;
+    f_C1 = f_C0 * SIM_TSL2591_CH1_RATIO;
+
+    Tsl2591.au8_Reg[SIM_TSL2591_REG_C0DATAL + 0] = (uint8_t)((uint16_t)f_C0);
+    Tsl2591.au8_Reg[SIM_TSL2591_REG_C0DATAL + 1] = (uint8_t)((uint16_t)f_C0 >> 8);
+    Tsl2591.au8_Reg[SIM_TSL2591_REG_C0DATAL + 2] = (uint8_t)((uint16_t)f_C1);
+    Tsl2591.au8_Reg[SIM_TSL2591_REG_C0DATAL + 3] = (uint8_t)((uint16_t)f_C1 >> 8);
+    Tsl2591.au8_Reg[SIM_TSL2591_REG_STATUS] |= SIM_TSL2591_STATUS_AVALID;
+}
+
+
+/// @brief       Command (and register data) to the TSL2591
+/// @param pData Command byte followed by the data
+/// @param Size  Size
+/// @return      ESP_FAIL if the command is NACKed
+static esp_err_t sim_tsl2591_write(const uint8_t *pData, size_t Size)
+{
+    uint8_t u8_Reg = pData[0] & SIM_TSL2591_REG_MASK;
+    uint8_t u8_Enable;
+
+    if((pData[0] & SIM_TSL2591_CMD) == 0)
+        return ESP_FAIL;
+
+    //Special functions only clear or set interrupts. Not used by the app.
+    if((pData[0] & SIM_TSL2591_TRANSACTION) == SIM_TSL2591_SPECIAL)
+        return ESP_OK;
+
+    for(size_t i = 1; i < Size && u8_Reg < sizeof(Tsl2591.au8_Reg); i++, u8_Reg++)
+    {
+        if(u8_Reg == SIM_TSL2591_REG_ID || u8_Reg >= SIM_TSL2591_REG_STATUS)
+            continue;
+
+        Tsl2591.au8_Reg[u8_Reg] = pData[i];
+
+        //Enabling or reconfiguring the ADC starts a new integration
+        if(u8_Reg == SIM_TSL2591_REG_ENABLE || u8_Reg == SIM_TSL2591_REG_CONTROL)
+        {
+            u8_Enable = Tsl2591.au8_Reg[SIM_TSL2591_REG_ENABLE];
+            Tsl2591.au8_Reg[SIM_TSL2591_REG_STATUS] &= (uint8_t)~SIM_TSL2591_STATUS_AVALID;
+
+            if((u8_Enable & (SIM_TSL2591_ENABLE_PON | SIM_TSL2591_ENABLE_AEN)) == (SIM_TSL2591_ENABLE_PON | SIM_TSL2591_ENABLE_AEN))
+                Tsl2591.s64_Valid_us = sim_now_us( ) + (int64_t)(Tsl2591.au8_Reg[SIM_TSL2591_REG_CONTROL] & 0x07) * 100000 + 100000;
+            else
+                Tsl2591.s64_Valid_us = SIM_FOREVER;
+        }
+    }
+
+    return ESP_OK;
+}
+
+
+/// @brief       Reads TSL2591 registers
+/// @param u8_Cmd Command byte with the start register
+/// @param pData Register data
+/// @param Size  Bytes to read
+/// @return      ESP_FAIL if the command is NACKed
+static esp_err_t sim_tsl2591_read(uint8_t u8_Cmd, uint8_t *pData, size_t Size)
+{
+    uint8_t u8_Reg = u8_Cmd & SIM_TSL2591_REG_MASK;
+
+    if((u8_Cmd & SIM_TSL2591_CMD) == 0 || u8_Reg + Size > sizeof(Tsl2591.au8_Reg))
+        return ESP_FAIL;
+
+    sim_tsl2591_update( );
+    memcpy(pData, &Tsl2591.au8_Reg[u8_Reg], Size);
+
+    return ESP_OK;
+}
+
+/*****************************END OF FILE**************************************/
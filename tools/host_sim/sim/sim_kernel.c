@@ -0,0 +1,844 @@
+/**
+  ******************************************************************************
+  * @file    sim_kernel.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - Virtual time FreeRTOS kernel.
+  *          Tasks, queues, semaphores and task notifications on top of
+  *          pthreads. Exactly one task runs at a time.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. Each task is a pthread. The running task holds the kernel lock and hands
+       it over to the next task like a baton. The highest priority ready task
+       runs, tasks of the same priority run in FIFO order. A task is
+       preempted when it makes a task with a higher priority ready.
+    2. Time does not pass while a task runs. When no task is ready the clock
+       jumps to the earliest timeout. If there is no timeout either the run is
+       stalled and ends with SIM_EXIT_STALLED.
+    3. sim_timer_after(..) callbacks run in the sim timer task (priority of the
+       esp_timer task).
+    4. Call sim_kernel_start(..) from the thread which then calls app_main(..).
+       It becomes the main task.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <pthread.h>
+#include "sim.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+    TS_Ready,
+    TS_Running,
+    TS_Blocked,
+    TS_Deleted,
+
+}SIM_TASK_STATE_t;
+
+struct sim_task
+{
+    pthread_t        Thread;
+    pthread_cond_t   Cond;                      //!< Signalled when the task gets the baton
+    char             ac_Name[16];
+    UBaseType_t      Prio;
+    TaskFunction_t   pFunc;
+    void            *pArg;
+    uint32_t         u32_StackDepth;            //!< As passed to xTaskCreate(..). The host stack is not measured.
+
+    SIM_TASK_STATE_t State;
+    sim_task_t      *pNextReady;                //!< Ready list
+    sim_task_t      *pNextWait;                 //!< Wait queue the task blocks on
+    SIM_WAITQ_t     *pWaitQ;
+    int64_t          s64_Deadline_us;           //!< Timeout of the current block. SIM_FOREVER if none
+    bool             b_Signaled;                //!< Woken by sim_signal(..) and not by the timeout
+    sim_task_t      *pNextAll;                  //!< List of all tasks
+
+    uint32_t         u32_Notify;                //!< Task notification value
+    bool             b_NotifyPending;
+    SIM_WAITQ_t      NotifyWaitQ;
+};
+
+typedef enum
+{
+    SQ_Queue,
+    SQ_Binary,
+    SQ_Mutex,
+    SQ_Counting,
+
+}SIM_QUEUE_TYPE_t;
+
+struct sim_queue
+{
+    SIM_QUEUE_TYPE_t Type;
+    UBaseType_t      Length;
+    UBaseType_t      ItemSize;
+    UBaseType_t      Count;
+    UBaseType_t      Head;                      //!< Index of the oldest item
+    uint8_t         *pu8_Items;
+    SIM_WAITQ_t      RxWaitQ;                   //!< Tasks waiting for an item
+    SIM_WAITQ_t      TxWaitQ;                   //!< Tasks waiting for space
+};
+
+typedef struct SIM_TIMER_t
+{
+    int64_t  s64_Due_us;
+    void   (*pFunc)(void *);
+    void    *pArg;
+    struct SIM_TIMER_t *pNext;
+
+}SIM_TIMER_t;
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_TASK_STACK_SIZE     (256 * 1024)
+
+
+/* Private macro -------------------------------------------------------------*/
+#define TICKS_TO_DEADLINE(t)    ((t) == portMAX_DELAY ? SIM_FOREVER : s64_Now_us + (int64_t)(t) * (1000000 / configTICK_RATE_HZ))
+
+
+/* Private variables ---------------------------------------------------------*/
+static pthread_mutex_t Kernel_Lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_task_t     *pCurrent;                //!< Task holding the baton
+static sim_task_t     *pReadyList;              //!< Sorted by priority, FIFO within a priority
+static sim_task_t     *pAllTasks;
+static int64_t         s64_Now_us;
+static int64_t         s64_Watchdog_us = SIM_FOREVER;
+
+static SIM_TIMER_t    *pTimers;                 //!< Sorted by due time, FIFO for the same time
+static SIM_WAITQ_t     TimerWaitQ;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static sim_task_t *sim_task_new(const char *pName, UBaseType_t Prio);
+static void *sim_task_entry(void *pArg);
+static void sim_timer_task(void *pArg);
+static void sim_ready_push(sim_task_t *pTask, bool b_Front);
+static void sim_ready_remove(sim_task_t *pTask);
+static void sim_waitq_push(SIM_WAITQ_t *pWaitQ, sim_task_t *pTask);
+static void sim_waitq_remove(SIM_WAITQ_t *pWaitQ, sim_task_t *pTask);
+static void sim_switch(void);
+static void sim_preempt(void);
+static void sim_release_due(void);
+static void sim_advance(void);
+static struct sim_queue *sim_queue_new(SIM_QUEUE_TYPE_t Type, UBaseType_t Length, UBaseType_t ItemSize, UBaseType_t Count);
+static BaseType_t sim_queue_send(struct sim_queue *pQueue, const void *pItem, TickType_t Ticks, bool b_Front);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief              Turns the calling thread into the main task and starts the timer task
+/// @param s64_Start_us Clock at app_main
+void sim_kernel_start(int64_t s64_Start_us)
+{
+    sim_task_t *pMain = sim_task_new("main", SIM_TASK_PRIO_MAIN);
+
+    s64_Now_us = s64_Start_us;
+    pthread_mutex_lock(&Kernel_Lock);
+
+    pMain->Thread = pthread_self();
+    pMain->State  = TS_Running;
+    pCurrent      = pMain;
+
+    xTaskCreate(sim_timer_task, "esp_timer", 4096, NULL, SIM_TASK_PRIO_TIMER, NULL);
+}
+
+
+/// @brief  Virtual time since boot
+/// @return Time in µs
+int64_t sim_now_us(void)
+{
+    return s64_Now_us;
+}
+
+
+/// @brief                 Blocks the running task
+/// @param pWaitQ          Wait queue to wait on. NULL to just wait for the deadline
+/// @param s64_Deadline_us Time the block ends at the latest. SIM_FOREVER for no timeout
+/// @return                true if woken by sim_signal(..), false on timeout
+bool sim_wait(SIM_WAITQ_t *pWaitQ, int64_t s64_Deadline_us)
+{
+    sim_task_t *pSelf = pCurrent;
+
+    pSelf->State           = TS_Blocked;
+    pSelf->s64_Deadline_us = s64_Deadline_us;
+    pSelf->b_Signaled      = false;
+    pSelf->pWaitQ          = pWaitQ;
+
+    if(pWaitQ != NULL)
+        sim_waitq_push(pWaitQ, pSelf);
+
+    sim_switch( );
+
+    return pSelf->b_Signaled;
+}
+
+
+/// @brief        Wakes the first task of a wait queue. Preempts the caller if it has a lower priority.
+/// @param pWaitQ Wait queue
+/// @return       true if a task was woken
+bool sim_signal(SIM_WAITQ_t *pWaitQ)
+{
+    sim_task_t *pTask = pWaitQ->pHead;
+
+    if(pTask == NULL)
+        return false;
+
+    sim_waitq_remove(pWaitQ, pTask);
+    pTask->b_Signaled = true;
+    sim_ready_push(pTask, false);
+    sim_preempt( );
+
+    return true;
+}
+
+
+/// @brief                 Models CPU or bus time of the running task. Other tasks can run meanwhile.
+/// @param s64_Duration_us Duration
+void sim_busy_us(int64_t s64_Duration_us)
+{
+    if(s64_Duration_us > 0)
+        sim_wait(NULL, s64_Now_us + s64_Duration_us);
+}
+
+
+/// @brief              Calls pFunc(pArg) from the timer task after a delay
+/// @param s64_Delay_us Delay
+/// @param pFunc        Callback
+/// @param pArg         Argument for the callback
+void sim_timer_after(int64_t s64_Delay_us, void (*pFunc)(void *), void *pArg)
+{
+    SIM_TIMER_t *pTimer = calloc(1, sizeof(SIM_TIMER_t));
+    SIM_TIMER_t **ppPos = &pTimers;
+
+    pTimer->s64_Due_us = s64_Now_us + (s64_Delay_us > 0 ? s64_Delay_us : 0);
+    pTimer->pFunc      = pFunc;
+    pTimer->pArg       = pArg;
+
+    while(*ppPos != NULL && (*ppPos)->s64_Due_us <= pTimer->s64_Due_us)
+        ppPos = &(*ppPos)->pNext;
+
+    pTimer->pNext = *ppPos;
+    *ppPos = pTimer;
+
+    //New earliest timer. Let the timer task pick up the new deadline.
+    if(pTimers == pTimer)
+        sim_signal(&TimerWaitQ);
+}
+
+
+/// @brief                 Advances the clock while all tasks are frozen (light sleep).
+///                        Timeouts which expired meanwhile are handled after the call.
+///                        The sleep time does not count for the watchdog.
+/// @param s64_Duration_us Duration
+void sim_skip_us(int64_t s64_Duration_us)
+{
+    if(s64_Duration_us > 0)
+    {
+        s64_Now_us += s64_Duration_us;
+
+        if(s64_Watchdog_us != SIM_FOREVER)
+            s64_Watchdog_us += s64_Duration_us;
+    }
+
+    sim_release_due( );
+    sim_preempt( );
+}
+
+
+/// @brief                 Sets the time the next cycle must have ended at
+/// @param s64_Deadline_us Deadline. SIM_FOREVER to disable the watchdog
+void sim_watchdog_set(int64_t s64_Deadline_us)
+{
+    s64_Watchdog_us = s64_Deadline_us;
+}
+
+
+/* FreeRTOS tasks ------------------------------------------------------------*/
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, const BaseType_t xCoreID)
+{
+    pthread_attr_t Attr;
+    sim_task_t *pTask = sim_task_new(pcName, uxPriority);
+
+    pTask->pFunc = pxTaskCode;
+    pTask->pArg  = pvParameters;
+    pTask->u32_StackDepth = usStackDepth;
+
+    pthread_attr_init(&Attr);
+    pthread_attr_setstacksize(&Attr, SIM_TASK_STACK_SIZE);
+    pthread_attr_setdetachstate(&Attr, PTHREAD_CREATE_DETACHED);
+
+    if(pthread_create(&pTask->Thread, &Attr, sim_task_entry, pTask) != 0)
+        sim_exit(SIM_EXIT_PANIC, "pthread_create failed for task %s", pcName);
+
+    pthread_attr_destroy(&Attr);
+
+    if(pxCreatedTask != NULL)
+        *pxCreatedTask = pTask;
+
+    sim_ready_push(pTask, false);
+    sim_preempt( );
+
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    sim_task_t *pTask = (xTaskToDelete == NULL) ? pCurrent : xTaskToDelete;
+
+    if(pTask != pCurrent)
+    {
+        //The thread stays blocked on its condition forever. It never gets the baton again.
+        if(pTask->State == TS_Ready)
+            sim_ready_remove(pTask);
+        else if(pTask->State == TS_Blocked && pTask->pWaitQ != NULL)
+            sim_waitq_remove(pTask->pWaitQ, pTask);
+
+        pTask->State = TS_Deleted;
+        return;
+    }
+
+    pTask->State = TS_Deleted;
+    sim_switch( );
+    pthread_mutex_unlock(&Kernel_Lock);
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    if(xTicksToDelay == 0)
+    {
+        pCurrent->State = TS_Ready;
+        sim_ready_push(pCurrent, false);
+        sim_switch( );
+        return;
+    }
+
+    sim_wait(NULL, TICKS_TO_DEADLINE(xTicksToDelay));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(s64_Now_us / (1000000 / configTICK_RATE_HZ));
+}
+
+UBaseType_t uxTaskPriorityGet(const TaskHandle_t xTask)
+{
+    return (xTask == NULL) ? pCurrent->Prio : xTask->Prio;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+    return (xTask == NULL) ? pCurrent->u32_StackDepth : xTask->u32_StackDepth;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return pCurrent;
+}
+
+const char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+    return (xTaskToQuery == NULL) ? pCurrent->ac_Name : xTaskToQuery->ac_Name;
+}
+
+
+/* FreeRTOS task notifications -----------------------------------------------*/
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    sim_task_t *pSelf = pCurrent;
+    int64_t s64_Deadline_us = TICKS_TO_DEADLINE(xTicksToWait);
+    uint32_t u32_Value;
+
+    while(pSelf->u32_Notify == 0 && xTicksToWait != 0)
+    {
+        if(sim_wait(&pSelf->NotifyWaitQ, s64_Deadline_us) == false)
+            break;
+    }
+
+    u32_Value = pSelf->u32_Notify;
+
+    if(u32_Value != 0)
+        pSelf->u32_Notify = (xClearCountOnExit != pdFALSE) ? 0 : u32_Value - 1;
+
+    pSelf->b_NotifyPending = false;
+
+    return u32_Value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction)
+{
+    BaseType_t Ret = pdPASS;
+
+    switch(eAction)
+    {
+        case eSetBits:                  xTaskToNotify->u32_Notify |= ulValue;   break;
+        case eIncrement:                xTaskToNotify->u32_Notify++;            break;
+        case eSetValueWithOverwrite:    xTaskToNotify->u32_Notify = ulValue;    break;
+        case eSetValueWithoutOverwrite:
+            if(xTaskToNotify->b_NotifyPending)
+                Ret = pdFAIL;
+            else
+                xTaskToNotify->u32_Notify = ulValue;
+            break;
+        default:
+            break;
+    }
+
+    if(Ret == pdPASS)
+    {
+        xTaskToNotify->b_NotifyPending = true;
+        sim_signal(&xTaskToNotify->NotifyWaitQ);
+    }
+
+    return Ret;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    return xTaskNotify(xTaskToNotify, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue, TickType_t xTicksToWait)
+{
+    sim_task_t *pSelf = pCurrent;
+    int64_t s64_Deadline_us = TICKS_TO_DEADLINE(xTicksToWait);
+    BaseType_t Ret;
+
+    if(pSelf->b_NotifyPending == false)
+        pSelf->u32_Notify &= ~ulBitsToClearOnEntry;
+
+    while(pSelf->b_NotifyPending == false && xTicksToWait != 0)
+    {
+        if(sim_wait(&pSelf->NotifyWaitQ, s64_Deadline_us) == false)
+            break;
+    }
+
+    if(pulNotificationValue != NULL)
+        *pulNotificationValue = pSelf->u32_Notify;
+
+    Ret = pSelf->b_NotifyPending ? pdTRUE : pdFALSE;
+
+    if(Ret == pdTRUE)
+        pSelf->u32_Notify &= ~ulBitsToClearOnExit;
+
+    pSelf->b_NotifyPending = false;
+
+    return Ret;
+}
+
+
+/* FreeRTOS queues and semaphores --------------------------------------------*/
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    return sim_queue_new(SQ_Queue, uxQueueLength, uxItemSize, 0);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return sim_queue_send(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return sim_queue_send(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    int64_t s64_Deadline_us = TICKS_TO_DEADLINE(xTicksToWait);
+
+    while(xQueue->Count == 0)
+    {
+        if(xTicksToWait == 0 || sim_wait(&xQueue->RxWaitQ, s64_Deadline_us) == false)
+            return pdFALSE;
+    }
+
+    if(xQueue->ItemSize > 0)
+        memcpy(pvBuffer, xQueue->pu8_Items + xQueue->Head * xQueue->ItemSize, xQueue->ItemSize);
+
+    xQueue->Head = (xQueue->Head + 1) % xQueue->Length;
+    xQueue->Count--;
+
+    sim_signal(&xQueue->TxWaitQ);
+
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue)
+{
+    return xQueue->Count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue)
+{
+    return xQueue->Length - xQueue->Count;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    if(xQueue == NULL)
+        return;
+
+    if(xQueue->RxWaitQ.pHead != NULL || xQueue->TxWaitQ.pHead != NULL)
+        sim_exit(SIM_EXIT_PANIC, "vQueueDelete(..) of a queue with waiting tasks");
+
+    free(xQueue->pu8_Items);
+    free(xQueue);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sim_queue_new(SQ_Binary, 1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sim_queue_new(SQ_Mutex, 1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    return sim_queue_new(SQ_Counting, uxMaxCount, 0, uxInitialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    return xQueueReceive(xSemaphore, NULL, xBlockTime);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    return sim_queue_send(xSemaphore, NULL, 0, false);
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief       Allocates a task control block
+/// @param pName Task name
+/// @param Prio  Priority
+/// @return      Task
+static sim_task_t *sim_task_new(const char *pName, UBaseType_t Prio)
+{
+    sim_task_t *pTask = calloc(1, sizeof(sim_task_t));
+
+    if(pTask == NULL)
+        sim_exit(SIM_EXIT_PANIC, "Out of memory");
+
+    pthread_cond_init(&pTask->Cond, NULL);
+    snprintf(pTask->ac_Name, sizeof(pTask->ac_Name), "%s", pName != NULL ? pName : "");
+    pTask->Prio            = Prio;
+    pTask->State           = TS_Ready;
+    pTask->s64_Deadline_us = SIM_FOREVER;
+    pTask->pNextAll        = pAllTasks;
+    pAllTasks = pTask;
+
+    return pTask;
+}
+
+
+/// @brief      Thread function of all tasks except main. Waits for the baton before running the task function.
+/// @param pArg Task
+static void *sim_task_entry(void *pArg)
+{
+    sim_task_t *pTask = pArg;
+
+    pthread_mutex_lock(&Kernel_Lock);
+
+    while(pCurrent != pTask)
+        pthread_cond_wait(&pTask->Cond, &Kernel_Lock);
+
+    pTask->pFunc(pTask->pArg);
+
+    //FreeRTOS tasks must not return. Behave like vTaskDelete(NULL)
+    vTaskDelete(NULL);
+
+    return NULL;
+}
+
+
+/// @brief      Runs the sim_timer_after(..) callbacks when they are due
+/// @param pArg Not used
+static void sim_timer_task(void *pArg)
+{
+    for(;;)
+    {
+        while(pTimers != NULL && pTimers->s64_Due_us <= s64_Now_us)
+        {
+            SIM_TIMER_t *pTimer = pTimers;
+
+            pTimers = pTimer->pNext;
+            pTimer->pFunc(pTimer->pArg);
+            free(pTimer);
+        }
+
+        sim_wait(&TimerWaitQ, (pTimers != NULL) ? pTimers->s64_Due_us : SIM_FOREVER);
+    }
+}
+
+
+/// @brief         Makes a task ready
+/// @param pTask   Task
+/// @param b_Front true: Runs before other ready tasks of the same priority (preempted task)
+static void sim_ready_push(sim_task_t *pTask, bool b_Front)
+{
+    sim_task_t **ppPos = &pReadyList;
+
+    while(*ppPos != NULL && ((*ppPos)->Prio > pTask->Prio || ((*ppPos)->Prio == pTask->Prio && b_Front == false)))
+        ppPos = &(*ppPos)->pNextReady;
+
+    pTask->State           = TS_Ready;
+    pTask->s64_Deadline_us = SIM_FOREVER;
+    pTask->pWaitQ          = NULL;
+    pTask->pNextReady      = *ppPos;
+    *ppPos = pTask;
+}
+
+
+/// @brief       Removes a task from the ready list
+/// @param pTask Task
+static void sim_ready_remove(sim_task_t *pTask)
+{
+    sim_task_t **ppPos = &pReadyList;
+
+    while(*ppPos != NULL && *ppPos != pTask)
+        ppPos = &(*ppPos)->pNextReady;
+
+    if(*ppPos != NULL)
+        *ppPos = pTask->pNextReady;
+}
+
+
+/// @brief        Adds a task to a wait queue. Ordered by priority like FreeRTOS event lists.
+/// @param pWaitQ Wait queue
+/// @param pTask  Task
+static void sim_waitq_push(SIM_WAITQ_t *pWaitQ, sim_task_t *pTask)
+{
+    sim_task_t **ppPos = &pWaitQ->pHead;
+
+    while(*ppPos != NULL && (*ppPos)->Prio >= pTask->Prio)
+        ppPos = &(*ppPos)->pNextWait;
+
+    pTask->pNextWait = *ppPos;
+    *ppPos = pTask;
+}
+
+
+/// @brief        Removes a task from a wait queue
+/// @param pWaitQ Wait queue
+/// @param pTask  Task
+static void sim_waitq_remove(SIM_WAITQ_t *pWaitQ, sim_task_t *pTask)
+{
+    sim_task_t **ppPos = &pWaitQ->pHead;
+
+    while(*ppPos != NULL && *ppPos != pTask)
+        ppPos = &(*ppPos)->pNextWait;
+
+    if(*ppPos != NULL)
+        *ppPos = pTask->pNextWait;
+
+    pTask->pWaitQ = NULL;
+}
+
+
+/// @brief Hands the baton to the highest priority ready task. The state of the running task must be set before.
+///        Returns when the calling task got the baton back, or right away if it is deleted.
+static void sim_switch(void)
+{
+    sim_task_t *pSelf = pCurrent;
+    sim_task_t *pNext;
+
+    while(pReadyList == NULL)
+        sim_advance( );
+
+    pNext = pReadyList;
+    pReadyList = pNext->pNextReady;
+    pNext->State = TS_Running;
+
+    if(pNext == pSelf)
+        return;
+
+    pCurrent = pNext;
+    pthread_cond_signal(&pNext->Cond);
+
+    if(pSelf->State == TS_Deleted)
+        return;
+
+    while(pCurrent != pSelf)
+        pthread_cond_wait(&pSelf->Cond, &Kernel_Lock);
+}
+
+
+/// @brief Yields if a task with a higher priority than the running task is ready
+static void sim_preempt(void)
+{
+    if(pReadyList == NULL || pReadyList->Prio <= pCurrent->Prio)
+        return;
+
+    sim_ready_push(pCurrent, true);
+    sim_switch( );
+}
+
+
+/// @brief Makes all tasks ready whose timeout has expired
+static void sim_release_due(void)
+{
+    for(sim_task_t *pTask = pAllTasks; pTask != NULL; pTask = pTask->pNextAll)
+    {
+        if(pTask->State != TS_Blocked || pTask->s64_Deadline_us == SIM_FOREVER || pTask->s64_Deadline_us > s64_Now_us)
+            continue;
+
+        if(pTask->pWaitQ != NULL)
+            sim_waitq_remove(pTask->pWaitQ, pTask);
+
+        pTask->b_Signaled = false;
+        sim_ready_push(pTask, false);
+    }
+}
+
+
+/// @brief Nothing is ready. Advances the clock to the earliest timeout.
+static void sim_advance(void)
+{
+    int64_t s64_Next_us = SIM_FOREVER;
+
+    for(sim_task_t *pTask = pAllTasks; pTask != NULL; pTask = pTask->pNextAll)
+    {
+        if(pTask->State == TS_Blocked && pTask->s64_Deadline_us != SIM_FOREVER)
+        {
+            if(s64_Next_us == SIM_FOREVER || pTask->s64_Deadline_us < s64_Next_us)
+                s64_Next_us = pTask->s64_Deadline_us;
+        }
+    }
+
+    if(s64_Next_us == SIM_FOREVER)
+        sim_exit(SIM_EXIT_STALLED, "All tasks blocked without timeout at %lld ms", (long long)(s64_Now_us / 1000));
+
+    if(s64_Watchdog_us != SIM_FOREVER && s64_Next_us > s64_Watchdog_us)
+    {
+        s64_Now_us = s64_Watchdog_us;
+        sim_exit(SIM_EXIT_STUCK, "No cycle end within %.0f s", SIM_P(WATCHDOG_S));
+    }
+
+    if(s64_Next_us > s64_Now_us)
+        s64_Now_us = s64_Next_us;
+
+    sim_release_due( );
+}
+
+
+/// @brief          Allocates a queue or semaphore
+/// @param Type     See SIM_QUEUE_TYPE_t
+/// @param Length   Max. number of items
+/// @param ItemSize Item size. 0 for semaphores
+/// @param Count    Initial count (semaphores)
+/// @return         Queue
+static struct sim_queue *sim_queue_new(SIM_QUEUE_TYPE_t Type, UBaseType_t Length, UBaseType_t ItemSize, UBaseType_t Count)
+{
+    struct sim_queue *pQueue = calloc(1, sizeof(struct sim_queue));
+
+    if(pQueue == NULL)
+        return NULL;
+
+    pQueue->Type     = Type;
+    pQueue->Length   = Length;
+    pQueue->ItemSize = ItemSize;
+    pQueue->Count    = Count;
+
+    if(ItemSize > 0)
+    {
+        pQueue->pu8_Items = malloc(Length * ItemSize);
+
+        if(pQueue->pu8_Items == NULL)
+        {
+            free(pQueue);
+            return NULL;
+        }
+    }
+
+    return pQueue;
+}
+
+
+/// @brief         Adds an item to a queue or gives a semaphore
+/// @param pQueue  Queue
+/// @param pItem   Item. NULL for semaphores
+/// @param Ticks   Max. time to wait for space
+/// @param b_Front true: Adds the item in front of the queue
+/// @return        pdTRUE on success, errQUEUE_FULL (pdFALSE) on timeout
+static BaseType_t sim_queue_send(struct sim_queue *pQueue, const void *pItem, TickType_t Ticks, bool b_Front)
+{
+    int64_t s64_Deadline_us = TICKS_TO_DEADLINE(Ticks);
+    UBaseType_t Idx;
+
+    while(pQueue->Count >= pQueue->Length)
+    {
+        //A semaphore given twice stays given
+        if(pQueue->ItemSize == 0 || Ticks == 0 || sim_wait(&pQueue->TxWaitQ, s64_Deadline_us) == false)
+            return pdFALSE;
+    }
+
+    if(pQueue->ItemSize > 0)
+    {
+        if(b_Front)
+        {
+            pQueue->Head = (pQueue->Head + pQueue->Length - 1) % pQueue->Length;
+            Idx = pQueue->Head;
+        }
+        else
+            Idx = (pQueue->Head + pQueue->Count) % pQueue->Length;
+
+        memcpy(pQueue->pu8_Items + Idx * pQueue->ItemSize, pItem, pQueue->ItemSize);
+    }
+
+    pQueue->Count++;
+    sim_signal(&pQueue->RxWaitQ);
+
+    return pdTRUE;
+}
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,579 @@
+/**
+  ******************************************************************************
+  * @file    sim_main.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - Supervisor and boot of the firmware.
+  *          Every boot of the chip is a child process. Deep sleep, restarts
+  *          and panics end the child and the supervisor boots again with the
+  *          RTC memory of the previous boot. At the end the wake cycle
+  *          timings and the charge per cycle are summarized.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. sim_<mode>_ps_<ps> [-n cycles] [-s seed] [-p name=value]... [-v|-vv|-q]
+       -l lists all model parameters with their default values.
+    2. The run ends after the requested number of wake cycles
+       (mod_prof_CycleEnd(..)), if the firmware stalls, if a cycle does not end
+       within watchdog_s or after 3 panics in a row.
+    3. The cycle timings are taken from MOD_Profiler, the charge from the
+       energy reports of MOD_Power (linker --wrap). The first report includes
+       the power on and is not used for the average.
+    4. Same seed and parameters give the same result. -q prints one line with
+       the key figures, e.g. to compare variants.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "sim.h"
+#include "mod_profiler.h"
+#include "mod_pwr_energy.h"
+#include "main_app_sm.h"
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_DEFAULT_CYCLES          8
+#define SIM_DEFAULT_SEED            1
+#define SIM_MAX_PANICS_IN_ROW       3
+#define SIM_REPORTS_PER_CYCLE       4           //!< Capacity of the report buffer per cycle
+
+#ifndef SIM_VARIANT
+#define SIM_VARIANT                 "unknown"
+#endif
+
+
+/* Private macro -------------------------------------------------------------*/
+#define SIM_PARAM_NAME(id, name, def, help)     name,
+#define SIM_PARAM_HELP(id, name, def, help)     help,
+#define SIM_PARAM_DEF(id, name, def, help)      def,
+#define SIM_COUNTER_NAME(id, name)              name,
+
+
+/* Private variables ---------------------------------------------------------*/
+SIM_SHARED_t *sim_shm;
+const char * const sim_param_names[SIM_Num_Params]      = { SIM_PARAMS(SIM_PARAM_NAME) };
+const char * const sim_param_help[SIM_Num_Params]       = { SIM_PARAMS(SIM_PARAM_HELP) };
+const double sim_param_defaults[SIM_Num_Params]         = { SIM_PARAMS(SIM_PARAM_DEF) };
+const char * const sim_counter_names[SIM_Num_Counters]  = { SIM_COUNTERS(SIM_COUNTER_NAME) };
+
+static PROF_RECORD_t *pRecords;                 //!< One record per completed cycle. Shared memory
+static SIM_REPORT_t *pReports;                  //!< Captured energy reports. Shared memory
+static uint32_t u32_ReportsMax;
+static uint64_t u64_Seed = SIM_DEFAULT_SEED;
+
+/*RTC sections of the firmware. Defined by the linker if the section is not empty.*/
+extern uint8_t __start_sim_rtc[] __attribute__((weak));
+extern uint8_t __stop_sim_rtc[] __attribute__((weak));
+extern uint8_t __start_sim_rtc_noinit[] __attribute__((weak));
+extern uint8_t __stop_sim_rtc_noinit[] __attribute__((weak));
+
+
+/* Private function prototypes -----------------------------------------------*/
+extern void app_main(void);
+void __real_mod_prof_CycleStart(bool b_Boot);
+void __real_mod_prof_CycleEnd(uint32_t u32_Sleep_s);
+void __real_mod_pwr_energy_SetState(uint8_t u8_State);
+void __real_mod_pwr_energy_Report(PWR_ENERGY_REPORT_t *pReport);
+
+static void sim_usage(const char *pProg);
+static void sim_list_params(void);
+static bool sim_set_param(const char *pArg);
+static void *sim_shared_alloc(size_t Size);
+static void sim_boot(void) __attribute__((noreturn));
+static void sim_crash_handler(int Signal);
+static void sim_rtc_save(void);
+static void sim_rtc_restore(void);
+static void sim_summary(bool b_Quiet, double f_Wall_ms);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+    esp_log_level_t LogLevel = ESP_LOG_WARN;
+    bool b_Quiet = false;
+    uint32_t u32_Cycles = SIM_DEFAULT_CYCLES;
+    struct timespec Start, End;
+    int Opt;
+
+    sim_shm = sim_shared_alloc(sizeof(SIM_SHARED_t));
+    memcpy(sim_shm->af_Param, sim_param_defaults, sizeof(sim_shm->af_Param));
+    memset(sim_shm->au8_Flash, 0xFF, sizeof(sim_shm->au8_Flash));
+
+    while((Opt = getopt(argc, argv, "n:s:p:vqlh")) != -1)
+    {
+        switch(Opt)
+        {
+            case 'n': u32_Cycles = (uint32_t)strtoul(optarg, NULL, 0);     break;
+            case 's': u64_Seed   = strtoull(optarg, NULL, 0);              break;
+            case 'v': LogLevel   = (LogLevel < ESP_LOG_INFO) ? ESP_LOG_INFO : ESP_LOG_DEBUG; break;
+            case 'q': b_Quiet    = true; LogLevel = ESP_LOG_NONE;          break;
+            case 'l': sim_list_params( );                                  return 0;
+            case 'p':
+                if(sim_set_param(optarg) == false)
+                    return 2;
+                break;
+            default:
+                sim_usage(argv[0]);
+                return (Opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if(u32_Cycles == 0)
+    {
+        sim_usage(argv[0]);
+        return 2;
+    }
+
+    u32_ReportsMax = u32_Cycles * SIM_REPORTS_PER_CYCLE;
+    pRecords = sim_shared_alloc(sizeof(PROF_RECORD_t) * u32_Cycles);
+    pReports = sim_shared_alloc(sizeof(SIM_REPORT_t) * u32_ReportsMax);
+
+    //splitmix64 of the seed. xorshift must not start with 0.
+    sim_shm->u64_Rng = u64_Seed + 0x9E3779B97F4A7C15ULL;
+    sim_shm->u64_Rng = (sim_shm->u64_Rng ^ (sim_shm->u64_Rng >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    sim_shm->u64_Rng = (sim_shm->u64_Rng ^ (sim_shm->u64_Rng >> 27)) * 0x94D049BB133111EBULL;
+    sim_shm->u64_Rng = (sim_shm->u64_Rng ^ (sim_shm->u64_Rng >> 31)) | 1;
+
+    sim_shm->f_Env_Temp_C     = SIM_P(ENV_TEMP_C);
+    sim_shm->f_Env_RH_Pct     = SIM_P(ENV_RH_PCT);
+    sim_shm->f_Env_Lux        = SIM_P(ENV_LUX);
+    sim_shm->ResetReason      = ESP_RST_POWERON;
+    sim_shm->u32_CyclesWanted = u32_Cycles;
+    sim_log_level_set(LogLevel);
+
+    clock_gettime(CLOCK_MONOTONIC, &Start);
+
+    for(;;)
+    {
+        pid_t Pid;
+        int Status;
+
+        fflush(stdout);
+        Pid = fork( );
+        if(Pid < 0)
+        {
+            perror("fork");
+            return 1;
+        }
+
+        if(Pid == 0)
+            sim_boot( );
+
+        waitpid(Pid, &Status, 0);
+
+        if(WIFEXITED(Status))
+            sim_shm->ExitCode = WEXITSTATUS(Status);
+        else
+        {
+            sim_shm->ExitCode = SIM_EXIT_PANIC;
+            snprintf(sim_shm->ac_ExitMsg, sizeof(sim_shm->ac_ExitMsg), "Killed by signal %d", WTERMSIG(Status));
+        }
+
+        if(sim_shm->ExitCode == SIM_EXIT_DEEP_SLEEP)
+        {
+            sim_shm->ResetReason = ESP_RST_DEEPSLEEP;
+            continue;
+        }
+
+        //RTC_DATA_ATTR is loaded from the image again on every reset except the deep sleep wakeup
+        sim_shm->b_RtcValid = false;
+
+        if(sim_shm->ExitCode == SIM_EXIT_RESTART)
+        {
+            sim_shm->ResetReason = ESP_RST_SW;
+            continue;
+        }
+
+        if(sim_shm->ExitCode == SIM_EXIT_PANIC)
+        {
+            SIM_COUNT(PANIC);
+            if(b_Quiet == false)
+                printf("*** Panic: %s\n", sim_shm->ac_ExitMsg);
+
+            sim_shm->ResetReason = ESP_RST_PANIC;
+            if(++sim_shm->u32_PanicsInRow < SIM_MAX_PANICS_IN_ROW)
+                continue;
+        }
+
+        break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &End);
+    sim_summary(b_Quiet, (End.tv_sec - Start.tv_sec) * 1e3 + (End.tv_nsec - Start.tv_nsec) / 1e6);
+
+    return (sim_shm->ExitCode == SIM_EXIT_DONE) ? 0 : 1;
+}
+
+
+/// @brief          Ends the current boot
+/// @param ExitCode SIM_EXIT_*
+/// @param pFormat  Reason, printf format
+void sim_exit(int ExitCode, const char *pFormat, ...)
+{
+    va_list Args;
+
+    va_start(Args, pFormat);
+    vsnprintf(sim_shm->ac_ExitMsg, sizeof(sim_shm->ac_ExitMsg), pFormat, Args);
+    va_end(Args);
+
+    //Time passes on for resets. Deep sleep adds its own time.
+    if(ExitCode == SIM_EXIT_RESTART || ExitCode == SIM_EXIT_PANIC)
+        sim_shm->s64_World_us += sim_now_us( );
+
+    fflush(stdout);
+    _exit(ExitCode);
+}
+
+
+/// @brief              Saves the RTC memory and ends the boot
+/// @param s64_Sleep_us Sleep time until the timer wakeup
+void sim_deep_sleep(int64_t s64_Sleep_us)
+{
+    sim_rtc_save( );
+    sim_shm->s64_World_us += sim_now_us( ) + s64_Sleep_us;
+
+    fflush(stdout);
+    _exit(SIM_EXIT_DEEP_SLEEP);
+}
+
+
+/// @brief  Time since the first power on incl. all sleep and boot times
+/// @return Time in µs
+int64_t sim_world_us(void)
+{
+    return sim_shm->s64_World_us + sim_now_us( );
+}
+
+
+/* Wrapped firmware functions ------------------------------------------------*/
+
+void __wrap_mod_prof_CycleStart(bool b_Boot)
+{
+    __real_mod_prof_CycleStart(b_Boot);
+    sim_watchdog_set(sim_now_us( ) + (int64_t)(SIM_P(WATCHDOG_S) * 1e6));
+}
+
+void __wrap_mod_prof_CycleEnd(uint32_t u32_Sleep_s)
+{
+    uint32_t u32_Cnt;
+
+    __real_mod_prof_CycleEnd(u32_Sleep_s);
+
+    u32_Cnt = mod_prof_GetRecordCnt( );
+    if(u32_Cnt > 0 && sim_shm->u32_Cycles < sim_shm->u32_CyclesWanted)
+        mod_prof_GetRecord(u32_Cnt - 1, &pRecords[sim_shm->u32_Cycles]);
+
+    sim_shm->u32_Cycles++;
+    sim_shm->u32_PanicsInRow = 0;
+
+    if(sim_shm->u32_Cycles >= sim_shm->u32_CyclesWanted)
+        sim_exit(SIM_EXIT_DONE, "%" PRIu32 " cycles done", sim_shm->u32_Cycles);
+
+    sim_watchdog_set(sim_now_us( ) + (int64_t)u32_Sleep_s * 1000000 + (int64_t)(SIM_P(WATCHDOG_S) * 1e6));
+}
+
+void __wrap_mod_pwr_energy_SetState(uint8_t u8_State)
+{
+    __real_mod_pwr_energy_SetState(u8_State);
+    sim_shm->s32_State = u8_State;
+}
+
+/*The system time is kept by the RTC over deep sleep. Starts at 0 on the first power on.*/
+int __wrap_gettimeofday(struct timeval *tv, void *tz)
+{
+    int64_t s64_Now_us = sim_world_us( );
+
+    (void)tz;
+    if(tv != NULL)
+    {
+        tv->tv_sec  = (time_t)(s64_Now_us / 1000000);
+        tv->tv_usec = (suseconds_t)(s64_Now_us % 1000000);
+    }
+    return 0;
+}
+
+void __wrap_mod_pwr_energy_Report(PWR_ENERGY_REPORT_t *pReport)
+{
+    __real_mod_pwr_energy_Report(pReport);
+
+    if(sim_shm->u32_Reports < u32_ReportsMax)
+    {
+        pReports[sim_shm->u32_Reports].s64_World_us = sim_world_us( );
+        pReports[sim_shm->u32_Reports].f_Report_uAh = pReport->f_Report_uAh;
+        pReports[sim_shm->u32_Reports].u32_Cycle    = sim_shm->u32_Cycles;
+        sim_shm->u32_Reports++;
+    }
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief       Prints the command line help
+/// @param pProg Program name
+static void sim_usage(const char *pProg)
+{
+    printf("Usage: %s [-n cycles] [-s seed] [-p name=value]... [-v|-vv|-q] [-l] [-h]\n"
+           "  -n  Number of wake cycles to simulate (default %d)\n"
+           "  -s  Seed of the random generator (default %d)\n"
+           "  -p  Set a model parameter, see -l\n"
+           "  -v  Log level INFO, -vv DEBUG. Default WARN\n"
+           "  -q  No firmware logs, one result line\n"
+           "  -l  List the model parameters\n", pProg, SIM_DEFAULT_CYCLES, SIM_DEFAULT_SEED);
+}
+
+
+/// @brief Prints the model parameters with default and description
+static void sim_list_params(void)
+{
+    for(int i = 0; i < SIM_Num_Params; i++)
+        printf("%-22s %10g  %s\n", sim_param_names[i], sim_param_defaults[i], sim_param_help[i]);
+}
+
+
+/// @brief      Sets a model parameter
+/// @param pArg name=value
+/// @return     false if the name is unknown or the value is missing
+static bool sim_set_param(const char *pArg)
+{
+    const char *pValue = strchr(pArg, '=');
+
+    if(pValue != NULL)
+    {
+        for(int i = 0; i < SIM_Num_Params; i++)
+        {
+            if(strlen(sim_param_names[i]) == (size_t)(pValue - pArg) && strncmp(sim_param_names[i], pArg, pValue - pArg) == 0)
+            {
+                sim_shm->af_Param[i] = strtod(pValue + 1, NULL);
+                return true;
+            }
+        }
+    }
+
+    fprintf(stderr, "Unknown parameter '%s'. Use -l to list them.\n", pArg);
+
+    return false;
+}
+
+
+/// @brief      Allocates memory shared with the boot processes
+/// @param Size Size
+/// @return     Zeroed memory
+static void *sim_shared_alloc(size_t Size)
+{
+    void *pMem = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if(pMem == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(1);
+    }
+
+    return pMem;
+}
+
+
+/// @brief One boot of the chip. Runs in the child process.
+static void sim_boot(void)
+{
+    sim_shm->s64_World_us += (int64_t)(SIM_P(BOOT_BOOTLOADER_MS) * 1000.0);
+    SIM_COUNT(BOOT);
+    sim_rtc_restore( );
+
+    signal(SIGABRT, sim_crash_handler);
+    signal(SIGSEGV, sim_crash_handler);
+    signal(SIGFPE,  sim_crash_handler);
+
+    sim_kernel_start((int64_t)(SIM_P(BOOT_STARTUP_MS) * 1000.0));
+    sim_watchdog_set(sim_now_us( ) + (int64_t)(SIM_P(WATCHDOG_S) * 1e6));
+
+    app_main( );
+
+    //Same as on target: returning from app_main deletes the main task
+    vTaskDelete(NULL);
+    sim_exit(SIM_EXIT_PANIC, "Main task still running after vTaskDelete");
+}
+
+
+/// @brief        Crash of the firmware
+/// @param Signal Signal number
+static void sim_crash_handler(int Signal)
+{
+    sim_exit(SIM_EXIT_PANIC, "%s", (Signal == SIGABRT) ? "abort()" : (Signal == SIGSEGV) ? "Guru Meditation: Load/Store access fault" : "Guru Meditation: Illegal instruction");
+}
+
+
+/// @brief Copies both RTC sections to the shared state
+static void sim_rtc_save(void)
+{
+    size_t Len = (size_t)(__stop_sim_rtc - __start_sim_rtc);
+    size_t NoInitLen = (size_t)(__stop_sim_rtc_noinit - __start_sim_rtc_noinit);
+
+    if(__start_sim_rtc != NULL && Len <= SIM_RTC_MAX_SIZE)
+    {
+        memcpy(sim_shm->au8_Rtc, __start_sim_rtc, Len);
+        sim_shm->RtcLen     = Len;
+        sim_shm->b_RtcValid = true;
+    }
+
+    if(__start_sim_rtc_noinit != NULL && NoInitLen <= SIM_RTC_MAX_SIZE)
+    {
+        memcpy(sim_shm->au8_NoInit, __start_sim_rtc_noinit, NoInitLen);
+        sim_shm->NoInitLen     = NoInitLen;
+        sim_shm->b_NoInitValid = true;
+    }
+}
+
+
+/// @brief Restores the RTC sections of the previous boot
+static void sim_rtc_restore(void)
+{
+    if(sim_shm->b_RtcValid && __start_sim_rtc != NULL && sim_shm->RtcLen == (size_t)(__stop_sim_rtc - __start_sim_rtc))
+        memcpy(__start_sim_rtc, sim_shm->au8_Rtc, sim_shm->RtcLen);
+
+    if(sim_shm->b_NoInitValid && __start_sim_rtc_noinit != NULL && sim_shm->NoInitLen == (size_t)(__stop_sim_rtc_noinit - __start_sim_rtc_noinit))
+        memcpy(__start_sim_rtc_noinit, sim_shm->au8_NoInit, sim_shm->NoInitLen);
+}
+
+
+/// @brief           Prints the result of the run
+/// @param b_Quiet   One line only
+/// @param f_Wall_ms Host time of the run
+static void sim_summary(bool b_Quiet, double f_Wall_ms)
+{
+    uint32_t u32_Cycles = (sim_shm->u32_Cycles < sim_shm->u32_CyclesWanted) ? sim_shm->u32_Cycles : sim_shm->u32_CyclesWanted;
+    uint32_t u32_Reports = sim_shm->u32_Reports;
+    double f_AwakeSum = 0.0, f_AwakeMin = 0.0, f_AwakeMax = 0.0;
+    double f_Charge_uAh = 0.0, f_Avg_uA = 0.0, f_Life_d = 0.0, f_PerCycle_uAh = 0.0;
+    char ac_Exit[sizeof(sim_shm->ac_ExitMsg) + 48];
+
+    for(uint32_t i = 0; i < u32_Cycles; i++)
+    {
+        double f_Awake = pRecords[i].u32_Awake_ms;
+
+        f_AwakeSum += f_Awake;
+        if(i == 0 || f_Awake < f_AwakeMin) f_AwakeMin = f_Awake;
+        if(i == 0 || f_Awake > f_AwakeMax) f_AwakeMax = f_Awake;
+    }
+
+    //Skip the first report. It contains the power on and the first connect.
+    //A report can cover several cycles if samples are stored and uploaded in batches.
+    if(u32_Reports >= 2)
+    {
+        int64_t s64_Span_us = pReports[u32_Reports - 1].s64_World_us - pReports[0].s64_World_us;
+        uint32_t u32_Span_Cycles = pReports[u32_Reports - 1].u32_Cycle - pReports[0].u32_Cycle;
+
+        for(uint32_t i = 1; i < u32_Reports; i++)
+            f_Charge_uAh += pReports[i].f_Report_uAh;
+
+        f_PerCycle_uAh = f_Charge_uAh / (u32_Span_Cycles ? u32_Span_Cycles : 1);
+        if(s64_Span_us > 0)
+            f_Avg_uA = f_Charge_uAh * 3.6e9 / (double)s64_Span_us;
+        if(f_Avg_uA > 0.0)
+            f_Life_d = SIM_P(BATTERY_MAH) * 1000.0 / f_Avg_uA / 24.0;
+    }
+
+    if(sim_shm->ExitCode == SIM_EXIT_STUCK || sim_shm->ExitCode == SIM_EXIT_STALLED)
+        snprintf(ac_Exit, sizeof(ac_Exit), "%s, stuck in %s", sim_shm->ac_ExitMsg, MAS_State_to_str((MainApp_State)sim_shm->s32_State));
+    else
+        snprintf(ac_Exit, sizeof(ac_Exit), "%s", sim_shm->ac_ExitMsg);
+
+    if(b_Quiet)
+    {
+        printf("variant=%s seed=%" PRIu64 " cycles=%" PRIu32 "/%" PRIu32 " boots=%" PRIu32 " panics=%" PRIu32
+               " awake_avg_ms=%.0f awake_max_ms=%.0f uAh_per_cycle=%.1f avg_uA=%.1f life_d=%.0f exit=%d\n",
+               SIM_VARIANT, u64_Seed, u32_Cycles, sim_shm->u32_CyclesWanted, sim_shm->au32_Cnt[SIM_CNT_BOOT], sim_shm->au32_Cnt[SIM_CNT_PANIC],
+               u32_Cycles ? f_AwakeSum / u32_Cycles : 0.0, f_AwakeMax, f_PerCycle_uAh, f_Avg_uA, f_Life_d, sim_shm->ExitCode);
+        return;
+    }
+
+    printf("\n=== %s, seed %" PRIu64 ", MQTT QoS %d ===\n", SIM_VARIANT, u64_Seed, CONFIG_APP_MQTT_QoS);
+    printf("Cycles: %" PRIu32 "/%" PRIu32 "   boots: %" PRIu32 "   panics: %" PRIu32 "\n",
+           u32_Cycles, sim_shm->u32_CyclesWanted, sim_shm->au32_Cnt[SIM_CNT_BOOT], sim_shm->au32_Cnt[SIM_CNT_PANIC]);
+
+    printf("\n%-21s %6s %9s %9s %9s\n", "Phase", "runs", "avg ms", "min ms", "max ms");
+    for(int Phase = 0; Phase < PROF_Num_Phases; Phase++)
+    {
+        uint32_t u32_Runs = 0;
+        double f_Sum = 0.0, f_Min = 0.0, f_Max = 0.0;
+
+        for(uint32_t i = 0; i < u32_Cycles; i++)
+        {
+            double f_Dur;
+
+            if(pRecords[i].au16_Start_ms[Phase] == PROF_NOT_RUN)
+                continue;
+
+            f_Dur = pRecords[i].au16_Dur_ms[Phase];
+            f_Sum += f_Dur;
+            if(u32_Runs == 0 || f_Dur < f_Min) f_Min = f_Dur;
+            if(u32_Runs == 0 || f_Dur > f_Max) f_Max = f_Dur;
+            u32_Runs++;
+        }
+
+        if(u32_Runs > 0)
+            printf("%-21s %6" PRIu32 " %9.1f %9.0f %9.0f\n", mod_prof_phase_to_str((PROF_PHASE_t)Phase), u32_Runs, f_Sum / u32_Runs, f_Min, f_Max);
+    }
+    if(u32_Cycles > 0)
+        printf("%-21s %6" PRIu32 " %9.1f %9.0f %9.0f\n", "Awake", u32_Cycles, f_AwakeSum / u32_Cycles, f_AwakeMin, f_AwakeMax);
+
+    printf("\nEnergy (reports 2..%" PRIu32 "):\n", u32_Reports);
+    if(u32_Reports >= 2)
+    {
+        printf("  %.1f uAh per cycle, %.1f uA average\n", f_PerCycle_uAh, f_Avg_uA);
+        printf("  %.0f days with %.0f mAh\n", f_Life_d, SIM_P(BATTERY_MAH));
+    }
+    else
+        printf("  not enough reports\n");
+
+    printf("\nCounters:\n");
+    for(int i = 0; i < SIM_Num_Counters; i++)
+    {
+        if(sim_shm->au32_Cnt[i] != 0)
+            printf("  %-20s %" PRIu32 "\n", sim_counter_names[i], sim_shm->au32_Cnt[i]);
+    }
+
+    printf("\nExit: %s\n", ac_Exit);
+    printf("Host time: %.1f ms per cycle\n", u32_Cycles ? f_Wall_ms / u32_Cycles : f_Wall_ms);
+}
+
+/*****************************END OF FILE**************************************/
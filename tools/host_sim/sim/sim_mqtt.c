@@ -0,0 +1,587 @@
+/**
+  ******************************************************************************
+  * @file    sim_mqtt.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - esp-mqtt client fake.
+  *          Models the broker connect, the QoS handshakes incl. lost
+  *          acknowledges and the outbox. The events are posted to an event
+  *          loop with its own task like the esp-mqtt client task on target.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. esp_mqtt_client_start(..) connects after mqtt.connect_ms. A connect
+       fails with mqtt.connect_fail_pct or if the station has no IP. The
+       client retries after network.reconnect_timeout_ms (default
+       mqtt.reconnect_ms) unless auto reconnect is disabled.
+    2. QoS 1 is acknowledged after mqtt.rtt_ms plus the downlink latency of the
+       Wi-Fi power save mode, QoS 2 needs two round trips. A lost exchange
+       (mqtt.ack_loss_pct) is retransmitted after mqtt.retransmit_ms.
+    3. Messages with QoS > 0 published while disconnected are kept in the
+       outbox and sent after the next connect.
+    4. A lost Wi-Fi link is noticed on the next exchange. The client then
+       posts MQTT_EVENT_ERROR and MQTT_EVENT_DISCONNECTED.
+    5. While connected a PINGREQ is sent after half the keepalive
+       (session.keepalive, default 120 sec) like esp-mqtt does. It is an
+       exchange as well and notices a lost link while the app sleeps.
+    6. With network.transport set (mqtts) the transport connect runs in the
+       client task after mqtt.connect_ms, like esp-mqtt does. The transport
+       is closed and destroyed from the client task as well.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim.h"
+#include "mqtt_client.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+/// @brief Message with QoS > 0 waiting for its acknowledge
+typedef struct SIM_MQTT_MSG_t
+{
+    int      s32_MsgId;
+    int      s32_QoS;
+    struct SIM_MQTT_MSG_t *pNext;
+
+}SIM_MQTT_MSG_t;
+
+/// @brief Argument of the client timers
+typedef struct SIM_MQTT_TIMER_ARG_t
+{
+    esp_mqtt_client_handle_t Client;
+    uint32_t u32_Gen;                           //!< Connection generation the timer belongs to
+    int      s32_MsgId;
+
+}SIM_MQTT_TIMER_ARG_t;
+
+struct esp_mqtt_client
+{
+    esp_event_loop_handle_t Loop;
+    bool     b_Started;
+    bool     b_Connected;
+    bool     b_RetryPending;                    //!< Waiting for the auto reconnect
+    uint32_t u32_Gen;                           //!< Incremented on every connection state change
+    int      s32_LastMsgId;
+    int64_t  s64_Reconnect_us;
+    int64_t  s64_Retransmit_us;
+    int64_t  s64_Ping_us;                       //!< PINGREQ interval, half the keepalive. 0 = keepalive disabled
+    bool     b_AutoReconnect;
+    esp_transport_handle_t Transport;           //!< Custom transport. NULL = plain TCP, not modelled
+    char     ac_Host[64];                       //!< Broker host of the URI
+    int      s32_Port;                          //!< Broker port of the URI. 0 = default port of the transport
+    SIM_MQTT_MSG_t *pOutbox;
+    esp_mqtt_error_codes_t ErrorCodes;
+};
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_MQTT_QUEUE_SIZE         16
+#define SIM_MQTT_ECONNREFUSED       111
+#define SIM_MQTT_KEEPALIVE_S        120         //!< esp-mqtt default keepalive
+#define SIM_MQTT_TRANSPORT_TMO_MS   10000       //!< esp-mqtt default network timeout
+
+/// @brief Transport requests handled in the client task. Not seen by the app.
+enum
+{
+    SIM_MQTT_TRANSPORT_CONNECT = 0,
+    SIM_MQTT_TRANSPORT_CLOSE,
+    SIM_MQTT_TRANSPORT_DESTROY,
+};
+
+
+/* Private variables ---------------------------------------------------------*/
+ESP_EVENT_DEFINE_BASE(MQTT_EVENTS);
+ESP_EVENT_DEFINE_BASE(SIM_MQTT_TRANSPORT);
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void sim_mqtt_post(esp_mqtt_client_handle_t Client, esp_mqtt_event_id_t EventID, int s32_MsgId);
+static void sim_mqtt_timer(esp_mqtt_client_handle_t Client, int64_t s64_Delay_us, void (*pFunc)(void *), int s32_MsgId);
+static void sim_mqtt_connect_done(void *pArg);
+static void sim_mqtt_connected(esp_mqtt_client_handle_t Client);
+static void sim_mqtt_transport(esp_mqtt_client_handle_t Client, int32_t s32_Request);
+static void sim_mqtt_transport_handler(void *pArg, esp_event_base_t Base, int32_t s32_ID, void *pData);
+static void sim_mqtt_retry(void *pArg);
+static void sim_mqtt_send(esp_mqtt_client_handle_t Client, SIM_MQTT_MSG_t *pMsg, int64_t s64_Delay_us);
+static void sim_mqtt_ack(void *pArg);
+static void sim_mqtt_ping(void *pArg);
+static void sim_mqtt_connection_lost(esp_mqtt_client_handle_t Client);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    esp_mqtt_client_handle_t Client;
+    esp_event_loop_args_t LoopArgs =
+    {
+        .queue_size      = SIM_MQTT_QUEUE_SIZE,
+        .task_name       = "mqtt_task",
+        .task_priority   = SIM_TASK_PRIO_MQTT,
+        .task_stack_size = 6144,
+        .task_core_id    = 0,
+    };
+
+    if(config == NULL || config->broker.address.uri == NULL)
+        return NULL;
+
+    Client = calloc(1, sizeof(struct esp_mqtt_client));
+    if(Client == NULL)
+        return NULL;
+
+    if(esp_event_loop_create(&LoopArgs, &Client->Loop) != ESP_OK)
+    {
+        free(Client);
+        return NULL;
+    }
+
+    Client->b_AutoReconnect   = (config->network.disable_auto_reconnect == false);
+    Client->s64_Reconnect_us  = (config->network.reconnect_timeout_ms > 0) ? (int64_t)config->network.reconnect_timeout_ms * 1000
+                                                                            : (int64_t)(SIM_P(MQTT_RECONNECT_MS) * 1000.0);
+    Client->s64_Retransmit_us = (config->session.message_retransmit_timeout > 0) ? (int64_t)config->session.message_retransmit_timeout * 1000
+                                                                                  : (int64_t)(SIM_P(MQTT_RETRANSMIT_MS) * 1000.0);
+    Client->s64_Ping_us       = config->session.disable_keepalive ? 0
+                                                                  : (int64_t)((config->session.keepalive > 0) ? config->session.keepalive : SIM_MQTT_KEEPALIVE_S) * 500000;
+
+    if(config->network.transport != NULL)
+    {
+        Client->Transport = config->network.transport;
+        sscanf(config->broker.address.uri, "%*[^:]://%63[^:/]:%d", Client->ac_Host, &Client->s32_Port);
+        esp_event_handler_register_with(Client->Loop, SIM_MQTT_TRANSPORT, ESP_EVENT_ANY_ID, sim_mqtt_transport_handler, Client);
+    }
+
+    return Client;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    if(client == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(client->b_Started)
+        return ESP_FAIL;
+
+    client->b_Started = true;
+    client->u32_Gen++;
+    sim_mqtt_timer(client, (int64_t)(SIM_P(MQTT_CONNECT_MS) * 1000.0), sim_mqtt_connect_done, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client)
+{
+    if(client == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(client->b_Started == false || client->b_RetryPending == false)
+        return ESP_FAIL;
+
+    //Skip the rest of the reconnect timeout
+    client->b_RetryPending = false;
+    client->u32_Gen++;
+    sim_mqtt_timer(client, (int64_t)(SIM_P(MQTT_CONNECT_MS) * 1000.0), sim_mqtt_connect_done, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client)
+{
+    if(client == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(client->b_Started == false)
+        return ESP_FAIL;
+
+    client->u32_Gen++;
+    client->b_RetryPending = false;
+    sim_mqtt_transport(client, SIM_MQTT_TRANSPORT_CLOSE);
+
+    if(client->b_Connected)
+    {
+        client->b_Connected = false;
+        sim_mqtt_post(client, MQTT_EVENT_DISCONNECTED, 0);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    if(client == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(client->b_Started == false)
+        return ESP_FAIL;
+
+    //Same as on target: the client cannot stop itself from its own task
+    if(strcmp(pcTaskGetName(NULL), "mqtt_task") == 0)
+        return ESP_FAIL;
+
+    client->u32_Gen++;
+    client->b_Started      = false;
+    client->b_Connected    = false;
+    client->b_RetryPending = false;
+    sim_mqtt_transport(client, SIM_MQTT_TRANSPORT_CLOSE);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client)
+{
+    if(client == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    //The loop task keeps running. The client memory is kept for timers still pending.
+    client->u32_Gen++;
+    client->b_Started   = false;
+    client->b_Connected = false;
+    sim_mqtt_transport(client, SIM_MQTT_TRANSPORT_DESTROY);
+
+    while(client->pOutbox != NULL)
+    {
+        SIM_MQTT_MSG_t *pMsg = client->pOutbox;
+
+        client->pOutbox = pMsg->pNext;
+        free(pMsg);
+    }
+
+    return ESP_OK;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int retain)
+{
+    SIM_MQTT_MSG_t *pMsg;
+    SIM_MQTT_MSG_t **ppPos;
+
+    (void)data;
+    (void)len;
+    (void)retain;
+
+    if(client == NULL || topic == NULL || qos < 0 || qos > 2)
+        return -1;
+
+    if(qos == 0)
+    {
+        if(client->b_Connected == false)
+            return -1;
+
+        SIM_COUNT(MQTT_PUBLISH);
+        return 0;
+    }
+
+    if(client->b_Started == false)
+        return -1;
+
+    pMsg = calloc(1, sizeof(SIM_MQTT_MSG_t));
+    client->s32_LastMsgId = (client->s32_LastMsgId % 0xFFFF) + 1;
+    pMsg->s32_MsgId = client->s32_LastMsgId;
+    pMsg->s32_QoS   = qos;
+
+    for(ppPos = &client->pOutbox; *ppPos != NULL; ppPos = &(*ppPos)->pNext);
+    *ppPos = pMsg;
+
+    SIM_COUNT(MQTT_PUBLISH);
+    if(client->b_Connected)
+        sim_mqtt_send(client, pMsg, 0);
+
+    return pMsg->s32_MsgId;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    if(client == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return esp_event_handler_register_with(client->Loop, MQTT_EVENTS, (int32_t)event, event_handler, event_handler_arg);
+}
+
+esp_err_t esp_mqtt_client_unregister_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event, esp_event_handler_t event_handler)
+{
+    if(client == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return esp_event_handler_unregister_with(client->Loop, MQTT_EVENTS, (int32_t)event, event_handler);
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief           Posts an event to the client event loop
+/// @param Client    Client
+/// @param EventID   Event id
+/// @param s32_MsgId Message id of the event
+static void sim_mqtt_post(esp_mqtt_client_handle_t Client, esp_mqtt_event_id_t EventID, int s32_MsgId)
+{
+    esp_mqtt_event_t Event =
+    {
+        .event_id     = EventID,
+        .client       = Client,
+        .msg_id       = s32_MsgId,
+        .error_handle = &Client->ErrorCodes,
+    };
+
+    esp_event_post_to(Client->Loop, MQTT_EVENTS, EventID, &Event, sizeof(Event), portMAX_DELAY);
+}
+
+
+/// @brief              Starts a timer bound to the current connection generation
+/// @param Client       Client
+/// @param s64_Delay_us Delay
+/// @param pFunc        Callback. Gets a SIM_MQTT_TIMER_ARG_t and frees it.
+/// @param s32_MsgId    Message id passed to the callback
+static void sim_mqtt_timer(esp_mqtt_client_handle_t Client, int64_t s64_Delay_us, void (*pFunc)(void *), int s32_MsgId)
+{
+    SIM_MQTT_TIMER_ARG_t *pArg = malloc(sizeof(SIM_MQTT_TIMER_ARG_t));
+
+    pArg->Client    = Client;
+    pArg->u32_Gen   = Client->u32_Gen;
+    pArg->s32_MsgId = s32_MsgId;
+    sim_timer_after(s64_Delay_us, pFunc, pArg);
+}
+
+
+/// @brief      CONNACK received or the connect failed
+/// @param pArg SIM_MQTT_TIMER_ARG_t
+static void sim_mqtt_connect_done(void *pArg)
+{
+    SIM_MQTT_TIMER_ARG_t Arg = *(SIM_MQTT_TIMER_ARG_t *)pArg;
+    esp_mqtt_client_handle_t Client = Arg.Client;
+
+    free(pArg);
+    if(Arg.u32_Gen != Client->u32_Gen || Client->b_Started == false)
+        return;
+
+    if(sim_wifi_has_ip( ) == false || sim_rand_pct(SIM_P(MQTT_CONNECT_FAIL_PCT)))
+    {
+        SIM_COUNT(MQTT_CONNECT_FAIL);
+        sim_mqtt_connection_lost(Client);
+        return;
+    }
+
+    //TLS handshake in the client task. It continues with sim_mqtt_connected(..)
+    if(Client->Transport != NULL)
+        sim_mqtt_transport(Client, SIM_MQTT_TRANSPORT_CONNECT);
+    else
+        sim_mqtt_connected(Client);
+}
+
+
+/// @brief        Transport connected and CONNACK received
+/// @param Client Client
+static void sim_mqtt_connected(esp_mqtt_client_handle_t Client)
+{
+    SIM_COUNT(MQTT_CONNECT);
+    Client->u32_Gen++;
+    Client->b_Connected = true;
+    memset(&Client->ErrorCodes, 0, sizeof(Client->ErrorCodes));
+    sim_mqtt_post(Client, MQTT_EVENT_CONNECTED, 0);
+
+    //Send the outbox again. The old connection's exchanges are void.
+    for(SIM_MQTT_MSG_t *pMsg = Client->pOutbox; pMsg != NULL; pMsg = pMsg->pNext)
+        sim_mqtt_send(Client, pMsg, 0);
+
+    if(Client->s64_Ping_us > 0)
+        sim_mqtt_timer(Client, Client->s64_Ping_us, sim_mqtt_ping, 0);
+}
+
+
+/// @brief             Hands a transport request over to the client task
+/// @param Client      Client
+/// @param s32_Request SIM_MQTT_TRANSPORT_*
+static void sim_mqtt_transport(esp_mqtt_client_handle_t Client, int32_t s32_Request)
+{
+    uint32_t u32_Gen = Client->u32_Gen;
+
+    if(Client->Transport != NULL)
+        esp_event_post_to(Client->Loop, SIM_MQTT_TRANSPORT, s32_Request, &u32_Gen, sizeof(u32_Gen), portMAX_DELAY);
+}
+
+
+/// @brief        Transport requests. Runs in the client task, so a close never hits a connect in progress.
+/// @param pArg   Client
+/// @param Base   SIM_MQTT_TRANSPORT
+/// @param s32_ID SIM_MQTT_TRANSPORT_*
+/// @param pData  Connection generation of the request
+static void sim_mqtt_transport_handler(void *pArg, esp_event_base_t Base, int32_t s32_ID, void *pData)
+{
+    esp_mqtt_client_handle_t Client = pArg;
+    uint32_t u32_Gen = *(uint32_t *)pData;
+    int ret;
+
+    (void)Base;
+    if(Client->Transport == NULL)
+        return;
+
+    if(s32_ID == SIM_MQTT_TRANSPORT_CLOSE)
+        esp_transport_close(Client->Transport);
+
+    if(s32_ID == SIM_MQTT_TRANSPORT_DESTROY)
+    {
+        esp_transport_destroy(Client->Transport);
+        Client->Transport = NULL;
+    }
+
+    if(s32_ID != SIM_MQTT_TRANSPORT_CONNECT || u32_Gen != Client->u32_Gen || Client->b_Started == false)
+        return;
+
+    ret = esp_transport_connect(Client->Transport, Client->ac_Host, Client->s32_Port, SIM_MQTT_TRANSPORT_TMO_MS);
+
+    //Stopped or disconnected during the handshake
+    if(u32_Gen != Client->u32_Gen || Client->b_Started == false)
+        return;
+
+    if(ret < 0)
+    {
+        SIM_COUNT(MQTT_CONNECT_FAIL);
+        sim_mqtt_connection_lost(Client);
+        return;
+    }
+
+    sim_mqtt_connected(Client);
+}
+
+
+/// @brief      Auto reconnect timeout expired
+/// @param pArg SIM_MQTT_TIMER_ARG_t
+static void sim_mqtt_retry(void *pArg)
+{
+    SIM_MQTT_TIMER_ARG_t Arg = *(SIM_MQTT_TIMER_ARG_t *)pArg;
+    esp_mqtt_client_handle_t Client = Arg.Client;
+
+    free(pArg);
+    if(Arg.u32_Gen != Client->u32_Gen || Client->b_RetryPending == false)
+        return;
+
+    Client->b_RetryPending = false;
+    sim_mqtt_timer(Client, (int64_t)(SIM_P(MQTT_CONNECT_MS) * 1000.0), sim_mqtt_connect_done, 0);
+}
+
+
+/// @brief              Sends a QoS > 0 message and waits for the exchange to complete
+/// @param Client       Client
+/// @param pMsg         Outbox message
+/// @param s64_Delay_us Extra delay before sending (retransmit timeout)
+static void sim_mqtt_send(esp_mqtt_client_handle_t Client, SIM_MQTT_MSG_t *pMsg, int64_t s64_Delay_us)
+{
+    int64_t s64_Exchange_us = 0;
+
+    for(int i = 0; i < pMsg->s32_QoS; i++)
+        s64_Exchange_us += (int64_t)(SIM_P(MQTT_RTT_MS) * 1000.0) + sim_wifi_rx_delay_us( );
+
+    sim_mqtt_timer(Client, s64_Delay_us + s64_Exchange_us, sim_mqtt_ack, pMsg->s32_MsgId);
+}
+
+
+/// @brief      PUBACK/PUBCOMP received or the exchange was lost
+/// @param pArg SIM_MQTT_TIMER_ARG_t
+static void sim_mqtt_ack(void *pArg)
+{
+    SIM_MQTT_TIMER_ARG_t Arg = *(SIM_MQTT_TIMER_ARG_t *)pArg;
+    esp_mqtt_client_handle_t Client = Arg.Client;
+    SIM_MQTT_MSG_t **ppPos;
+    SIM_MQTT_MSG_t *pMsg;
+
+    free(pArg);
+    if(Arg.u32_Gen != Client->u32_Gen || Client->b_Connected == false)
+        return;
+
+    for(ppPos = &Client->pOutbox; *ppPos != NULL && (*ppPos)->s32_MsgId != Arg.s32_MsgId; ppPos = &(*ppPos)->pNext);
+    pMsg = *ppPos;
+    if(pMsg == NULL)
+        return;
+
+    if(sim_wifi_has_ip( ) == false)
+    {
+        sim_mqtt_connection_lost(Client);
+        return;
+    }
+
+    if(sim_rand_pct(SIM_P(MQTT_ACK_LOSS_PCT)))
+    {
+        SIM_COUNT(MQTT_RETRANSMIT);
+        sim_mqtt_send(Client, pMsg, Client->s64_Retransmit_us);
+        return;
+    }
+
+    *ppPos = pMsg->pNext;
+    free(pMsg);
+    sim_mqtt_post(Client, MQTT_EVENT_PUBLISHED, Arg.s32_MsgId);
+}
+
+
+/// @brief      Keepalive. PINGREQ sent, the PINGRESP is not modelled.
+/// @param pArg SIM_MQTT_TIMER_ARG_t
+static void sim_mqtt_ping(void *pArg)
+{
+    SIM_MQTT_TIMER_ARG_t Arg = *(SIM_MQTT_TIMER_ARG_t *)pArg;
+    esp_mqtt_client_handle_t Client = Arg.Client;
+
+    free(pArg);
+    if(Arg.u32_Gen != Client->u32_Gen || Client->b_Connected == false)
+        return;
+
+    if(sim_wifi_has_ip( ) == false)
+    {
+        sim_mqtt_connection_lost(Client);
+        return;
+    }
+
+    SIM_COUNT(MQTT_PING);
+    sim_mqtt_timer(Client, Client->s64_Ping_us, sim_mqtt_ping, 0);
+}
+
+
+/// @brief        Connection failed or broken. Posts the error and schedules the auto reconnect.
+/// @param Client Client
+static void sim_mqtt_connection_lost(esp_mqtt_client_handle_t Client)
+{
+    Client->u32_Gen++;
+    Client->b_Connected = false;
+    sim_mqtt_transport(Client, SIM_MQTT_TRANSPORT_CLOSE);
+
+    Client->ErrorCodes.error_type               = MQTT_ERROR_TYPE_TCP_TRANSPORT;
+    Client->ErrorCodes.esp_transport_sock_errno = SIM_MQTT_ECONNREFUSED;
+    sim_mqtt_post(Client, MQTT_EVENT_ERROR, 0);
+    sim_mqtt_post(Client, MQTT_EVENT_DISCONNECTED, 0);
+
+    if(Client->b_AutoReconnect)
+    {
+        Client->b_RetryPending = true;
+        sim_mqtt_timer(Client, Client->s64_Reconnect_us, sim_mqtt_retry, 0);
+    }
+}
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,550 @@
+/**
+  ******************************************************************************
+  * @file    sim_system.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - esp_system, esp_log, esp_sleep, esp_pm, GPIO and
+  *          NVS fakes. Random numbers of the simulation.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. esp_deep_sleep_start(..) ends the boot. The supervisor boots again after
+       the wakeup time. Without a timer wakeup the run stalls.
+    2. esp_light_sleep_start(..) freezes all tasks for the wakeup time.
+    3. Logs are written with the virtual time since boot. The level is set with
+       sim_log_level_set(..). Default is ESP_LOG_WARN.
+       Lines up to ESP_LOG_INFO cost log.uart_char_us per char like the console
+       UART on target, even if they are not printed.
+    4. Switching CONFIG_APP_PERIPH_PWR_PIN powers the emulated I2C sensors.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include "sim.h"
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_MAX_SHUTDOWN_HANDLERS   5
+#define SIM_NUM_GPIOS               32
+#define SIM_FREE_HEAP               (312 * 1024)
+#define SIM_FLASH_SECTOR_SIZE       4096
+#define SIM_FLASH_PAGE_SIZE         256
+#define SIM_FLASH_QUEUE_ADDR        0x110000        //!< Behind the 1 MB factory app, see partitions.csv
+
+
+/* Private variables ---------------------------------------------------------*/
+static esp_log_level_t LogLevel = ESP_LOG_WARN;
+static shutdown_handler_t aShutdownHandlers[SIM_MAX_SHUTDOWN_HANDLERS];
+static uint64_t u64_TimerWakeup_us;
+static bool b_TimerWakeup;
+static esp_pm_config_t PmConfig;
+static uint32_t au32_GpioLevel[SIM_NUM_GPIOS];
+static bool b_NvsInit;
+static esp_partition_t FlashQueuePart;
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief  Uniform random number
+/// @return Random value
+uint32_t sim_rand_u32(void)
+{
+    //xorshift64. The state is part of the shared state to be reproducible over deep sleep.
+    uint64_t x = sim_shm->u64_Rng;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    sim_shm->u64_Rng = x;
+
+    return (uint32_t)(x >> 32);
+}
+
+
+/// @brief  Uniform random number
+/// @return Random value in [0, 1)
+double sim_rand_unit(void)
+{
+    return sim_rand_u32( ) / 4294967296.0;
+}
+
+
+/// @brief       Random event
+/// @param f_Pct Probability in %
+/// @return      true with the given probability
+bool sim_rand_pct(double f_Pct)
+{
+    if(f_Pct <= 0.0)
+        return false;
+
+    return (sim_rand_unit( ) * 100.0) < f_Pct;
+}
+
+
+/// @brief            Random duration
+/// @param f_Ms       Fixed part
+/// @param f_JitterMs Uniform random part added to f_Ms
+/// @return           Duration in µs
+int64_t sim_rand_ms_us(double f_Ms, double f_JitterMs)
+{
+    return (int64_t)((f_Ms + f_JitterMs * sim_rand_unit( )) * 1000.0);
+}
+
+
+/// @brief       Sets the log level of all tags
+/// @param Level Level
+void sim_log_level_set(esp_log_level_t Level)
+{
+    LogLevel = Level;
+}
+
+
+/* esp_err -------------------------------------------------------------------*/
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch(code)
+    {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:      return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:       return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NOT_FINISHED:          return "ESP_ERR_NOT_FINISHED";
+        case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        case ESP_ERR_WIFI_NOT_INIT:         return "ESP_ERR_WIFI_NOT_INIT";
+        case ESP_ERR_WIFI_NOT_STARTED:      return "ESP_ERR_WIFI_NOT_STARTED";
+        case ESP_ERR_WIFI_NOT_CONNECT:      return "ESP_ERR_WIFI_NOT_CONNECT";
+        default:                            return "UNKNOWN ERROR";
+    }
+}
+
+void sim_error_check_failed(esp_err_t rc, const char *file, int line, const char *function, const char *expression)
+{
+    sim_exit(SIM_EXIT_PANIC, "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d %s(): %s",
+             esp_err_to_name(rc), rc, file, line, function, expression);
+}
+
+
+/* esp_log -------------------------------------------------------------------*/
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char acLetter[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+    char sLine[256];
+    int s32_Len;
+    va_list Args;
+
+    if(level == ESP_LOG_NONE)
+        return;
+
+    va_start(Args, format);
+    s32_Len = vsnprintf(sLine, sizeof(sLine), format, Args);
+    va_end(Args);
+
+    if(level <= LogLevel)
+        printf("%c (%" PRIu32 ") %s: %s\n", acLetter[level], esp_log_timestamp( ), tag, sLine);
+
+    /*The target logs up to INFO (CONFIG_LOG_DEFAULT_LEVEL) and the caller blocks while the UART sends the line*/
+    if(level <= ESP_LOG_INFO && s32_Len >= 0)
+        sim_busy_us((int64_t)((s32_Len + strlen(tag) + 16) * SIM_P(LOG_UART_CHAR_US)));
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(sim_now_us( ) / 1000);
+}
+
+
+/* esp_timer / esp_system ----------------------------------------------------*/
+
+int64_t esp_timer_get_time(void)
+{
+    return sim_now_us( );
+}
+
+/// @brief One shot esp_timer on top of sim_timer_after(..), which cannot be cancelled.
+///        Callbacks of a stopped or restarted timer find it inactive or not due and return.
+struct esp_timer
+{
+    esp_timer_create_args_t Args;
+    int64_t                 s64_Due_us;
+    bool                    b_Active;
+};
+
+static void sim_esp_timer_fire(void *pArg)
+{
+    struct esp_timer *pTimer = pArg;
+
+    if(pTimer->b_Active == false || sim_now_us( ) < pTimer->s64_Due_us)
+        return;
+
+    pTimer->b_Active = false;
+    pTimer->Args.callback(pTimer->Args.arg);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    struct esp_timer *pTimer = calloc(1, sizeof(struct esp_timer));
+
+    if(pTimer == NULL)
+        return ESP_ERR_NO_MEM;
+
+    pTimer->Args = *create_args;
+    *out_handle  = pTimer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if(timer->b_Active)
+        return ESP_ERR_INVALID_STATE;
+
+    timer->b_Active   = true;
+    timer->s64_Due_us = sim_now_us( ) + (int64_t)timeout_us;
+    sim_timer_after((int64_t)timeout_us, sim_esp_timer_fire, timer);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if(timer->b_Active == false)
+        return ESP_ERR_INVALID_STATE;
+
+    timer->b_Active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if(timer->b_Active)
+        return ESP_ERR_INVALID_STATE;
+
+    //Not freed, a pending sim_timer_after(..) callback still points to it
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->b_Active;
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return sim_shm->ResetReason;
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle)
+{
+    for(int i = 0; i < SIM_MAX_SHUTDOWN_HANDLERS; i++)
+    {
+        if(aShutdownHandlers[i] == handle)
+            return ESP_ERR_INVALID_STATE;
+
+        if(aShutdownHandlers[i] == NULL)
+        {
+            aShutdownHandlers[i] = handle;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handle)
+{
+    for(int i = 0; i < SIM_MAX_SHUTDOWN_HANDLERS; i++)
+    {
+        if(aShutdownHandlers[i] == handle)
+        {
+            aShutdownHandlers[i] = NULL;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_INVALID_STATE;
+}
+
+void esp_restart(void)
+{
+    for(int i = SIM_MAX_SHUTDOWN_HANDLERS - 1; i >= 0; i--)
+    {
+        if(aShutdownHandlers[i] != NULL)
+            aShutdownHandlers[i]( );
+    }
+
+    sim_exit(SIM_EXIT_RESTART, "esp_restart");
+}
+
+uint32_t esp_random(void)
+{
+    return sim_rand_u32( );
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return SIM_FREE_HEAP;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    static const uint8_t au8_Mac[6] = { 0x40, 0x4C, 0xCA, 0x51, 0x5E, 0x10 };
+
+    if(mac == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(mac, au8_Mac, sizeof(au8_Mac));
+    mac[5] += (uint8_t)type;
+
+    return ESP_OK;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+
+    while(len-- > 0)
+    {
+        crc ^= *buf++;
+
+        for(int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+
+    return ~crc;
+}
+
+
+/* esp_sleep / esp_pm --------------------------------------------------------*/
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us)
+{
+    u64_TimerWakeup_us = time_in_us;
+    b_TimerWakeup      = true;
+
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void)
+{
+    return (sim_shm->ResetReason == ESP_RST_DEEPSLEEP) ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+void esp_deep_sleep_start(void)
+{
+    if(b_TimerWakeup == false)
+        sim_exit(SIM_EXIT_STALLED, "Deep sleep without wakeup source");
+
+    sim_deep_sleep((int64_t)u64_TimerWakeup_us);
+}
+
+esp_err_t esp_light_sleep_start(void)
+{
+    if(b_TimerWakeup == false)
+        sim_exit(SIM_EXIT_STALLED, "Light sleep without wakeup source");
+
+    sim_skip_us((int64_t)u64_TimerWakeup_us);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_configure(const void *config)
+{
+    if(config == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(&PmConfig, config, sizeof(PmConfig));
+
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_get_configuration(void *config)
+{
+    if(config == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(config, &PmConfig, sizeof(PmConfig));
+
+    return ESP_OK;
+}
+
+
+/* driver/gpio ---------------------------------------------------------------*/
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig)
+{
+    if(pGPIOConfig == NULL || (pGPIOConfig->pin_bit_mask >> SIM_NUM_GPIOS) != 0)
+        return ESP_ERR_INVALID_ARG;
+
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if(gpio_num < 0 || gpio_num >= SIM_NUM_GPIOS)
+        return ESP_ERR_INVALID_ARG;
+
+    level = (level != 0);
+    if(gpio_num == CONFIG_APP_PERIPH_PWR_PIN && au32_GpioLevel[gpio_num] != level)
+        sim_i2c_power(level != 0);
+
+    au32_GpioLevel[gpio_num] = level;
+
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if(gpio_num < 0 || gpio_num >= SIM_NUM_GPIOS)
+        return 0;
+
+    return (int)au32_GpioLevel[gpio_num];
+}
+
+esp_err_t gpio_hold_en(gpio_num_t gpio_num)
+{
+    return (gpio_num < 0 || gpio_num >= SIM_NUM_GPIOS) ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+esp_err_t gpio_hold_dis(gpio_num_t gpio_num)
+{
+    return (gpio_num < 0 || gpio_num >= SIM_NUM_GPIOS) ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+
+/* nvs_flash -----------------------------------------------------------------*/
+
+esp_err_t nvs_flash_init(void)
+{
+    if(b_NvsInit)
+    {
+        sim_busy_us((int64_t)(SIM_P(NVS_REINIT_MS) * 1000.0));
+        return ESP_OK;
+    }
+
+    sim_busy_us((int64_t)(SIM_P(NVS_INIT_MS) * 1000.0));
+    SIM_COUNT(NVS_INIT);
+    b_NvsInit = true;
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    b_NvsInit = false;
+
+    return ESP_OK;
+}
+
+
+/* esp_partition -------------------------------------------------------------*/
+
+/// @brief  Checks an access to the flashqueue partition
+/// @return true if it is within the partition
+static bool sim_flash_range_ok(const esp_partition_t *partition, size_t Offset, size_t Size)
+{
+    return (partition == &FlashQueuePart) && (Offset <= partition->size) && (Size <= partition->size - Offset);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    uint32_t u32_Size = (uint32_t)(SIM_P(FLASH_QUEUE_KB)) * 1024;
+
+    if(type != ESP_PARTITION_TYPE_DATA || label == NULL || strcmp(label, "flashqueue") != 0 || u32_Size == 0)
+        return NULL;
+
+    FlashQueuePart.type       = ESP_PARTITION_TYPE_DATA;
+    FlashQueuePart.subtype    = (esp_partition_subtype_t)(0x40);
+    FlashQueuePart.address    = SIM_FLASH_QUEUE_ADDR;
+    FlashQueuePart.size       = (u32_Size < SIM_FLASH_MAX_SIZE) ? u32_Size : SIM_FLASH_MAX_SIZE;
+    FlashQueuePart.erase_size = SIM_FLASH_SECTOR_SIZE;
+    snprintf(FlashQueuePart.label, sizeof(FlashQueuePart.label), "%s", label);
+
+    return &FlashQueuePart;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if(dst == NULL || sim_flash_range_ok(partition, src_offset, size) == false)
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(dst, &sim_shm->au8_Flash[src_offset], size);
+
+    return ESP_OK;
+}
+
+/// @note Like NOR flash a write can only clear bits
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    const uint8_t *pu8_Src = (const uint8_t*)(src);
+
+    if(src == NULL || sim_flash_range_ok(partition, dst_offset, size) == false)
+        return ESP_ERR_INVALID_ARG;
+
+    for(size_t i = 0; i < size; i++)
+        sim_shm->au8_Flash[dst_offset + i] &= pu8_Src[i];
+
+    sim_busy_us((int64_t)(SIM_P(FLASH_WRITE_US) * (double)((size + SIM_FLASH_PAGE_SIZE - 1) / SIM_FLASH_PAGE_SIZE)));
+    SIM_COUNT(FLASH_WRITE);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if(sim_flash_range_ok(partition, offset, size) == false || offset % SIM_FLASH_SECTOR_SIZE != 0 || size % SIM_FLASH_SECTOR_SIZE != 0)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(&sim_shm->au8_Flash[offset], 0xFF, size);
+
+    for(size_t i = 0; i < size / SIM_FLASH_SECTOR_SIZE; i++)
+    {
+        sim_busy_us((int64_t)(SIM_P(FLASH_ERASE_MS) * 1000.0));
+        SIM_COUNT(FLASH_ERASE);
+    }
+
+    return ESP_OK;
+}
+
+/*****************************END OF FILE**************************************/
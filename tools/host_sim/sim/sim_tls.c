@@ -0,0 +1,384 @@
+/**
+  ******************************************************************************
+  * @file    sim_tls.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - esp-tls, tcp_transport and mbedtls session fakes.
+  *          Models the cost of a full and a resumed TLS handshake and a
+  *          broker which issues and accepts sessions.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. esp_transport_*(..) is the generic part of tcp_transport: a handle
+       with the functions set by esp_transport_set_func(..). The sim MQTT
+       client calls esp_transport_connect(..) from its task.
+    2. esp_tls_conn_new_sync(..) blocks the calling task for the TCP connect
+       (one round trip) and the handshake: tls.full_ms plus two round trips,
+       or tls.resume_ms plus one round trip if the offered session
+       (esp_tls_cfg_t::client_session) is younger than tls.ticket_lifetime_s
+       and not rejected with tls.reject_pct. A round trip is mqtt.rtt_ms plus
+       the downlink latency of the Wi-Fi power save mode.
+    3. Failures are reported with esp_tls_get_error_handle(..) like on
+       target: no IP for the TCP connect, a link loss during the handshake
+       (mbedtls timeout) and, with tls.alert_pct, a fatal alert of the
+       broker on a resumed handshake.
+    4. A resumed handshake keeps the master secret of the session, a full
+       handshake creates a new session with a random master secret, like
+       mbedtls_ssl_get_session(..) shows on target.
+    5. The data path (read/write) is not used, sim_mqtt.c models the MQTT
+       exchanges itself.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim.h"
+#include "esp_transport.h"
+#include "esp_tls.h"
+#include "mbedtls/ssl.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+struct esp_transport_item_t
+{
+    connect_func Connect;
+    io_read_func Read;
+    io_func      Write;
+    trans_func   Close;
+    poll_func    PollRead;
+    poll_func    PollWrite;
+    trans_func   Destroy;
+    void        *pContext;
+    int          s32_Port;
+};
+
+struct esp_tls
+{
+    mbedtls_ssl_context Ssl;
+    esp_tls_last_error_t Error;
+    bool b_Connected;
+};
+
+//Same layout as esp-tls (and mod_backend_tls.c)
+struct esp_tls_client_session
+{
+    mbedtls_ssl_session saved_session;
+};
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_TLS_SOCKFD              54          //!< Never used for I/O
+#define SIM_TLS_TICKET_LEN          160         //!< Typical ticket of a TLS 1.2 broker
+#define SIM_TLS_SESSION_HDR_LEN     offsetof(mbedtls_ssl_session, ticket)
+
+
+/* Private variables ---------------------------------------------------------*/
+
+//CA embedded by target_add_binary_data(..) on target. Only the symbols matter here.
+__asm__(".section .rodata\n"
+        ".global _binary_mqtt_broker_ca_pem_start\n"
+        "_binary_mqtt_broker_ca_pem_start:\n"
+        ".asciz \"-----BEGIN CERTIFICATE-----\\nsim\\n-----END CERTIFICATE-----\\n\"\n"
+        ".global _binary_mqtt_broker_ca_pem_end\n"
+        "_binary_mqtt_broker_ca_pem_end:\n"
+        ".previous\n");
+
+
+/* Private function prototypes -----------------------------------------------*/
+static int64_t sim_tls_rtt_us(void);
+static bool sim_tls_resumable(const esp_tls_cfg_t *pCfg);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+esp_transport_handle_t esp_transport_init(void)
+{
+    return calloc(1, sizeof(struct esp_transport_item_t));
+}
+
+esp_err_t esp_transport_destroy(esp_transport_handle_t t)
+{
+    if(t == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(t->Destroy != NULL)
+        t->Destroy(t);
+
+    free(t);
+    return ESP_OK;
+}
+
+esp_err_t esp_transport_set_func(esp_transport_handle_t t, connect_func _connect, io_read_func _read, io_func _write,
+                                 trans_func _close, poll_func _poll_read, poll_func _poll_write, trans_func _destroy)
+{
+    if(t == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    t->Connect   = _connect;
+    t->Read      = _read;
+    t->Write     = _write;
+    t->Close     = _close;
+    t->PollRead  = _poll_read;
+    t->PollWrite = _poll_write;
+    t->Destroy   = _destroy;
+    return ESP_OK;
+}
+
+esp_err_t esp_transport_set_context_data(esp_transport_handle_t t, void *data)
+{
+    if(t == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    t->pContext = data;
+    return ESP_OK;
+}
+
+void *esp_transport_get_context_data(esp_transport_handle_t t)
+{
+    return (t != NULL) ? t->pContext : NULL;
+}
+
+esp_err_t esp_transport_set_default_port(esp_transport_handle_t t, int port)
+{
+    if(t == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    t->s32_Port = port;
+    return ESP_OK;
+}
+
+int esp_transport_get_default_port(esp_transport_handle_t t)
+{
+    return (t != NULL) ? t->s32_Port : -1;
+}
+
+int esp_transport_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    if(t == NULL || t->Connect == NULL)
+        return -1;
+
+    return t->Connect(t, host, (port > 0) ? port : t->s32_Port, timeout_ms);
+}
+
+int esp_transport_close(esp_transport_handle_t t)
+{
+    if(t == NULL || t->Close == NULL)
+        return 0;
+
+    return t->Close(t);
+}
+
+
+esp_tls_t *esp_tls_init(void)
+{
+    return calloc(1, sizeof(esp_tls_t));
+}
+
+int esp_tls_conn_new_sync(const char *hostname, int hostlen, int port, const esp_tls_cfg_t *cfg, esp_tls_t *tls)
+{
+    mbedtls_ssl_session *pSession = &tls->Ssl.session;
+
+    (void)hostname;
+    (void)hostlen;
+    (void)port;
+
+    //TCP connect
+    sim_busy_us(sim_tls_rtt_us( ));
+    if(sim_wifi_has_ip( ) == false)
+    {
+        tls->Error.last_error = ESP_ERR_ESP_TLS_FAILED_CONNECT_TO_HOST;
+        return -1;
+    }
+
+    if(sim_tls_resumable(cfg))
+    {
+        if(sim_rand_pct(SIM_P(TLS_ALERT_PCT)))
+        {
+            sim_busy_us(sim_tls_rtt_us( ));
+            tls->Error.last_error = ESP_ERR_MBEDTLS_SSL_HANDSHAKE_FAILED;
+            tls->Error.esp_tls_error_code = -MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE;
+            return -1;
+        }
+
+        //ServerHello with the session, ChangeCipherSpec and Finished
+        sim_busy_us((int64_t)(SIM_P(TLS_RESUME_MS) * 1000.0) + sim_tls_rtt_us( ));
+        *pSession = cfg->client_session->saved_session;
+        SIM_COUNT(TLS_RESUMED);
+    }
+    else
+    {
+        //Certificate chain, ECDHE and a new session with a new ticket
+        sim_busy_us((int64_t)(SIM_P(TLS_FULL_MS) * 1000.0) + 2 * sim_tls_rtt_us( ));
+        for(size_t i = 0; i < sizeof(pSession->master); i++)
+            pSession->master[i] = (unsigned char)sim_rand_u32( );
+        for(size_t i = 0; i < SIM_TLS_TICKET_LEN; i++)
+            pSession->ticket[i] = (unsigned char)sim_rand_u32( );
+        pSession->u16_TicketLen = SIM_TLS_TICKET_LEN;
+        pSession->s64_Issued_us = sim_world_us( );
+        SIM_COUNT(TLS_FULL);
+    }
+
+    if(sim_wifi_has_ip( ) == false)
+    {
+        tls->Error.last_error = ESP_ERR_MBEDTLS_SSL_HANDSHAKE_FAILED;
+        tls->Error.esp_tls_error_code = -MBEDTLS_ERR_SSL_TIMEOUT;
+        return -1;
+    }
+
+    tls->b_Connected = true;
+    return 1;
+}
+
+ssize_t esp_tls_conn_read(esp_tls_t *tls, void *data, size_t datalen)
+{
+    (void)data;
+    (void)datalen;
+    return (tls != NULL && tls->b_Connected) ? ESP_TLS_ERR_SSL_WANT_READ : -1;
+}
+
+ssize_t esp_tls_conn_write(esp_tls_t *tls, const void *data, size_t datalen)
+{
+    (void)data;
+    return (tls != NULL && tls->b_Connected) ? (ssize_t)datalen : -1;
+}
+
+ssize_t esp_tls_get_bytes_avail(esp_tls_t *tls)
+{
+    (void)tls;
+    return 0;
+}
+
+esp_err_t esp_tls_get_conn_sockfd(esp_tls_t *tls, int *sockfd)
+{
+    if(tls == NULL || sockfd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    *sockfd = tls->b_Connected ? SIM_TLS_SOCKFD : -1;
+    return ESP_OK;
+}
+
+int esp_tls_conn_destroy(esp_tls_t *tls)
+{
+    free(tls);
+    return 0;
+}
+
+void *esp_tls_get_ssl_context(esp_tls_t *tls)
+{
+    return (tls != NULL) ? &tls->Ssl : NULL;
+}
+
+esp_err_t esp_tls_get_error_handle(esp_tls_t *tls, esp_tls_error_handle_t *error_handle)
+{
+    if(tls == NULL || error_handle == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    *error_handle = &tls->Error;
+    return ESP_OK;
+}
+
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session)
+{
+    memset(session, 0, sizeof(mbedtls_ssl_session));
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session)
+{
+    memset(session, 0, sizeof(mbedtls_ssl_session));
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len, size_t *olen)
+{
+    *olen = SIM_TLS_SESSION_HDR_LEN + session->u16_TicketLen;
+    if(buf_len < *olen)
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+
+    memcpy(buf, session, *olen);
+    return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len)
+{
+    if(len < SIM_TLS_SESSION_HDR_LEN || len > sizeof(mbedtls_ssl_session))
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+
+    memcpy(session, buf, len);
+    if(SIM_TLS_SESSION_HDR_LEN + session->u16_TicketLen != len)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+
+    return 0;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session)
+{
+    if(ssl == NULL || session == NULL)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+
+    *session = ssl->session;
+    return 0;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief  One round trip to the broker
+/// @return Round trip incl. the downlink latency of the power save mode
+static int64_t sim_tls_rtt_us(void)
+{
+    return (int64_t)(SIM_P(MQTT_RTT_MS) * 1000.0) + sim_wifi_rx_delay_us( );
+}
+
+
+/// @brief      Broker side check of the offered session
+/// @param pCfg Connect configuration
+/// @return     true if the broker resumes the session
+static bool sim_tls_resumable(const esp_tls_cfg_t *pCfg)
+{
+    const mbedtls_ssl_session *pSession;
+
+    if(pCfg->client_session == NULL)
+        return false;
+
+    pSession = &pCfg->client_session->saved_session;
+    if(pSession->u16_TicketLen == 0)
+        return false;
+
+    if(sim_world_us( ) - pSession->s64_Issued_us > (int64_t)(SIM_P(TLS_TICKET_LIFETIME_S) * 1000000.0))
+        return false;
+
+    return sim_rand_pct(SIM_P(TLS_REJECT_PCT)) == false;
+}
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,886 @@
+/**
+  ******************************************************************************
+  * @file    sim_wifi.c
+  * @author  The Embedded Dude
+  * @brief   Host simulation - Wi-Fi station, esp_netif, iTWT and ESP-NOW fakes.
+  *          Models the connect latency and the link to the AP. The events are
+  *          posted to the default event loop like on target.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. esp_wifi_connect(..) posts WIFI_EVENT_STA_CONNECTED after wifi.assoc_ms
+       (+ jitter) or WIFI_EVENT_STA_DISCONNECTED with probability
+       wifi.assoc_fail_pct. IP_EVENT_STA_GOT_IP follows after wifi.static_ip_ms
+       if a static IP is set, otherwise after wifi.dhcp_ms.
+       With BSSID and channel set (fast connect) the association takes
+       wifi.fast_assoc_ms instead. It fails with NO_AP_FOUND if they do not
+       match the AP or with probability wifi.ap_moved_pct.
+    2. While connected the link is lost after an exponential distributed time
+       with the mean wifi.link_mtbf_s.
+    3. Latencies scheduled with sim_timer_after(..) carry the link generation.
+       A disconnect increments it, so events of an old link are dropped.
+    4. sim_wifi_rx_delay_us(..) returns the extra downlink latency caused by
+       the configured modem sleep. Used by the MQTT fake.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <arpa/inet.h>
+#include "sim.h"
+#include "esp_wifi.h"
+#include "esp_wifi_he.h"
+#include "esp_now.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+struct esp_netif_obj
+{
+    char                 ac_Desc[32];
+    int                  RoutePrio;
+    esp_netif_ip_info_t  IpInfo;
+    bool                 b_StaticIp;
+    esp_ip6_addr_t       Ip6;
+    bool                 b_Ip6;
+    struct esp_netif_obj *pNext;
+};
+
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_WIFI_REASON_ASSOC_LEAVE     8
+#define SIM_WIFI_REASON_BEACON_TIMEOUT  200
+#define SIM_WIFI_REASON_NO_AP_FOUND     201
+#define SIM_WIFI_RSSI                   (-58)
+#define SIM_WIFI_CHANNEL                6
+#define SIM_WIFI_BSSID                  { 0x24, 0x4B, 0xFE, 0x12, 0x34, 0x56 }
+#define SIM_WIFI_DHCP_IP                "192.168.178.77"
+#define SIM_WIFI_DHCP_GW                "192.168.178.1"
+#define SIM_WIFI_DHCP_MASK              "255.255.255.0"
+
+
+/* Private macro -------------------------------------------------------------*/
+#define SIM_GEN_ARG(gen)                ((void *)(uintptr_t)(gen))
+#define SIM_ARG_GEN(arg)                ((uint32_t)(uintptr_t)(arg))
+
+
+/* Private variables ---------------------------------------------------------*/
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+static struct esp_netif_obj *pNetifs;
+static esp_netif_t *pSta;
+
+static bool b_Inited;
+static bool b_Started;
+static bool b_Connecting;
+static bool b_Connected;
+static bool b_HasIp;
+static bool b_Itwt;
+static int64_t s64_ItwtResume_us;               //!< End of the iTWT suspension
+static bool b_FastAssoc;                    //!< Connect attempt with BSSID and channel set
+static uint32_t u32_LinkGen;                    //!< Incremented on every disconnect
+static wifi_ps_type_t PsType = WIFI_PS_MIN_MODEM;
+static wifi_config_t StaConfig;
+
+static bool b_EspNowInit;
+static esp_now_send_cb_t pEspNowSendCb;
+static uint8_t au8_EspNowPeer[ESP_NOW_ETH_ALEN];
+
+
+/* Private function prototypes -----------------------------------------------*/
+static void sim_wifi_post(int32_t s32_ID, const void *pData, size_t DataSize);
+static void sim_wifi_post_disconnected(uint8_t u8_Reason);
+static void sim_wifi_assoc_done(void *pArg);
+static void sim_wifi_got_ip(void *pArg);
+static void sim_wifi_got_ip6(void *pArg);
+static void sim_wifi_link_lost(void *pArg);
+static void sim_wifi_itwt_setup_done(void *pArg);
+static void sim_wifi_itwt_probe_done(void *pArg);
+static void sim_wifi_itwt_suspend_done(void *pArg);
+static void sim_wifi_espnow_sent(void *pArg);
+
+
+/* Exported functions --------------------------------------------------------*/
+
+/// @brief  Extra downlink latency caused by modem sleep.
+///         The station only receives after the next beacon (TIM) it listens to.
+/// @return Latency in µs
+int64_t sim_wifi_rx_delay_us(void)
+{
+    switch(PsType)
+    {
+        case WIFI_PS_MIN_MODEM: return sim_rand_ms_us(0.0, SIM_P(WIFI_BEACON_MS));
+        case WIFI_PS_MAX_MODEM: return sim_rand_ms_us(0.0, SIM_P(WIFI_BEACON_MS) * SIM_P(WIFI_LISTEN_INTERVAL));
+        default:                return 0;
+    }
+}
+
+
+/// @brief  IP connectivity
+/// @return true if the station is connected and has an IPv4 address
+bool sim_wifi_has_ip(void)
+{
+    return b_Connected && b_HasIp;
+}
+
+
+/* esp_netif -----------------------------------------------------------------*/
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_wifi(wifi_interface_t wifi_if, const esp_netif_inherent_config_t *esp_netif_config)
+{
+    esp_netif_t *pNetif;
+
+    if(wifi_if != WIFI_IF_STA || esp_netif_config == NULL)
+        return NULL;
+
+    pNetif = calloc(1, sizeof(esp_netif_t));
+    snprintf(pNetif->ac_Desc, sizeof(pNetif->ac_Desc), "%s", esp_netif_config->if_desc != NULL ? esp_netif_config->if_desc : "sta");
+    pNetif->RoutePrio = esp_netif_config->route_prio;
+    pNetif->pNext     = pNetifs;
+    pNetifs = pNetif;
+    pSta    = pNetif;
+
+    return pNetif;
+}
+
+void esp_netif_destroy(esp_netif_t *esp_netif)
+{
+    for(esp_netif_t **ppPos = &pNetifs; *ppPos != NULL; ppPos = &(*ppPos)->pNext)
+    {
+        if(*ppPos == esp_netif)
+        {
+            *ppPos = esp_netif->pNext;
+            break;
+        }
+    }
+
+    if(pSta == esp_netif)
+        pSta = NULL;
+
+    free(esp_netif);
+}
+
+const char *esp_netif_get_desc(esp_netif_t *esp_netif)
+{
+    return (esp_netif != NULL) ? esp_netif->ac_Desc : NULL;
+}
+
+esp_netif_t *esp_netif_next_unsafe(esp_netif_t *esp_netif)
+{
+    return (esp_netif == NULL) ? pNetifs : esp_netif->pNext;
+}
+
+size_t esp_netif_get_nr_of_ifs(void)
+{
+    size_t Num = 0;
+
+    for(esp_netif_t *pNetif = pNetifs; pNetif != NULL; pNetif = pNetif->pNext)
+        Num++;
+
+    return Num;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info)
+{
+    if(esp_netif == NULL || ip_info == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    *ip_info = esp_netif->IpInfo;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *esp_netif, const esp_netif_ip_info_t *ip_info)
+{
+    if(esp_netif == NULL || ip_info == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_netif->IpInfo     = *ip_info;
+    esp_netif->b_StaticIp = true;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *esp_netif)
+{
+    return (esp_netif != NULL) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_netif_create_ip6_linklocal(esp_netif_t *esp_netif)
+{
+    if(esp_netif == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(b_Connected == false)
+        return ESP_FAIL;
+
+    if(sim_rand_pct(SIM_P(WIFI_NO_IP6_PCT)) == false)
+        sim_timer_after((int64_t)(SIM_P(WIFI_IP6_LL_MS) * 1000.0), sim_wifi_got_ip6, SIM_GEN_ARG(u32_LinkGen));
+
+    return ESP_OK;
+}
+
+int esp_netif_get_all_ip6(esp_netif_t *esp_netif, esp_ip6_addr_t if_ip6[])
+{
+    if(esp_netif == NULL || esp_netif->b_Ip6 == false)
+        return 0;
+
+    if_ip6[0] = esp_netif->Ip6;
+
+    return 1;
+}
+
+esp_ip6_addr_type_t esp_netif_ip6_get_addr_type(esp_ip6_addr_t *ip6_addr)
+{
+    //Address words are in network byte order. fe80::/10 is link local.
+    if((ip6_addr->addr[0] & 0xC0FF) == 0x80FE)
+        return ESP_IP6_ADDR_IS_LINK_LOCAL;
+
+    return ESP_IP6_ADDR_IS_GLOBAL;
+}
+
+uint32_t ipaddr_addr(const char *cp)
+{
+    return (uint32_t)inet_addr(cp);
+}
+
+
+/* esp_wifi ------------------------------------------------------------------*/
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    if(config == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(b_Inited)
+        return ESP_OK;
+
+    sim_busy_us((int64_t)(SIM_P(WIFI_INIT_MS) * 1000.0));
+    SIM_COUNT(WIFI_INIT);
+    b_Inited = true;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deinit(void)
+{
+    if(b_Started)
+        return ESP_ERR_INVALID_STATE;
+
+    b_Inited = false;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    if(b_Started)
+        return ESP_OK;
+
+    sim_busy_us((int64_t)(SIM_P(WIFI_START_MS) * 1000.0));
+    b_Started = true;
+    sim_wifi_post(WIFI_EVENT_STA_START, NULL, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    if(b_Started == false)
+        return ESP_OK;
+
+    if(b_Connected || b_Connecting)
+        sim_wifi_post_disconnected(SIM_WIFI_REASON_ASSOC_LEAVE);
+
+    b_Started = false;
+    sim_wifi_post(WIFI_EVENT_STA_STOP, NULL, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    if(b_Started == false)
+        return ESP_ERR_WIFI_NOT_STARTED;
+
+    if(b_Connected || b_Connecting)
+        return ESP_OK;
+
+    b_Connecting = true;
+    b_FastAssoc  = StaConfig.sta.bssid_set && (StaConfig.sta.channel != 0);
+
+    //No scan with a known channel. The jitter shrinks with the scan.
+    if(b_FastAssoc)
+        sim_timer_after(sim_rand_ms_us(SIM_P(WIFI_FAST_ASSOC_MS), SIM_P(WIFI_ASSOC_JITTER_MS) * SIM_P(WIFI_FAST_ASSOC_MS) / SIM_P(WIFI_ASSOC_MS)),
+                        sim_wifi_assoc_done, SIM_GEN_ARG(u32_LinkGen));
+    else
+        sim_timer_after(sim_rand_ms_us(SIM_P(WIFI_ASSOC_MS), SIM_P(WIFI_ASSOC_JITTER_MS)), sim_wifi_assoc_done, SIM_GEN_ARG(u32_LinkGen));
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    if(b_Started == false)
+        return ESP_ERR_WIFI_NOT_STARTED;
+
+    if(b_Connected || b_Connecting)
+        sim_wifi_post_disconnected(SIM_WIFI_REASON_ASSOC_LEAVE);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    return (mode == WIFI_MODE_STA) ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    (void)storage;
+
+    return b_Inited ? ESP_OK : ESP_ERR_WIFI_NOT_INIT;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    if(interface != WIFI_IF_STA || conf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    StaConfig = *conf;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    if(interface != WIFI_IF_STA || conf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    *conf = StaConfig;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t ifx, wifi_bandwidth_t bw)
+{
+    (void)ifx;
+    (void)bw;
+
+    return b_Inited ? ESP_OK : ESP_ERR_WIFI_NOT_INIT;
+}
+
+esp_err_t esp_wifi_set_protocol(wifi_interface_t ifx, uint8_t protocol_bitmap)
+{
+    (void)ifx;
+    (void)protocol_bitmap;
+
+    return b_Inited ? ESP_OK : ESP_ERR_WIFI_NOT_INIT;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+    PsType = type;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second)
+{
+    (void)second;
+
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    return (primary >= 1 && primary <= 14) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_wifi_sta_get_negotiated_phymode(wifi_phy_mode_t *phymode)
+{
+    if(b_Connected == false)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    *phymode = WIFI_PHY_MODE_HE20;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info)
+{
+    if(b_Connected == false)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    memset(ap_info, 0, sizeof(*ap_info));
+    memcpy(ap_info->ssid, StaConfig.sta.ssid, sizeof(StaConfig.sta.ssid));
+    memcpy(ap_info->bssid, (const uint8_t[])SIM_WIFI_BSSID, sizeof(ap_info->bssid));
+    ap_info->primary = SIM_WIFI_CHANNEL;
+    ap_info->rssi    = SIM_WIFI_RSSI;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connectionless_module_set_wake_interval(uint16_t wake_interval)
+{
+    (void)wake_interval;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_default_wifi_sta_handlers(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_clear_default_wifi_driver_and_handlers(void *esp_netif)
+{
+    (void)esp_netif;
+
+    return ESP_OK;
+}
+
+
+/* iTWT ----------------------------------------------------------------------*/
+
+esp_err_t esp_wifi_sta_itwt_setup(wifi_twt_setup_config_t *setup_config)
+{
+    static wifi_twt_setup_config_t Config;
+
+    if(setup_config == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if(b_Connected == false)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    //One agreement at a time is enough for the app
+    Config = *setup_config;
+    sim_timer_after((int64_t)(SIM_P(ITWT_SETUP_MS) * 1000.0), sim_wifi_itwt_setup_done, &Config);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_itwt_teardown(int flow_id)
+{
+    wifi_event_sta_itwt_teardown_t Teardown = { .flow_id = (uint8_t)flow_id };
+
+    if(b_Connected == false)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    if(b_Itwt == true)
+        SIM_COUNT(ITWT_TEARDOWN);
+
+    b_Itwt = false;
+    sim_wifi_post(WIFI_EVENT_ITWT_TEARDOWN, &Teardown, sizeof(Teardown));
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_itwt_suspend(int flow_id, int suspend_time_ms)
+{
+    static wifi_event_sta_itwt_suspend_t Suspend;
+
+    if(b_Connected == false)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    //A teardown of the AP while sleeping shows up with the first suspend after waking up
+    if(b_Itwt == true && sim_now_us( ) >= s64_ItwtResume_us && sim_rand_pct(SIM_P(ITWT_LOST_PCT)))
+    {
+        wifi_event_sta_itwt_teardown_t Teardown = { .flow_id = FLOW_ID_ALL };
+
+        SIM_COUNT(ITWT_LOST);
+        b_Itwt = false;
+        sim_wifi_post(WIFI_EVENT_ITWT_TEARDOWN, &Teardown, sizeof(Teardown));
+    }
+
+    if(b_Itwt == false)
+        return ESP_ERR_INVALID_STATE;
+
+    SIM_COUNT(ITWT_SUSPEND);
+    s64_ItwtResume_us = sim_now_us( ) + (int64_t)(suspend_time_ms) * 1000;
+
+    memset(&Suspend, 0, sizeof(Suspend));
+    Suspend.status         = ESP_OK;
+    Suspend.flow_id_bitmap = (flow_id == FLOW_ID_ALL) ? 0xFF : (uint8_t)(1 << flow_id);
+    for(int i = 0; i < 8; i++)
+    {
+        if(Suspend.flow_id_bitmap & (1 << i))
+            Suspend.actual_suspend_time_ms[i] = (uint32_t)suspend_time_ms;
+    }
+    sim_timer_after((int64_t)(SIM_P(ITWT_SUSPEND_MS) * 1000.0), sim_wifi_itwt_suspend_done, &Suspend);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_itwt_send_probe_req(int timeout_ms)
+{
+    (void)timeout_ms;
+
+    if(b_Connected == false)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    sim_timer_after((int64_t)(SIM_P(ITWT_PROBE_MS) * 1000.0), sim_wifi_itwt_probe_done, SIM_GEN_ARG(u32_LinkGen));
+
+    return ESP_OK;
+}
+
+
+/* ESP-NOW -------------------------------------------------------------------*/
+
+esp_err_t esp_now_init(void)
+{
+    if(b_Inited == false)
+        return ESP_ERR_WIFI_NOT_INIT;
+
+    b_EspNowInit = true;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_now_deinit(void)
+{
+    b_EspNowInit  = false;
+    pEspNowSendCb = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb)
+{
+    if(b_EspNowInit == false)
+        return ESP_ERR_INVALID_STATE;
+
+    pEspNowSendCb = cb;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_send_cb(void)
+{
+    pEspNowSendCb = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_now_set_pmk(const uint8_t *pmk)
+{
+    return (pmk != NULL) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer)
+{
+    if(b_EspNowInit == false)
+        return ESP_ERR_INVALID_STATE;
+
+    if(peer == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(au8_EspNowPeer, peer->peer_addr, ESP_NOW_ETH_ALEN);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_now_set_wake_window(uint16_t window)
+{
+    (void)window;
+
+    return b_EspNowInit ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len)
+{
+    if(b_EspNowInit == false)
+        return ESP_ERR_INVALID_STATE;
+
+    if(data == NULL || len == 0 || len > ESP_NOW_MAX_DATA_LEN)
+        return ESP_ERR_INVALID_ARG;
+
+    if(b_Started == false)
+        return ESP_ERR_WIFI_NOT_STARTED;
+
+    if(peer_addr != NULL && memcmp(peer_addr, au8_EspNowPeer, ESP_NOW_ETH_ALEN) != 0)
+        return ESP_ERR_NOT_FOUND;
+
+    SIM_COUNT(ESPNOW_SEND);
+    sim_timer_after((int64_t)(SIM_P(ESPNOW_TX_MS) * 1000.0), sim_wifi_espnow_sent, NULL);
+
+    return ESP_OK;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief          Posts a WIFI_EVENT to the default event loop
+/// @param s32_ID   Event id
+/// @param pData    Event data
+/// @param DataSize Size of the event data
+static void sim_wifi_post(int32_t s32_ID, const void *pData, size_t DataSize)
+{
+    esp_event_post(WIFI_EVENT, s32_ID, pData, DataSize, portMAX_DELAY);
+}
+
+
+/// @brief           Ends the link and posts WIFI_EVENT_STA_DISCONNECTED
+/// @param u8_Reason Disconnect reason
+static void sim_wifi_post_disconnected(uint8_t u8_Reason)
+{
+    wifi_event_sta_disconnected_t Disconnected = { .reason = u8_Reason, .rssi = SIM_WIFI_RSSI };
+
+    u32_LinkGen++;
+    b_Connecting = false;
+    b_Connected  = false;
+    b_HasIp      = false;
+    b_Itwt       = false;
+
+    if(pSta != NULL)
+        pSta->b_Ip6 = false;
+
+    memcpy(Disconnected.ssid, StaConfig.sta.ssid, sizeof(Disconnected.ssid));
+    Disconnected.ssid_len = (uint8_t)strnlen((const char *)StaConfig.sta.ssid, sizeof(StaConfig.sta.ssid));
+    sim_wifi_post(WIFI_EVENT_STA_DISCONNECTED, &Disconnected, sizeof(Disconnected));
+}
+
+
+/// @brief      Association finished
+/// @param pArg Link generation
+static void sim_wifi_assoc_done(void *pArg)
+{
+    wifi_event_sta_connected_t Connected = { .bssid = SIM_WIFI_BSSID, .channel = SIM_WIFI_CHANNEL, .authmode = WIFI_AUTH_WPA2_PSK, .aid = 1 };
+    double f_Mtbf_s = SIM_P(WIFI_LINK_MTBF_S);
+
+    if(SIM_ARG_GEN(pArg) != u32_LinkGen || b_Connecting == false)
+        return;
+
+    if(b_FastAssoc && ((memcmp(StaConfig.sta.bssid, Connected.bssid, sizeof(Connected.bssid)) != 0) ||
+                       (StaConfig.sta.channel != SIM_WIFI_CHANNEL) || sim_rand_pct(SIM_P(WIFI_AP_MOVED_PCT))))
+    {
+        SIM_COUNT(WIFI_ASSOC_FAIL);
+        sim_wifi_post_disconnected(SIM_WIFI_REASON_NO_AP_FOUND);
+        return;
+    }
+
+    if(sim_rand_pct(SIM_P(WIFI_ASSOC_FAIL_PCT)))
+    {
+        SIM_COUNT(WIFI_ASSOC_FAIL);
+        sim_wifi_post_disconnected(SIM_WIFI_REASON_NO_AP_FOUND);
+        return;
+    }
+
+    SIM_COUNT(WIFI_CONNECT);
+    if(b_FastAssoc)
+        SIM_COUNT(WIFI_FAST_CONNECT);
+    b_Connecting = false;
+    b_Connected  = true;
+
+    memcpy(Connected.ssid, StaConfig.sta.ssid, sizeof(Connected.ssid));
+    Connected.ssid_len = (uint8_t)strnlen((const char *)StaConfig.sta.ssid, sizeof(StaConfig.sta.ssid));
+    sim_wifi_post(WIFI_EVENT_STA_CONNECTED, &Connected, sizeof(Connected));
+
+    if(sim_rand_pct(SIM_P(WIFI_NO_IP_PCT)))
+        ;   /*DHCP server does not answer*/
+    else if(pSta != NULL && pSta->b_StaticIp)
+        sim_timer_after((int64_t)(SIM_P(WIFI_STATIC_IP_MS) * 1000.0), sim_wifi_got_ip, pArg);
+    else
+        sim_timer_after((int64_t)(SIM_P(WIFI_DHCP_MS) * 1000.0), sim_wifi_got_ip, pArg);
+
+    if(f_Mtbf_s > 0.0)
+        sim_timer_after((int64_t)(-log(1.0 - sim_rand_unit( )) * f_Mtbf_s * 1e6), sim_wifi_link_lost, pArg);
+}
+
+
+/// @brief      IPv4 address assigned
+/// @param pArg Link generation
+static void sim_wifi_got_ip(void *pArg)
+{
+    ip_event_got_ip_t GotIp = { .esp_netif = pSta, .ip_changed = false };
+
+    if(SIM_ARG_GEN(pArg) != u32_LinkGen || b_Connected == false || pSta == NULL)
+        return;
+
+    if(pSta->b_StaticIp == false)
+    {
+        pSta->IpInfo.ip.addr      = ipaddr_addr(SIM_WIFI_DHCP_IP);
+        pSta->IpInfo.gw.addr      = ipaddr_addr(SIM_WIFI_DHCP_GW);
+        pSta->IpInfo.netmask.addr = ipaddr_addr(SIM_WIFI_DHCP_MASK);
+    }
+
+    b_HasIp = true;
+    GotIp.ip_info = pSta->IpInfo;
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &GotIp, sizeof(GotIp), portMAX_DELAY);
+}
+
+
+/// @brief      IPv6 link local address valid
+/// @param pArg Link generation
+static void sim_wifi_got_ip6(void *pArg)
+{
+    ip_event_got_ip6_t GotIp6 = { .esp_netif = pSta, .ip_index = 0 };
+    uint8_t au8_Mac[6];
+
+    if(SIM_ARG_GEN(pArg) != u32_LinkGen || b_Connected == false || pSta == NULL)
+        return;
+
+    //fe80::<EUI-64 of the MAC>, words in network byte order
+    esp_read_mac(au8_Mac, ESP_MAC_WIFI_STA);
+    memset(&pSta->Ip6, 0, sizeof(pSta->Ip6));
+    pSta->Ip6.addr[0] = 0x000080FE;
+    pSta->Ip6.addr[2] = (uint32_t)(au8_Mac[0] ^ 0x02) | ((uint32_t)au8_Mac[1] << 8) | ((uint32_t)au8_Mac[2] << 16) | (0xFFu << 24);
+    pSta->Ip6.addr[3] = 0xFEu | ((uint32_t)au8_Mac[3] << 8) | ((uint32_t)au8_Mac[4] << 16) | ((uint32_t)au8_Mac[5] << 24);
+    pSta->b_Ip6 = true;
+
+    GotIp6.ip6_info.ip = pSta->Ip6;
+    esp_event_post(IP_EVENT, IP_EVENT_GOT_IP6, &GotIp6, sizeof(GotIp6), portMAX_DELAY);
+}
+
+
+/// @brief      Link to the AP lost (beacon timeout)
+/// @param pArg Link generation
+static void sim_wifi_link_lost(void *pArg)
+{
+    if(SIM_ARG_GEN(pArg) != u32_LinkGen || b_Connected == false)
+        return;
+
+    SIM_COUNT(WIFI_LINK_LOSS);
+    sim_wifi_post_disconnected(SIM_WIFI_REASON_BEACON_TIMEOUT);
+}
+
+
+/// @brief      Response of the AP to the iTWT setup request
+/// @param pArg Requested agreement
+static void sim_wifi_itwt_setup_done(void *pArg)
+{
+    wifi_event_sta_itwt_setup_t Setup = { .config = *(wifi_twt_setup_config_t *)pArg, .status = ESP_OK };
+    uint64_t u64_Invl_us = (uint64_t)Setup.config.wake_invl_mant << Setup.config.wake_invl_expn;
+    uint64_t u64_Max_us  = (uint64_t)(SIM_P(ITWT_MAX_INVL_S) * 1e6);
+
+    if(b_Connected == false)
+        return;
+
+    SIM_COUNT(ITWT_SETUP);
+    if(sim_rand_pct(SIM_P(ITWT_REJECT_PCT)) || (u64_Max_us > 0 && u64_Invl_us > u64_Max_us && Setup.config.setup_cmd != TWT_SUGGEST))
+    {
+        SIM_COUNT(ITWT_REJECT);
+        Setup.config.setup_cmd = TWT_REJECT;
+        b_Itwt = false;
+    }
+    else if(u64_Max_us > 0 && u64_Invl_us > u64_Max_us)
+    {
+        //Counter-offer with the longest interval of the AP
+        SIM_COUNT(ITWT_ALTERNATE);
+        Setup.config.setup_cmd      = TWT_ALTERNATE;
+        Setup.config.wake_invl_expn = 0;
+        while((u64_Max_us >> Setup.config.wake_invl_expn) > UINT16_MAX)
+            Setup.config.wake_invl_expn++;
+        Setup.config.wake_invl_mant = (uint16_t)(u64_Max_us >> Setup.config.wake_invl_expn);
+        b_Itwt = false;
+    }
+    else
+    {
+        Setup.config.setup_cmd = TWT_ACCEPT;
+        b_Itwt = true;
+    }
+
+    sim_wifi_post(WIFI_EVENT_ITWT_SETUP, &Setup, sizeof(Setup));
+}
+
+
+/// @brief      TWT information frame of the suspend acked by the AP
+/// @param pArg wifi_event_sta_itwt_suspend_t to post
+static void sim_wifi_itwt_suspend_done(void *pArg)
+{
+    if(b_Connected == false)
+        return;
+
+    sim_wifi_post(WIFI_EVENT_ITWT_SUSPEND, pArg, sizeof(wifi_event_sta_itwt_suspend_t));
+}
+
+
+/// @brief      Response of the AP to the iTWT probe request
+/// @param pArg Link generation
+static void sim_wifi_itwt_probe_done(void *pArg)
+{
+    wifi_event_sta_itwt_probe_t Probe = { .status = ITWT_PROBE_SUCCESS, .reason = 0 };
+
+    if(SIM_ARG_GEN(pArg) != u32_LinkGen)
+        Probe.status = ITWT_PROBE_STA_DISCONNECTED;
+
+    sim_wifi_post(WIFI_EVENT_ITWT_PROBE, &Probe, sizeof(Probe));
+}
+
+
+/// @brief      ESP-NOW frame sent. Calls the send callback from the Wi-Fi task context.
+/// @param pArg Unused
+static void sim_wifi_espnow_sent(void *pArg)
+{
+    esp_now_send_status_t Status = ESP_NOW_SEND_SUCCESS;
+
+    (void)pArg;
+
+    if(sim_rand_pct(SIM_P(ESPNOW_FAIL_PCT)))
+    {
+        SIM_COUNT(ESPNOW_FAIL);
+        Status = ESP_NOW_SEND_FAIL;
+    }
+
+    if(pEspNowSendCb != NULL)
+        pEspNowSendCb(au8_EspNowPeer, Status);
+}
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,265 @@
+/**
+  ******************************************************************************
+  * @file    mas_test.c
+  * @author  The Embedded Dude
+  * @brief   Host test of the main app state machine transition table.
+  *          Every state/event pair is run through MAS_Handle_Transition(..)
+  *          and compared against the transitions expected for the variant.
+  * @date    Git controlled
+  * @version Git controlled
+
+  @verbatim
+  ==============================================================================
+                     ##### How to use this module #####
+  ==============================================================================
+    1. cmake -S tools/main_app_sm -B build_mas && cmake --build build_mas
+    2. ctest --test-dir build_mas --output-on-failure
+       Runs one executable per transition table variant: Wi-Fi/MQTT,
+       CONFIG_APP_DEEP_SLEEP_ESP_NOW and CONFIG_APP_LIGHT_SLEEP_ESP_NOW.
+    3. ./build_mas/mas_test_<variant> -v prints every checked pair.
+    4. Each expected row of s_Expected must match. Every other pair must keep
+       the state. s_Invalid lists at least one invalid event per state, so a
+       state without any ignored event fails the test as well.
+
+  @endverbatim
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy;
+  * The MIT License (MIT)
+  * Copyright (c) 2024, The Embedded Dude, (https://github.com/TheEmbeddedDude)
+  *
+  * Permission is hereby granted, free of charge, to any person obtaining a copy
+  * of this software and associated documentation files (the "Software"), to deal
+  * in the Software without restriction, including without limitation the rights
+  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  * copies of the Software, and to permit persons to whom the Software is
+  * furnished to do so, subject to the following conditions:
+  *
+  * The above copyright notice and this permission notice shall be included in
+  * all copies or substantial portions of the Software.
+  *
+  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  * THE SOFTWARE.
+  *
+  ******************************************************************************
+  */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "main_app_sm.h"
+
+
+/* Private typedef -----------------------------------------------------------*/
+
+
+/* Private define ------------------------------------------------------------*/
+#if defined(CONFIG_APP_DEEP_SLEEP_ESP_NOW) || defined(CONFIG_APP_LIGHT_SLEEP_ESP_NOW)
+#define MAS_TEST_CONNECTED          MAS_Backend_Connected   //!< ESP-NOW skips the backend connect
+#else
+#define MAS_TEST_CONNECTED          MAS_WiFi_Connected
+#endif
+
+#ifdef CONFIG_APP_LIGHT_SLEEP_ESP_NOW
+#define MAS_TEST_WAKE_CONNECTED     MAS_Backend_Connected   //!< Wake up from forced light sleep with ESP-NOW
+#else
+#define MAS_TEST_WAKE_CONNECTED     MAS_WiFi_Connected
+#endif
+
+
+/* Private constants ---------------------------------------------------------*/
+
+/// @brief Expected transitions. Written down independently of MAS_TransitionTable on purpose.
+static const MAS_TRANSITION_t s_Expected[] =
+{
+    { MAS_Init_Sys,            MAE_Sys_Init_Done,                    MAS_Not_Connected       },
+    { MAS_Init_Sys,            MAE_Sys_Init_Failed,                  MAS_Error               },
+    { MAS_Init_Sys,            MAE_Upload_Not_Due,                   MAS_Store_Sample        },
+
+    { MAS_Store_Sample,        MAE_Sys_Init_Done,                    MAS_Not_Connected       },
+    { MAS_Store_Sample,        MAE_Sys_Init_Failed,                  MAS_Error               },
+    { MAS_Store_Sample,        MAE_Sensor_Read_Failed,               MAS_Error               },
+
+    { MAS_Not_Connected,       MAE_WiFi_Connection_Established,      MAS_TEST_CONNECTED      },
+    { MAS_Not_Connected,       MAE_WiFi_Failed,                      MAS_Error               },
+    { MAS_Not_Connected,       MAE_Sensor_Read_Failed,               MAS_Error               },
+
+    { MAS_WiFi_Connected,      MAE_Backend_Connection_Established,   MAS_Backend_Connected   },
+    { MAS_WiFi_Connected,      MAE_WiFi_Connection_Lost,             MAS_Not_Connected       },
+    { MAS_WiFi_Connected,      MAE_Backend_Failed,                   MAS_Error               },
+
+    { MAS_Backend_Connected,   MAE_Data_Sent_To_Backend,             MAS_Data_Published      },
+    { MAS_Backend_Connected,   MAE_Backend_Connection_Lost,          MAS_WiFi_Connected      },
+    { MAS_Backend_Connected,   MAE_WiFi_Connection_Lost,             MAS_Not_Connected       },
+    { MAS_Backend_Connected,   MAE_Backend_Failed,                   MAS_Error               },
+    { MAS_Backend_Connected,   MAE_Sensor_Read_Failed,               MAS_Error               },
+
+    { MAS_Data_Published,      MAE_Enter_Sleep_Mode,                 MAS_Sleep               },
+
+    { MAS_Sleep,               MAE_WiFi_Connection_Established,      MAS_TEST_WAKE_CONNECTED },
+    { MAS_Sleep,               MAE_WiFi_Connection_Lost,             MAS_Not_Connected       },
+};
+
+/// @brief At least one event per state which must not cause a transition
+static const struct { MainApp_State State; MainApp_Event Event; } s_Invalid[] =
+{
+    { MAS_Init_Sys,            MAE_Timeout                           },
+    { MAS_Not_Connected,       MAE_Data_Sent_To_Backend              },
+    { MAS_WiFi_Connected,      MAE_Enter_Sleep_Mode                  },
+    { MAS_Backend_Connected,   MAE_Sys_Init_Done                     },
+    { MAS_Data_Published,      MAE_WiFi_Connection_Lost              },
+    { MAS_Sleep,               MAE_Sensor_Read_Failed                },
+    { MAS_Error,               MAE_Sys_Init_Done                     },
+    { MAS_Store_Sample,        MAE_WiFi_Connection_Established       },
+};
+
+
+/* Private variables ---------------------------------------------------------*/
+static bool b_Verbose = false;
+
+
+/* Private function prototypes -----------------------------------------------*/
+static const MAS_TRANSITION_t *Expected_Find(MainApp_State State, MainApp_Event Event);
+static int Check(MainApp_State State, MainApp_Event Event, MainApp_State Expected);
+
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    int s32_Errors = 0;
+    uint32_t u32_Rows = 0;
+    uint32_t u32_Ignored[MAS_Num_States] = { 0 };
+
+    b_Verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+
+    //Each expected row is defined exactly once and leads to another state
+    for(size_t i = 0; i < sizeof(s_Expected) / sizeof(s_Expected[0]); i++)
+    {
+        if( Expected_Find(s_Expected[i].CurrentState, s_Expected[i].Event) != &s_Expected[i] ||
+            s_Expected[i].NextState == s_Expected[i].CurrentState )
+        {
+            printf("FAIL expected row %zu is not unique or not a transition\n", i);
+            s32_Errors++;
+        }
+    }
+
+    //Full state x event matrix
+    for(int s = 0; s < MAS_Num_States; s++)
+    {
+        for(int e = 0; e < MAE_Num_Events; e++)
+        {
+            const MAS_TRANSITION_t *pRow = Expected_Find((MainApp_State)(s), (MainApp_Event)(e));
+
+            if(pRow != NULL)
+            {
+                s32_Errors += Check(pRow->CurrentState, pRow->Event, pRow->NextState);
+                u32_Rows++;
+            }
+            else
+            {
+                s32_Errors += Check((MainApp_State)(s), (MainApp_Event)(e), (MainApp_State)(s));
+                u32_Ignored[s]++;
+            }
+        }
+    }
+
+    //Explicit invalid events. Each state must ignore at least one event.
+    for(size_t i = 0; i < sizeof(s_Invalid) / sizeof(s_Invalid[0]); i++)
+    {
+        if(Expected_Find(s_Invalid[i].State, s_Invalid[i].Event) != NULL)
+        {
+            printf("FAIL %s/%s is listed as valid and invalid\n", MAS_State_to_str(s_Invalid[i].State), MAS_Event_to_str(s_Invalid[i].Event));
+            s32_Errors++;
+        }
+        s32_Errors += Check(s_Invalid[i].State, s_Invalid[i].Event, s_Invalid[i].State);
+    }
+
+    for(int s = 0; s < MAS_Num_States; s++)
+    {
+        bool b_Listed = false;
+
+        for(size_t i = 0; i < sizeof(s_Invalid) / sizeof(s_Invalid[0]); i++)
+            b_Listed = b_Listed || (s_Invalid[i].State == (MainApp_State)(s));
+
+        if(b_Listed == false || u32_Ignored[s] == 0 || strncmp(MAS_State_to_str((MainApp_State)(s)), "MAS_", 4) != 0)
+        {
+            printf("FAIL state %d has no invalid event or no name\n", s);
+            s32_Errors++;
+        }
+    }
+
+    for(int e = 0; e < MAE_Num_Events; e++)
+    {
+        if(strncmp(MAS_Event_to_str((MainApp_Event)(e)), "MAE_", 4) != 0)
+        {
+            printf("FAIL event %d has no name\n", e);
+            s32_Errors++;
+        }
+    }
+
+    //Table of the module must not hold rows which are not expected
+    if(MAS_TransitionTableSize != (size_t)(u32_Rows))
+    {
+        printf("FAIL MAS_TransitionTable has %zu rows, expected %lu\n", MAS_TransitionTableSize, (unsigned long)(u32_Rows));
+        s32_Errors++;
+    }
+
+    printf("%s: %d states x %d events, %lu transitions, %d errors\n", (s32_Errors == 0) ? "PASS" : "FAIL",
+           MAS_Num_States, MAE_Num_Events, (unsigned long)(u32_Rows), s32_Errors);
+
+    return (s32_Errors == 0) ? 0 : 1;
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/// @brief       Looks up the expected transition of a state/event pair
+/// @param State Current state
+/// @param Event Event
+/// @return      First matching row of s_Expected. NULL if the pair must not cause a transition
+static const MAS_TRANSITION_t *Expected_Find(MainApp_State State, MainApp_Event Event)
+{
+    for(size_t i = 0; i < sizeof(s_Expected) / sizeof(s_Expected[0]); i++)
+    {
+        if(s_Expected[i].CurrentState == State && s_Expected[i].Event == Event)
+            return &s_Expected[i];
+    }
+
+    return NULL;
+}
+
+
+/// @brief          Runs one state/event pair through MAS_Handle_Transition(..)
+/// @param State    Current state
+/// @param Event    Event
+/// @param Expected Expected next state
+/// @return         0 on success, 1 on mismatch
+static int Check(MainApp_State State, MainApp_Event Event, MainApp_State Expected)
+{
+    MainApp_State Next = MAS_Handle_Transition(State, Event);
+
+    if(Next != Expected)
+    {
+        printf("FAIL %s --%s--> %s, expected %s\n", MAS_State_to_str(State), MAS_Event_to_str(Event),
+               MAS_State_to_str(Next), MAS_State_to_str(Expected));
+        return 1;
+    }
+
+    if(b_Verbose == true)
+        printf("ok   %s --%s--> %s\n", MAS_State_to_str(State), MAS_Event_to_str(Event), MAS_State_to_str(Next));
+
+    return 0;
+}
+
+
+/*****************************END OF FILE**************************************/
@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""Minimal MQTT 3.1.1 broker over TLS for testing mqtts with session resumption (APP_MQTT_TLS).
+
+Not a real broker: publishes are acknowledged and printed, nothing is forwarded.
+Every connect shows the TLS handshake as "full" or "resumed", so the session
+cache of mod_backend_tls.c can be checked without a broker installation.
+TLS 1.2 with session tickets and session IDs, as offered by esp-tls.
+
+    python3 tools/tls_broker/tls_broker.py --make-certs            # certs/mqtt_ca.pem, broker.pem, broker.key
+    python3 tools/tls_broker/tls_broker.py                         # serve on port 8883
+    python3 tools/tls_broker/tls_broker.py --selftest 5            # local client, full vs resumed handshake time
+
+Set APP_MQTT_TLS_COMMON_NAME to the --cn of the certificate (default mqtt-broker).
+"""
+
+import argparse
+import asyncio
+import os
+import socket
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+REPO_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+CERTS_DIR = os.path.join(REPO_DIR, "certs")
+
+CONNECT, CONNACK, PUBLISH, PUBACK, PUBREC, PUBREL, PUBCOMP = 1, 2, 3, 4, 5, 6, 7
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 12, 13, 14
+
+
+def make_certs(certs_dir, cn, days):
+    """Creates a test CA and a broker certificate signed by it with the openssl CLI"""
+    os.makedirs(certs_dir, exist_ok=True)
+    path = lambda name: os.path.join(certs_dir, name)
+
+    def openssl(*args):
+        subprocess.run(["openssl"] + list(args), check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+    openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", path("ca.key"))
+    openssl("req", "-x509", "-new", "-key", path("ca.key"), "-sha256", "-days", str(days),
+            "-subj", "/CN=WiFi6_PwrTest test CA", "-out", path("mqtt_ca.pem"))
+    openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", path("broker.key"))
+    openssl("req", "-new", "-key", path("broker.key"), "-subj", "/CN=%s" % cn, "-out", path("broker.csr"))
+
+    with tempfile.NamedTemporaryFile("w", suffix=".ext", delete=False) as ext:
+        ext.write("subjectAltName=DNS:%s\nextendedKeyUsage=serverAuth\n" % cn)
+    try:
+        openssl("x509", "-req", "-in", path("broker.csr"), "-CA", path("mqtt_ca.pem"), "-CAkey", path("ca.key"),
+                "-CAcreateserial", "-days", str(days), "-sha256", "-extfile", ext.name, "-out", path("broker.pem"))
+    finally:
+        os.unlink(ext.name)
+
+    print("CA %s, broker certificate %s (CN %s)" % (path("mqtt_ca.pem"), path("broker.pem"), cn))
+
+
+def server_context(certs_dir):
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.load_cert_chain(os.path.join(certs_dir, "broker.pem"), os.path.join(certs_dir, "broker.key"))
+    # Resumption in mod_backend_tls.c is detected with the TLS 1.2 master secret
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+    return ctx
+
+
+def encode_remaining_length(length):
+    out = bytearray()
+    while True:
+        byte, length = length % 128, length // 128
+        out.append(byte | (0x80 if length else 0))
+        if not length:
+            return bytes(out)
+
+
+def packet(ptype, flags, body=b""):
+    return bytes([(ptype << 4) | flags]) + encode_remaining_length(len(body)) + body
+
+
+async def read_packet(reader):
+    """Returns (type, flags, body) of the next MQTT packet"""
+    first = (await reader.readexactly(1))[0]
+    length, shift = 0, 0
+    while True:
+        byte = (await reader.readexactly(1))[0]
+        length |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    return first >> 4, first & 0x0F, await reader.readexactly(length)
+
+
+class Broker:
+    def __init__(self, quiet=False):
+        self.sessions = set()                           # client IDs with a persistent session
+        self.quiet = quiet
+
+    def log(self, text):
+        if not self.quiet:
+            print("%s %s" % (time.strftime("%H:%M:%S"), text), flush=True)
+
+    async def client(self, reader, writer):
+        ssl_object = writer.get_extra_info("ssl_object")
+        peer = "%s:%d" % writer.get_extra_info("peername")[:2]
+        self.log("%s TLS %s, %s handshake" % (peer, ssl_object.version(),
+                                               "resumed" if ssl_object.session_reused else "full"))
+        try:
+            while True:
+                ptype, flags, body = await read_packet(reader)
+
+                if ptype == CONNECT:
+                    name_len = struct.unpack(">H", body[:2])[0]
+                    connect_flags = body[2 + name_len + 1]
+                    id_len = struct.unpack(">H", body[2 + name_len + 4:2 + name_len + 6])[0]
+                    client_id = body[2 + name_len + 6:2 + name_len + 6 + id_len].decode(errors="replace")
+                    clean = bool(connect_flags & 0x02)
+                    present = (not clean) and client_id in self.sessions
+                    if clean:
+                        self.sessions.discard(client_id)
+                    else:
+                        self.sessions.add(client_id)
+                    self.log("%s CONNECT %s, clean session %d, session present %d" % (peer, client_id, clean, present))
+                    writer.write(packet(CONNACK, 0, bytes([1 if present else 0, 0])))
+
+                elif ptype == PUBLISH:
+                    qos = (flags >> 1) & 0x03
+                    topic_len = struct.unpack(">H", body[:2])[0]
+                    topic = body[2:2 + topic_len].decode(errors="replace")
+                    pos = 2 + topic_len
+                    msg_id = body[pos:pos + 2] if qos else b""
+                    self.log("%s PUBLISH %s QoS %d, %d bytes" % (peer, topic, qos, len(body) - pos - len(msg_id)))
+                    if qos == 1:
+                        writer.write(packet(PUBACK, 0, msg_id))
+                    elif qos == 2:
+                        writer.write(packet(PUBREC, 0, msg_id))
+
+                elif ptype == PUBREL:
+                    writer.write(packet(PUBCOMP, 0, body[:2]))
+
+                elif ptype == SUBSCRIBE:
+                    granted, pos = bytearray(), 2
+                    while pos < len(body):
+                        topic_len = struct.unpack(">H", body[pos:pos + 2])[0]
+                        granted.append(body[pos + 2 + topic_len] & 0x03)
+                        pos += 3 + topic_len
+                    writer.write(packet(SUBACK, 0, body[:2] + bytes(granted)))
+
+                elif ptype == PINGREQ:
+                    writer.write(packet(PINGRESP, 0))
+
+                elif ptype == DISCONNECT:
+                    self.log("%s DISCONNECT" % peer)
+                    break
+
+                await writer.drain()
+
+        except (asyncio.IncompleteReadError, ConnectionError, ssl.SSLError):
+            self.log("%s connection lost" % peer)
+        finally:
+            writer.close()
+
+    async def serve(self, host, port, ctx, started=None):
+        server = await asyncio.start_server(self.client, host, port, ssl=ctx)
+        if started is not None:
+            started.port = server.sockets[0].getsockname()[1]
+            started.set()
+        self.log("Listening on %s:%d" % (host, server.sockets[0].getsockname()[1]))
+        async with server:
+            await server.serve_forever()
+
+
+def selftest(certs_dir, cn, count):
+    """Connects count times with session reuse and prints the handshake times"""
+    started = threading.Event()
+    broker = Broker(quiet=True)
+    threading.Thread(target=lambda: asyncio.run(broker.serve("127.0.0.1", 0, server_context(certs_dir), started)),
+                     daemon=True).start()
+    started.wait(5)
+
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.load_verify_locations(os.path.join(certs_dir, "mqtt_ca.pem"))
+    session, times = None, {"full": [], "resumed": []}
+
+    client_id = b"selftest"
+    connect = packet(CONNECT, 0, b"\x00\x04MQTT\x04\x00\x00\x3c" + struct.pack(">H", len(client_id)) + client_id)
+    publish = packet(PUBLISH, 2, b"\x00\x04test\x00\x01payload")
+
+    for _ in range(count):
+        start = time.perf_counter()
+        sock = ctx.wrap_socket(socket.create_connection(("127.0.0.1", started.port)), server_hostname=cn, session=session)
+        elapsed_ms = (time.perf_counter() - start) * 1000
+        kind = "resumed" if sock.session_reused else "full"
+        times[kind].append(elapsed_ms)
+
+        sock.sendall(connect + publish)
+        acks = b""
+        while len(acks) < 8:                            # CONNACK and PUBACK
+            chunk = sock.recv(64)
+            if not chunk:
+                break
+            acks += chunk
+        if acks[:1] != bytes([CONNACK << 4]) or bytes([PUBACK << 4]) not in acks[4:]:
+            sys.exit("selftest: unexpected reply %s" % acks.hex())
+        sock.sendall(packet(DISCONNECT, 0))
+        session = sock.session
+        sock.close()
+        print("%-7s handshake %6.2f ms" % (kind, elapsed_ms))
+
+    for kind, values in times.items():
+        if values:
+            print("%-7s %d x %.2f ms avg" % (kind, len(values), sum(values) / len(values)))
+    if count > 1 and not times["resumed"]:
+        sys.exit("selftest: no session was resumed")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Minimal MQTT broker over TLS with session resumption")
+    parser.add_argument("--certs", default=CERTS_DIR, help="directory of mqtt_ca.pem, broker.pem and broker.key")
+    parser.add_argument("--cn", default="mqtt-broker", help="common name of the broker certificate")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8883)
+    parser.add_argument("--make-certs", action="store_true", help="create the test CA and the broker certificate")
+    parser.add_argument("--days", type=int, default=3650, help="validity of the created certificates")
+    parser.add_argument("--selftest", type=int, metavar="N", help="connect N times from a local client and exit")
+    args = parser.parse_args()
+
+    if args.make_certs:
+        make_certs(args.certs, args.cn, args.days)
+        return
+    if args.selftest:
+        selftest(args.certs, args.cn, args.selftest)
+        return
+
+    try:
+        asyncio.run(Broker().serve(args.host, args.port, server_context(args.certs)))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()